@@ -1,6 +1,6 @@
 # we are going to build an app
 TARGET=app.bin
-CONFIG+=c++11
+CONFIG+=c++14
 # qt 5 wants this may cause errors with 4
 isEqual(QT_MAJOR_VERSION, 5) {cache() }
 QT += core
@@ -0,0 +1,228 @@
+#include <iostream>
+#include <cmath>
+#include "distributedMatrix.h"
+#include <gtest/gtest.h>
+
+/// Tests for matrices distributed over local processes. Every process checks its own results and throws if they
+/// are wrong, launchProcesses then returns false.
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
+
+// throws if _ok is false, used inside the worker processes
+void check(bool _ok)
+{
+    if(!_ok)
+    {
+      throw std::runtime_error("check failed");
+    }
+}
+
+double valueA(std::size_t _row, std::size_t _col) { return double(int(_row*3 + _col*7) % 11) - 5.0; }
+double valueB(std::size_t _row, std::size_t _col) { return double(int(_row*5 + _col*2) % 13) - 6.0; }
+double valueL(std::size_t _row, std::size_t _col) { return std::sin(double(_row*_row + 3*_col) * 0.37) * 4.0; }
+
+TEST(ProcessGroup,AllReduce)
+{
+    bool ok = launchProcesses(4,1024,[](ProcessGroup& _group)
+    {
+      int total = _group.allReduce(_group.rank()+1,[](int _x, int _y) { return _x + _y; });
+      check(total == 10);
+      int largest = _group.allReduce(_group.rank(),[](int _x, int _y) { return std::max(_x,_y); });
+      check(largest == 3);
+    });
+
+    EXPECT_TRUE(ok);
+
+}
+
+TEST(ProcessGroup,NamedSegment)
+{
+    const std::string name = "/mylibDistributedTesting";
+    ProcessGroup group = ProcessGroup::create(name,2,64);
+
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+      int status = 0;
+      try
+      {
+        ProcessGroup joined = ProcessGroup::attach(name,1);
+        check(joined.allReduce(5,[](int _x, int _y) { return _x * _y; }) == 15);
+      }
+      catch(...)
+      {
+        status = 1;
+      }
+      _exit(status);
+    }
+
+    int product = group.allReduce(3,[](int _x, int _y) { return _x * _y; });
+    int status = 0;
+    waitpid(pid,&status,0);
+    ProcessGroup::unlink(name);
+
+    EXPECT_EQ(product,15);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+}
+
+TEST(DistributedMatrix,Distribution)
+{
+    bool ok = launchProcesses(6,64*1024,[](ProcessGroup& _group)
+    {
+      DistributedMatrix<double> a(_group,13,11,2,2,3);
+      a.fill(valueA);
+
+      // every value is held by exactly one process
+      std::size_t held = _group.allReduce(a.localRows()*a.localCols(),[](std::size_t _x, std::size_t _y) { return _x + _y; });
+      check(held == 13*11);
+
+      std::vector<double> all = a.gather();
+      for(std::size_t i=0; i<13; i++)
+      {
+        for(std::size_t j=0; j<11; j++)
+        {
+          check(all[i*11+j] == valueA(i+1,j+1));
+        }
+      }
+    });
+
+    EXPECT_TRUE(ok);
+
+}
+
+TEST(DistributedMatrix,Summa)
+{
+    bool ok = launchProcesses(4,64*1024,[](ProcessGroup& _group)
+    {
+      DistributedMatrix<double> a(_group,13,11,3,2,2);
+      DistributedMatrix<double> b(_group,11,9,3,2,2);
+      DistributedMatrix<double> c(_group,13,9,3,2,2);
+      a.fill(valueA);
+      b.fill(valueB);
+
+      summa(a,b,c);
+
+      std::vector<double> result = c.gather();
+      for(std::size_t i=0; i<13; i++)
+      {
+        for(std::size_t j=0; j<9; j++)
+        {
+          double expected = 0;
+          for(std::size_t k=0; k<11; k++)
+          {
+            expected += valueA(i+1,k+1) * valueB(k+1,j+1);
+          }
+          check(result[i*9+j] == expected);
+        }
+      }
+    });
+
+    EXPECT_TRUE(ok);
+
+}
+
+TEST(DistributedMatrix,LUDecomposition)
+{
+    bool ok = launchProcesses(6,64*1024,[](ProcessGroup& _group)
+    {
+      const std::size_t n = 17;
+      DistributedMatrix<double> a(_group,n,n,2,3,2);
+      a.fill(valueL);
+
+      std::vector<std::size_t> pivots = luDecompose(a);
+      std::vector<double> lu = a.gather();
+
+      // apply the row swaps to the original matrix
+      std::vector<double> pa(n*n);
+      for(std::size_t i=0; i<n; i++)
+      {
+        for(std::size_t j=0; j<n; j++)
+        {
+          pa[i*n+j] = valueL(i+1,j+1);
+        }
+      }
+      for(std::size_t k=0; k<n; k++)
+      {
+        for(std::size_t j=0; j<n; j++)
+        {
+          std::swap(pa[k*n+j],pa[pivots[k]*n+j]);
+        }
+      }
+
+      // P*A must equal L*U
+      for(std::size_t i=0; i<n; i++)
+      {
+        for(std::size_t j=0; j<n; j++)
+        {
+          double sum = 0;
+          for(std::size_t k=0; k<=std::min(i,j); k++)
+          {
+            double l = k == i ? 1.0 : lu[i*n+k];
+            sum += l * lu[k*n+j];
+          }
+          check(std::abs(sum - pa[i*n+j]) < 1e-9);
+        }
+      }
+    });
+
+    EXPECT_TRUE(ok);
+
+}
+
+TEST(DistributedMatrix,LUSingular)
+{
+    bool ok = launchProcesses(4,64*1024,[](ProcessGroup& _group)
+    {
+      DistributedMatrix<double> a(_group,6,6,2,2,2);
+      // every row is the same
+      a.fill([](std::size_t, std::size_t _col) { return double(_col); });
+
+      bool thrown = false;
+      try
+      {
+        luDecompose(a);
+      }
+      catch(const std::out_of_range&)
+      {
+        thrown = true;
+      }
+      check(thrown);
+    });
+
+    EXPECT_TRUE(ok);
+
+}
+
+TEST(DistributedMatrix,SlotTooSmall)
+{
+    // every process throws before exchanging anything, so none are left waiting at a barrier
+    bool ok = launchProcesses(4,64,[](ProcessGroup& _group)
+    {
+      DistributedMatrix<double> a(_group,13,11,3,2,2);
+      DistributedMatrix<double> b(_group,11,9,3,2,2);
+      DistributedMatrix<double> c(_group,13,9,3,2,2);
+      summa(a,b,c);
+    });
+    EXPECT_FALSE(ok);
+
+    ok = launchProcesses(4,64,[](ProcessGroup& _group)
+    {
+      DistributedMatrix<double> a(_group,16,16,2,2,2);
+      luDecompose(a);
+    });
+    EXPECT_FALSE(ok);
+
+    ok = launchProcesses(4,64,[](ProcessGroup& _group)
+    {
+      DistributedMatrix<double> a(_group,13,11,3,2,2);
+      a.gather();
+    });
+    EXPECT_FALSE(ok);
+
+}
@@ -0,0 +1,20 @@
+TARGET = app.bin
+
+CONFIG += console c++14
+CONFIG -= app_bundle
+CONFIG -= qt
+
+INCLUDEPATH+=../../include
+DEPENDPATH+=../../include
+
+LIBS+= -lgtest \
+        -lpthread \
+        -lrt \
+        -L../../lib -lmyLib
+
+QMAKE_RPATHDIR+=../../lib
+
+SOURCES += \
+    distributedTesting.cpp
+
+OTHER_FILES+=$$PWD/app
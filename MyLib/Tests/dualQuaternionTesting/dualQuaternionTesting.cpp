@@ -0,0 +1,315 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "dualQuaternion.h"
+#include <gtest/gtest.h>
+
+/// Tests for dual quaternions and dual quaternion skinning.
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
+
+// unit quaternion of angle _angle about the (not normalized) axis _x,_y,_z
+template <typename T>
+Quaternion<T> axisAngle(T _x, T _y, T _z, T _angle)
+{
+    T length = std::sqrt(_x*_x + _y*_y + _z*_z);
+    T s = std::sin(_angle/2)/length;
+    return Quaternion<T>(std::cos(_angle/2), _x*s, _y*s, _z*s);
+}
+
+template <typename T>
+Matrix<T,3,1> vector3(T _x, T _y, T _z)
+{
+    Matrix<T,3,1> v;
+    v.data()[0] = _x;
+    v.data()[1] = _y;
+    v.data()[2] = _z;
+    return v;
+}
+
+// largest difference between two vectors
+template <typename T>
+T vectorError(const Matrix<T,3,1>& _v, const Matrix<T,3,1>& _expected)
+{
+    T error = 0;
+    for(std::size_t i = 0; i < 3; ++i)
+    {
+        error = std::max(error, std::abs(_v.data()[i] - _expected.data()[i]));
+    }
+    return error;
+}
+
+// _n joint transforms, rotations about different axes with translations
+template <typename T>
+std::vector< DualQuaternion<T> > examplePose(std::size_t _n)
+{
+    std::vector< DualQuaternion<T> > pose;
+    for(std::size_t j = 0; j < _n; ++j)
+    {
+        Quaternion<T> rotation = axisAngle<T>(T(0.3)+j, T(1)-T(0.2)*j, T(0.5), T(0.4)*j - T(1));
+        // every third joint is stored with the opposite sign, the same rotation
+        if(j % 3 == 2)
+        {
+            rotation * T(-1);
+        }
+        pose.push_back(DualQuaternion<T>(rotation, vector3<T>(T(0.5)*j, T(1)-j, T(0.25))));
+    }
+    return pose;
+}
+
+TEST(DualQuaternion,RigidTransform)
+{
+    Matrix<double,3,1> p = vector3(1.0, -2.0, 0.5);
+
+    DualQuaternion<double> identity;
+    EXPECT_LT(vectorError(identity.transformPoint(p), p), 1e-15);
+
+    Quaternion<double> rotation = axisAngle(1.0, 2.0, -0.5, 1.1);
+    Matrix<double,3,1> t = vector3(3.0, 0.25, -4.0);
+    DualQuaternion<double> dq(rotation, t);
+
+    EXPECT_LT(vectorError(dq.translation(), t), 1e-14);
+
+    Matrix<double,3,1> expected = rotation.rotate(p);
+    EXPECT_LT(vectorError(dq.transformVector(p), expected), 1e-14);
+    for(std::size_t i = 0; i < 3; ++i)
+    {
+        expected.data()[i] += t.data()[i];
+    }
+    EXPECT_LT(vectorError(dq.transformPoint(p), expected), 1e-14);
+}
+
+TEST(DualQuaternion,Composition)
+{
+    DualQuaternion<double> first(axisAngle(0.0, 0.0, 1.0, 0.7), vector3(1.0, 2.0, 3.0));
+    DualQuaternion<double> second(axisAngle(1.0, 1.0, 0.0, -1.3), vector3(-0.5, 0.0, 2.0));
+    Matrix<double,3,1> p = vector3(0.3, -1.0, 2.0);
+
+    // the product applies the right hand transform first
+    DualQuaternion<double> composed(second);
+    composed * first;
+    EXPECT_LT(vectorError(composed.transformPoint(p), second.transformPoint(first.transformPoint(p))), 1e-14);
+
+    // composing with the conjugate undoes a unit transform
+    DualQuaternion<double> inverse(composed);
+    inverse.conjugate();
+    EXPECT_LT(vectorError(inverse.transformPoint(composed.transformPoint(p)), p), 1e-14);
+
+    // self composition applies the transform twice
+    DualQuaternion<double> twice(first);
+    twice * twice;
+    EXPECT_LT(vectorError(twice.transformPoint(p), first.transformPoint(first.transformPoint(p))), 1e-14);
+}
+
+TEST(DualQuaternion,Normalize)
+{
+    Quaternion<double> rotation = axisAngle(-1.0, 0.5, 2.0, 2.3);
+    Matrix<double,3,1> t = vector3(-1.0, 4.0, 0.5);
+    DualQuaternion<double> dq(rotation, t);
+
+    // scaled and with some of the real part added to the dual part, a blend can give both
+    DualQuaternion<double> drifted(dq);
+    drifted.dual() + (Quaternion<double>(rotation) * 0.1);
+    drifted * 2.5;
+    drifted.normalize();
+
+    EXPECT_NEAR(drifted.real().norm(), 1.0, 1e-15);
+    EXPECT_NEAR(drifted.real().dot(drifted.dual()), 0.0, 1e-15);
+    EXPECT_LT(vectorError(drifted.translation(), t), 1e-14);
+
+    // a zero dual quaternion is left alone rather than divided by zero
+    Quaternion<double> zeroPart;
+    DualQuaternion<double> zero(zeroPart, zeroPart);
+    zero.normalize();
+    EXPECT_TRUE(zero == DualQuaternion<double>(zeroPart, zeroPart));
+}
+
+TEST(DualQuaternion,Matrix)
+{
+    DualQuaternion<float> dq(axisAngle(0.2f, -1.0f, 0.4f, 2.9f), vector3(5.0f, -6.0f, 7.0f));
+    Matrix<float,4,4> mat = dq.toMatrix4();
+    Matrix<float,4,4> rotation = dq.real().toMatrix4();
+
+    for(std::size_t r = 0; r < 4; ++r)
+    {
+        for(std::size_t c = 0; c < 3; ++c)
+        {
+            EXPECT_EQ(mat.data()[r*4+c], rotation.data()[r*4+c]);
+        }
+    }
+    EXPECT_NEAR(mat.data()[3], 5.0f, 1e-5f);
+    EXPECT_NEAR(mat.data()[7], -6.0f, 1e-5f);
+    EXPECT_NEAR(mat.data()[11], 7.0f, 1e-5f);
+    EXPECT_EQ(mat.data()[15], 1.0f);
+
+    // the round trip can come back with the opposite sign, so compare what it does to a point
+    DualQuaternion<float> back = DualQuaternion<float>::fromMatrix(mat);
+    Matrix<float,3,1> p = vector3(1.0f, 2.0f, -3.0f);
+    EXPECT_LT(vectorError(back.transformPoint(p), dq.transformPoint(p)), 1e-5f);
+    EXPECT_GE(back.real().a(), 0.0f);
+}
+
+// a mesh of _n vertices bound to _influences of _joints joints each, the arrays are kept in the vectors
+template <typename T>
+SkinnedMesh<T> exampleMesh(std::size_t _n, std::size_t _influences, std::size_t _joints,
+                           std::vector< Matrix<T,3,1> >& _positions, std::vector< Matrix<T,3,1> >& _normals,
+                           std::vector<unsigned int>& _indices, std::vector<T>& _weights,
+                           std::vector< Matrix<T,3,1> >& _outPositions, std::vector< Matrix<T,3,1> >& _outNormals)
+{
+    _positions.clear();
+    _normals.clear();
+    _indices.clear();
+    _weights.clear();
+    for(std::size_t i = 0; i < _n; ++i)
+    {
+        _positions.push_back(vector3<T>(std::sin(T(0.1)*i), T(0.01)*i, std::cos(T(0.3)*i)));
+        _normals.push_back(vector3<T>(T(0), T(1), T(0)));
+        T total = 0;
+        for(std::size_t k = 0; k < _influences; ++k)
+        {
+            _indices.push_back(static_cast<unsigned int>((i + 2*k) % _joints));
+            _weights.push_back(T(1) + T((i*7 + k*3) % 5));
+            total += _weights.back();
+        }
+        for(std::size_t k = 0; k < _influences; ++k)
+        {
+            _weights[i*_influences + k] /= total;
+        }
+    }
+    _outPositions.assign(_n, Matrix<T,3,1>());
+    _outNormals.assign(_n, Matrix<T,3,1>());
+
+    SkinnedMesh<T> mesh;
+    mesh.vertices = _n;
+    mesh.influences = _influences;
+    mesh.positions = _positions.data();
+    mesh.normals = _normals.data();
+    mesh.joints = _indices.data();
+    mesh.weights = _weights.data();
+    mesh.outPositions = _outPositions.data();
+    mesh.outNormals = _outNormals.data();
+    return mesh;
+}
+
+TEST(DualQuaternionSkinning,SingleInfluence)
+{
+    std::vector< DualQuaternion<double> > pose = examplePose<double>(5);
+    std::vector< Matrix<double,3,1> > positions, normals, outPositions, outNormals;
+    std::vector<unsigned int> indices;
+    std::vector<double> weights;
+    SkinnedMesh<double> mesh = exampleMesh(20, 1, 5, positions, normals, indices, weights, outPositions, outNormals);
+    mesh.pose = pose.data();
+
+    skinVertices(mesh);
+    for(std::size_t i = 0; i < mesh.vertices; ++i)
+    {
+        const DualQuaternion<double>& joint = pose[indices[i]];
+        EXPECT_LT(vectorError(outPositions[i], joint.transformPoint(positions[i])), 1e-14);
+        EXPECT_LT(vectorError(outNormals[i], joint.transformVector(normals[i])), 1e-14);
+    }
+
+    mesh.influences = 0;
+    EXPECT_THROW(skinVertices(mesh), std::out_of_range);
+}
+
+TEST(DualQuaternionSkinning,Antipodal)
+{
+    // q and -q are the same joint transform, blending them has to give that transform rather than cancelling
+    DualQuaternion<float> joint(axisAngle(1.0f, 0.0f, 1.0f, 1.2f), vector3(0.0f, 2.0f, -1.0f));
+    DualQuaternion<float> flipped(joint);
+    flipped * -1.0f;
+    std::vector< DualQuaternion<float> > pose = {joint, flipped};
+
+    std::vector< Matrix<float,3,1> > positions, normals, outPositions, outNormals;
+    std::vector<unsigned int> indices;
+    std::vector<float> weights;
+    SkinnedMesh<float> mesh = exampleMesh(11, 2, 2, positions, normals, indices, weights, outPositions, outNormals);
+    mesh.pose = pose.data();
+
+    skinVertices(mesh);
+    for(std::size_t i = 0; i < mesh.vertices; ++i)
+    {
+        EXPECT_LT(vectorError(outPositions[i], joint.transformPoint(positions[i])), 1e-5f);
+    }
+}
+
+TEST(DualQuaternionSkinning,FloatMatchesDouble)
+{
+    const std::size_t joints = 7;
+    std::vector< DualQuaternion<float> > pose = examplePose<float>(joints);
+    std::vector< DualQuaternion<double> > poseDouble = examplePose<double>(joints);
+
+    // 37 vertices leaves a partial block for every SimdFloat width
+    std::vector< Matrix<float,3,1> > positions, normals, outPositions, outNormals;
+    std::vector<unsigned int> indices;
+    std::vector<float> weights;
+    SkinnedMesh<float> mesh = exampleMesh(37, 3, joints, positions, normals, indices, weights, outPositions, outNormals);
+    mesh.pose = pose.data();
+
+    std::vector< Matrix<double,3,1> > positionsDouble, normalsDouble, outPositionsDouble, outNormalsDouble;
+    std::vector<unsigned int> indicesDouble;
+    std::vector<double> weightsDouble;
+    SkinnedMesh<double> meshDouble = exampleMesh(37, 3, joints, positionsDouble, normalsDouble, indicesDouble,
+                                                 weightsDouble, outPositionsDouble, outNormalsDouble);
+    meshDouble.pose = poseDouble.data();
+
+    skinVertices(mesh);
+    skinVertices(meshDouble);
+    for(std::size_t i = 0; i < mesh.vertices; ++i)
+    {
+        for(std::size_t c = 0; c < 3; ++c)
+        {
+            EXPECT_NEAR(outPositions[i].data()[c], outPositionsDouble[i].data()[c], 1e-5);
+            EXPECT_NEAR(outNormals[i].data()[c], outNormalsDouble[i].data()[c], 1e-5);
+        }
+    }
+
+    // without normals only the positions are written
+    mesh.normals = nullptr;
+    std::vector< Matrix<float,3,1> > untouched(outNormals.size());
+    mesh.outNormals = untouched.data();
+    skinVertices(mesh);
+    EXPECT_TRUE((untouched[0] == Matrix<float,3,1>()));
+}
+
+TEST(DualQuaternionSkinning,Meshes)
+{
+    // enough meshes and vertices to be split across threads
+    const std::size_t meshes = 6;
+    const std::size_t vertices = 12001;
+    std::vector< DualQuaternion<float> > pose = examplePose<float>(9);
+
+    std::vector< std::vector< Matrix<float,3,1> > > positions(meshes), normals(meshes), outPositions(meshes),
+                                                    outNormals(meshes);
+    std::vector< std::vector<unsigned int> > indices(meshes);
+    std::vector< std::vector<float> > weights(meshes);
+    std::vector< SkinnedMesh<float> > skinned;
+    for(std::size_t m = 0; m < meshes; ++m)
+    {
+        skinned.push_back(exampleMesh(vertices + m, 4, 9, positions[m], normals[m], indices[m], weights[m],
+                                      outPositions[m], outNormals[m]));
+        skinned.back().pose = pose.data();
+    }
+
+    setParallelThreads(4);
+    skinMeshes(skinned.size(), skinned.data());
+    setParallelThreads(0);
+
+    for(std::size_t m = 0; m < meshes; ++m)
+    {
+        std::vector< Matrix<float,3,1> > expected(skinned[m].vertices);
+        SkinnedMesh<float> single = skinned[m];
+        single.outPositions = expected.data();
+        single.normals = nullptr;
+        skinVertices(single);
+        for(std::size_t i = 0; i < skinned[m].vertices; i += 97)
+        {
+            EXPECT_TRUE(outPositions[m][i] == expected[i]);
+        }
+    }
+}
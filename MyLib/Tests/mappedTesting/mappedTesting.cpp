@@ -0,0 +1,226 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include "mappedMatrix.h"
+#include "matrixChain.h"
+#include "matrixReductions.h"
+#include <gtest/gtest.h>
+
+/// Tests for file backed tiled matrices.
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
+
+// temporary file name that is removed at the end of the test
+struct TempFile
+{
+    std::string path;
+
+    TempFile()
+    {
+      char name[] = "/tmp/mappedTestingXXXXXX";
+      int file = mkstemp(name);
+      close(file);
+      path = name;
+    }
+
+    ~TempFile() { std::remove(path.c_str()); }
+};
+
+// fills a matrix with small distinct values
+template <size_t ROWS, size_t COLS>
+void fill(Matrix<double,ROWS,COLS>& _mat)
+{
+    for(size_t i=0; i<ROWS*COLS; i++)
+    {
+      _mat.data()[i] = double(int(i*7 % 23) - 11);
+    }
+}
+
+TEST(MappedMatrix,CreateLoadStore)
+{
+    TempFile file;
+    Matrix<double,37,21>* dense = new Matrix<double,37,21>;
+    Matrix<double,37,21>* back = new Matrix<double,37,21>;
+    fill(*dense);
+
+    {
+      MappedMatrix<double> mat = MappedMatrix<double>::create(file.path,37,21,16);
+      EXPECT_TRUE(mat.tileRows() == 3);
+      EXPECT_TRUE(mat.tileCols() == 2);
+      mat.load(*dense);
+      mat.flush();
+    }
+
+    MappedMatrix<double> mat = MappedMatrix<double>::open(file.path);
+    EXPECT_TRUE(mat.getRows() == 37);
+    EXPECT_TRUE(mat.getCols() == 21);
+    mat.store(*back);
+    EXPECT_TRUE(*back == *dense);
+    EXPECT_EQ(mat(37,21),(*dense)(37,21));
+    EXPECT_THROW(mat(38,1),std::out_of_range);
+    EXPECT_THROW(MappedMatrix<float>::open(file.path),std::runtime_error);
+
+    delete dense;
+    delete back;
+
+}
+
+TEST(MappedMatrix,Multiply)
+{
+    TempFile fileA;
+    TempFile fileB;
+    TempFile fileC;
+    Matrix<double,45,30>* a = new Matrix<double,45,30>;
+    Matrix<double,30,50>* b = new Matrix<double,30,50>;
+    Matrix<double,45,50>* c = new Matrix<double,45,50>;
+    fill(*a);
+    fill(*b);
+
+    MappedMatrix<double> ma = MappedMatrix<double>::create(fileA.path,45,30,16);
+    MappedMatrix<double> mb = MappedMatrix<double>::create(fileB.path,30,50,16);
+    MappedMatrix<double> mc = MappedMatrix<double>::create(fileC.path,45,50,16);
+    ma.load(*a);
+    mb.load(*b);
+
+    setParallelThreads(3);
+    multiply(ma,mb,mc);
+    setParallelThreads(0);
+    mc.store(*c);
+
+    Matrix<double,45,50>* expected = new Matrix<double,45,50>(multiplyPair(*a,*b));
+    EXPECT_TRUE(*c == *expected);
+
+    EXPECT_THROW(multiply(ma,ma,mc),std::out_of_range);
+
+    delete a;
+    delete b;
+    delete c;
+    delete expected;
+
+}
+
+TEST(MappedMatrix,TransposeAndReductions)
+{
+    TempFile fileA;
+    TempFile fileB;
+    Matrix<double,45,30>* a = new Matrix<double,45,30>;
+    Matrix<double,30,45>* b = new Matrix<double,30,45>;
+    fill(*a);
+
+    MappedMatrix<double> ma = MappedMatrix<double>::create(fileA.path,45,30,8);
+    MappedMatrix<double> mb = MappedMatrix<double>::create(fileB.path,30,45,8);
+    ma.load(*a);
+
+    transpose(ma,mb);
+    mb.store(*b);
+
+    Matrix<double,30,45> expected = transposed(*a);
+    EXPECT_TRUE(*b == expected);
+
+    EXPECT_EQ(sum(ma),sum(*a));
+    EXPECT_EQ(maxAbs(ma),maxAbs(*a));
+    EXPECT_NEAR(normFrobenius(ma),normFrobenius(*a),1e-9);
+
+    delete a;
+    delete b;
+
+}
+
+TEST(MappedMatrix,ResultChecks)
+{
+    TempFile fileA;
+    TempFile fileB;
+    TempFile fileC;
+    Matrix<double,20,20>* a = new Matrix<double,20,20>;
+    fill(*a);
+
+    MappedMatrix<double> ma = MappedMatrix<double>::create(fileA.path,20,20,8);
+    MappedMatrix<double> mb = MappedMatrix<double>::create(fileB.path,20,20,8);
+    ma.load(*a);
+    mb.load(*a);
+    ma.flush();
+    {
+      MappedMatrix<double> mc = MappedMatrix<double>::create(fileC.path,20,20,8);
+      EXPECT_TRUE(mc.writable());
+    }
+
+    // a read only result would fault on the first store
+    MappedMatrix<double> readOnly = MappedMatrix<double>::open(fileC.path);
+    EXPECT_FALSE(readOnly.writable());
+    EXPECT_THROW(multiply(ma,mb,readOnly),std::invalid_argument);
+    EXPECT_THROW(transpose(ma,readOnly),std::invalid_argument);
+
+    // the result can't be an input, whether it is the same object or the same file opened again
+    MappedMatrix<double> again = MappedMatrix<double>::open(fileA.path,true);
+    EXPECT_TRUE(again.sameFile(ma));
+    EXPECT_FALSE(again.sameFile(mb));
+    EXPECT_THROW(multiply(ma,mb,ma),std::invalid_argument);
+    EXPECT_THROW(multiply(ma,mb,mb),std::invalid_argument);
+    EXPECT_THROW(multiply(ma,mb,again),std::invalid_argument);
+    EXPECT_THROW(transpose(ma,again),std::invalid_argument);
+
+    // nothing was written
+    Matrix<double,20,20>* back = new Matrix<double,20,20>;
+    ma.store(*back);
+    EXPECT_TRUE(*back == *a);
+
+    // a moved matrix keeps its write access
+    MappedMatrix<double> moved = std::move(again);
+    EXPECT_TRUE(moved.writable());
+    EXPECT_FALSE(again.writable());
+
+    delete a;
+    delete back;
+
+}
+
+// rewrites the header of a mapped matrix file
+void writeHeader(const std::string& _path, const MappedMatrixHeader& _header)
+{
+    int file = open(_path.c_str(),O_RDWR);
+    EXPECT_TRUE(pwrite(file,&_header,sizeof(_header),0) == static_cast<ssize_t>(sizeof(_header)));
+    close(file);
+}
+
+TEST(MappedMatrix,CorruptHeader)
+{
+    TempFile file;
+    {
+      MappedMatrix<double> mat = MappedMatrix<double>::create(file.path,40,20,16);
+    }
+    MappedMatrixHeader good = {{'M','Y','L','I','B','M','A','T'},40,20,16,sizeof(double)};
+    MappedMatrixHeader header = good;
+
+    // a zero tile size would divide by zero
+    header.tileSize = 0;
+    writeHeader(file.path,header);
+    EXPECT_THROW(MappedMatrix<double>::open(file.path),std::runtime_error);
+
+    // sizes that need more or less data than the file holds
+    header = good;
+    header.rows = 100;
+    writeHeader(file.path,header);
+    EXPECT_THROW(MappedMatrix<double>::open(file.path),std::runtime_error);
+
+    header = good;
+    header.cols = 8;
+    writeHeader(file.path,header);
+    EXPECT_THROW(MappedMatrix<double>::open(file.path),std::runtime_error);
+
+    // sizes whose byte count overflows
+    header = good;
+    header.rows = std::uint64_t(1) << 62;
+    header.cols = std::uint64_t(1) << 62;
+    writeHeader(file.path,header);
+    EXPECT_THROW(MappedMatrix<double>::open(file.path),std::runtime_error);
+
+    writeHeader(file.path,good);
+    MappedMatrix<double> mat = MappedMatrix<double>::open(file.path);
+    EXPECT_TRUE(mat.getRows() == 40);
+
+}
@@ -1,5 +1,16 @@
 #include <iostream>
 #include "matrix.h"
+#include "matrixBlas.h"
+#include "matrixChain.h"
+#include "matrixFunctions.h"
+#include "matrixReductions.h"
+#include "matrixMap.h"
+#include "arena.h"
+#include "largeAllocation.h"
+#include "sharedMatrix.h"
+#include "sparseMatrix.h"
+#include <complex>
+#include <thread>
 #include <gtest/gtest.h>
 #include <fstream>
 
@@ -209,6 +220,25 @@ TEST(MatrixOperators,MultiplicationOperator)
 
 }
 
+TEST(MatrixOperators,MultiplicationOperatorNonSquare)
+{
+    // the product keeps the left matrix's layout so elements and a second multiply read it back correctly
+    Matrix<int,2,3> mat{1,0,-2,0,3,-1};
+    Matrix<int,3,2> mat2{0,3,-2,-1,0,4};
+    Matrix<int,3,1> vec{1,2,3};
+    Matrix<int,2,3> result{0,-5,0,-6,-7,0};
+    mat*mat2;
+    EXPECT_TRUE(mat == result);
+    EXPECT_EQ(mat(1,2),-5);
+    EXPECT_EQ(mat(2,1),-6);
+    EXPECT_EQ(mat.getCols(),3);
+
+    Matrix<int,2,3> result2{-10,0,0,-20,0,0};
+    mat*vec;
+    EXPECT_TRUE(mat == result2);
+
+}
+
 TEST(MatrixOperators,MultiplicationOperatorScalar)
 {
     Matrix<int,2,2> mat{1,2,3,4};
@@ -376,21 +406,997 @@ TEST(MatrixFunctions,MinorMatrixUpperBoundary)
 }
 
 
+TEST(MatrixChain,ChainOrderTextbook)
+{
+    // (10x30)(30x5)(5x60) is cheapest as (AB)C, 4500 multiplications
+    typedef MatrixChainOrder<10,30,5,60> Order;
 
+    static_assert(Order::cost() == 4500, "wrong chain cost");
+    EXPECT_TRUE(Order::split(0,2) == 1);
 
+}
 
+TEST(MatrixChain,ChainOrderMatrixVector)
+{
+    // P*V*M*v should be done right to left as three matrix-vector products
+    typedef MatrixChainOrder<4,4,4,4,1> Order;
 
+    static_assert(Order::cost() == 48, "wrong chain cost");
+    EXPECT_TRUE(Order::split(0,3) == 0);
 
+}
 
+TEST(MatrixChain,MultiplyChain)
+{
+    Matrix<int,2,3> mat{1,0,-2,0,3,-1};
+    Matrix<int,3,2> mat2{0,3,-2,-1,0,4};
+    Matrix<int,2,1> vec{1,2};
+    Matrix<int,2,1> result{-10,-20};
 
+    Matrix<int,2,1> chain = multiplyChain(mat,mat2,vec);
 
+    EXPECT_TRUE(chain == result);
 
+}
 
+TEST(MatrixChain,MultiplyChainLeavesInputs)
+{
+    Matrix<int,2,2> mat{1,2,3,4};
+    Matrix<int,2,2> mat2{1,0,0,1};
+    Matrix<int,2,2> original{1,2,3,4};
+    Matrix<int,2,2> result{7,10,15,22};
+
+    Matrix<int,2,2> chain = multiplyChain(mat,mat2,mat);
+
+    EXPECT_TRUE(chain == result);
+    EXPECT_TRUE(mat == original);
+
+}
+
+TEST(MatrixPowers,PowerFunction)
+{
+    Matrix<int,2,2> mat{1,1,1,0};
+    // fibonacci numbers
+    Matrix<int,2,2> result{89,55,55,34};
+
+    Matrix<int,2,2> power = pow(mat,10);
 
+    EXPECT_TRUE(power == result);
+    EXPECT_TRUE(pow(mat,0) == (identityMatrix<int,2>()));
 
+}
+
+TEST(MatrixPowers,PowerFunctionNegative)
+{
+    Matrix<double,3,3> mat{2,0,0,0,4,0,0,0,0.5};
+    Matrix<double,3,3> result{0.125,0,0,0,0.015625,0,0,0,8};
+
+    Matrix<double,3,3> power = pow(mat,-3);
 
+    EXPECT_TRUE(power == result);
 
+}
 
+TEST(MatrixPowers,PowerCache)
+{
+    Matrix<int,2,2> mat{1,1,1,0};
+    MatrixPowers<int,2> powers(mat);
 
+    EXPECT_TRUE(powers.power(10) == pow(mat,10));
+    EXPECT_TRUE(powers.cached() == 4);
+    EXPECT_TRUE(powers.power(5) == pow(mat,5));
+    EXPECT_TRUE(powers.cached() == 4);
 
+}
 
+TEST(MatrixPowers,ExponentialRotation)
+{
+    // e^(theta K) for the cross product matrix K of the z axis is a rotation about z
+    double theta = 0.75;
+    Matrix<double,3,3> mat{0,-theta,0,theta,0,0,0,0,0};
+
+    Matrix<double,3,3> rot = exp(mat);
+
+    EXPECT_NEAR(rot(1,1),cos(theta),1e-12);
+    EXPECT_NEAR(rot(1,2),-sin(theta),1e-12);
+    EXPECT_NEAR(rot(2,1),sin(theta),1e-12);
+    EXPECT_NEAR(rot(2,2),cos(theta),1e-12);
+    EXPECT_NEAR(rot(3,3),1.0,1e-12);
+
+}
+
+TEST(MatrixPowers,ExponentialLargeNorm)
+{
+    Matrix<double,2,2> mat{5,0,0,-3};
+
+    Matrix<double,2,2> result = exp(mat);
+
+    EXPECT_NEAR(result(1,1),std::exp(5.0),1e-10*std::exp(5.0));
+    EXPECT_NEAR(result(2,2),std::exp(-3.0),1e-12);
+    EXPECT_NEAR(result(1,2),0.0,1e-12);
+
+}
+
+TEST(MatrixPowers,LogarithmInverseOfExponential)
+{
+    Matrix<double,4,4> mat{0.1,-0.8,0.3,1.0,
+                           0.8,0.2,-0.5,2.0,
+                           -0.3,0.5,0.0,-1.5,
+                           0.0,0.0,0.0,0.3};
+
+    Matrix<double,4,4> result = log(exp(mat));
+
+    for(int i=1; i<=4; i++)
+    {
+      for(int j=1; j<=4; j++)
+      {
+        EXPECT_NEAR(result(i,j),mat(i,j),1e-9);
+      }
+    }
+
+}
+
+TEST(MatrixPowers,ExponentialLogarithmGeneric)
+{
+    // 5x5 goes through Gaussian elimination rather than the closed form inverse
+    Matrix<double,5,5> mat;
+    for(int i=1; i<=5; i++)
+    {
+      for(int j=1; j<=5; j++)
+      {
+        mat(i,j) = 0.1*((i*j)%3) - 0.05*(i==j);
+      }
+    }
+
+    Matrix<double,5,5> result = log(exp(mat));
+
+    for(int i=1; i<=5; i++)
+    {
+      for(int j=1; j<=5; j++)
+      {
+        EXPECT_NEAR(result(i,j),mat(i,j),1e-9);
+      }
+    }
+
+}
+
+TEST(MatrixPowers,LogarithmNegativeEigenvalue)
+{
+    Matrix<double,2,2> mat{-1,0,0,1};
+
+    EXPECT_THROW(log(mat),std::out_of_range);
+
+}
+
+TEST(MatrixReductions,SumProductMinMax)
+{
+    Matrix<int,2,3> mat{3,-1,4,1,-5,9};
+
+    EXPECT_TRUE(sum(mat) == 11);
+    EXPECT_TRUE(product(mat) == 540);
+    EXPECT_TRUE(min(mat) == -5);
+    EXPECT_TRUE(max(mat) == 9);
+    EXPECT_TRUE(maxAbs(mat) == 9);
+
+}
+
+TEST(MatrixReductions,ArgMinArgMax)
+{
+    Matrix<int,2,3> mat{3,-5,4,1,-5,9};
+
+    // first smallest element is at row 1 column 2
+    EXPECT_TRUE(argMin(mat) == std::make_pair(size_t(1),size_t(2)));
+    EXPECT_TRUE(argMax(mat) == std::make_pair(size_t(2),size_t(3)));
+
+}
+
+TEST(MatrixReductions,Trace)
+{
+    Matrix<int,3,3> mat{1,2,3,4,5,6,7,8,9};
+    Matrix<int,2,3> mat2;
+
+    EXPECT_TRUE(trace(mat) == 15);
+    EXPECT_THROW(trace(mat2),std::out_of_range);
+
+}
+
+TEST(MatrixReductions,Norms)
+{
+    Matrix<double,2,2> mat{1,-2,-3,4};
+
+    EXPECT_DOUBLE_EQ(normFrobenius(mat),sqrt(30.0));
+    EXPECT_DOUBLE_EQ(norm1(mat),6.0);
+    EXPECT_DOUBLE_EQ(normInf(mat),7.0);
+
+}
+
+TEST(MatrixReductions,ComplexNorms)
+{
+    typedef std::complex<double> C;
+    const C i(0,1);
+
+    // moduli are {5,1,0,2}
+    Matrix<C,2,2> mat{C(3,4),i,C(0,0),C(-2,0)};
+
+    EXPECT_TRUE((std::is_same<decltype(maxAbs(mat)),double>::value));
+    EXPECT_TRUE((std::is_same<decltype(normFrobenius(mat)),double>::value));
+    EXPECT_TRUE((std::is_same<decltype(norm1(mat)),double>::value));
+    EXPECT_TRUE((std::is_same<decltype(normInf(mat)),double>::value));
+
+    EXPECT_DOUBLE_EQ(maxAbs(mat),5.0);
+    EXPECT_DOUBLE_EQ(normFrobenius(mat),sqrt(30.0));
+    EXPECT_DOUBLE_EQ(norm1(mat),5.0);
+    EXPECT_DOUBLE_EQ(normInf(mat),6.0);
+
+    Matrix<C,1,2> vec{i,i};
+    EXPECT_DOUBLE_EQ(normFrobenius(vec),sqrt(2.0));
+
+    // a wider accumulator for complex float
+    Matrix<std::complex<float>,1,2> vecf{std::complex<float>(0,1),std::complex<float>(0,1)};
+    EXPECT_DOUBLE_EQ(normFrobenius<double>(vecf),sqrt(2.0));
+
+}
+
+TEST(MatrixReductions,DoubleAccumulation)
+{
+    // adding 0.1f 100000 times loses precision in float but not in double
+    const size_t n = 100000;
+    Matrix<float,n,1>* vec = new Matrix<float,n,1>;
+    for(size_t i=0; i<n; i++)
+    {
+      vec->data()[i] = 0.1f;
+    }
+
+    double total = sum<double>(*vec);
+
+    EXPECT_NEAR(total,10000.0,1e-2);
+
+    delete vec;
+
+}
+
+TEST(MatrixReductions,ParallelMatchesSerial)
+{
+    const size_t n = 600;
+    Matrix<double,n,n>* mat = new Matrix<double,n,n>;
+    for(size_t i=0; i<n*n; i++)
+    {
+      mat->data()[i] = double((i*7919)%1000) - 500.0;
+    }
+    mat->data()[12345] = 1000.0;
+    mat->data()[n*n-1] = -1000.0;
+
+    setParallelThreads(1);
+    double serialSum = sum(*mat);
+    double serialNorm1 = norm1(*mat);
+    double serialNormInf = normInf(*mat);
+
+    setParallelThreads(4);
+    EXPECT_EQ(sum(*mat),serialSum);
+    EXPECT_EQ(norm1(*mat),serialNorm1);
+    EXPECT_EQ(normInf(*mat),serialNormInf);
+    EXPECT_EQ(max(*mat),1000.0);
+    EXPECT_TRUE(argMax(*mat) == std::make_pair(size_t(12345/n+1),size_t(12345%n+1)));
+    EXPECT_TRUE(argMin(*mat) == std::make_pair(n,n));
+    setParallelThreads(0);
+
+    delete mat;
+
+}
+
+TEST(MatrixMap,Map)
+{
+    Matrix<int,2,2> mat{1,2,3,4};
+    Matrix<int,2,2> original{1,2,3,4};
+    Matrix<double,2,2> result{0.5,1,1.5,2};
+
+    Matrix<double,2,2> half = map([](int _x) { return _x/2.0; },mat);
+
+    EXPECT_TRUE(half == result);
+    EXPECT_TRUE(mat == original);
+
+}
+
+TEST(MatrixMap,MapInPlace)
+{
+    Matrix<int,2,2> mat{1,2,3,4};
+    Matrix<int,2,2> result{1,4,9,16};
+
+    mapInPlace([](int _x) { return _x*_x; },mat);
+
+    EXPECT_TRUE(mat == result);
+
+}
+
+TEST(MatrixMap,ZipComplex)
+{
+    typedef std::complex<float> cf;
+    Matrix<cf,1,2> a{cf(1,1),cf(0,2)};
+    Matrix<cf,1,2> b{cf(1,-1),cf(3,0)};
+    Matrix<cf,1,2> result{cf(2,0),cf(0,6)};
+
+    Matrix<cf,1,2> prod = zip([](const cf& _x, const cf& _y) { return _x*_y; },a,b);
+
+    EXPECT_TRUE(prod == result);
+
+}
+
+TEST(MatrixMap,ZipInPlace)
+{
+    Matrix<int,1,3> a{1,2,3};
+    Matrix<int,1,3> b{4,5,6};
+    Matrix<int,1,3> result{-3,-3,-3};
+
+    zipInPlace([](int _x, int _y) { return _x-_y; },a,b);
+
+    EXPECT_TRUE(a == result);
+
+}
+
+TEST(MatrixMap,ClampAbsLerpFma)
+{
+    Matrix<float,1,4> a{-2.0f,-0.5f,0.5f,2.0f};
+    Matrix<float,1,4> b{2.0f,0.5f,1.5f,0.0f};
+
+    EXPECT_TRUE(clamp(a,-1.0f,1.0f) == (Matrix<float,1,4>{-1.0f,-0.5f,0.5f,1.0f}));
+    EXPECT_TRUE(abs(a) == (Matrix<float,1,4>{2.0f,0.5f,0.5f,2.0f}));
+    EXPECT_TRUE(lerp(a,b,0.5f) == (Matrix<float,1,4>{0.0f,0.0f,1.0f,1.0f}));
+    EXPECT_TRUE(fma(a,b,b) == (Matrix<float,1,4>{-2.0f,0.25f,2.25f,0.0f}));
+
+}
+
+TEST(MatrixMap,ParallelMap)
+{
+    const size_t n = 512;
+    Matrix<float,n,n>* mat = new Matrix<float,n,n>;
+    for(size_t i=0; i<n*n; i++)
+    {
+      mat->data()[i] = float(i%100);
+    }
+
+    setParallelThreads(4);
+    mapInPlace([](float _x) { return _x > 50.0f ? _x : 0.0f; },*mat);
+    setParallelThreads(0);
+
+    EXPECT_EQ(mat->data()[0],0.0f);
+    EXPECT_EQ(mat->data()[99],99.0f);
+    EXPECT_EQ(mat->data()[n*n-1],float((n*n-1)%100 > 50 ? (n*n-1)%100 : 0));
+
+    delete mat;
+
+}
+
+TEST(MatrixTranspose,SquareInPlace)
+{
+    const size_t n = 75;
+    Matrix<float,n,n>* mat = new Matrix<float,n,n>;
+    for(size_t i=0; i<n*n; i++)
+    {
+      mat->data()[i] = float(i);
+    }
+
+    mat->transpose();
+
+    for(size_t i=0; i<n; i++)
+    {
+      for(size_t j=0; j<n; j++)
+      {
+        EXPECT_EQ((*mat)(i+1,j+1),float(j*n+i));
+      }
+    }
+
+    delete mat;
+
+}
+
+TEST(MatrixTranspose,Rectangular)
+{
+    const size_t rows = 37;
+    const size_t cols = 53;
+    Matrix<double,rows,cols>* mat = new Matrix<double,rows,cols>;
+    for(size_t i=0; i<rows*cols; i++)
+    {
+      mat->data()[i] = double(i);
+    }
+
+    Matrix<double,cols,rows> trans = transposed(*mat);
+
+    for(size_t i=0; i<rows; i++)
+    {
+      for(size_t j=0; j<cols; j++)
+      {
+        EXPECT_EQ(trans(j+1,i+1),(*mat)(i+1,j+1));
+      }
+    }
+
+    // transposing in place twice gives back the original
+    mat->transpose();
+    EXPECT_TRUE(mat->getRows() == int(cols));
+    EXPECT_EQ(mat->data(2,1),trans(3,2));
+    mat->transpose();
+    EXPECT_TRUE(mat->getRows() == int(rows));
+    for(size_t i=0; i<rows*cols; i++)
+    {
+      EXPECT_EQ(mat->data()[i],double(i));
+    }
+
+    delete mat;
+
+}
+
+TEST(MatrixTranspose,RectangularIndexing)
+{
+    Matrix<int,2,3> mat = {1,2,3,4,5,6};
+    mat.transpose();
+
+    EXPECT_EQ(mat(1,1),1);
+    EXPECT_EQ(mat(2,1),2);
+    EXPECT_EQ(mat(3,1),3);
+    EXPECT_EQ(mat(1,2),4);
+    EXPECT_EQ(mat(3,2),6);
+    EXPECT_THROW(mat(1,3),std::out_of_range);
+    EXPECT_THROW(mat(4,1),std::out_of_range);
+
+    mat(3,1) = 7;
+    EXPECT_EQ(mat.data(2,0),7);
+}
+
+TEST(MatrixTranspose,LargeKernel)
+{
+    const size_t rows = 301;
+    const size_t cols = 517;
+    std::vector<float> in(rows*cols);
+    std::vector<float> out(rows*cols);
+    for(size_t i=0; i<rows*cols; i++)
+    {
+      in[i] = float(i);
+    }
+
+    transposeKernel(rows,cols,in.data(),out.data());
+
+    bool match = true;
+    for(size_t i=0; i<rows; i++)
+    {
+      for(size_t j=0; j<cols; j++)
+      {
+        match = match && out[j*rows+i] == in[i*cols+j];
+      }
+    }
+    EXPECT_TRUE(match);
+
+}
+
+TEST(MatrixArena,BumpAndReset)
+{
+    Arena arena(1024);
+
+    Arena::Marker start = arena.mark();
+    double* a = static_cast<double*>(arena.allocate(100*sizeof(double),alignof(double)));
+    float* b = static_cast<float*>(arena.allocate(10*sizeof(float),32));
+    EXPECT_TRUE(reinterpret_cast<std::uintptr_t>(b) % 32 == 0);
+    EXPECT_TRUE(static_cast<void*>(a) != static_cast<void*>(b));
+
+    // larger than a block, gets a block of its own
+    arena.allocate(4096);
+    EXPECT_TRUE(arena.blockCount() == 2);
+
+    arena.reset(start);
+    std::size_t capacity = arena.capacity();
+    for(int frame=0; frame<10; frame++)
+    {
+      ArenaScope scope(arena);
+      arena.allocate(100*sizeof(double));
+      arena.allocate(4096);
+    }
+    EXPECT_TRUE(arena.capacity() == capacity);
+
+}
+
+TEST(MatrixArena,LastAllocationReleased)
+{
+    Arena arena;
+    {
+      TempBuffer<int,ArenaAllocator<int> > outer(10,ArenaAllocator<int>(arena));
+      Arena::Marker afterOuter = arena.mark();
+      {
+        TempBuffer<int,ArenaAllocator<int> > inner(20,ArenaAllocator<int>(arena));
+        EXPECT_TRUE(inner[19] == 0);
+      }
+      EXPECT_TRUE(arena.mark().offset == afterOuter.offset);
+    }
+    EXPECT_TRUE(arena.mark().offset == 0);
+
+}
+
+TEST(MatrixArena,ReleaseAfterSpill)
+{
+    Arena arena(1024);
+    char* a = static_cast<char*>(arena.allocate(800,1));
+    // doesn't fit in the rest of the first block so it spills into a second
+    char* b = static_cast<char*>(arena.allocate(800,1));
+    EXPECT_TRUE(arena.mark().block == 1);
+
+    // releasing it goes back to the first block, which has room for a small allocation
+    arena.release(b,800);
+    EXPECT_TRUE(arena.mark().block == 0);
+    EXPECT_TRUE(arena.mark().offset == 800);
+    char* c = static_cast<char*>(arena.allocate(100,1));
+    EXPECT_TRUE(c == a + 800);
+
+    arena.release(c,100);
+    arena.release(a,800);
+    EXPECT_TRUE(arena.mark().offset == 0);
+
+    // the same pattern again reuses both blocks
+    for(int frame=0; frame<10; frame++)
+    {
+      char* first = static_cast<char*>(arena.allocate(800,1));
+      char* second = static_cast<char*>(arena.allocate(800,1));
+      EXPECT_TRUE(first == a);
+      EXPECT_TRUE(second == b);
+      arena.release(second,800);
+      arena.release(first,800);
+    }
+    EXPECT_TRUE(arena.blockCount() == 2);
+    EXPECT_TRUE(arena.mark().block == 0);
+
+}
+
+TEST(MatrixArena,MatrixTemporaries)
+{
+    Matrix<double,3,3> mat{2,0,0,0,4,0,0,0,8};
+    Matrix<double,3,4> rect;
+
+    // the temporaries are given back as soon as each function returns
+    Arena::Marker start = threadArena().mark();
+    mat.inverse();
+    mat.minorMatrix(1,1);
+    rect.transpose();
+    EXPECT_TRUE(threadArena().mark().block == start.block);
+    EXPECT_TRUE(threadArena().mark().offset == start.offset);
+
+}
+
+TEST(MatrixLargeAllocation,Policies)
+{
+    typedef Matrix<double,512,512> Big;
+    MemoryPolicy policies[] = {{PagePolicy::Default,NumaPolicy::Default},
+                               {PagePolicy::TransparentHuge,NumaPolicy::FirstTouch},
+                               {PagePolicy::ExplicitHuge,NumaPolicy::Interleaved}};
+
+    for(const MemoryPolicy& policy : policies)
+    {
+      LargeMatrixPtr<Big> mat = makeLargeMatrix<Big>(policy);
+
+      EXPECT_EQ(mat->data()[0],0.0);
+      EXPECT_EQ(mat->data()[512*512-1],0.0);
+      (*mat)(512,512) = 3.0;
+      EXPECT_EQ(mat->data()[512*512-1],3.0);
+      EXPECT_TRUE(mat->getRows() == 512);
+    }
+
+    LargeMatrixPtr<Big> huge = makeLargeMatrix<Big>();
+    EXPECT_TRUE(reinterpret_cast<std::uintptr_t>(huge.get()) % MYLIB_HUGE_PAGE_SIZE == 0);
+
+}
+
+TEST(MatrixLargeAllocation,Interleaved)
+{
+    // the node mask is sized from the nodes in sysfs so the kernel accepts it wherever there is a node list
+    MemoryPolicy policy = {PagePolicy::Default,NumaPolicy::Interleaved};
+    LargeBlock block = allocateLarge(1 << 18,sizeof(double),policy);
+    EXPECT_EQ(block.interleaved,!numaNodes().empty());
+    EXPECT_EQ(static_cast<double*>(block.data)[(1 << 18) - 1],0.0);
+    freeLarge(block);
+
+    MemoryPolicy firstTouchPolicy = {PagePolicy::Default,NumaPolicy::FirstTouch};
+    LargeBlock local = allocateLarge(16,sizeof(double),firstTouchPolicy);
+    EXPECT_FALSE(local.interleaved);
+    freeLarge(local);
+
+}
+
+TEST(MatrixLargeAllocation,Allocator)
+{
+    setParallelThreads(4);
+    std::vector<float,LargeAllocator<float> > values(1 << 20,1.0f);
+    setParallelThreads(0);
+
+    EXPECT_EQ(values.front(),1.0f);
+    EXPECT_EQ(values.back(),1.0f);
+    EXPECT_TRUE(reinterpret_cast<std::uintptr_t>(values.data()) % MYLIB_HUGE_PAGE_SIZE == 0);
+
+}
+
+TEST(MatrixLargeAllocation,SmallFromHeap)
+{
+    // below MYLIB_LARGE_MIN_BYTES the policy is ignored rather than rounding up to a whole huge page
+    MemoryPolicy policy = {PagePolicy::TransparentHuge,NumaPolicy::Interleaved};
+    LargeBlock block = allocateLarge(8,sizeof(double),policy);
+    EXPECT_FALSE(block.mapped);
+    EXPECT_FALSE(block.interleaved);
+    EXPECT_EQ(block.bytes,8*sizeof(double));
+    EXPECT_EQ(static_cast<double*>(block.data)[7],0.0);
+    freeLarge(block);
+
+    LargeBlock large = allocateLarge(MYLIB_LARGE_MIN_BYTES,1,policy);
+    EXPECT_TRUE(large.mapped);
+    EXPECT_EQ(large.bytes,std::size_t(MYLIB_HUGE_PAGE_SIZE));
+    freeLarge(large);
+
+    // the allocator frees small and large vectors the way they were allocated as they grow
+    std::vector<double,LargeAllocator<double> > values(8,1.0);
+    values.resize(1 << 19,2.0);
+    values.resize(4);
+    values.shrink_to_fit();
+    EXPECT_EQ(values.back(),1.0);
+    EXPECT_EQ(values.size(),std::size_t(4));
+
+}
+
+// returns a shared matrix by value, only the reference count changes
+SharedMatrix<double,256,256> passThrough(SharedMatrix<double,256,256> _mat)
+{
+    return _mat;
+}
+
+TEST(MatrixSharedStorage,CopyOnWrite)
+{
+    SharedMatrix<double,256,256> a = makeSharedMatrix<double,256,256>();
+    a.write()(1,1) = 2.0;
+
+    SharedMatrix<double,256,256> b = passThrough(a);
+    EXPECT_TRUE(b.sameAs(a));
+    EXPECT_TRUE(a.shared());
+    EXPECT_TRUE(b.read().data() == a.read().data());
+
+    // the first write copies, the second doesn't
+    b.write()(1,1) = 5.0;
+    EXPECT_FALSE(b.sameAs(a));
+    const double* data = b.read().data();
+    b.write()(2,2) = 1.0;
+    EXPECT_TRUE(b.read().data() == data);
+
+    EXPECT_EQ(a.read()(1,1),2.0);
+    EXPECT_EQ(b.read()(1,1),5.0);
+    EXPECT_FALSE(a.shared());
+
+}
+
+TEST(MatrixSharedStorage,CopiesOnOtherThreads)
+{
+    SharedMatrix<double,64,64> a = makeSharedMatrix<double,64,64>();
+    a.write()(1,1) = 3.0;
+    const double* data = a.read().data();
+
+    // each thread reads its own copy and lets go of it when it finishes
+    std::vector<std::thread> readers;
+    std::vector<double> seen(4,0.0);
+    for(std::size_t t=0; t<4; t++)
+    {
+      SharedMatrix<double,64,64> copy = a;
+      readers.emplace_back([copy,&seen,t]() { seen[t] = copy.read()(1,1); });
+    }
+    for(std::thread& reader : readers)
+    {
+      reader.join();
+    }
+    readers.clear();
+
+    // every copy has gone so the write happens in place
+    EXPECT_EQ(a.useCount(),1);
+    a.write()(1,1) = 4.0;
+    EXPECT_TRUE(a.read().data() == data);
+    for(double value : seen)
+    {
+      EXPECT_EQ(value,3.0);
+    }
+
+}
+
+TEST(MatrixSharedStorage,InPlaceOperations)
+{
+    SharedMatrix<int,2,2> a = makeSharedMatrix<int,2,2>({1,2,3,4});
+    SharedMatrix<int,2,2> b = a;
+
+    b.write().transpose();
+
+    EXPECT_TRUE(a->data()[1] == 2);
+    EXPECT_TRUE(b->data()[1] == 3);
+
+}
+
+TEST(MatrixSharedStorage,RuntimeSized)
+{
+    CowPtr< CsrMatrix<double> > a = CowPtr< CsrMatrix<double> >::make(CsrMatrix<double>::fromTriplets(2,2,{{1,1,1.0},{2,2,2.0}}));
+    CowPtr< CsrMatrix<double> > b = a;
+
+    b.write().values()[0] = 7.0;
+
+    EXPECT_EQ((*a)(1,1),1.0);
+    EXPECT_EQ((*b)(1,1),7.0);
+
+}
+
+TEST(MatrixReducedPrecision,Conversion)
+{
+  // exact values, rounding to nearest even, overflow, subnormals and NaN
+  EXPECT_EQ(half(1.0f).bits(),0x3c00);
+  EXPECT_EQ(half(-2.5f).bits(),0xc100);
+  EXPECT_EQ(half(65504.0f).bits(),0x7bff);
+  EXPECT_EQ(half(65520.0f).bits(),0x7c00);
+  EXPECT_EQ(half(1.0f + 1.0f/2048).bits(),0x3c00);
+  EXPECT_EQ(half(1.0f + 3.0f/2048).bits(),0x3c02);
+  EXPECT_EQ(half(5.9604644775390625e-8f).bits(),0x0001);
+  EXPECT_EQ(float(half::fromBits(0x0001)),5.9604644775390625e-8f);
+  EXPECT_TRUE(float(half(NAN)) != float(half(NAN)));
+
+  EXPECT_EQ(bfloat16(1.0f).bits(),0x3f80);
+  EXPECT_EQ(float(bfloat16(3.0e38f)),float(bfloat16::fromBits(bfloat16(3.0e38f).bits())));
+  EXPECT_EQ(bfloat16(1.0f + 1.0f/256).bits(),0x3f80);
+  EXPECT_EQ(bfloat16(1.0f + 3.0f/256).bits(),0x3f82);
+  EXPECT_TRUE(float(bfloat16(NAN)) != float(bfloat16(NAN)));
+
+  // the bulk conversions give the same bits as the scalar ones
+  float values[19];
+  for(int i=0; i<19; i++)
+  {
+    values[i] = (i - 9) * 0.3337f + i*i*100.0f;
+  }
+  values[18] = NAN;
+  half h[19];
+  bfloat16 b[19];
+  convertKernel(19,values,h);
+  convertKernel(19,values,b);
+  float back[19];
+  convertKernel(19,b,back);
+  for(int i=0; i<18; i++)
+  {
+    EXPECT_EQ(h[i].bits(),half(values[i]).bits());
+    EXPECT_EQ(b[i].bits(),bfloat16(values[i]).bits());
+    EXPECT_EQ(back[i],float(b[i]));
+  }
+  EXPECT_TRUE(back[18] != back[18]);
+  convertKernel(19,h,back);
+  EXPECT_TRUE(back[18] != back[18]);
+
+}
+
+TEST(MatrixReducedPrecision,MatrixOperations)
+{
+  Matrix<half,2,2> a = {1,2,3,4};
+  Matrix<half,2,2> b = {0.5f,1,1.5f,2};
+
+  a+b;
+  EXPECT_EQ(float(a(1,1)),1.5f);
+  EXPECT_EQ(float(a(2,2)),6.0f);
+
+  Matrix<bfloat16,2,2> c = {1,2,3,4};
+  Matrix<bfloat16,2,2> d = {1,0,0,1};
+  c*d;
+  EXPECT_EQ(float(c(1,2)),2.0f);
+  EXPECT_EQ(float(c(2,1)),3.0f);
+  EXPECT_EQ(float(c.determinant()),-2.0f);
+
+  EXPECT_EQ(sizeof(Matrix<half,64,64>) < sizeof(Matrix<float,64,64>),true);
+
+}
+
+TEST(MatrixReducedPrecision,Gemm)
+{
+  // summed in half the total would stop at 2, where adding 1/1024 is only half a unit in the last place
+  const std::size_t n = 4096;
+  Matrix<half,1,n> a;
+  Matrix<half,n,3> b;
+  for(std::size_t i=0; i<n; i++)
+  {
+    a.data()[i] = 1.0f/1024;
+    for(std::size_t j=0; j<3; j++)
+    {
+      b.data()[i*3+j] = float(j+1);
+    }
+  }
+
+  Matrix<half,1,3> c;
+  gemm(half(1),a,b,half(0),c);
+  EXPECT_EQ(float(c(1,1)),4.0f);
+  EXPECT_EQ(float(c(1,3)),12.0f);
+
+  // blocked kernel against float over sizes that aren't multiples of the blocks
+  const std::size_t m = 45;
+  const std::size_t k = 70;
+  const std::size_t cols = 300;
+  std::vector<bfloat16> x(m*k), y(k*cols), z(m*cols,bfloat16(1));
+  std::vector<float> xf(m*k), yf(k*cols), zf(m*cols,1.0f);
+  for(std::size_t i=0; i<m*k; i++) { x[i] = float(i%7) - 3; xf[i] = float(x[i]); }
+  for(std::size_t i=0; i<k*cols; i++) { y[i] = float(i%5)*0.25f; yf[i] = float(y[i]); }
+
+  gemmKernel(m,cols,k,bfloat16(2),x.data(),y.data(),bfloat16(0.5f),z.data());
+  gemmKernel(m,cols,k,2.0f,xf.data(),yf.data(),0.5f,zf.data());
+  for(std::size_t i=0; i<m*cols; i++)
+  {
+    EXPECT_EQ(float(z[i]),float(bfloat16(zf[i])));
+  }
+
+  // level 1 and 2 kernels
+  std::vector<half> u(1000,half(0.5f)), v(1000,half(2));
+  EXPECT_EQ(dotKernel(1000,u.data(),v.data()),1000.0f);
+  axpyKernel(1000,half(2),u.data(),v.data());
+  EXPECT_EQ(float(v[999]),3.0f);
+  scalKernel(1000,half(0.25f),v.data());
+  EXPECT_EQ(float(v[0]),0.75f);
+
+}
+
+TEST(MatrixComplex,VectorFunctions)
+{
+  typedef std::complex<float> C;
+  Matrix<C,3,1> v = {C(1,1),C(2,0),C(0,-2)};
+  Matrix<C,3,1> w = {C(0,1),C(1,0),C(1,1)};
+
+  // |1+i|^2 + 4 + 4
+  EXPECT_FLOAT_EQ(v.magnitude(),sqrt(10.0f));
+  // Hermitian, conj(v).w
+  EXPECT_TRUE(v.dot(w) == C(1,1) + C(2,0) + C(-2,2));
+  EXPECT_TRUE(v.dot(v) == C(10,0));
+
+  Matrix<C,3,1> x = v;
+  EXPECT_FLOAT_EQ(v.angle(x),0.0f);
+
+  // real vectors keep their types
+  Matrix<int,3,1> a = {1,2,3};
+  Matrix<int,3,1> b = {4,5,6};
+  EXPECT_EQ(a.dot(b),32.0f);
+  Matrix<double,2,1> d = {3,4};
+  EXPECT_EQ(d.magnitude(),5.0);
+
+}
+
+TEST(MatrixComplex,DeterminantInverse)
+{
+  typedef std::complex<double> C;
+  Matrix<C,2,2> a = {C(1,1),C(2,0),C(0,1),C(3,-1)};
+
+  // (1+i)(3-i) - 2i
+  EXPECT_TRUE(a.determinant() == C(4,0));
+
+  Matrix<C,2,2> b = a;
+  b.inverse();
+  Matrix<C,2,2> c = a;
+  c*b;
+  EXPECT_NEAR(std::abs(c(1,1) - C(1,0)),0.0,1e-12);
+  EXPECT_NEAR(std::abs(c(1,2)),0.0,1e-12);
+  EXPECT_NEAR(std::abs(c(2,2) - C(1,0)),0.0,1e-12);
+
+}
+
+TEST(MatrixComplex,ConjugateTranspose)
+{
+  typedef std::complex<float> C;
+  Matrix<C,2,3> a = {C(1,1),C(2,-1),C(0,3),C(4,0),C(5,5),C(6,-6)};
+
+  Matrix<C,3,2> h = conjugateTransposed(a);
+  EXPECT_TRUE(h(1,1) == C(1,-1));
+  EXPECT_TRUE(h(3,1) == C(0,-3));
+  EXPECT_TRUE(h(2,2) == C(5,-5));
+
+  a.conjugateTranspose();
+  EXPECT_EQ(a.getRows(),3);
+  EXPECT_TRUE(a.data(2,0) == C(0,-3));
+  EXPECT_TRUE(a.data(2,1) == C(6,6));
+  EXPECT_TRUE(a(3,1) == C(0,-3));
+  EXPECT_TRUE(a(3,2) == C(6,6));
+  EXPECT_TRUE(a(1,2) == C(4,0));
+  EXPECT_THROW(a(1,3),std::out_of_range);
+
+  // A^H*A is Hermitian
+  Matrix<C,2,3> b = {C(1,1),C(2,-1),C(0,3),C(4,0),C(5,5),C(6,-6)};
+  Matrix<C,3,3> g = adjointMultiply(b,b);
+  EXPECT_TRUE(isHermitian(g,1e-5f));
+  Matrix<C,3,3> expected;
+  for(int i=1; i<=3; i++)
+  {
+    for(int j=1; j<=3; j++)
+    {
+      expected(i,j) = std::conj(b(1,i))*b(1,j) + std::conj(b(2,i))*b(2,j);
+      EXPECT_NEAR(std::abs(g(i,j) - expected(i,j)),0.0f,1e-5f);
+    }
+  }
+
+  // A*A^H, 2x2
+  Matrix<C,2,2> k = multiplyAdjoint(b,b);
+  EXPECT_TRUE(isHermitian(k,1e-5f));
+  EXPECT_NEAR(std::abs(k(1,2) - (b(1,1)*std::conj(b(2,1)) + b(1,2)*std::conj(b(2,2)) + b(1,3)*std::conj(b(2,3)))),0.0f,1e-4f);
+
+  Matrix<float,2,2> r = {1,2,3,4};
+  EXPECT_FALSE(isHermitian(r));
+
+}
+
+TEST(MatrixComplex,SimdKernels)
+{
+  typedef std::complex<float> C;
+  // odd sizes so both the SIMD loop and the tail run
+  const std::size_t m = 5;
+  const std::size_t k = 7;
+  const std::size_t n = 11;
+  std::vector<C> a(m*k), b(k*n), c(m*n,C(1,-1)), expected(m*n);
+  for(std::size_t i=0; i<m*k; i++) { a[i] = C(float(i%5) - 2,float(i%3)); }
+  for(std::size_t i=0; i<k*n; i++) { b[i] = C(float(i%4),float(i%7) - 3); }
+
+  const C alpha(0.5f,1);
+  const C beta(2,0);
+  for(std::size_t i=0; i<m; i++)
+  {
+    for(std::size_t j=0; j<n; j++)
+    {
+      C sum(0);
+      for(std::size_t p=0; p<k; p++)
+      {
+        sum += a[i*k+p]*b[p*n+j];
+      }
+      expected[i*n+j] = alpha*sum + beta*c[i*n+j];
+    }
+  }
+
+  gemmKernel(m,n,k,alpha,a.data(),b.data(),beta,c.data());
+  for(std::size_t i=0; i<m*n; i++)
+  {
+    EXPECT_NEAR(std::abs(c[i] - expected[i]),0.0f,1e-4f);
+  }
+
+  // x^H*y and A^H*x
+  std::vector<C> x(k), y(m,C(0));
+  for(std::size_t i=0; i<k; i++) { x[i] = C(float(i),1); }
+  C dot = complexDotKernel(k,x.data(),x.data(),true);
+  EXPECT_NEAR(dot.real(),91.0f + 7.0f,1e-4f);
+  EXPECT_NEAR(dot.imag(),0.0f,1e-4f);
+
+  std::vector<C> z(m);
+  for(std::size_t i=0; i<m; i++) { z[i] = C(1,float(i)); }
+  std::vector<C> ahz(k);
+  complexGemvKernel(m,k,C(1),a.data(),true,z.data(),C(0),ahz.data());
+  for(std::size_t j=0; j<k; j++)
+  {
+    C sum(0);
+    for(std::size_t i=0; i<m; i++)
+    {
+      sum += std::conj(a[i*k+j])*z[i];
+    }
+    EXPECT_NEAR(std::abs(ahz[j] - sum),0.0f,1e-4f);
+  }
+
+}
+
+TEST(MatrixComplex,Batch)
+{
+  typedef std::complex<double> C;
+  const std::size_t count = 3000;
+  std::vector< Matrix<C,4,4> > a(count), b(count), c(count);
+  std::vector< Matrix<C,4,1> > x(count), y(count);
+  for(std::size_t i=0; i<count; i++)
+  {
+    for(std::size_t j=0; j<16; j++)
+    {
+      a[i].data()[j] = C(double(i%13),double(j));
+      b[i].data()[j] = (j%5 == 0) ? C(0,1) : C(0);
+    }
+    for(std::size_t j=0; j<4; j++)
+    {
+      x[i].data()[j] = C(1,0);
+    }
+  }
+
+  // B is i times the identity
+  gemmBatch(count,C(1),a.data(),b.data(),C(0),c.data());
+  gemvBatch(count,C(1),a.data(),x.data(),C(0),y.data());
+  for(std::size_t i=0; i<count; i+=97)
+  {
+    for(std::size_t j=0; j<16; j++)
+    {
+      EXPECT_TRUE(c[i].data()[j] == a[i].data()[j]*C(0,1));
+    }
+    EXPECT_TRUE(y[i].data()[1] == C(4.0*(i%13),4+5+6+7));
+  }
+
+}
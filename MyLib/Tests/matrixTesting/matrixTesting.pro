@@ -1,6 +1,6 @@
 TARGET = app.bin
 
-CONFIG += console c++11
+CONFIG += console c++14
 CONFIG -= app_bundle
 CONFIG -= qt
 
@@ -8,6 +8,7 @@ INCLUDEPATH+=../../include
 DEPENDPATH+=../../include
 
 LIBS+= -lgtest \
+        -lpthread \
         -L../../lib -lmyLib
 
 QMAKE_RPATHDIR+=../../lib
@@ -0,0 +1,139 @@
+#include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "quaternionArray.h"
+#include <gtest/gtest.h>
+
+/// Tests for the structure of arrays quaternion container.
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
+
+// _n quaternions that aren't normalized, with every component non zero
+std::vector< Quaternion<float> > exampleQuaternions(std::size_t _n)
+{
+    std::vector< Quaternion<float> > quaternions;
+    for(std::size_t i = 0; i < _n; ++i)
+    {
+        quaternions.push_back(Quaternion<float>(1.0f+0.1f*i, std::sin(0.3f*i)+0.2f, std::cos(0.7f*i)-0.1f, 0.5f-0.05f*i));
+    }
+    return quaternions;
+}
+
+// distance between two quaternions
+float quaternionError(Quaternion<float> _q, const Quaternion<float>& _expected)
+{
+    return (_q - _expected).norm();
+}
+
+TEST(QuaternionArray,Construction)
+{
+    QuaternionArray empty;
+    EXPECT_EQ(empty.size(), 0u);
+
+    QuaternionArray identities(5);
+    EXPECT_EQ(identities.size(), 5u);
+    EXPECT_EQ(identities.paddedSize() % MYLIB_QUATERNION_ARRAY_PAD, 0u);
+    EXPECT_TRUE(identities.get(4) == Quaternion<float>(1.0f,0.0f,0.0f,0.0f));
+    EXPECT_THROW(identities.get(5), std::out_of_range);
+
+    // every component array is aligned for the widest loads
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(identities.a()) % 64, 0u);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(identities.d()) % 64, 0u);
+}
+
+TEST(QuaternionArray,AoSRoundTrip)
+{
+    std::vector< Quaternion<float> > quaternions = exampleQuaternions(37);
+    QuaternionArray array(quaternions.size(), quaternions.data());
+
+    EXPECT_EQ(array.size(), quaternions.size());
+    EXPECT_EQ(array.c()[3], std::cos(2.1f)-0.1f);
+
+    std::vector< Quaternion<float> > back(quaternions.size());
+    array.toAoS(back.data());
+    for(std::size_t i = 0; i < quaternions.size(); ++i)
+    {
+        EXPECT_TRUE(back[i] == quaternions[i]);
+        EXPECT_TRUE(array.get(i) == quaternions[i]);
+    }
+}
+
+TEST(QuaternionArray,SetAndCopy)
+{
+    QuaternionArray array(3);
+    array.set(1, Quaternion<float>(1.0f,2.0f,3.0f,4.0f));
+
+    QuaternionArray copy(array);
+    array.set(1, Quaternion<float>());
+
+    EXPECT_TRUE(copy.get(1) == Quaternion<float>(1.0f,2.0f,3.0f,4.0f));
+    EXPECT_TRUE(array.get(1) == Quaternion<float>());
+    EXPECT_THROW(array.set(3, Quaternion<float>()), std::out_of_range);
+}
+
+TEST(QuaternionArray,Multiply)
+{
+    std::vector< Quaternion<float> > left = exampleQuaternions(41);
+    std::vector< Quaternion<float> > right(left.rbegin(), left.rend());
+    QuaternionArray l(left.size(), left.data());
+    QuaternionArray r(right.size(), right.data());
+    QuaternionArray out;
+
+    multiply(l, r, out);
+    l.multiply(r);
+
+    for(std::size_t i = 0; i < left.size(); ++i)
+    {
+        Quaternion<float> expected(left[i]);
+        expected*right[i];
+        EXPECT_LT(quaternionError(out.get(i), expected), 1e-5f);
+        EXPECT_LT(quaternionError(l.get(i), expected), 1e-5f);
+    }
+
+    EXPECT_THROW(multiply(l, QuaternionArray(3), out), std::out_of_range);
+}
+
+TEST(QuaternionArray,ConjugateInverseNormalize)
+{
+    std::vector< Quaternion<float> > quaternions = exampleQuaternions(19);
+    quaternions[7] = Quaternion<float>();
+    QuaternionArray conjugates(quaternions.size(), quaternions.data());
+    QuaternionArray inverses(conjugates);
+    QuaternionArray normalized(conjugates);
+
+    conjugates.conjugate();
+    inverses.inverse();
+    normalized.normalize();
+
+    for(std::size_t i = 0; i < quaternions.size(); ++i)
+    {
+        Quaternion<float> conjugate(quaternions[i]);
+        Quaternion<float> inverse(quaternions[i]);
+        Quaternion<float> unit(quaternions[i]);
+        EXPECT_TRUE(conjugates.get(i) == conjugate.conjugate());
+        EXPECT_LT(quaternionError(inverses.get(i), inverse.inverse()), 1e-6f);
+        EXPECT_LT(quaternionError(normalized.get(i), unit.normalize()), 1e-6f);
+    }
+}
+
+TEST(QuaternionArray,Dot)
+{
+    std::vector< Quaternion<float> > quaternions = exampleQuaternions(20);
+    QuaternionArray array(quaternions.size(), quaternions.data());
+    // one past the end is left alone, the padding isn't written
+    std::vector<float> dots(quaternions.size()+1, -7.0f);
+
+    array.dot(array, dots.data());
+
+    for(std::size_t i = 0; i < quaternions.size(); ++i)
+    {
+        EXPECT_NEAR(dots[i], quaternions[i].dot(quaternions[i]), 1e-5f);
+    }
+    EXPECT_EQ(dots.back(), -7.0f);
+}
@@ -0,0 +1,171 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "quaternionCompression.h"
+#include <gtest/gtest.h>
+
+/// Tests for smallest three quaternion packing.
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
+
+// _n rotations spread over every axis and angle, with every component the largest somewhere and both signs
+std::vector< Quaternion<float> > exampleRotations(std::size_t _n)
+{
+    std::vector< Quaternion<float> > rotations;
+    for(std::size_t i = 0; i < _n; ++i)
+    {
+        float angle = 0.731f*i;
+        float axis[3] = {std::sin(1.3f*i), std::cos(0.7f*i), std::sin(0.4f*i+1.0f)};
+        float length = std::sqrt(axis[0]*axis[0]+axis[1]*axis[1]+axis[2]*axis[2]);
+        float s = std::sin(angle/2)/length;
+        rotations.push_back(Quaternion<float>(std::cos(angle/2), s*axis[0], s*axis[1], s*axis[2]));
+    }
+    // exact ties between the largest components and one that isn't normalized
+    float h = std::sqrt(0.5f);
+    rotations.push_back(Quaternion<float>(0.0f, h, -h, 0.0f));
+    rotations.push_back(Quaternion<float>(0.5f, -0.5f, 0.5f, -0.5f));
+    rotations.push_back(Quaternion<float>(0.0f, 0.0f, 0.0f, -3.0f));
+    return rotations;
+}
+
+// rotation angle between two quaternions, q and -q are the same rotation
+double rotationAngle(const Quaternion<float>& _q, const Quaternion<float>& _r)
+{
+    double qNorm = _q.norm(), rNorm = _r.norm();
+    double minus = 0.0, plus = 0.0;
+    for(std::size_t k = 0; k < 4; ++k)
+    {
+        double x = _q.data()[k]/qNorm, y = _r.data()[k]/rNorm;
+        minus += (x-y)*(x-y);
+        plus += (x+y)*(x+y);
+    }
+    return 4.0*std::asin(std::sqrt(std::min(minus,plus))/2.0);
+}
+
+template <std::size_t BITS>
+void checkRoundTrip()
+{
+    std::vector< Quaternion<float> > rotations = exampleRotations(1000);
+    float bound = CompressedQuaternion<BITS>::angularErrorBound();
+
+    for(const Quaternion<float>& q : rotations)
+    {
+        Quaternion<float> decoded = CompressedQuaternion<BITS>(q).decode();
+        EXPECT_LE(rotationAngle(decoded, q), bound);
+        EXPECT_NEAR(decoded.norm(), 1.0f, 1e-6f);
+    }
+}
+
+TEST(QuaternionCompression,Sizes)
+{
+    EXPECT_EQ(sizeof(CompressedQuaternion<32>), 4u);
+    EXPECT_EQ(sizeof(CompressedQuaternion<48>), 6u);
+    EXPECT_EQ(sizeof(CompressedQuaternion<64>), 8u);
+    EXPECT_EQ(CompressedQuaternion<32>::componentBits, 10u);
+    EXPECT_EQ(CompressedQuaternion<48>::componentBits, 15u);
+    EXPECT_EQ(CompressedQuaternion<64>::componentBits, 20u);
+
+    // deeper packings have smaller bounds (5 more bits each, less at 64 where float rounding counts), 32 bits is
+    // within about half a degree
+    EXPECT_LT(CompressedQuaternion<32>::angularErrorBound(), 0.01f);
+    EXPECT_LT(CompressedQuaternion<48>::angularErrorBound(), CompressedQuaternion<32>::angularErrorBound()/20.0f);
+    EXPECT_LT(CompressedQuaternion<64>::angularErrorBound(), CompressedQuaternion<48>::angularErrorBound()/20.0f);
+}
+
+TEST(QuaternionCompression,Identity)
+{
+    // zero is a quantization step so the identity packs exactly
+    Quaternion<float> identity(1.0f,0.0f,0.0f,0.0f);
+    EXPECT_TRUE(CompressedQuaternion<32>().decode() == identity);
+    EXPECT_TRUE(CompressedQuaternion<48>(identity).decode() == identity);
+    EXPECT_TRUE(CompressedQuaternion<64>(Quaternion<float>(-2.0f,0.0f,0.0f,0.0f)).decode() == identity);
+    EXPECT_TRUE(CompressedQuaternion<64>(Quaternion<float>()).decode() == identity);
+}
+
+TEST(QuaternionCompression,RoundTrip)
+{
+    checkRoundTrip<32>();
+    checkRoundTrip<48>();
+    checkRoundTrip<64>();
+}
+
+TEST(QuaternionCompression,Bits)
+{
+    // d is the largest, so it is dropped (index 3) and the sign flipped to make it positive
+    CompressedQuaternion<48> packed(Quaternion<float>(0.0f,0.0f,0.0f,-1.0f));
+    std::uint64_t middle = CompressedQuaternion<48>::maxValue/2;
+    EXPECT_EQ(packed.bits(), (std::uint64_t(3) << 45) | (middle << 30) | (middle << 15) | middle);
+
+    CompressedQuaternion<48> copy;
+    copy.setBits(packed.bits());
+    EXPECT_TRUE(copy.decode() == Quaternion<float>(0.0f,0.0f,0.0f,1.0f));
+}
+
+template <std::size_t BITS>
+void checkBulk()
+{
+    // not a multiple of the SIMD width
+    std::vector< Quaternion<float> > rotations = exampleRotations(203);
+    std::vector< CompressedQuaternion<BITS> > packed(rotations.size());
+    std::vector< Quaternion<float> > decoded(rotations.size());
+
+    compressQuaternions(rotations.size(), rotations.data(), packed.data());
+    decompressQuaternions(packed.size(), packed.data(), decoded.data());
+
+    // the same as the scalar version to within a step of rounding
+    float step = 2.0f*CompressedQuaternion<BITS>::range()/float(CompressedQuaternion<BITS>::maxValue);
+    for(std::size_t i = 0; i < rotations.size(); ++i)
+    {
+        Quaternion<float> scalar = CompressedQuaternion<BITS>(rotations[i]).decode();
+        Quaternion<float> difference(decoded[i]);
+        EXPECT_LT((difference - scalar).norm(), 2.0f*step + 1e-6f);
+        EXPECT_LE(rotationAngle(decoded[i], rotations[i]), CompressedQuaternion<BITS>::angularErrorBound());
+    }
+
+    // decoding in bulk gives exactly what decode does
+    for(std::size_t i = 0; i < rotations.size(); ++i)
+    {
+        Quaternion<float> scalar = packed[i].decode();
+        Quaternion<float> difference(decoded[i]);
+        EXPECT_LT((difference - scalar).norm(), 1e-6f);
+    }
+
+    QuaternionCompressionError error = compressionError(rotations.size(), rotations.data(), packed.data());
+    EXPECT_GT(error.maxAngle, 0.0);
+    EXPECT_LE(error.meanAngle, error.maxAngle);
+    EXPECT_LE(error.maxAngle, error.bound);
+    EXPECT_FLOAT_EQ(float(error.bound), CompressedQuaternion<BITS>::angularErrorBound());
+}
+
+TEST(QuaternionCompression,Bulk)
+{
+    checkBulk<32>();
+    checkBulk<48>();
+    checkBulk<64>();
+}
+
+TEST(QuaternionCompression,BulkThreads)
+{
+    std::vector< Quaternion<float> > rotations = exampleRotations(40000);
+    std::vector< CompressedQuaternion<32> > packed(rotations.size()), single(rotations.size());
+
+    setParallelThreads(4);
+    compressQuaternions(rotations.size(), rotations.data(), packed.data());
+    QuaternionCompressionError error = compressionError(rotations.size(), rotations.data(), packed.data());
+    setParallelThreads(1);
+    compressQuaternions(rotations.size(), rotations.data(), single.data());
+    QuaternionCompressionError singleError = compressionError(rotations.size(), rotations.data(), single.data());
+    setParallelThreads(0);
+
+    for(std::size_t i = 0; i < rotations.size(); i += 101)
+    {
+        EXPECT_EQ(packed[i].bits(), single[i].bits());
+    }
+    EXPECT_EQ(error.maxAngle, singleError.maxAngle);
+    EXPECT_LE(error.maxAngle, error.bound);
+}
@@ -0,0 +1,19 @@
+TARGET = app.bin
+
+CONFIG += console c++14
+CONFIG -= app_bundle
+CONFIG -= qt
+
+INCLUDEPATH+=../../include
+DEPENDPATH+=../../include
+
+LIBS+= -lgtest \
+        -lpthread \
+        -L../../lib -lmyLib
+
+QMAKE_RPATHDIR+=../../lib
+
+SOURCES += \
+    quaternionCompressionTesting.cpp
+
+OTHER_FILES+=$$PWD/app
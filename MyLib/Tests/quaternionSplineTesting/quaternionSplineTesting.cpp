@@ -0,0 +1,231 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "quaternionSpline.h"
+#include <gtest/gtest.h>
+
+/// Tests for SQUAD splines through quaternion keys.
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
+
+// _n keys one second apart turning about changing axes, every other key is stored with the opposite sign
+template <typename T>
+std::vector< Quaternion<T> > exampleKeys(std::size_t _n)
+{
+    std::vector< Quaternion<T> > keys;
+    for(std::size_t i = 0; i < _n; ++i)
+    {
+        Matrix<T,3,1> axis{std::sin(T(0.9)*i), T(1), std::cos(T(0.4)*i)};
+        Quaternion<T> key = Quaternion<T>::fromAxisAngle(axis, T(0.6)*i);
+        if(i % 2)
+        {
+            -key;
+        }
+        keys.push_back(key);
+    }
+    return keys;
+}
+
+template <typename T>
+std::vector<T> exampleTimes(std::size_t _n)
+{
+    std::vector<T> times;
+    for(std::size_t i = 0; i < _n; ++i)
+    {
+        times.push_back(T(i));
+    }
+    return times;
+}
+
+// distance between two rotations, q and -q are the same rotation
+template <typename T>
+T rotationError(const Quaternion<T>& _q, const Quaternion<T>& _expected)
+{
+    Quaternion<T> minus(_q), plus(_q);
+    return std::min((minus - _expected).norm(), (plus + _expected).norm());
+}
+
+TEST(QuaternionSpline,Construction)
+{
+    std::vector< Quaternion<double> > keys = exampleKeys<double>(5);
+    std::vector<double> times = exampleTimes<double>(5);
+    QuaternionSpline<double> spline(keys.size(), times.data(), keys.data());
+
+    EXPECT_EQ(spline.size(), 5u);
+    EXPECT_EQ(spline.startTime(), 0.0);
+    EXPECT_EQ(spline.endTime(), 4.0);
+    // the keys are flipped to be on the same side as the one before
+    for(std::size_t i = 1; i < spline.size(); ++i)
+    {
+        EXPECT_GT(spline.key(i).dot(spline.key(i-1)), 0.0);
+    }
+    // the end keys are their own tangents
+    Quaternion<double> tangent = spline.tangent(0);
+    EXPECT_TRUE(tangent == spline.key(0));
+    EXPECT_THROW(spline.key(5), std::out_of_range);
+
+    EXPECT_THROW(QuaternionSpline<double>(0, times.data(), keys.data()), std::out_of_range);
+    times[3] = times[2];
+    EXPECT_THROW(QuaternionSpline<double>(keys.size(), times.data(), keys.data()), std::out_of_range);
+}
+
+TEST(QuaternionSpline,PassesThroughKeys)
+{
+    std::vector< Quaternion<double> > keys = exampleKeys<double>(7);
+    std::vector<double> times = {0.0, 0.5, 2.0, 2.25, 3.0, 5.0, 5.5};
+    QuaternionSpline<double> spline(keys.size(), times.data(), keys.data());
+
+    for(std::size_t i = 0; i < keys.size(); ++i)
+    {
+        EXPECT_LT(rotationError(spline.evaluate(times[i]), keys[i]), 1e-14);
+    }
+
+    // times outside the keys are clamped
+    EXPECT_LT(rotationError(spline.evaluate(-1.0), keys.front()), 1e-14);
+    EXPECT_LT(rotationError(spline.evaluate(9.0), keys.back()), 1e-14);
+
+    // a single key is constant
+    QuaternionSpline<double> single(1, times.data(), keys.data() + 2);
+    EXPECT_LT(rotationError(single.evaluate(4.0), keys[2]), 1e-15);
+}
+
+TEST(QuaternionSpline,TwoKeysIsSlerp)
+{
+    std::vector< Quaternion<double> > keys = exampleKeys<double>(3);
+    std::vector<double> times = {1.0, 3.0};
+    QuaternionSpline<double> spline(2, times.data(), keys.data() + 1);
+
+    for(double h = 0.0; h <= 1.0; h += 0.125)
+    {
+        Quaternion<double> expected = Quaternion<double>::slerp(spline.key(0), spline.key(1), h);
+        EXPECT_LT(rotationError(spline.evaluate(1.0 + 2.0*h), expected), 1e-14);
+    }
+}
+
+TEST(QuaternionSpline,SmoothThroughKeys)
+{
+    // with evenly spaced keys SQUAD has a continuous angular velocity, the rotation over a short time just before
+    // a key matches the one just after it
+    std::vector< Quaternion<double> > keys = exampleKeys<double>(6);
+    std::vector<double> times = exampleTimes<double>(6);
+    QuaternionSpline<double> spline(keys.size(), times.data(), keys.data());
+
+    const double dt = 1e-5;
+    for(std::size_t i = 1; i + 1 < keys.size(); ++i)
+    {
+        Quaternion<double> before = spline.evaluate(times[i] - dt);
+        Quaternion<double> at = spline.evaluate(times[i]);
+        Quaternion<double> after = spline.evaluate(times[i] + dt);
+
+        // at*before^-1 and after*at^-1 are the world frame rotations over the two steps
+        Quaternion<double> first(at), second(after);
+        first * before.conjugate();
+        second * at.conjugate();
+        if(first.dot(second) < 0.0)
+        {
+            -second;
+        }
+        EXPECT_LT((first - second).norm(), 1e-8);
+    }
+}
+
+TEST(QuaternionSpline,Cursor)
+{
+    std::vector< Quaternion<double> > keys = exampleKeys<double>(40);
+    std::vector<double> times = exampleTimes<double>(40);
+    QuaternionSpline<double> spline(keys.size(), times.data(), keys.data());
+
+    // small forward steps, a jump forward and a jump back all give the same as a binary search
+    QuaternionSpline<double>::Cursor cursor;
+    std::vector<double> queries;
+    for(double t = 0.0; t < 10.0; t += 0.3)
+    {
+        queries.push_back(t);
+    }
+    queries.push_back(35.5);
+    queries.push_back(2.5);
+    queries.push_back(39.0);
+    queries.push_back(-3.0);
+
+    for(double t : queries)
+    {
+        Quaternion<double> expected = spline.evaluate(t);
+        EXPECT_TRUE(spline.evaluate(t, cursor) == expected);
+
+        double h;
+        QuaternionSpline<double>::Cursor fresh;
+        fresh.segment = 20;
+        std::size_t segment = spline.segment(t, fresh, h);
+        EXPECT_EQ(segment, cursor.segment);
+        EXPECT_GE(h, 0.0);
+        EXPECT_LE(h, 1.0);
+    }
+    EXPECT_EQ(cursor.segment, 0u);
+
+    double h;
+    spline.segment(17.25, cursor, h);
+    EXPECT_EQ(cursor.segment, 17u);
+    EXPECT_DOUBLE_EQ(h, 0.25);
+}
+
+TEST(QuaternionSpline,BatchFloat)
+{
+    std::vector< Quaternion<float> > keys = exampleKeys<float>(12);
+    std::vector<float> times = exampleTimes<float>(12);
+    QuaternionSpline<float> spline(keys.size(), times.data(), keys.data());
+
+    // sorted times that don't fill the last SIMD block, then some out of order
+    std::vector<float> t;
+    for(std::size_t i = 0; i < 91; ++i)
+    {
+        t.push_back(-0.5f + 0.13f*i);
+    }
+    t.push_back(3.5f);
+    t.push_back(0.25f);
+    t.push_back(10.75f);
+
+    std::vector< Quaternion<float> > out(t.size());
+    spline.evaluate(t.size(), t.data(), out.data());
+
+    // the batch uses the polynomial slerp weights, within a few 1e-6 of the exact ones
+    for(std::size_t i = 0; i < t.size(); ++i)
+    {
+        EXPECT_LT(rotationError(out[i], spline.evaluate(t[i])), 1e-5f);
+    }
+
+    QuaternionSpline<float> single(1, times.data(), keys.data());
+    single.evaluate(t.size(), t.data(), out.data());
+    for(std::size_t i = 0; i < t.size(); ++i)
+    {
+        EXPECT_TRUE(out[i] == single.key(0));
+    }
+}
+
+TEST(QuaternionSpline,BatchDoubleAndThreads)
+{
+    std::vector< Quaternion<double> > keys = exampleKeys<double>(30);
+    std::vector<double> times = exampleTimes<double>(30);
+    QuaternionSpline<double> spline(keys.size(), times.data(), keys.data());
+
+    // enough times to be split across threads, each thread starts its own cursor
+    std::vector<double> t(20000);
+    for(std::size_t i = 0; i < t.size(); ++i)
+    {
+        t[i] = 29.0*i/t.size();
+    }
+    std::vector< Quaternion<double> > out(t.size());
+
+    setParallelThreads(4);
+    spline.evaluate(t.size(), t.data(), out.data());
+    setParallelThreads(0);
+
+    for(std::size_t i = 0; i < t.size(); i += 37)
+    {
+        EXPECT_TRUE(out[i] == spline.evaluate(t[i]));
+    }
+}
@@ -1,5 +1,10 @@
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 #include "quaternion.h"
+#include "quaternionBatch.h"
 #include <gtest/gtest.h>
 
 /// Tests for quaternion constructors, operators and functions.
@@ -246,12 +251,675 @@ TEST(QuaternionFunction,InverseFunctionZero)
 
 }
 
+// quaternions covering every case of Shepperd's method, rotations of about 180 degrees make b, c or d the largest
+static std::vector< Quaternion<float> > testRotations(std::size_t _n)
+{
+    std::vector< Quaternion<float> > rotations;
+    for(std::size_t i = 0; i < _n; ++i)
+    {
+        float angle = 0.37f*i;
+        float axis[3] = {std::sin(1.3f*i), std::cos(0.7f*i), std::sin(0.4f*i+1.0f)};
+        float length = std::sqrt(axis[0]*axis[0]+axis[1]*axis[1]+axis[2]*axis[2]);
+        float s = std::sin(angle/2)/length;
+        rotations.push_back(Quaternion<float>(std::cos(angle/2), s*axis[0], s*axis[1], s*axis[2]));
+    }
+    rotations.push_back(Quaternion<float>(0.0f,1.0f,0.0f,0.0f));
+    rotations.push_back(Quaternion<float>(0.0f,0.0f,1.0f,0.0f));
+    rotations.push_back(Quaternion<float>(0.0f,0.0f,0.0f,1.0f));
+    return rotations;
+}
+
+// distance between two quaternions
+static float quaternionError(Quaternion<float> _q, const Quaternion<float>& _expected)
+{
+    return (_q - _expected).norm();
+}
+
+// distance between two rotations, q and -q are the same rotation
+static float rotationError(const Quaternion<float>& _q, const Quaternion<float>& _expected)
+{
+    Quaternion<float> negated(_expected);
+    return std::min(quaternionError(_q, _expected), quaternionError(_q, -negated));
+}
+
+TEST(QuaternionMatrix,ToMatrix3)
+{
+    float h = std::sqrt(0.5f);
+    // 90 degrees about z
+    Matrix<float,3,3> mat = Quaternion<float>(h,0.0f,0.0f,h).toMatrix3();
+    float result[9] = {0,-1,0, 1,0,0, 0,0,1};
+
+    for(std::size_t i = 0; i < 9; ++i)
+    {
+        EXPECT_NEAR(mat.data()[i], result[i], 1e-6f);
+    }
+}
+
+TEST(QuaternionMatrix,ToMatrix3NotNormalized)
+{
+    float h = std::sqrt(0.5f);
+    Matrix<float,3,3> unit = Quaternion<float>(h,h,0.0f,0.0f).toMatrix3();
+    Matrix<float,3,3> scaled = Quaternion<float>(3*h,3*h,0.0f,0.0f).toMatrix3();
+    Matrix<float,3,3> identity = Quaternion<float>().toMatrix3();
+
+    for(std::size_t i = 0; i < 9; ++i)
+    {
+        EXPECT_NEAR(scaled.data()[i], unit.data()[i], 1e-6f);
+        EXPECT_EQ(identity.data()[i], i % 4 == 0 ? 1.0f : 0.0f);
+    }
+}
+
+TEST(QuaternionMatrix,ToMatrix4)
+{
+    Quaternion<double> q(0.5,0.5,0.5,0.5);
+    Matrix<double,3,3> rotation = q.toMatrix3();
+    Matrix<double,4,4> mat = q.toMatrix4();
+
+    for(std::size_t r = 0; r < 4; ++r)
+    {
+        for(std::size_t c = 0; c < 4; ++c)
+        {
+            double expected = r < 3 && c < 3 ? rotation.data()[r*3+c] : (r == c ? 1.0 : 0.0);
+            EXPECT_EQ(mat.data()[r*4+c], expected);
+        }
+    }
+}
+
+TEST(QuaternionMatrix,FromMatrixRoundTrip)
+{
+    std::vector< Quaternion<float> > rotations = testRotations(40);
+    for(std::size_t i = 0; i < rotations.size(); ++i)
+    {
+        Quaternion<float> q = rotations[i];
+
+        EXPECT_LT(rotationError(Quaternion<float>::fromMatrix(q.toMatrix3()), q), 1e-5f);
+        EXPECT_LT(rotationError(Quaternion<float>::fromMatrix(q.toMatrix4()), q), 1e-5f);
+    }
+}
+
+TEST(QuaternionMatrix,FromMatrix4IgnoresTranslation)
+{
+    Quaternion<float> q(0.5f,0.5f,-0.5f,0.5f);
+    Matrix<float,4,4> mat = q.toMatrix4();
+    mat.data()[3] = 10.0f;
+    mat.data()[7] = -4.0f;
+    mat.data()[11] = 2.5f;
+
+    EXPECT_LT(quaternionError(Quaternion<float>::fromMatrix(mat), q), 1e-6f);
+}
+
+TEST(QuaternionMatrix,BatchToMatrices)
+{
+    // not a multiple of the SIMD width so the padded block is tested
+    std::vector< Quaternion<float> > rotations = testRotations(37);
+    rotations.push_back(Quaternion<float>());
+    std::vector< Matrix<float,3,3> > mat3(rotations.size());
+    std::vector< Matrix<float,4,4> > mat4(rotations.size());
+    // the homogeneous row and column must be overwritten too
+    for(std::size_t i = 0; i < mat4.size(); ++i)
+    {
+        std::fill(mat4[i].data(), mat4[i].data() + 16, 7.0f);
+    }
+
+    quaternionsToMatrices(rotations.size(), rotations.data(), mat3.data());
+    quaternionsToMatrices(rotations.size(), rotations.data(), mat4.data());
+
+    for(std::size_t i = 0; i < rotations.size(); ++i)
+    {
+        Matrix<float,3,3> expected3 = rotations[i].toMatrix3();
+        Matrix<float,4,4> expected4 = rotations[i].toMatrix4();
+        for(std::size_t j = 0; j < 9; ++j)
+        {
+            EXPECT_NEAR(mat3[i].data()[j], expected3.data()[j], 1e-6f);
+        }
+        for(std::size_t j = 0; j < 16; ++j)
+        {
+            EXPECT_NEAR(mat4[i].data()[j], expected4.data()[j], 1e-6f);
+        }
+    }
+}
+
+TEST(QuaternionMatrix,BatchFromMatrices)
+{
+    std::vector< Quaternion<float> > rotations = testRotations(45);
+    std::vector< Matrix<float,3,3> > mat3(rotations.size());
+    std::vector< Matrix<float,4,4> > mat4(rotations.size());
+    for(std::size_t i = 0; i < rotations.size(); ++i)
+    {
+        mat3[i] = rotations[i].toMatrix3();
+        mat4[i] = rotations[i].toMatrix4();
+    }
+
+    std::vector< Quaternion<float> > from3(rotations.size());
+    std::vector< Quaternion<float> > from4(rotations.size());
+    matricesToQuaternions(mat3.size(), mat3.data(), from3.data());
+    matricesToQuaternions(mat4.size(), mat4.data(), from4.data());
+
+    for(std::size_t i = 0; i < rotations.size(); ++i)
+    {
+        Quaternion<float> expected = Quaternion<float>::fromMatrix(mat3[i]);
+        EXPECT_LT(quaternionError(from3[i], expected), 1e-6f);
+        EXPECT_LT(quaternionError(from4[i], expected), 1e-6f);
+    }
+}
+
+TEST(QuaternionMatrix,BatchDouble)
+{
+    std::vector< Quaternion<double> > rotations(5, Quaternion<double>(0.5,0.5,0.5,0.5));
+    std::vector< Matrix<double,3,3> > mats(rotations.size());
+    std::vector< Quaternion<double> > back(rotations.size());
+
+    quaternionsToMatrices(rotations.size(), rotations.data(), mats.data());
+    matricesToQuaternions(mats.size(), mats.data(), back.data());
+
+    for(std::size_t i = 0; i < rotations.size(); ++i)
+    {
+        EXPECT_LT((back[i] - rotations[i]).norm(), 1e-12);
+    }
+}
+
+// vectors with a mix of signs and sizes
+static std::vector< Matrix<float,3,1> > testVectors(std::size_t _n)
+{
+    std::vector< Matrix<float,3,1> > vectors(_n);
+    for(std::size_t i = 0; i < _n; ++i)
+    {
+        vectors[i].data()[0] = std::cos(0.9f*i)*(1.0f+i);
+        vectors[i].data()[1] = std::sin(0.5f*i)-0.25f;
+        vectors[i].data()[2] = 2.0f-0.1f*i;
+    }
+    return vectors;
+}
+
+TEST(QuaternionRotate,RotateAboutZ)
+{
+    float h = std::sqrt(0.5f);
+    Quaternion<float> q(h,0.0f,0.0f,h);
+    Matrix<float,3,1> v{1.0f,2.0f,3.0f};
+
+    Matrix<float,3,1> r = q.rotate(v);
+
+    EXPECT_NEAR(r.data()[0], -2.0f, 1e-6f);
+    EXPECT_NEAR(r.data()[1], 1.0f, 1e-6f);
+    EXPECT_NEAR(r.data()[2], 3.0f, 1e-6f);
+}
+
+TEST(QuaternionRotate,MatchesProductAndMatrix)
+{
+    std::vector< Quaternion<float> > rotations = testRotations(20);
+    std::vector< Matrix<float,3,1> > vectors = testVectors(rotations.size());
+
+    for(std::size_t i = 0; i < rotations.size(); ++i)
+    {
+        const float* v = vectors[i].data();
+        Matrix<float,3,1> r = rotations[i].rotate(vectors[i]);
+
+        // q*v*q^-1 with v as a pure quaternion, the operators change their left operand so work on copies
+        Quaternion<float> q(rotations[i]);
+        Quaternion<float> conjugate(rotations[i]);
+        Quaternion<float> product = q*Quaternion<float>(0.0f,v[0],v[1],v[2])*conjugate.conjugate();
+        EXPECT_LT(quaternionError(product, Quaternion<float>(0.0f,r.data()[0],r.data()[1],r.data()[2])), 1e-4f);
+
+        Matrix<float,3,3> mat = rotations[i].toMatrix3();
+        for(std::size_t row = 0; row < 3; ++row)
+        {
+            const float* m = mat.data() + 3*row;
+            EXPECT_NEAR(r.data()[row], m[0]*v[0]+m[1]*v[1]+m[2]*v[2], 1e-4f);
+        }
+    }
+}
+
+TEST(QuaternionRotate,BatchOneQuaternion)
+{
+    Quaternion<float> q = testRotations(4)[3];
+    std::vector< Matrix<float,3,1> > vectors = testVectors(29);
+    std::vector< Matrix<float,3,1> > rotated(vectors.size());
+
+    rotateVectors(vectors.size(), q, vectors.data(), rotated.data());
+
+    for(std::size_t i = 0; i < vectors.size(); ++i)
+    {
+        Matrix<float,3,1> expected = q.rotate(vectors[i]);
+        for(std::size_t j = 0; j < 3; ++j)
+        {
+            EXPECT_NEAR(rotated[i].data()[j], expected.data()[j], 1e-5f);
+        }
+    }
+}
+
+TEST(QuaternionRotate,BatchPerElementInPlace)
+{
+    std::vector< Quaternion<float> > rotations = testRotations(30);
+    std::vector< Matrix<float,3,1> > vectors = testVectors(rotations.size());
+    std::vector< Matrix<float,3,1> > original = vectors;
+
+    rotateVectors(vectors.size(), rotations.data(), vectors.data(), vectors.data());
+
+    for(std::size_t i = 0; i < vectors.size(); ++i)
+    {
+        Matrix<float,3,1> expected = rotations[i].rotate(original[i]);
+        for(std::size_t j = 0; j < 3; ++j)
+        {
+            EXPECT_NEAR(vectors[i].data()[j], expected.data()[j], 1e-5f);
+        }
+    }
+}
+
+TEST(QuaternionRotate,BatchDouble)
+{
+    Quaternion<double> q(0.5,0.5,0.5,0.5);
+    std::vector< Matrix<double,3,1> > vectors(3, Matrix<double,3,1>{1.0,0.0,0.0});
+    std::vector< Matrix<double,3,1> > rotated(vectors.size());
+
+    rotateVectors(vectors.size(), q, vectors.data(), rotated.data());
+
+    // a third of a turn about (1,1,1) takes x to y
+    EXPECT_NEAR(rotated[2].data()[0], 0.0, 1e-12);
+    EXPECT_NEAR(rotated[2].data()[1], 1.0, 1e-12);
+    EXPECT_NEAR(rotated[2].data()[2], 0.0, 1e-12);
+}
+
+TEST(QuaternionSimd,AlignedStorage)
+{
+    EXPECT_EQ(sizeof(Quaternion<float>), 4*sizeof(float));
+    EXPECT_EQ(alignof(Quaternion<float>), 16u);
+    EXPECT_EQ(sizeof(Quaternion<double>), 4*sizeof(double));
+
+    std::vector< Quaternion<float> > array(5);
+    for(std::size_t i = 0; i < array.size(); ++i)
+    {
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&array[i]) % 16, 0u);
+    }
+}
+
+TEST(QuaternionSimd,MultiplyMatchesGeneric)
+{
+    // long double goes through the generic kernels, float and double through the SIMD ones when enabled
+    std::vector< Quaternion<float> > rotations = testRotations(12);
+    for(std::size_t i = 0; i + 1 < rotations.size(); ++i)
+    {
+        Matrix<float,3,3> m0 = rotations[i].toMatrix3();
+        Matrix<float,3,3> m1 = rotations[i+1].toMatrix3();
+        Quaternion<long double> l = Quaternion<long double>::fromMatrix(Matrix<long double,3,3>{
+            m0.data()[0],m0.data()[1],m0.data()[2],m0.data()[3],m0.data()[4],m0.data()[5],m0.data()[6],m0.data()[7],m0.data()[8]});
+        Quaternion<long double> r = Quaternion<long double>::fromMatrix(Matrix<long double,3,3>{
+            m1.data()[0],m1.data()[1],m1.data()[2],m1.data()[3],m1.data()[4],m1.data()[5],m1.data()[6],m1.data()[7],m1.data()[8]});
+        Quaternion<float> lf = Quaternion<float>::fromMatrix(m0);
+        Quaternion<float> rf = Quaternion<float>::fromMatrix(m1);
+
+        Quaternion<long double> expected = l*r;
+        Matrix<long double,3,3> expectedMatrix = expected.toMatrix3();
+        Matrix<float,3,3> product = (lf*rf).toMatrix3();
+        for(std::size_t j = 0; j < 9; ++j)
+        {
+            EXPECT_NEAR(product.data()[j], expectedMatrix.data()[j], 1e-5);
+        }
+    }
+}
+
+TEST(QuaternionSimd,DotFunction)
+{
+    Quaternion<float> q(1.0f,2.0f,3.0f,4.0f);
+    Quaternion<float> q2(0.5f,-1.0f,2.0f,0.25f);
+    Quaternion<double> d(1.0,2.0,3.0,4.0);
 
+    EXPECT_EQ(q.dot(q2), 5.5f);
+    EXPECT_EQ(d.dot(d), 30.0);
+    EXPECT_EQ(q.norm(), std::sqrt(30.0f));
+}
+
+TEST(QuaternionSimd,NormalizeFast)
+{
+    Quaternion<float> q(1.0f,2.0f,3.0f,4.0f);
+    Quaternion<float> exact(q);
+    exact.normalize();
+    q.normalizeFast();
 
+    EXPECT_LT(quaternionError(q, exact), 1e-6f);
+    EXPECT_NEAR(q.norm(), 1.0f, 1e-6f);
 
+    Quaternion<float> zero;
+    EXPECT_TRUE(zero.normalizeFast() == Quaternion<float>());
+}
 
+TEST(QuaternionSimd,UnalignedFloatKernels)
+{
+    // the float kernels take raw pointers so they must work on quaternions packed at any float offset
+    alignas(16) float buffer[13] = {0.0f, 1.0f,2.0f,3.0f,4.0f, 0.5f,-1.0f,2.0f,0.25f, 0.0f,0.0f,0.0f,0.0f};
+    float* l = buffer + 1;
+    float* r = buffer + 5;
+    float* out = buffer + 9;
+
+    quaternionMultiplyKernel(l,r,out);
+    Quaternion<float> expected = Quaternion<float>(1.0f,2.0f,3.0f,4.0f)*Quaternion<float>(0.5f,-1.0f,2.0f,0.25f);
+    for(std::size_t i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(out[i], expected.data()[i]);
+    }
+
+    EXPECT_EQ(quaternionDotKernel(l,r), 5.5f);
+
+    quaternionConjugateKernel(l);
+    EXPECT_EQ(l[1], -2.0f);
+    quaternionInverseKernel(r);
+    EXPECT_NEAR(r[0], 0.5f/5.3125f, 1e-7f);
+    quaternionNormalizeKernel(out);
+    EXPECT_NEAR(quaternionDotKernel(out,out), 1.0f, 1e-6f);
+    quaternionNormalizeFastKernel(l);
+    EXPECT_NEAR(quaternionDotKernel(l,l), 1.0f, 1e-6f);
+    EXPECT_EQ(buffer[0], 0.0f);
+}
 
+TEST(QuaternionSimd,InverseDouble)
+{
+    Quaternion<double> q(1.0,-2.0,0.5,3.0);
+    Quaternion<double> inverse(q);
+    inverse.inverse();
 
+    Quaternion<double> identity(1.0,0.0,0.0,0.0);
+    EXPECT_LT((q*inverse - identity).norm(), 1e-15);
+}
 
+TEST(QuaternionInterpolation,SlerpEndsAndMiddle)
+{
+    float h = std::sqrt(0.5f);
+    Quaternion<float> q0(1.0f,0.0f,0.0f,0.0f);
+    // 90 degrees about z
+    Quaternion<float> q1(h,0.0f,0.0f,h);
+
+    EXPECT_LT(quaternionError(Quaternion<float>::slerp(q0,q1,0.0f), q0), 1e-6f);
+    EXPECT_LT(quaternionError(Quaternion<float>::slerp(q0,q1,1.0f), q1), 1e-6f);
+
+    // half way is 45 degrees
+    Quaternion<float> half(std::cos(0.125f*3.14159265f),0.0f,0.0f,std::sin(0.125f*3.14159265f));
+    EXPECT_LT(quaternionError(Quaternion<float>::slerp(q0,q1,0.5f), half), 1e-6f);
+    EXPECT_LT(quaternionError(Quaternion<float>::nlerp(q0,q1,0.5f), half), 1e-6f);
+    EXPECT_LT(quaternionError(Quaternion<float>::slerpFast(q0,q1,0.5f), half), 1e-6f);
+}
 
+TEST(QuaternionInterpolation,ShortPath)
+{
+    std::vector< Quaternion<float> > rotations = testRotations(6);
+    Quaternion<float> negated(rotations[5]);
+    -negated;
+
+    // -q is the same rotation, the result must not go the long way round
+    for(float t = 0.0f; t <= 1.0f; t += 0.25f)
+    {
+        EXPECT_LT(rotationError(Quaternion<float>::slerp(rotations[1],negated,t),
+                                Quaternion<float>::slerp(rotations[1],rotations[5],t)), 1e-5f);
+        EXPECT_LT(rotationError(Quaternion<float>::nlerp(rotations[1],negated,t),
+                                Quaternion<float>::nlerp(rotations[1],rotations[5],t)), 1e-5f);
+    }
+}
+
+TEST(QuaternionInterpolation,SlerpFastFollowsSlerp)
+{
+    std::vector< Quaternion<double> > rotations;
+    for(std::size_t i = 0; i <= 20; ++i)
+    {
+        // 0 to 180 degrees about x
+        double angle = 3.14159265358979*i/20;
+        rotations.push_back(Quaternion<double>(std::cos(angle/2),std::sin(angle/2),0.0,0.0));
+    }
+
+    Quaternion<double> start(1.0,0.0,0.0,0.0);
+    for(std::size_t i = 0; i < rotations.size(); ++i)
+    {
+        for(double t = 0.0; t <= 1.0; t += 0.05)
+        {
+            Quaternion<double> exact = Quaternion<double>::slerp(start,rotations[i],t);
+            Quaternion<double> fast = Quaternion<double>::slerpFast(start,rotations[i],t);
+            // angle between the two rotations
+            double angle = 2*std::acos(std::min(1.0,std::fabs(exact.dot(fast))));
+            EXPECT_LT(angle, 1e-3);
+        }
+    }
+}
+
+TEST(QuaternionInterpolation,Batches)
+{
+    // not a multiple of the SIMD width, some pairs have negative dot products
+    std::vector< Quaternion<float> > q0 = testRotations(34);
+    std::vector< Quaternion<float> > q1(q0.rbegin(), q0.rend());
+    std::vector<float> t(q0.size());
+    for(std::size_t i = 0; i < t.size(); ++i)
+    {
+        t[i] = (i % 11)/10.0f;
+    }
+
+    std::vector< Quaternion<float> > slerped(q0.size()), nlerped(q0.size()), fast(q0.size());
+    slerpBatch(q0.size(), q0.data(), q1.data(), t.data(), slerped.data());
+    nlerpBatch(q0.size(), q0.data(), q1.data(), t.data(), nlerped.data());
+    slerpFastBatch(q0.size(), q0.data(), q1.data(), t.data(), fast.data());
+
+    for(std::size_t i = 0; i < q0.size(); ++i)
+    {
+        EXPECT_LT(quaternionError(slerped[i], Quaternion<float>::slerp(q0[i],q1[i],t[i])), 4e-6f);
+        EXPECT_LT(quaternionError(nlerped[i], Quaternion<float>::nlerp(q0[i],q1[i],t[i])), 1e-6f);
+        EXPECT_LT(quaternionError(fast[i], Quaternion<float>::slerpFast(q0[i],q1[i],t[i])), 1e-6f);
+    }
+}
+
+TEST(QuaternionInterpolation,BatchDouble)
+{
+    std::vector< Quaternion<double> > q0(3, Quaternion<double>(1.0,0.0,0.0,0.0));
+    std::vector< Quaternion<double> > q1(3, Quaternion<double>(0.0,0.0,1.0,0.0));
+    std::vector<double> t = {0.0, 0.5, 1.0};
+    std::vector< Quaternion<double> > out(3);
+
+    slerpBatch(q0.size(), q0.data(), q1.data(), t.data(), out.data());
+
+    EXPECT_LT((out[1] - Quaternion<double>(std::sqrt(0.5),0.0,std::sqrt(0.5),0.0)).norm(), 1e-12);
+    EXPECT_LT((out[2] - q1[2]).norm(), 1e-12);
+}
+
+TEST(QuaternionAccess,NamedComponents)
+{
+    Quaternion<int> q(1,2,3,4);
+    q.c() = 7;
+
+    EXPECT_EQ(q.a(), 1);
+    EXPECT_EQ(q.b(), 2);
+    EXPECT_EQ(q.c(), 7);
+    EXPECT_EQ(q.d(), 4);
+
+    const Quaternion<int> constant(q);
+    EXPECT_EQ(constant.get<0>(), 1);
+    EXPECT_EQ(constant.get<2>(), 7);
+    q.get<3>() = 9;
+    EXPECT_EQ(q.d(), 9);
+}
 
+TEST(QuaternionAccess,ContiguousData)
+{
+    Quaternion<float> q(1.0f,2.0f,3.0f,4.0f);
+    float* data = q.data();
+
+    EXPECT_EQ(data[0], 1.0f);
+    EXPECT_EQ(data[3], 4.0f);
+    EXPECT_EQ(&data[1], &q.b());
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(data) % 16, 0u);
+
+    data[2] = -3.0f;
+    EXPECT_EQ(q.c(), -3.0f);
+}
+
+TEST(QuaternionAccess,GetDataByContent)
+{
+    Quaternion<double> q(1.0,2.0,3.0,4.0);
+    // a name that isn't a string literal, which comparing pointers didn't match
+    char name[2] = {'c', '\0'};
+
+    q.setData(name, 5.0);
+
+    EXPECT_EQ(q.getData(name), 5.0);
+    EXPECT_EQ(q.getData("d"), 4.0);
+    EXPECT_THROW(q.getData("e"), std::out_of_range);
+    EXPECT_THROW(q.setData("ab", 1.0), std::out_of_range);
+}
+
+TEST(QuaternionExpLog,RoundTrip)
+{
+    // not unit length, vector parts shorter than π so log(exp(q)) is the principal value
+    std::vector< Quaternion<double> > quaternions = {Quaternion<double>(0.5,0.1,-0.2,0.3),
+                                                     Quaternion<double>(-2.0,1.0,0.5,-0.25),
+                                                     Quaternion<double>(3.0,0.0,0.0,0.0),
+                                                     Quaternion<double>(0.0,1.5,-1.0,2.0)};
+    for(const Quaternion<double>& q : quaternions)
+    {
+        Quaternion<double> back = Quaternion<double>::exp(Quaternion<double>::log(q));
+        EXPECT_LT((back - q).norm(), 1e-14);
+    }
+
+    Quaternion<double> small(0.25,0.5,-1.0,0.75);
+    EXPECT_LT((Quaternion<double>::log(Quaternion<double>::exp(small)) - small).norm(), 1e-14);
+
+    // -1 has no unique log, the one given still comes back to -1
+    Quaternion<double> minusOne(-1.0,0.0,0.0,0.0);
+    EXPECT_LT((Quaternion<double>::exp(Quaternion<double>::log(minusOne)) - minusOne).norm(), 1e-15);
+    EXPECT_TRUE(Quaternion<double>::exp(Quaternion<double>()) == Quaternion<double>(1.0,0.0,0.0,0.0));
+}
+
+TEST(QuaternionExpLog,Pow)
+{
+    Matrix<double,3,1> axis{1.0,-2.0,0.5};
+    Quaternion<double> q = Quaternion<double>::fromAxisAngle(axis, 1.2);
+
+    // a fraction of the rotation about the same axis
+    Quaternion<double> third = Quaternion<double>::pow(q, 1.0/3.0);
+    Quaternion<double> difference(third);
+    EXPECT_LT((difference - Quaternion<double>::fromAxisAngle(axis, 0.4)).norm(), 1e-15);
+    Quaternion<double> cubed(third);
+    cubed * third * third;
+    EXPECT_LT((cubed - q).norm(), 1e-15);
+
+    // the norm is raised to the power as well
+    Quaternion<double> scaled(q);
+    scaled * 2.0;
+    EXPECT_NEAR(Quaternion<double>::pow(scaled, 3.0).norm(), 8.0, 1e-13);
+    EXPECT_TRUE(Quaternion<double>::pow(Quaternion<double>(), 2.0) == Quaternion<double>());
+}
+
+TEST(QuaternionExpLog,AxisAngle)
+{
+    // 90 degrees about z takes x to y
+    Matrix<float,3,1> z{0.0f,0.0f,2.0f};
+    Quaternion<float> q = Quaternion<float>::fromAxisAngle(z, float(M_PI/2));
+    Matrix<float,3,1> r = q.rotate(Matrix<float,3,1>{1.0f,0.0f,0.0f});
+    EXPECT_NEAR(r.data()[0], 0.0f, 1e-6f);
+    EXPECT_NEAR(r.data()[1], 1.0f, 1e-6f);
+
+    Matrix<float,3,1> axis;
+    float angle;
+    for(const Quaternion<float>& rotation : testRotations(20))
+    {
+        rotation.toAxisAngle(axis, angle);
+        EXPECT_GE(angle, 0.0f);
+        EXPECT_LE(angle, float(2*M_PI));
+        EXPECT_LT(quaternionError(Quaternion<float>::fromAxisAngle(axis, angle), rotation), 1e-6f);
+    }
+
+    // the scale of the quaternion doesn't change the angle, -q is the other way round the axis
+    Quaternion<float> scaled = Quaternion<float>::fromAxisAngle(z, 0.5f);
+    scaled * -3.0f;
+    scaled.toAxisAngle(axis, angle);
+    EXPECT_NEAR(angle, float(2*M_PI) - 0.5f, 1e-6f);
+    EXPECT_NEAR(axis.data()[2], -1.0f, 1e-6f);
+
+    // no rotation and a zero axis
+    Quaternion<float>(1.0f,0.0f,0.0f,0.0f).toAxisAngle(axis, angle);
+    EXPECT_EQ(angle, 0.0f);
+    EXPECT_EQ(axis.data()[0], 1.0f);
+    EXPECT_TRUE(Quaternion<float>::fromAxisAngle(Matrix<float,3,1>(), 1.0f) == Quaternion<float>(1.0f,0.0f,0.0f,0.0f));
+}
+
+// angular velocities from slow to more than π per step at dt = 0.1
+static std::vector< Matrix<float,3,1> > testAngularVelocities(std::size_t _n)
+{
+    std::vector< Matrix<float,3,1> > omega = testVectors(_n);
+    for(std::size_t i = 0; i < _n; ++i)
+    {
+        float s = i % 9 == 4 ? 20.0f : 1.0f;
+        for(std::size_t k = 0; k < 3; ++k)
+        {
+            omega[i].data()[k] *= s;
+        }
+    }
+    return omega;
+}
+
+TEST(QuaternionIntegrate,ConstantVelocity)
+{
+    // a constant angular velocity is integrated exactly whatever the step
+    Matrix<double,3,1> omega{0.3,-1.2,2.0};
+    std::vector< Quaternion<double> > q(1, Quaternion<double>::fromAxisAngle(Matrix<double,3,1>{1.0,1.0,0.0}, 0.7));
+    Quaternion<double> start(q[0]);
+
+    for(std::size_t step = 0; step < 100; ++step)
+    {
+        integrateOrientations(1, q.data(), &omega, 0.01);
+    }
+
+    double speed = std::sqrt(0.09+1.44+4.0);
+    Quaternion<double> expected = Quaternion<double>::fromAxisAngle(omega, speed);
+    expected * start;
+    EXPECT_LT((q[0] - expected).norm(), 1e-13);
+}
+
+TEST(QuaternionIntegrate,FloatMatchesDouble)
+{
+    std::vector< Quaternion<float> > q = testRotations(37);
+    std::vector< Matrix<float,3,1> > omega = testAngularVelocities(q.size());
+
+    std::vector< Quaternion<double> > qDouble;
+    std::vector< Matrix<double,3,1> > omegaDouble(q.size());
+    for(std::size_t i = 0; i < q.size(); ++i)
+    {
+        qDouble.push_back(Quaternion<double>(q[i].a(), q[i].b(), q[i].c(), q[i].d()));
+        for(std::size_t k = 0; k < 3; ++k)
+        {
+            omegaDouble[i].data()[k] = omega[i].data()[k];
+        }
+    }
+
+    for(std::size_t step = 0; step < 10; ++step)
+    {
+        integrateOrientations(q.size(), q.data(), omega.data(), 0.1f);
+        integrateOrientations(qDouble.size(), qDouble.data(), omegaDouble.data(), 0.1);
+    }
+
+    for(std::size_t i = 0; i < q.size(); ++i)
+    {
+        Quaternion<float> expected(float(qDouble[i].a()), float(qDouble[i].b()), float(qDouble[i].c()),
+                                   float(qDouble[i].d()));
+        EXPECT_LT(quaternionError(q[i], expected), 2e-5f);
+        EXPECT_NEAR(q[i].norm(), 1.0f, 1e-5f);
+    }
+}
+
+TEST(QuaternionIntegrate,LazyRenormalization)
+{
+    std::vector< Quaternion<float> > q = testRotations(21);
+    std::vector< Matrix<float,3,1> > omega = testAngularVelocities(q.size());
+
+    // unit orientations stepped by unit rotations stay within the default threshold
+    EXPECT_EQ(integrateOrientations(q.size(), q.data(), omega.data(), 0.01f), 0u);
+
+    // orientations that have drifted are all renormalized and only those
+    q[3] * 1.01f;
+    q[17] * 0.99f;
+    EXPECT_EQ(integrateOrientations(q.size(), q.data(), omega.data(), 0.01f), 2u);
+    EXPECT_NEAR(q[3].norm(), 1.0f, 1e-6f);
+    EXPECT_NEAR(q[17].norm(), 1.0f, 1e-6f);
+
+    // a large threshold never renormalizes
+    q[5] * 1.5f;
+    EXPECT_EQ(integrateOrientations(q.size(), q.data(), omega.data(), 0.01f, 10.0f), 0u);
+    EXPECT_NEAR(q[5].norm(), 1.5f, 1e-5f);
+
+    std::vector< Quaternion<double> > qDouble(4, Quaternion<double>(2.0,0.0,0.0,0.0));
+    std::vector< Matrix<double,3,1> > omegaDouble(4);
+    EXPECT_EQ(integrateOrientations(qDouble.size(), qDouble.data(), omegaDouble.data(), 0.01), 4u);
+    EXPECT_TRUE(qDouble[2] == Quaternion<double>(1.0,0.0,0.0,0.0));
+}
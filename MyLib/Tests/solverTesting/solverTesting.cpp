@@ -0,0 +1,225 @@
+#include <iostream>
+#include <cmath>
+#include "iterativeSolvers.h"
+#include <gtest/gtest.h>
+
+/// Tests for the conjugate gradient and BiCGSTAB solvers and their preconditioners.
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
+
+// 1D Laplacian (2 on the diagonal, -1 either side), symmetric positive definite
+CsrMatrix<double> laplacian(std::size_t _n)
+{
+    std::vector< Triplet<double> > triplets;
+    for(std::size_t i=1; i<=_n; i++)
+    {
+      triplets.push_back({i,i,2.0});
+      if(i > 1)
+      {
+        triplets.push_back({i,i-1,-1.0});
+      }
+      if(i < _n)
+      {
+        triplets.push_back({i,i+1,-1.0});
+      }
+    }
+    return CsrMatrix<double>::fromTriplets(_n,_n,triplets);
+}
+
+// largest difference between A*x and b
+double residual(const CsrMatrix<double>& _mat, const std::vector<double>& _x, const std::vector<double>& _b)
+{
+    std::vector<double> ax(_b.size());
+    _mat.multiply(_x.data(),ax.data());
+    double worst = 0;
+    for(std::size_t i=0; i<_b.size(); i++)
+    {
+      worst = std::max(worst,std::abs(ax[i]-_b[i]));
+    }
+    return worst;
+}
+
+TEST(ConjugateGradient,DenseMatrix)
+{
+    Matrix<double,3,3> mat{4,1,0,1,3,1,0,1,2};
+    Matrix<double,3,1> b{1,2,3};
+    Matrix<double,3,1> x;
+    ConjugateGradient<double> cg(3,100,1e-12);
+
+    SolverResult<double> result = cg.solve(mat,b,x);
+
+    EXPECT_TRUE(result.converged);
+    EXPECT_TRUE(result.iterations <= 3);
+    Matrix<double,3,1> check{4*x(1,1)+x(2,1), x(1,1)+3*x(2,1)+x(3,1), x(2,1)+2*x(3,1)};
+    for(int i=1; i<=3; i++)
+    {
+      EXPECT_NEAR(check(i,1),b(i,1),1e-9);
+    }
+
+}
+
+TEST(ConjugateGradient,SparsePreconditioners)
+{
+    const std::size_t n = 200;
+    CsrMatrix<double> mat = laplacian(n);
+    std::vector<double> b(n,1.0);
+    ConjugateGradient<double> cg(n,1000,1e-10);
+
+    std::vector<double> x(n,0.0);
+    SolverResult<double> plain = cg.solve(matrixOperator(mat),b.data(),x.data());
+    EXPECT_TRUE(plain.converged);
+    EXPECT_TRUE(residual(mat,x,b) < 1e-6);
+
+    std::fill(x.begin(),x.end(),0.0);
+    SolverResult<double> jacobi = cg.solve(matrixOperator(mat),b.data(),x.data(),JacobiPreconditioner<double>(mat));
+    EXPECT_TRUE(jacobi.converged);
+    EXPECT_TRUE(residual(mat,x,b) < 1e-6);
+
+    // IC(0) of a tridiagonal matrix is its exact Cholesky factor so one iteration is enough
+    std::fill(x.begin(),x.end(),0.0);
+    SolverResult<double> cholesky = cg.solve(matrixOperator(mat),b.data(),x.data(),IncompleteCholesky<double>(mat));
+    EXPECT_TRUE(cholesky.converged);
+    EXPECT_TRUE(cholesky.iterations <= 2);
+    EXPECT_TRUE(residual(mat,x,b) < 1e-6);
+
+}
+
+TEST(ConjugateGradient,OperatorCallback)
+{
+    // A = diag(1..n), never stored
+    const std::size_t n = 50;
+    std::vector<double> b(n);
+    std::vector<double> x(n,0.0);
+    for(std::size_t i=0; i<n; i++)
+    {
+      b[i] = double(i+1);
+    }
+    ConjugateGradient<double> cg(n,200,1e-12);
+
+    SolverResult<double> result = cg.solve([](const double* _in, double* _out)
+    {
+      for(std::size_t i=0; i<n; i++)
+      {
+        _out[i] = double(i+1)*_in[i];
+      }
+    },b.data(),x.data());
+
+    EXPECT_TRUE(result.converged);
+    for(std::size_t i=0; i<n; i++)
+    {
+      EXPECT_NEAR(x[i],1.0,1e-9);
+    }
+
+}
+
+TEST(ConjugateGradient,MonitorAndLimit)
+{
+    const std::size_t n = 100;
+    CsrMatrix<double> mat = laplacian(n);
+    std::vector<double> b(n,1.0);
+    std::vector<double> x(n,0.0);
+    std::vector<double> history;
+    ConjugateGradient<double> cg(n,5,1e-12);
+    cg.setMonitor([&history](std::size_t, double _residual) { history.push_back(_residual); });
+
+    SolverResult<double> result = cg.solve(matrixOperator(mat),b.data(),x.data());
+
+    EXPECT_FALSE(result.converged);
+    EXPECT_TRUE(result.iterations == 5);
+    EXPECT_TRUE(history.size() == 5);
+    EXPECT_TRUE(history.back() == result.residual);
+
+}
+
+TEST(IncompleteCholesky,NotPositiveDefinite)
+{
+    Matrix<double,2,2> mat{1,2,2,1};
+
+    EXPECT_THROW(IncompleteCholesky<double> ic(mat),std::out_of_range);
+
+}
+
+TEST(BiCGStab,NonSymmetric)
+{
+    const std::size_t n = 100;
+    std::vector< Triplet<double> > triplets;
+    for(std::size_t i=1; i<=n; i++)
+    {
+      triplets.push_back({i,i,4.0});
+      if(i > 1)
+      {
+        triplets.push_back({i,i-1,-2.0});
+      }
+      if(i < n)
+      {
+        triplets.push_back({i,i+1,-1.0});
+      }
+    }
+    CsrMatrix<double> mat = CsrMatrix<double>::fromTriplets(n,n,triplets);
+    std::vector<double> b(n,1.0);
+    std::vector<double> x(n,0.0);
+    std::size_t calls = 0;
+    BiCGStab<double> solver(n,500,1e-10);
+    solver.setMonitor([&calls](std::size_t, double) { ++calls; });
+
+    SolverResult<double> result = solver.solve(matrixOperator(mat),b.data(),x.data(),JacobiPreconditioner<double>(mat));
+
+    EXPECT_TRUE(result.converged);
+    EXPECT_TRUE(calls == result.iterations);
+    EXPECT_TRUE(residual(mat,x,b) < 1e-6);
+
+}
+
+TEST(BiCGStab,DenseMatrix)
+{
+    Matrix<double,3,3> mat{3,1,0,-1,4,2,0,1,5};
+    Matrix<double,3,1> b{4,5,6};
+    Matrix<double,3,1> x;
+    BiCGStab<double> solver(3,100,1e-12);
+
+    SolverResult<double> result = solver.solve(mat,b,x);
+
+    EXPECT_TRUE(result.converged);
+    EXPECT_NEAR(3*x(1,1)+x(2,1),4.0,1e-9);
+    EXPECT_NEAR(-x(1,1)+4*x(2,1)+2*x(3,1),5.0,1e-9);
+    EXPECT_NEAR(x(2,1)+5*x(3,1),6.0,1e-9);
+
+}
+
+TEST(IterativeSolvers,MatrixSizeMismatch)
+{
+    // the work vectors only hold the solver's size, a bigger or smaller matrix must not be solved
+    Matrix<double,3,3> mat{4,1,0,1,3,1,0,1,2};
+    Matrix<double,3,1> b{1,2,3};
+    Matrix<double,3,1> x;
+    ConjugateGradient<double> smaller(2);
+    ConjugateGradient<double> bigger(4);
+    BiCGStab<double> bicg(2);
+
+    EXPECT_THROW(smaller.solve(mat,b,x),std::out_of_range);
+    EXPECT_THROW(bigger.solve(mat,b,x),std::out_of_range);
+    EXPECT_THROW(bicg.solve(mat,b,x),std::out_of_range);
+
+}
+
+TEST(ConjugateGradient,ArenaWorkspace)
+{
+    const std::size_t n = 64;
+    CsrMatrix<double> mat = laplacian(n);
+    std::vector<double> b(n,1.0);
+    std::vector<double> x(n,0.0);
+    Arena arena;
+    ConjugateGradient<double,ArenaAllocator<double> > cg(n,1000,1e-10,ArenaAllocator<double>(arena));
+
+    SolverResult<double> result = cg.solve(matrixOperator(mat),b.data(),x.data());
+
+    EXPECT_TRUE(result.converged);
+    EXPECT_TRUE(arena.blockCount() == 1);
+    EXPECT_TRUE(residual(mat,x,b) < 1e-6);
+
+}
@@ -0,0 +1,174 @@
+#include <iostream>
+#include "sparseMatrix.h"
+#include <gtest/gtest.h>
+
+/// Tests for sparse matrix construction, products and transposes.
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
+
+// 3x4 matrix used by most of the tests
+//  1 0 0 2
+//  0 0 3 0
+//  4 5 0 6
+std::vector< Triplet<double> > exampleTriplets()
+{
+    std::vector< Triplet<double> > triplets = {{3,4,6.0},{1,1,1.0},{2,3,3.0},{3,1,4.0},{1,4,2.0},{3,2,2.0},{3,2,3.0}};
+    return triplets;
+}
+
+TEST(SparseConstructors,FromTriplets)
+{
+    CsrMatrix<double> mat = CsrMatrix<double>::fromTriplets(3,4,exampleTriplets());
+
+    EXPECT_TRUE(mat.getRows() == 3);
+    EXPECT_TRUE(mat.getCols() == 4);
+    // the two (3,2) entries are added together
+    EXPECT_TRUE(mat.nonZeros() == 6);
+    EXPECT_TRUE(mat(3,2) == 5.0);
+    EXPECT_TRUE(mat(1,4) == 2.0);
+    EXPECT_TRUE(mat(2,1) == 0.0);
+
+}
+
+TEST(SparseConstructors,FromTripletsOutOfRange)
+{
+    std::vector< Triplet<double> > triplets = {{4,1,1.0}};
+
+    EXPECT_THROW(CsrMatrix<double>::fromTriplets(3,4,triplets),std::out_of_range);
+
+}
+
+TEST(SparseConstructors,DenseRoundTrip)
+{
+    Matrix<double,3,4> dense{1,0,0,2,0,0,3,0,4,5,0,6};
+    Matrix<double,3,4> result;
+
+    CsrMatrix<double> mat = CsrMatrix<double>::fromDense(dense);
+    mat.toDense(result);
+
+    EXPECT_TRUE(mat.nonZeros() == 6);
+    EXPECT_TRUE(result == dense);
+
+}
+
+TEST(SparseOperations,SpMV)
+{
+    CsrMatrix<double> mat = CsrMatrix<double>::fromTriplets(3,4,exampleTriplets());
+    Matrix<double,4,1> x{1,2,3,4};
+    Matrix<double,3,1> y;
+    Matrix<double,3,1> result{9,9,38};
+
+    mat.multiply(x,y);
+
+    EXPECT_TRUE(y == result);
+
+}
+
+TEST(SparseOperations,SpMM)
+{
+    CsrMatrix<double> mat = CsrMatrix<double>::fromTriplets(3,4,exampleTriplets());
+    Matrix<double,4,2> x{1,0,0,1,1,1,0,2};
+    Matrix<double,3,2> y;
+    Matrix<double,3,2> result{1,4,3,3,4,17};
+
+    mat.multiply(x,y);
+
+    EXPECT_TRUE(y == result);
+
+}
+
+TEST(SparseOperations,SpMVSizeError)
+{
+    CsrMatrix<double> mat = CsrMatrix<double>::fromTriplets(3,4,exampleTriplets());
+    Matrix<double,3,1> x;
+    Matrix<double,3,1> y;
+
+    EXPECT_THROW(mat.multiply(x,y),std::out_of_range);
+
+}
+
+TEST(SparseOperations,Transpose)
+{
+    CsrMatrix<double> mat = CsrMatrix<double>::fromTriplets(3,4,exampleTriplets());
+    CsrMatrix<double> trans = mat.transpose();
+
+    EXPECT_TRUE(trans.getRows() == 4);
+    EXPECT_TRUE(trans.getCols() == 3);
+    for(size_t i=1; i<=3; i++)
+    {
+      for(size_t j=1; j<=4; j++)
+      {
+        EXPECT_TRUE(trans(j,i) == mat(i,j));
+      }
+    }
+
+}
+
+TEST(SparseOperations,CscMatchesCsr)
+{
+    CsrMatrix<double> csr = CsrMatrix<double>::fromTriplets(3,4,exampleTriplets());
+    CscMatrix<double> csc = CscMatrix<double>::fromTriplets(3,4,exampleTriplets());
+    double x[4] = {1,2,3,4};
+    double y[3];
+    double y2[3];
+
+    csr.multiply(x,y);
+    csc.multiply(x,y2);
+
+    EXPECT_TRUE(csc(3,2) == 5.0);
+    EXPECT_TRUE(csc.colStart().size() == 5);
+    for(int i=0; i<3; i++)
+    {
+      EXPECT_TRUE(y[i] == y2[i]);
+    }
+    EXPECT_TRUE(csr.toCsc()(1,4) == 2.0);
+    EXPECT_TRUE(csc.toCsr()(3,1) == 4.0);
+
+}
+
+TEST(SparseOperations,BlockSparse)
+{
+    BsrMatrix<double,2> bsr = BsrMatrix<double,2>::fromTriplets(4,4,{{1,1,1.0},{2,2,2.0},{4,3,3.0},{4,4,4.0},{1,4,5.0}});
+    Matrix<double,4,1> x{1,2,3,4};
+    Matrix<double,4,1> y;
+    Matrix<double,4,1> result{21,4,0,25};
+
+    bsr.multiply(x,y);
+
+    EXPECT_TRUE(bsr.nonZeroBlocks() == 3);
+    EXPECT_TRUE(bsr(4,3) == 3.0);
+    EXPECT_TRUE(bsr(3,1) == 0.0);
+    EXPECT_TRUE(y == result);
+
+}
+
+TEST(SparseOperations,ParallelSpMV)
+{
+    // 1D laplacian, large enough to be split across threads
+    const size_t n = 200000;
+    std::vector< Triplet<double> > triplets;
+    for(size_t i=1; i<=n; i++)
+    {
+      triplets.push_back({i,i,2.0});
+      if(i>1) triplets.push_back({i,i-1,-1.0});
+      if(i<n) triplets.push_back({i,i+1,-1.0});
+    }
+    CsrMatrix<double> mat = CsrMatrix<double>::fromTriplets(n,n,triplets);
+
+    std::vector<double> x(n,1.0);
+    std::vector<double> y(n,5.0);
+
+    setParallelThreads(4);
+    mat.multiply(x.data(),y.data());
+    setParallelThreads(0);
+
+    EXPECT_EQ(y[0],1.0);
+    EXPECT_EQ(y[n/2],0.0);
+    EXPECT_EQ(y[n-1],1.0);
+
+}
@@ -1,5 +1,6 @@
 #include <iostream>
 #include "matrix.h"
+#include "matrixBlas.h"
 #include <gtest/gtest.h>
 
 /// Tests for vector constructors, operators anf functions
@@ -294,6 +295,156 @@ TEST(VectorFunctions,4DVectorRotationError)
 
 }
 
+TEST(VectorBlas,Axpy)
+{
+    Matrix<float,3,1> x{1.0f,2.0f,3.0f};
+    Matrix<float,3,1> y{1.0f,1.0f,1.0f};
+    Matrix<float,3,1> resultX{1.0f,2.0f,3.0f};
+    Matrix<float,3,1> resultY{3.0f,5.0f,7.0f};
+
+    axpy(2.0f,x,y);
+
+    EXPECT_TRUE(y == resultY);
+    EXPECT_TRUE(x == resultX);
+
+}
+
+TEST(VectorBlas,Axpby)
+{
+    Matrix<double,1,4> x{1,2,3,4};
+    Matrix<double,1,4> y{4,3,2,1};
+    Matrix<double,1,4> result{2.5,2.5,2.5,2.5};
+
+    axpby(0.5,x,0.5,y);
+
+    EXPECT_TRUE(y == result);
+
+}
+
+TEST(VectorBlas,Gemv)
+{
+    Matrix<int,2,3> mat{1,0,-2,0,3,-1};
+    Matrix<int,3,1> x{1,2,3};
+    Matrix<int,2,1> y{1,1};
+    Matrix<int,2,1> result{-7,9};
+
+    // y = 2*A*x + 3*y
+    gemv(2,mat,x,3,y);
+
+    EXPECT_TRUE(y == result);
+
+}
+
+TEST(VectorBlas,GemvLarge)
+{
+    // odd number of columns to cover the remainder of the unrolled loop
+    const size_t n = 257;
+    Matrix<double,n,n>* mat = new Matrix<double,n,n>;
+    Matrix<double,n,1> x;
+    Matrix<double,n,1> y;
+
+    for(size_t i=0; i<n; i++)
+    {
+      x.data()[i] = 1.0;
+      for(size_t j=0; j<n; j++)
+      {
+        mat->data()[i*n+j] = (j<=i) ? 1.0 : 0.0;
+      }
+    }
+
+    gemv(1.0,*mat,x,0.0,y);
+
+    EXPECT_EQ(y(1,1),1.0);
+    EXPECT_EQ(y(n,1),double(n));
+
+    delete mat;
+
+}
+
+TEST(VectorBlas,GemvSameVector)
+{
+    Matrix<int,2,2> mat{0,1,1,0};
+    Matrix<int,2,1> x{1,2};
+    Matrix<int,2,1> result{2,1};
+
+    gemv(1,mat,x,0,x);
+
+    EXPECT_TRUE(x == result);
+
+}
+
+TEST(VectorBlas,Ger)
+{
+    Matrix<int,2,1> x{1,2};
+    Matrix<int,3,1> y{1,0,-1};
+    Matrix<int,2,3> mat{1,1,1,1,1,1};
+    Matrix<int,2,3> result{3,1,-1,5,1,-3};
+
+    ger(2,x,y,mat);
+
+    EXPECT_TRUE(mat == result);
+
+}
 
+TEST(VectorBlas,GerAliased)
+{
+    // x and y are both the first row of A, they are used as they were before the update
+    Matrix<int,2,2> mat{1,2,3,4};
+    Matrix<int,2,2> result{2,4,5,8};
+
+    gerKernel(2,2,1,mat.data(),mat.data(),mat.data());
 
+    EXPECT_TRUE(mat == result);
+
+}
 
+TEST(VectorBlas,LargeSplitAcrossThreads)
+{
+    // big enough for gemv, ger and gemm to split their rows across threads, the result must match one thread exactly
+    typedef Matrix<double,600,600> Big;
+    typedef Matrix<double,200,200> Square;
+    Big* a = new Big;
+    Big* expected = new Big;
+    Square* b = new Square;
+    Square* c = new Square;
+    Square* cExpected = new Square;
+    Matrix<double,600,1> x, y, yExpected;
+    for(std::size_t i = 0; i < 600*600; ++i)
+    {
+        a->data()[i] = double(i%17) - 8.0;
+    }
+    for(std::size_t i = 0; i < 200*200; ++i)
+    {
+        b->data()[i] = double(i%11)*0.25;
+        c->data()[i] = 1.0;
+    }
+    for(std::size_t i = 0; i < 600; ++i)
+    {
+        x.data()[i] = double(i%7);
+        y.data()[i] = 1.0;
+    }
+    *expected = *a;
+    *cExpected = *c;
+    yExpected = y;
+
+    setParallelThreads(1);
+    gemm(0.5,*b,*b,2.0,*cExpected);
+    gemv(1.0,*a,x,-1.0,yExpected);
+    ger(3.0,x,yExpected,*expected);
+    setParallelThreads(4);
+    gemm(0.5,*b,*b,2.0,*c);
+    gemv(1.0,*a,x,-1.0,y);
+    ger(3.0,x,y,*a);
+    setParallelThreads(0);
+
+    EXPECT_TRUE(*c == *cExpected);
+    EXPECT_TRUE(y == yExpected);
+    EXPECT_TRUE(*a == *expected);
+
+    delete a;
+    delete expected;
+    delete b;
+    delete c;
+    delete cExpected;
+
+}
@@ -0,0 +1,323 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <cstddef>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Bump (arena) allocation for temporaries. An Arena hands out memory by moving a pointer forward through blocks it
+/// keeps hold of, nothing is given back to the system until the arena is destroyed. Memory is released in O(1)
+/// either by freeing the most recent allocation or by going back to a mark, eg with an ArenaScope around a frame
+/// or a solver iteration. Once the blocks have grown to the largest size needed there are no more malloc calls.
+///
+/// Every thread has its own arena (threadArena()), which the Matrix member functions use for their temporary copies.
+/// ArenaAllocator<T> is a standard allocator on top of an arena so it can also be given to std::vector or the solvers.
+/// To use a different allocator for Matrix temporaries specialise MatrixTempAllocator<T>.
+
+// size of each block an arena asks the system for, larger allocations get a block of their own
+#ifndef MYLIB_ARENA_BLOCK
+#define MYLIB_ARENA_BLOCK (1 << 20)
+#endif
+
+//----------------------------------------------------------------------------------------------
+/// \class Arena
+/// \brief Bump allocator over a list of blocks, reset releases everything allocated since a mark in O(1)
+class Arena
+{
+public:
+
+    // position in the arena, returned by mark() and passed back to reset()
+    struct Marker
+    {
+      std::size_t block;
+      std::size_t offset;
+    };
+
+private:
+
+    struct Block
+    {
+      char* data;
+      std::size_t size;
+      // offset of the first allocation since the arena last moved on to this block
+      std::size_t first;
+      // offset the arena had reached in this block when it moved on to the next one
+      std::size_t spill;
+    };
+
+    // blocks in the order they are used, kept when the arena is reset
+    std::vector<Block> m_blocks;
+    // block currently being allocated from
+    std::size_t m_current = 0;
+    // bytes used in the current block
+    std::size_t m_offset = 0;
+    // size given to new blocks
+    std::size_t m_blockSize;
+
+    // makes block _index at least _bytes big, only called while the arena is growing
+    void reserveBlock(std::size_t _index, std::size_t _bytes);
+
+public:
+
+    // the first block isn't allocated until it is needed
+    explicit Arena(std::size_t _blockSize = MYLIB_ARENA_BLOCK) : m_blockSize(_blockSize) {}
+
+    // frees every block
+    ~Arena();
+
+    // arenas own their blocks so they can't be copied
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // returns _bytes of memory aligned to _align (a power of 2)
+    void* allocate(std::size_t _bytes, std::size_t _align = alignof(std::max_align_t));
+
+    // gives back _ptr if it was the most recent allocation, otherwise it is released by the next reset,
+    // releasing the only allocation in a block goes back to the free space left in the block before it
+    void release(void* _ptr, std::size_t _bytes);
+
+    // the current position
+    Marker mark() const { Marker m = {m_current, m_offset}; return m; }
+
+    // releases everything allocated since _mark
+    void reset(Marker _mark) { m_current = _mark.block; m_offset = _mark.offset; }
+
+    // releases everything, the blocks are kept for reuse
+    void reset() { m_current = 0; m_offset = 0; }
+
+    // bytes held from the system
+    std::size_t capacity() const;
+
+    // number of blocks held from the system
+    std::size_t blockCount() const { return m_blocks.size(); }
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Frees every block
+inline Arena::~Arena()
+{
+  for(Block& block : m_blocks)
+  {
+    std::free(block.data);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Makes sure block _index exists and holds at least _bytes, a block that is too small is replaced
+inline void Arena::reserveBlock(std::size_t _index, std::size_t _bytes)
+{
+  if(_index < m_blocks.size() && m_blocks[_index].size >= _bytes)
+  {
+    return;
+  }
+
+  std::size_t size = std::max(m_blockSize,_bytes);
+  char* data = static_cast<char*>(std::malloc(size));
+  if(!data)
+  {
+    throw std::bad_alloc();
+  }
+
+  if(_index < m_blocks.size())
+  {
+    std::free(m_blocks[_index].data);
+    m_blocks[_index].data = data;
+    m_blocks[_index].size = size;
+  }
+  else
+  {
+    Block block = {data, size, 0, 0};
+    m_blocks.push_back(block);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Bumps the offset in the current block, moving on to the next block when it doesn't fit
+/// param[in] _bytes, number of bytes needed
+/// param[in] _align, alignment of the returned pointer, must be a power of 2
+inline void* Arena::allocate(std::size_t _bytes, std::size_t _align)
+{
+  if(m_current < m_blocks.size())
+  {
+    std::uintptr_t base = reinterpret_cast<std::uintptr_t>(m_blocks[m_current].data);
+    std::size_t start = ((base + m_offset + _align - 1) & ~std::uintptr_t(_align - 1)) - base;
+    if(start + _bytes <= m_blocks[m_current].size)
+    {
+      m_offset = start + _bytes;
+      return m_blocks[m_current].data + start;
+    }
+    m_blocks[m_current].spill = m_offset;
+    ++m_current;
+  }
+
+  // malloc alignment covers every type the matrices use, larger alignments are padded
+  std::size_t padding = _align > alignof(std::max_align_t) ? _align : 0;
+  reserveBlock(m_current,_bytes + padding);
+
+  std::uintptr_t base = reinterpret_cast<std::uintptr_t>(m_blocks[m_current].data);
+  std::size_t start = ((base + _align - 1) & ~std::uintptr_t(_align - 1)) - base;
+  m_blocks[m_current].first = start;
+  m_offset = start + _bytes;
+
+  return m_blocks[m_current].data + start;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Gives back the most recent allocation straight away, so nested temporaries are released in O(1).
+/// When that empties a block that was spilled into, the arena goes back to where the previous block left off,
+/// so the earlier blocks are used again instead of only after a reset.
+inline void Arena::release(void* _ptr, std::size_t _bytes)
+{
+  if(m_current < m_blocks.size() && m_offset >= _bytes &&
+     static_cast<char*>(_ptr) == m_blocks[m_current].data + m_offset - _bytes)
+  {
+    m_offset -= _bytes;
+    if(m_current > 0 && m_offset == m_blocks[m_current].first)
+    {
+      --m_current;
+      m_offset = m_blocks[m_current].spill;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the number of bytes held from the system
+inline std::size_t Arena::capacity() const
+{
+  std::size_t total = 0;
+  for(const Block& block : m_blocks)
+  {
+    total += block.size;
+  }
+
+  return total;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the calling thread's arena
+inline Arena& threadArena()
+{
+  static thread_local Arena arena;
+  return arena;
+}
+
+//----------------------------------------------------------------------------------------------
+/// \class ArenaScope
+/// \brief Releases everything allocated from an arena while the scope was alive, eg one per frame or solver iteration
+class ArenaScope
+{
+private:
+
+    Arena& m_arena;
+    Arena::Marker m_mark;
+
+public:
+
+    explicit ArenaScope(Arena& _arena = threadArena()) : m_arena(_arena), m_mark(_arena.mark()) {}
+    ~ArenaScope() { m_arena.reset(m_mark); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+};
+
+//----------------------------------------------------------------------------------------------
+/// \class ArenaAllocator
+/// \brief Standard allocator that takes memory from an arena (the calling thread's by default).
+/// Memory must not be used after the arena is reset past it or after its thread exits.
+template <typename T>
+class ArenaAllocator
+{
+private:
+
+    Arena* m_arena;
+
+    template <typename U> friend class ArenaAllocator;
+
+public:
+
+    typedef T value_type;
+
+    ArenaAllocator() : m_arena(&threadArena()) {}
+    explicit ArenaAllocator(Arena& _arena) : m_arena(&_arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& _other) : m_arena(_other.m_arena) {}
+
+    T* allocate(std::size_t _n) { return static_cast<T*>(m_arena->allocate(_n*sizeof(T),alignof(T))); }
+    void deallocate(T* _ptr, std::size_t _n) { m_arena->release(_ptr,_n*sizeof(T)); }
+
+    // the arena memory comes from
+    Arena& arena() const { return *m_arena; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& _rhs) const { return m_arena == _rhs.m_arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& _rhs) const { return m_arena != _rhs.m_arena; }
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Allocator the Matrix member functions use for their temporary copies, specialise it to plug in another
+template <typename T>
+struct MatrixTempAllocator
+{
+  typedef ArenaAllocator<T> type;
+};
+
+//----------------------------------------------------------------------------------------------
+/// \class TempBuffer
+/// \brief Value initialised scratch array of _n elements, released when it goes out of scope
+template <typename T, typename ALLOC = typename MatrixTempAllocator<T>::type>
+class TempBuffer
+{
+private:
+
+    ALLOC m_alloc;
+    std::size_t m_size;
+    T* m_data;
+
+public:
+
+    explicit TempBuffer(std::size_t _n, const ALLOC& _alloc = ALLOC());
+    ~TempBuffer();
+
+    TempBuffer(const TempBuffer&) = delete;
+    TempBuffer& operator=(const TempBuffer&) = delete;
+
+    T* data() { return m_data; }
+    const T* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+    T& operator[](std::size_t _i) { return m_data[_i]; }
+    const T& operator[](std::size_t _i) const { return m_data[_i]; }
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Allocates and value initialises _n elements
+template <typename T, typename ALLOC>
+TempBuffer<T,ALLOC>::TempBuffer(std::size_t _n, const ALLOC& _alloc) :
+  m_alloc(_alloc),
+  m_size(_n),
+  m_data(std::allocator_traits<ALLOC>::allocate(m_alloc,_n))
+{
+  std::uninitialized_fill_n(m_data,_n,T());
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Destroys the elements and gives the memory back, in O(1) for the arena
+template <typename T, typename ALLOC>
+TempBuffer<T,ALLOC>::~TempBuffer()
+{
+  for(std::size_t i = 0; i < m_size; ++i)
+  {
+    m_data[i].~T();
+  }
+  std::allocator_traits<ALLOC>::deallocate(m_alloc,m_data,m_size);
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // ARENA_H
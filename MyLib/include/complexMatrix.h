@@ -0,0 +1,478 @@
+#ifndef COMPLEXMATRIX_H
+#define COMPLEXMATRIX_H
+#include <cstddef>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <complex>
+#include <type_traits>
+#include "matrixTranspose.h"
+#if defined(__SSE3__)
+#include <pmmintrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Complex element types. ScalarTraits<T> gives the real type lengths and angles of T are measured in and the
+/// conjugate of a T (a no op for real types), Matrix uses it so magnitude(), dot() and angle() work for
+/// Matrix<std::complex<float>,R,C> as well as real matrices, dot() being the Hermitian product x^H*y.
+/// The kernels below keep complex numbers interleaved (re,im,re,im, the std::complex layout) and multiply them with
+/// SIMD, 4 complex floats or 2 complex doubles per AVX register (2 and 1 with SSE3). The multiply is written out
+/// rather than using std::complex operator*, which goes through a library call to recover inf/NaN results.
+/// gemm/gemv in matrixBlas.h use these kernels for std::complex<float> and std::complex<double>, gemmBatch there
+/// multiplies many small matrices across threads.
+
+template <typename T, size_t ROWS, size_t COLS> class Matrix;
+
+//----------------------------------------------------------------------------------------------
+/// @brief Real type and conjugate of an element type, real types are their own conjugate
+template <typename T>
+struct ScalarTraits
+{
+  // type lengths and angles are returned in, float unless T is a wider floating point type
+  typedef typename std::conditional<std::is_floating_point<T>::value, T, float>::type real;
+  // type dot products are returned in
+  typedef real value;
+  // type absolute values and norms are returned in, T itself so an int matrix keeps int norms
+  typedef T abs_type;
+
+  static T conj(const T& _x) { return _x; }
+  static real abs2(const T& _x) { return real(_x) * real(_x); }
+  static abs_type abs(const T& _x) { using std::abs; return abs(_x); }
+  static real realPart(const T& _x) { return real(_x); }
+};
+
+template <typename U>
+struct ScalarTraits< std::complex<U> >
+{
+  typedef U real;
+  typedef std::complex<U> value;
+  typedef U abs_type;
+
+  static std::complex<U> conj(const std::complex<U>& _x) { return std::conj(_x); }
+  static U abs2(const std::complex<U>& _x) { return _x.real()*_x.real() + _x.imag()*_x.imag(); }
+  static U abs(const std::complex<U>& _x) { return std::abs(_x); }
+  static U realPart(const std::complex<U>& _x) { return _x.real(); }
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief One complex number at a time, used where there is no SIMD and for the elements left over after it
+template <typename F>
+struct ComplexScalar
+{
+  typedef std::complex<F> reg;
+  static constexpr std::size_t width = 1;
+
+  static reg load(const std::complex<F>* _p) { return *_p; }
+  static void store(std::complex<F>* _p, reg _v) { *_p = _v; }
+  static reg broadcast(std::complex<F> _v) { return _v; }
+  static reg zero() { return reg(F(0),F(0)); }
+  static reg add(reg _a, reg _b) { return reg(_a.real() + _b.real(),_a.imag() + _b.imag()); }
+  static reg mul(reg _a, reg _b)
+  {
+    return reg(_a.real()*_b.real() - _a.imag()*_b.imag(),_a.real()*_b.imag() + _a.imag()*_b.real());
+  }
+  static reg conj(reg _a) { return reg(_a.real(),-_a.imag()); }
+  static std::complex<F> sum(reg _a) { return _a; }
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief As many interleaved complex numbers as fit in a SIMD register, the generic version is ComplexScalar.
+/// mul works out (ar*br - ai*bi, ai*br + ar*bi) as a*dup(br) addsub swap(a)*dup(bi).
+template <typename F>
+struct ComplexSimd : ComplexScalar<F>
+{
+};
+
+#if defined(__AVX__)
+/// @brief 4 complex floats
+template <>
+struct ComplexSimd<float>
+{
+  typedef __m256 reg;
+  static constexpr std::size_t width = 4;
+
+  static reg load(const std::complex<float>* _p) { return _mm256_loadu_ps(reinterpret_cast<const float*>(_p)); }
+  static void store(std::complex<float>* _p, reg _v) { _mm256_storeu_ps(reinterpret_cast<float*>(_p),_v); }
+  static reg broadcast(std::complex<float> _v)
+  {
+    return _mm256_setr_ps(_v.real(),_v.imag(),_v.real(),_v.imag(),_v.real(),_v.imag(),_v.real(),_v.imag());
+  }
+  static reg zero() { return _mm256_setzero_ps(); }
+  static reg add(reg _a, reg _b) { return _mm256_add_ps(_a,_b); }
+  static reg mul(reg _a, reg _b)
+  {
+    reg re = _mm256_mul_ps(_a,_mm256_moveldup_ps(_b));
+    reg im = _mm256_mul_ps(_mm256_permute_ps(_a,0xb1),_mm256_movehdup_ps(_b));
+    return _mm256_addsub_ps(re,im);
+  }
+  static reg conj(reg _a) { return _mm256_xor_ps(_a,_mm256_setr_ps(0.0f,-0.0f,0.0f,-0.0f,0.0f,-0.0f,0.0f,-0.0f)); }
+  static std::complex<float> sum(reg _a)
+  {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(_a),_mm256_extractf128_ps(_a,1));
+    s = _mm_add_ps(s,_mm_movehl_ps(s,s));
+    return std::complex<float>(_mm_cvtss_f32(s),_mm_cvtss_f32(_mm_shuffle_ps(s,s,1)));
+  }
+};
+
+/// @brief 2 complex doubles
+template <>
+struct ComplexSimd<double>
+{
+  typedef __m256d reg;
+  static constexpr std::size_t width = 2;
+
+  static reg load(const std::complex<double>* _p) { return _mm256_loadu_pd(reinterpret_cast<const double*>(_p)); }
+  static void store(std::complex<double>* _p, reg _v) { _mm256_storeu_pd(reinterpret_cast<double*>(_p),_v); }
+  static reg broadcast(std::complex<double> _v) { return _mm256_setr_pd(_v.real(),_v.imag(),_v.real(),_v.imag()); }
+  static reg zero() { return _mm256_setzero_pd(); }
+  static reg add(reg _a, reg _b) { return _mm256_add_pd(_a,_b); }
+  static reg mul(reg _a, reg _b)
+  {
+    reg re = _mm256_mul_pd(_a,_mm256_movedup_pd(_b));
+    reg im = _mm256_mul_pd(_mm256_permute_pd(_a,0x5),_mm256_permute_pd(_b,0xf));
+    return _mm256_addsub_pd(re,im);
+  }
+  static reg conj(reg _a) { return _mm256_xor_pd(_a,_mm256_setr_pd(0.0,-0.0,0.0,-0.0)); }
+  static std::complex<double> sum(reg _a)
+  {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(_a),_mm256_extractf128_pd(_a,1));
+    return std::complex<double>(_mm_cvtsd_f64(s),_mm_cvtsd_f64(_mm_unpackhi_pd(s,s)));
+  }
+};
+#elif defined(__SSE3__)
+/// @brief 2 complex floats
+template <>
+struct ComplexSimd<float>
+{
+  typedef __m128 reg;
+  static constexpr std::size_t width = 2;
+
+  static reg load(const std::complex<float>* _p) { return _mm_loadu_ps(reinterpret_cast<const float*>(_p)); }
+  static void store(std::complex<float>* _p, reg _v) { _mm_storeu_ps(reinterpret_cast<float*>(_p),_v); }
+  static reg broadcast(std::complex<float> _v) { return _mm_setr_ps(_v.real(),_v.imag(),_v.real(),_v.imag()); }
+  static reg zero() { return _mm_setzero_ps(); }
+  static reg add(reg _a, reg _b) { return _mm_add_ps(_a,_b); }
+  static reg mul(reg _a, reg _b)
+  {
+    reg re = _mm_mul_ps(_a,_mm_moveldup_ps(_b));
+    reg im = _mm_mul_ps(_mm_shuffle_ps(_a,_a,_MM_SHUFFLE(2,3,0,1)),_mm_movehdup_ps(_b));
+    return _mm_addsub_ps(re,im);
+  }
+  static reg conj(reg _a) { return _mm_xor_ps(_a,_mm_setr_ps(0.0f,-0.0f,0.0f,-0.0f)); }
+  static std::complex<float> sum(reg _a)
+  {
+    reg s = _mm_add_ps(_a,_mm_movehl_ps(_a,_a));
+    return std::complex<float>(_mm_cvtss_f32(s),_mm_cvtss_f32(_mm_shuffle_ps(s,s,1)));
+  }
+};
+
+/// @brief 1 complex double
+template <>
+struct ComplexSimd<double>
+{
+  typedef __m128d reg;
+  static constexpr std::size_t width = 1;
+
+  static reg load(const std::complex<double>* _p) { return _mm_loadu_pd(reinterpret_cast<const double*>(_p)); }
+  static void store(std::complex<double>* _p, reg _v) { _mm_storeu_pd(reinterpret_cast<double*>(_p),_v); }
+  static reg broadcast(std::complex<double> _v) { return _mm_setr_pd(_v.real(),_v.imag()); }
+  static reg zero() { return _mm_setzero_pd(); }
+  static reg add(reg _a, reg _b) { return _mm_add_pd(_a,_b); }
+  static reg mul(reg _a, reg _b)
+  {
+    reg re = _mm_mul_pd(_a,_mm_movedup_pd(_b));
+    reg im = _mm_mul_pd(_mm_shuffle_pd(_a,_a,1),_mm_unpackhi_pd(_b,_b));
+    return _mm_addsub_pd(re,im);
+  }
+  static reg conj(reg _a) { return _mm_xor_pd(_a,_mm_setr_pd(0.0,-0.0)); }
+  static std::complex<double> sum(reg _a) { return std::complex<double>(_mm_cvtsd_f64(_a),_mm_cvtsd_f64(_mm_unpackhi_pd(_a,_a))); }
+};
+#endif
+
+//----------------------------------------------------------------------------------------------
+/// @brief y = _alpha*x + y over _n interleaved complex numbers, x is conjugated first if _conjugate is true
+template <typename F>
+void complexAxpyKernel(std::size_t _n, std::complex<F> _alpha, const std::complex<F>* _x, std::complex<F>* _y,
+                       bool _conjugate = false)
+{
+  typedef ComplexSimd<F> Simd;
+  typedef ComplexScalar<F> Scalar;
+
+  const typename Simd::reg alpha = Simd::broadcast(_alpha);
+  std::size_t i = 0;
+  for(; i + Simd::width <= _n; i += Simd::width)
+  {
+    typename Simd::reg x = Simd::load(_x + i);
+    x = _conjugate ? Simd::conj(x) : x;
+    Simd::store(_y + i,Simd::add(Simd::load(_y + i),Simd::mul(alpha,x)));
+  }
+  for(; i < _n; ++i)
+  {
+    std::complex<F> x = _conjugate ? Scalar::conj(_x[i]) : _x[i];
+    _y[i] = Scalar::add(_y[i],Scalar::mul(_alpha,x));
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief x = _alpha*x over _n interleaved complex numbers
+template <typename F>
+void complexScalKernel(std::size_t _n, std::complex<F> _alpha, std::complex<F>* _x)
+{
+  typedef ComplexSimd<F> Simd;
+  typedef ComplexScalar<F> Scalar;
+
+  const typename Simd::reg alpha = Simd::broadcast(_alpha);
+  std::size_t i = 0;
+  for(; i + Simd::width <= _n; i += Simd::width)
+  {
+    Simd::store(_x + i,Simd::mul(alpha,Simd::load(_x + i)));
+  }
+  for(; i < _n; ++i)
+  {
+    _x[i] = Scalar::mul(_alpha,_x[i]);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the sum of x*y over _n interleaved complex numbers, or conj(x)*y (x^H*y) if _conjugate is true.
+/// Two accumulators keep the adds pipelined.
+template <typename F>
+std::complex<F> complexDotKernel(std::size_t _n, const std::complex<F>* _x, const std::complex<F>* _y,
+                                 bool _conjugate = false)
+{
+  typedef ComplexSimd<F> Simd;
+  typedef ComplexScalar<F> Scalar;
+
+  typename Simd::reg sum0 = Simd::zero();
+  typename Simd::reg sum1 = Simd::zero();
+  std::size_t i = 0;
+  for(; i + 2*Simd::width <= _n; i += 2*Simd::width)
+  {
+    typename Simd::reg x0 = Simd::load(_x + i);
+    typename Simd::reg x1 = Simd::load(_x + i + Simd::width);
+    x0 = _conjugate ? Simd::conj(x0) : x0;
+    x1 = _conjugate ? Simd::conj(x1) : x1;
+    sum0 = Simd::add(sum0,Simd::mul(x0,Simd::load(_y + i)));
+    sum1 = Simd::add(sum1,Simd::mul(x1,Simd::load(_y + i + Simd::width)));
+  }
+  for(; i + Simd::width <= _n; i += Simd::width)
+  {
+    typename Simd::reg x = Simd::load(_x + i);
+    x = _conjugate ? Simd::conj(x) : x;
+    sum0 = Simd::add(sum0,Simd::mul(x,Simd::load(_y + i)));
+  }
+
+  std::complex<F> sum = Simd::sum(Simd::add(sum0,sum1));
+  for(; i < _n; ++i)
+  {
+    std::complex<F> x = _conjugate ? Scalar::conj(_x[i]) : _x[i];
+    sum = Scalar::add(sum,Scalar::mul(x,_y[i]));
+  }
+
+  return sum;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief C = _alpha*op(A)*B + _beta*C, B is _k x _n and C _m x _n row major, op(A)(i,k) is
+/// _a[i*_aRow + k*_aCol], conjugated if _conjugate is true, so A^H is op(A) with the strides swapped.
+/// Each row of C is built from axpys over the rows of B so the inner loop walks B and C contiguously.
+template <typename F>
+void complexGemmKernel(std::size_t _m, std::size_t _n, std::size_t _k, std::complex<F> _alpha,
+                       const std::complex<F>* _a, std::size_t _aRow, std::size_t _aCol, bool _conjugate,
+                       const std::complex<F>* _b, std::complex<F> _beta, std::complex<F>* _c)
+{
+  for(std::size_t i = 0; i < _m; ++i)
+  {
+    std::complex<F>* c = _c + i*_n;
+    // beta of 0 must not read C (BLAS convention)
+    if(_beta == std::complex<F>(0))
+    {
+      std::fill(c,c + _n,std::complex<F>(0));
+    }
+    else
+    {
+      complexScalKernel(_n,_beta,c);
+    }
+
+    for(std::size_t k = 0; k < _k; ++k)
+    {
+      std::complex<F> a = _a[i*_aRow + k*_aCol];
+      a = _conjugate ? ComplexScalar<F>::conj(a) : a;
+      complexAxpyKernel(_n,ComplexScalar<F>::mul(_alpha,a),_b + k*_n,c);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief y = _alpha*op(A)*x + _beta*y for a row major _rows x _cols matrix A, op(A) is A or, if _adjoint is true,
+/// A^H (then x has _rows elements and y _cols). A*x is a dot product per row, A^H*x an axpy per row of A.
+template <typename F>
+void complexGemvKernel(std::size_t _rows, std::size_t _cols, std::complex<F> _alpha, const std::complex<F>* _a,
+                       bool _adjoint, const std::complex<F>* _x, std::complex<F> _beta, std::complex<F>* _y)
+{
+  typedef ComplexScalar<F> Scalar;
+  const bool zeroBeta = _beta == std::complex<F>(0);
+
+  if(!_adjoint)
+  {
+    for(std::size_t i = 0; i < _rows; ++i)
+    {
+      std::complex<F> dot = Scalar::mul(_alpha,complexDotKernel(_cols,_a + i*_cols,_x));
+      // beta of 0 must not read y, it may not be initialised (BLAS convention)
+      _y[i] = zeroBeta ? dot : Scalar::add(dot,Scalar::mul(_beta,_y[i]));
+    }
+    return;
+  }
+
+  if(zeroBeta)
+  {
+    std::fill(_y,_y + _cols,std::complex<F>(0));
+  }
+  else
+  {
+    complexScalKernel(_cols,_beta,_y);
+  }
+
+  // y += conj(row i)*alpha*x[i]
+  for(std::size_t i = 0; i < _rows; ++i)
+  {
+    complexAxpyKernel(_cols,Scalar::mul(_alpha,_x[i]),_a + i*_cols,_y,true);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief C = op(A)*B for any element type, op(A)(i,k) = conj(_a[i*_aRow + k*_aCol]), the generic version of
+/// complexGemmKernel used by adjointMultiply for real matrices
+template <typename T>
+void adjointGemmKernel(std::size_t _m, std::size_t _n, std::size_t _k, const T* _a, std::size_t _aRow,
+                       std::size_t _aCol, const T* _b, T* _c)
+{
+  for(std::size_t i = 0; i < _m; ++i)
+  {
+    T* c = _c + i*_n;
+    std::fill(c,c + _n,T(0));
+    for(std::size_t k = 0; k < _k; ++k)
+    {
+      const T a = ScalarTraits<T>::conj(_a[i*_aRow + k*_aCol]);
+      for(std::size_t j = 0; j < _n; ++j)
+      {
+        c[j] += a * _b[k*_n + j];
+      }
+    }
+  }
+}
+
+inline void adjointGemmKernel(std::size_t _m, std::size_t _n, std::size_t _k, const std::complex<float>* _a,
+                              std::size_t _aRow, std::size_t _aCol, const std::complex<float>* _b, std::complex<float>* _c)
+{
+  complexGemmKernel(_m,_n,_k,std::complex<float>(1),_a,_aRow,_aCol,true,_b,std::complex<float>(0),_c);
+}
+
+inline void adjointGemmKernel(std::size_t _m, std::size_t _n, std::size_t _k, const std::complex<double>* _a,
+                              std::size_t _aRow, std::size_t _aCol, const std::complex<double>* _b, std::complex<double>* _c)
+{
+  complexGemmKernel(_m,_n,_k,std::complex<double>(1),_a,_aRow,_aCol,true,_b,std::complex<double>(0),_c);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the sum of x*conj(y) over _n elements, the generic version of complexDotKernel used by multiplyAdjoint
+template <typename T>
+T adjointDotKernel(std::size_t _n, const T* _x, const T* _y)
+{
+  T sum = T(0);
+  for(std::size_t i = 0; i < _n; ++i)
+  {
+    sum += _x[i] * ScalarTraits<T>::conj(_y[i]);
+  }
+
+  return sum;
+}
+
+inline std::complex<float> adjointDotKernel(std::size_t _n, const std::complex<float>* _x, const std::complex<float>* _y)
+{
+  return complexDotKernel(_n,_y,_x,true);
+}
+
+inline std::complex<double> adjointDotKernel(std::size_t _n, const std::complex<double>* _x, const std::complex<double>* _y)
+{
+  return complexDotKernel(_n,_y,_x,true);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the conjugate transpose (Hermitian adjoint) of _mat as a new COLS x ROWS matrix, _mat is not changed.
+/// For real matrices it is the same as transposed(_mat).
+template <typename T, size_t ROWS, size_t COLS>
+Matrix<T,COLS,ROWS> conjugateTransposed(const Matrix<T,ROWS,COLS>& _mat)
+{
+  Matrix<T,COLS,ROWS> result = transposed(_mat);
+  T* data = result.data();
+  for(std::size_t i = 0; i < ROWS*COLS; ++i)
+  {
+    data[i] = ScalarTraits<T>::conj(data[i]);
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns A^H*B without forming A^H, A is ROWS x COLS and B ROWS x N, neither is changed
+template <typename T, size_t ROWS, size_t COLS, size_t N>
+Matrix<T,COLS,N> adjointMultiply(const Matrix<T,ROWS,COLS>& _a, const Matrix<T,ROWS,N>& _b)
+{
+  Matrix<T,COLS,N> result;
+  adjointGemmKernel(COLS,N,ROWS,_a.data(),1,COLS,_b.data(),result.data());
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns A*B^H without forming B^H, A is ROWS x COLS and B N x COLS, neither is changed.
+/// Each element is a dot product of a row of A and a row of B so both are read contiguously.
+template <typename T, size_t ROWS, size_t COLS, size_t N>
+Matrix<T,ROWS,N> multiplyAdjoint(const Matrix<T,ROWS,COLS>& _a, const Matrix<T,N,COLS>& _b)
+{
+  Matrix<T,ROWS,N> result;
+  T* data = result.data();
+  for(std::size_t i = 0; i < ROWS; ++i)
+  {
+    for(std::size_t j = 0; j < N; ++j)
+    {
+      data[i*N + j] = adjointDotKernel(COLS,_a.data() + i*COLS,_b.data() + j*COLS);
+    }
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns true if _mat equals its conjugate transpose to within _tolerance (exactly by default)
+template <typename T, size_t ROWS, size_t COLS>
+bool isHermitian(const Matrix<T,ROWS,COLS>& _mat, typename ScalarTraits<T>::real _tolerance = 0)
+{
+  if(ROWS != COLS)
+  {
+    return false;
+  }
+
+  const T* data = _mat.data();
+  for(std::size_t i = 0; i < ROWS; ++i)
+  {
+    for(std::size_t j = i; j < COLS; ++j)
+    {
+      T difference = data[i*COLS + j] - ScalarTraits<T>::conj(data[j*COLS + i]);
+      if(ScalarTraits<T>::abs2(difference) > _tolerance*_tolerance)
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // COMPLEXMATRIX_H
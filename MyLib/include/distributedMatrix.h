@@ -0,0 +1,742 @@
+#ifndef DISTRIBUTEDMATRIX_H
+#define DISTRIBUTEDMATRIX_H
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <new>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Matrices split across processes on one machine, each process standing in for a node.
+/// ProcessGroup is the communication layer, a POSIX shared memory segment holding a barrier and one message slot per
+/// process: a process writes into its own slot, everyone waits at the barrier, then reads whichever slots it needs.
+/// The operations check the slot size on every process before exchanging anything, so a slot that is too small makes
+/// every process throw rather than leaving the others waiting at a barrier.
+/// launchProcesses(n,f) forks n processes and runs f(group) in each, for testing on one box. Processes started
+/// separately can share a named group with ProcessGroup::create(name,...) and ProcessGroup::attach(name,rank).
+///
+/// DistributedMatrix<T> spreads a rows x cols matrix over a gridRows x gridCols grid of processes 2D block cyclically
+/// (as ScaLAPACK does), block (i,j) belongs to process (i % gridRows, j % gridCols), so the work stays balanced as
+/// LU shrinks the active part of the matrix.
+/// summa(A,B,C)   - C = A*B, SUMMA (van de Geijn and Watts 1997), panels of A go along process rows and panels of
+///                  B go down process columns
+/// luDecompose(A) - LU with partial pivoting in place, returns the row swaps
+/// POSIX only.
+
+//----------------------------------------------------------------------------------------------
+/// \class ProcessGroupHeader
+/// \brief Start of the shared segment, followed by the message slots
+struct ProcessGroupHeader
+{
+  std::atomic<unsigned int> count;
+  std::atomic<unsigned int> generation;
+  std::size_t size;
+  std::size_t slotBytes;
+  std::size_t mapBytes;
+};
+
+//----------------------------------------------------------------------------------------------
+/// \class ProcessGroup
+/// \brief A set of processes sharing a barrier and a message slot each
+class ProcessGroup
+{
+private:
+
+    ProcessGroupHeader* m_header = nullptr;
+    char* m_slots = nullptr;
+    int m_rank = 0;
+
+    // header size rounded up so every slot starts on a cache line
+    static std::size_t headerBytes() { return (sizeof(ProcessGroupHeader) + 63) / 64 * 64; }
+
+    // sets up a new segment
+    void initialise(void* _map, std::size_t _size, std::size_t _slotBytes, std::size_t _mapBytes);
+
+public:
+
+    ProcessGroup() {}
+    ~ProcessGroup();
+
+    ProcessGroup(ProcessGroup&& _rhs) { *this = std::move(_rhs); }
+    ProcessGroup& operator=(ProcessGroup&& _rhs);
+    ProcessGroup(const ProcessGroup&) = delete;
+    ProcessGroup& operator=(const ProcessGroup&) = delete;
+
+    // anonymous shared segment for _size processes that are forked afterwards, this process is rank 0
+    static ProcessGroup create(std::size_t _size, std::size_t _slotBytes);
+
+    // named segment (shm_open) for _size separately started processes, this process is rank 0
+    static ProcessGroup create(const std::string& _name, std::size_t _size, std::size_t _slotBytes);
+
+    // joins a named segment as _rank, the segment must already have been made with create
+    static ProcessGroup attach(const std::string& _name, int _rank);
+
+    // removes a named segment, processes already attached keep it until they exit
+    static void unlink(const std::string& _name) { shm_unlink(_name.c_str()); }
+
+    int rank() const { return m_rank; }
+    int size() const { return static_cast<int>(m_header->size); }
+    std::size_t slotBytes() const { return m_header->slotBytes; }
+
+    // used after fork to give each process its own rank
+    void setRank(int _rank) { m_rank = _rank; }
+
+    // waits until every process has reached the barrier
+    void barrier();
+
+    // message slot of process _rank, only its owner writes to it
+    void* slot(int _rank) { return m_slots + static_cast<std::size_t>(_rank)*m_header->slotBytes; }
+
+    // copies _n values into this process's slot at element _offset, throws if the slot is too small
+    template <typename T>
+    void publish(const T* _data, std::size_t _n, std::size_t _offset = 0);
+
+    // throws if _bytes don't fit in a slot, called by every process before an exchange where only some of them
+    // publish, so they all throw together instead of the others waiting at a barrier for ever
+    void requireSlotBytes(std::size_t _bytes) const;
+
+    // values in process _rank's slot starting at element _offset
+    template <typename T>
+    const T* peer(int _rank, std::size_t _offset = 0) { return static_cast<const T*>(slot(_rank)) + _offset; }
+
+    // combines one value from every process in rank order, every process gets the same result
+    template <typename T, typename COMBINE>
+    T allReduce(const T& _value, COMBINE _combine);
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Unmaps the segment
+inline ProcessGroup::~ProcessGroup()
+{
+  if(m_header)
+  {
+    munmap(m_header,m_header->mapBytes);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Move assignment
+inline ProcessGroup& ProcessGroup::operator=(ProcessGroup&& _rhs)
+{
+  if(this != &_rhs)
+  {
+    if(m_header)
+    {
+      munmap(m_header,m_header->mapBytes);
+    }
+    m_header = _rhs.m_header;
+    m_slots = _rhs.m_slots;
+    m_rank = _rhs.m_rank;
+    _rhs.m_header = nullptr;
+    _rhs.m_slots = nullptr;
+  }
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Places the header at the start of a new segment
+inline void ProcessGroup::initialise(void* _map, std::size_t _size, std::size_t _slotBytes, std::size_t _mapBytes)
+{
+  m_header = new (_map) ProcessGroupHeader;
+  m_header->count = 0;
+  m_header->generation = 0;
+  m_header->size = _size;
+  m_header->slotBytes = _slotBytes;
+  m_header->mapBytes = _mapBytes;
+  m_slots = static_cast<char*>(_map) + headerBytes();
+  m_rank = 0;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Anonymous shared segment, it is inherited by processes forked from this one
+/// param[in] _size, number of processes
+/// param[in] _slotBytes, size of each process's message slot
+inline ProcessGroup ProcessGroup::create(std::size_t _size, std::size_t _slotBytes)
+{
+  if(_size == 0)
+  {
+    throw std::out_of_range("A process group needs at least one process");
+  }
+
+  _slotBytes = (_slotBytes + 63) / 64 * 64;
+  std::size_t bytes = headerBytes() + _size*_slotBytes;
+  void* map = mmap(nullptr,bytes,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_ANONYMOUS,-1,0);
+  if(map == MAP_FAILED)
+  {
+    throw std::runtime_error(std::string("mmap failed: ") + std::strerror(errno));
+  }
+
+  ProcessGroup group;
+  group.initialise(map,_size,_slotBytes,bytes);
+  return group;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Named shared segment (shm_open), other processes join it with attach
+inline ProcessGroup ProcessGroup::create(const std::string& _name, std::size_t _size, std::size_t _slotBytes)
+{
+  if(_size == 0)
+  {
+    throw std::out_of_range("A process group needs at least one process");
+  }
+
+  _slotBytes = (_slotBytes + 63) / 64 * 64;
+  std::size_t bytes = headerBytes() + _size*_slotBytes;
+  int file = shm_open(_name.c_str(),O_RDWR | O_CREAT | O_TRUNC,0600);
+  if(file < 0 || ftruncate(file,static_cast<off_t>(bytes)) != 0)
+  {
+    throw std::runtime_error("could not create shared memory " + _name + ": " + std::strerror(errno));
+  }
+  void* map = mmap(nullptr,bytes,PROT_READ | PROT_WRITE,MAP_SHARED,file,0);
+  close(file);
+  if(map == MAP_FAILED)
+  {
+    throw std::runtime_error(std::string("mmap failed: ") + std::strerror(errno));
+  }
+
+  ProcessGroup group;
+  group.initialise(map,_size,_slotBytes,bytes);
+  return group;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Joins a named segment made by create
+inline ProcessGroup ProcessGroup::attach(const std::string& _name, int _rank)
+{
+  int file = shm_open(_name.c_str(),O_RDWR,0600);
+  struct stat info;
+  if(file < 0 || fstat(file,&info) != 0)
+  {
+    throw std::runtime_error("could not open shared memory " + _name + ": " + std::strerror(errno));
+  }
+  void* map = mmap(nullptr,static_cast<std::size_t>(info.st_size),PROT_READ | PROT_WRITE,MAP_SHARED,file,0);
+  close(file);
+  if(map == MAP_FAILED)
+  {
+    throw std::runtime_error(std::string("mmap failed: ") + std::strerror(errno));
+  }
+
+  ProcessGroup group;
+  group.m_header = static_cast<ProcessGroupHeader*>(map);
+  group.m_slots = static_cast<char*>(map) + headerBytes();
+  if(_rank < 0 || _rank >= group.size())
+  {
+    throw std::out_of_range("rank out of range");
+  }
+  group.m_rank = _rank;
+  return group;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Sense reversing barrier on the shared counters, the last process to arrive starts the next generation
+inline void ProcessGroup::barrier()
+{
+  unsigned int generation = m_header->generation.load(std::memory_order_acquire);
+
+  if(m_header->count.fetch_add(1,std::memory_order_acq_rel) + 1 == m_header->size)
+  {
+    m_header->count.store(0,std::memory_order_relaxed);
+    m_header->generation.fetch_add(1,std::memory_order_acq_rel);
+    return;
+  }
+
+  while(m_header->generation.load(std::memory_order_acquire) == generation)
+  {
+    sched_yield();
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Copies values into this process's slot
+template <typename T>
+void ProcessGroup::publish(const T* _data, std::size_t _n, std::size_t _offset)
+{
+  if((_offset + _n)*sizeof(T) > m_header->slotBytes)
+  {
+    throw std::out_of_range("message is larger than the process group's slots");
+  }
+  std::memcpy(static_cast<T*>(slot(m_rank)) + _offset,_data,_n*sizeof(T));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Throws std::out_of_range if a message of _bytes is larger than a slot
+inline void ProcessGroup::requireSlotBytes(std::size_t _bytes) const
+{
+  if(_bytes > m_header->slotBytes)
+  {
+    throw std::out_of_range("message is larger than the process group's slots");
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Every process publishes _value, then everyone combines all of them in rank order
+template <typename T, typename COMBINE>
+T ProcessGroup::allReduce(const T& _value, COMBINE _combine)
+{
+  publish(&_value,1);
+  barrier();
+
+  T result = *peer<T>(0);
+  for(int r = 1; r < size(); ++r)
+  {
+    result = _combine(result,*peer<T>(r));
+  }
+  barrier();
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Forks _size-1 processes and runs _func(group) in all _size of them (this process is rank 0), then waits for them.
+/// Returns true if every process finished without throwing.
+/// param[in] _size, number of processes
+/// param[in] _slotBytes, size of each process's message slot
+/// param[in] _func, the work, called with the group
+inline bool launchProcesses(std::size_t _size, std::size_t _slotBytes, const std::function<void(ProcessGroup&)>& _func)
+{
+  ProcessGroup group = ProcessGroup::create(_size,_slotBytes);
+  std::vector<pid_t> children;
+
+  for(std::size_t r = 1; r < _size; ++r)
+  {
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+      int status = 0;
+      try
+      {
+        group.setRank(static_cast<int>(r));
+        _func(group);
+      }
+      catch(...)
+      {
+        status = 1;
+      }
+      // skips the parent's exit handlers (eg the test framework's)
+      _exit(status);
+    }
+    if(pid < 0)
+    {
+      throw std::runtime_error(std::string("fork failed: ") + std::strerror(errno));
+    }
+    children.push_back(pid);
+  }
+
+  bool ok = true;
+  try
+  {
+    _func(group);
+  }
+  catch(...)
+  {
+    ok = false;
+  }
+
+  for(pid_t pid : children)
+  {
+    int status = 0;
+    waitpid(pid,&status,0);
+    ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  }
+
+  return ok;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Number of rows (or columns) of an _n long dimension in blocks of _block held by process _proc of _procs
+inline std::size_t blockCyclicCount(std::size_t _n, std::size_t _block, std::size_t _proc, std::size_t _procs)
+{
+  std::size_t blocks = _n / _block;
+  std::size_t count = (blocks / _procs) * _block;
+  std::size_t extra = blocks % _procs;
+
+  if(_proc < extra)
+  {
+    count += _block;
+  }
+  else if(_proc == extra)
+  {
+    count += _n % _block;
+  }
+
+  return count;
+}
+
+//----------------------------------------------------------------------------------------------
+/// \class DistributedMatrix
+/// \brief rows x cols matrix spread 2D block cyclically over a grid of processes, each process stores only its blocks
+template <typename T>
+class DistributedMatrix
+{
+private:
+
+    ProcessGroup* m_group;
+    std::size_t m_rows;
+    std::size_t m_cols;
+    std::size_t m_block;
+    std::size_t m_gridRows;
+    std::size_t m_gridCols;
+    // this process's place in the grid
+    std::size_t m_myRow;
+    std::size_t m_myCol;
+    // this process's blocks packed into a localRows x localCols row major matrix
+    std::size_t m_localRows;
+    std::size_t m_localCols;
+    std::vector<T> m_local;
+
+public:
+
+    // the group must have gridRows*gridCols processes, every process constructs the matrix with the same sizes
+    DistributedMatrix(ProcessGroup& _group, std::size_t _rows, std::size_t _cols, std::size_t _block,
+                      std::size_t _gridRows, std::size_t _gridCols);
+
+    std::size_t getRows() const { return m_rows; }
+    std::size_t getCols() const { return m_cols; }
+    std::size_t blockSize() const { return m_block; }
+    std::size_t gridRows() const { return m_gridRows; }
+    std::size_t gridCols() const { return m_gridCols; }
+    std::size_t gridRow() const { return m_myRow; }
+    std::size_t gridCol() const { return m_myCol; }
+    std::size_t localRows() const { return m_localRows; }
+    std::size_t localCols() const { return m_localCols; }
+    ProcessGroup& group() const { return *m_group; }
+
+    // process grid row (or column) that holds global row (or column) _i, counted from 0
+    std::size_t ownerRow(std::size_t _i) const { return (_i / m_block) % m_gridRows; }
+    std::size_t ownerCol(std::size_t _j) const { return (_j / m_block) % m_gridCols; }
+    // rank of the process in grid position (_row,_col)
+    int rankOf(std::size_t _row, std::size_t _col) const { return static_cast<int>(_row*m_gridCols + _col); }
+
+    // local index of global row (or column) _i, only meaningful on its owner
+    std::size_t localRow(std::size_t _i) const { return (_i / m_block / m_gridRows)*m_block + _i % m_block; }
+    std::size_t localCol(std::size_t _j) const { return (_j / m_block / m_gridCols)*m_block + _j % m_block; }
+    // global index of local row (or column) _l
+    std::size_t globalRow(std::size_t _l) const { return ((_l / m_block)*m_gridRows + m_myRow)*m_block + _l % m_block; }
+    std::size_t globalCol(std::size_t _l) const { return ((_l / m_block)*m_gridCols + m_myCol)*m_block + _l % m_block; }
+
+    // this process's values
+    T* local() { return m_local.data(); }
+    const T* local() const { return m_local.data(); }
+    T& local(std::size_t _lr, std::size_t _lc) { return m_local[_lr*m_localCols + _lc]; }
+
+    // sets every value this process holds to _func(row,col), rows and columns start at 1 as with Matrix
+    template <typename FUNC>
+    void fill(FUNC _func);
+
+    // returns the whole matrix row major on every process, for checking and small results
+    std::vector<T> gather() const;
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Works out this process's share of the matrix
+template <typename T>
+DistributedMatrix<T>::DistributedMatrix(ProcessGroup& _group, std::size_t _rows, std::size_t _cols, std::size_t _block,
+                                        std::size_t _gridRows, std::size_t _gridCols) :
+  m_group(&_group),
+  m_rows(_rows),
+  m_cols(_cols),
+  m_block(_block),
+  m_gridRows(_gridRows),
+  m_gridCols(_gridCols)
+{
+  if(_block == 0 || _gridRows*_gridCols != static_cast<std::size_t>(_group.size()))
+  {
+    throw std::out_of_range("the process grid must use every process in the group");
+  }
+
+  m_myRow = static_cast<std::size_t>(_group.rank()) / _gridCols;
+  m_myCol = static_cast<std::size_t>(_group.rank()) % _gridCols;
+  m_localRows = blockCyclicCount(_rows,_block,m_myRow,_gridRows);
+  m_localCols = blockCyclicCount(_cols,_block,m_myCol,_gridCols);
+  m_local.assign(m_localRows*m_localCols,T(0));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Sets every local value from its global position
+template <typename T>
+template <typename FUNC>
+void DistributedMatrix<T>::fill(FUNC _func)
+{
+  for(std::size_t lr = 0; lr < m_localRows; ++lr)
+  {
+    for(std::size_t lc = 0; lc < m_localCols; ++lc)
+    {
+      m_local[lr*m_localCols + lc] = _func(globalRow(lr)+1,globalCol(lc)+1);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Every process publishes its values and then unpacks everyone else's
+template <typename T>
+std::vector<T> DistributedMatrix<T>::gather() const
+{
+  ProcessGroup& group = *m_group;
+  // process (0,0) holds the most values, every process checks against it before anyone waits at the barrier
+  group.requireSlotBytes(blockCyclicCount(m_rows,m_block,0,m_gridRows)*
+                         blockCyclicCount(m_cols,m_block,0,m_gridCols)*sizeof(T));
+  std::vector<T> result(m_rows*m_cols);
+
+  group.publish(m_local.data(),m_local.size());
+  group.barrier();
+
+  for(std::size_t pr = 0; pr < m_gridRows; ++pr)
+  {
+    for(std::size_t pc = 0; pc < m_gridCols; ++pc)
+    {
+      const T* values = group.peer<T>(rankOf(pr,pc));
+      std::size_t rows = blockCyclicCount(m_rows,m_block,pr,m_gridRows);
+      std::size_t cols = blockCyclicCount(m_cols,m_block,pc,m_gridCols);
+      for(std::size_t lr = 0; lr < rows; ++lr)
+      {
+        std::size_t gr = ((lr / m_block)*m_gridRows + pr)*m_block + lr % m_block;
+        for(std::size_t lc = 0; lc < cols; ++lc)
+        {
+          std::size_t gc = ((lc / m_block)*m_gridCols + pc)*m_block + lc % m_block;
+          result[gr*m_cols + gc] = values[lr*cols + lc];
+        }
+      }
+    }
+  }
+  group.barrier();
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief C = A*B with SUMMA. For each block column k the processes holding A's panel k publish it and the ones
+/// holding B's panel k publish theirs, then every process multiplies the A panel from its grid row by the B panel
+/// from its grid column into its part of C. All three matrices must use the same grid and block size.
+/// param[in] _a, the left hand matrix (M x K)
+/// param[in] _b, the right hand matrix (K x N)
+/// param[in] _c, the result (M x N), overwritten
+template <typename T>
+void summa(const DistributedMatrix<T>& _a, const DistributedMatrix<T>& _b, DistributedMatrix<T>& _c)
+{
+  if(_a.getCols() != _b.getRows() || _c.getRows() != _a.getRows() || _c.getCols() != _b.getCols())
+  {
+    throw std::out_of_range("number of columns of matrix 1 must be equil to number of rows of matrix 2");
+  }
+  if(_a.blockSize() != _b.blockSize() || _a.blockSize() != _c.blockSize() ||
+     _a.gridRows() != _c.gridRows() || _a.gridCols() != _c.gridCols() ||
+     _b.gridRows() != _c.gridRows() || _b.gridCols() != _c.gridCols())
+  {
+    throw std::out_of_range("distributed matrices must use the same grid and block size");
+  }
+
+  ProcessGroup& group = _c.group();
+  const std::size_t nb = _a.blockSize();
+  const std::size_t inner = _a.getCols();
+  // B's panel goes after the largest A panel any process can publish
+  const std::size_t bOffset = blockCyclicCount(_a.getRows(),nb,0,_a.gridRows())*nb;
+  // checked on every process with the largest B panel (grid column 0), only the panel owners publish
+  group.requireSlotBytes((bOffset + std::min(nb,inner)*blockCyclicCount(_b.getCols(),nb,0,_b.gridCols()))*sizeof(T));
+
+  std::fill(_c.local(),_c.local() + _c.localRows()*_c.localCols(),T(0));
+  std::vector<T> panel(std::max(_a.localRows(),_b.localCols())*nb);
+
+  for(std::size_t k0 = 0; k0 < inner; k0 += nb)
+  {
+    std::size_t kw = std::min(nb,inner - k0);
+    std::size_t aOwner = _a.ownerCol(k0);
+    std::size_t bOwner = _b.ownerRow(k0);
+
+    if(_a.gridCol() == aOwner)
+    {
+      std::size_t lc = _a.localCol(k0);
+      for(std::size_t lr = 0; lr < _a.localRows(); ++lr)
+      {
+        std::copy(_a.local() + lr*_a.localCols() + lc,_a.local() + lr*_a.localCols() + lc + kw,panel.data() + lr*kw);
+      }
+      group.publish(panel.data(),_a.localRows()*kw);
+    }
+    if(_b.gridRow() == bOwner)
+    {
+      std::size_t lr = _b.localRow(k0);
+      group.publish(_b.local() + lr*_b.localCols(),kw*_b.localCols(),bOffset);
+    }
+    group.barrier();
+
+    const T* aPanel = group.peer<T>(_c.rankOf(_c.gridRow(),aOwner));
+    const T* bPanel = group.peer<T>(_c.rankOf(bOwner,_c.gridCol()),bOffset);
+    const std::size_t cols = _c.localCols();
+
+    for(std::size_t i = 0; i < _c.localRows(); ++i)
+    {
+      T* c = _c.local() + i*cols;
+      for(std::size_t k = 0; k < kw; ++k)
+      {
+        const T aik = aPanel[i*kw + k];
+        const T* b = bPanel + k*cols;
+        for(std::size_t j = 0; j < cols; ++j)
+        {
+          c[j] += aik * b[j];
+        }
+      }
+    }
+    group.barrier();
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// \class DistributedPivot
+/// \brief Candidate pivot published by each process during luDecompose
+template <typename T>
+struct DistributedPivot
+{
+  T magnitude;
+  T value;
+  std::uint64_t row;
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief LU decomposition with partial pivoting, in place. Afterwards A holds U on and above the diagonal and the
+/// multipliers of L (whose diagonal is 1) below it, so P*A = L*U. Each column takes four exchanges: the pivot search
+/// down the owning process column, the row swap, then the L column along process rows and the U row down process columns.
+/// Throws std::out_of_range on every process if the matrix is singular.
+/// param[in] _a, a square matrix
+/// Returns the row swapped with row k at step k (counted from 0), the same on every process
+template <typename T>
+std::vector<std::size_t> luDecompose(DistributedMatrix<T>& _a)
+{
+  if(_a.getRows() != _a.getCols())
+  {
+    throw std::out_of_range("You must use a square matrix for LU decomposition");
+  }
+
+  ProcessGroup& group = _a.group();
+  const std::size_t n = _a.getRows();
+  const std::size_t rows = _a.localRows();
+  const std::size_t cols = _a.localCols();
+  // second half of each slot, after the largest local row or column anyone publishes
+  const std::size_t second = std::max(blockCyclicCount(n,_a.blockSize(),0,_a.gridRows()),
+                                      blockCyclicCount(n,_a.blockSize(),0,_a.gridCols()));
+  // the row swap and the L and U exchanges use both halves, checked on every process before any of them
+  group.requireSlotBytes(std::max(2*second*sizeof(T),sizeof(DistributedPivot<T>)));
+  std::vector<std::size_t> pivots(n);
+  std::vector<T> column(rows);
+
+  for(std::size_t k = 0; k < n; ++k)
+  {
+    const std::size_t kRow = _a.ownerRow(k);
+    const std::size_t kCol = _a.ownerCol(k);
+
+    // pivot search, the process column holding column k offers its largest value below the diagonal
+    DistributedPivot<T> best = {T(-1), T(0), std::uint64_t(n)};
+    if(_a.gridCol() == kCol)
+    {
+      std::size_t lc = _a.localCol(k);
+      for(std::size_t lr = 0; lr < rows; ++lr)
+      {
+        std::size_t gr = _a.globalRow(lr);
+        T value = _a.local(lr,lc);
+        if(gr >= k && std::abs(value) > best.magnitude)
+        {
+          best.magnitude = std::abs(value);
+          best.value = value;
+          best.row = gr;
+        }
+      }
+    }
+    best = group.allReduce(best,[](const DistributedPivot<T>& _x, const DistributedPivot<T>& _y)
+    {
+      return (_y.magnitude > _x.magnitude || (_y.magnitude == _x.magnitude && _y.row < _x.row)) ? _y : _x;
+    });
+
+    if(!(best.magnitude > T(0)))
+    {
+      throw std::out_of_range("LU decomposition failed, the matrix is singular");
+    }
+
+    const std::size_t p = static_cast<std::size_t>(best.row);
+    pivots[k] = p;
+
+    // swap rows k and p, each holder publishes its piece and takes the other one
+    if(p != k)
+    {
+      const std::size_t pRow = _a.ownerRow(p);
+      if(_a.gridRow() == kRow)
+      {
+        group.publish(&_a.local(_a.localRow(k),0),cols);
+      }
+      if(_a.gridRow() == pRow)
+      {
+        group.publish(&_a.local(_a.localRow(p),0),cols,second);
+      }
+      group.barrier();
+      if(_a.gridRow() == kRow)
+      {
+        const T* from = group.peer<T>(_a.rankOf(pRow,_a.gridCol()),second);
+        std::copy(from,from + cols,&_a.local(_a.localRow(k),0));
+      }
+      if(_a.gridRow() == pRow)
+      {
+        const T* from = group.peer<T>(_a.rankOf(kRow,_a.gridCol()));
+        std::copy(from,from + cols,&_a.local(_a.localRow(p),0));
+      }
+      group.barrier();
+    }
+
+    // multipliers below the pivot, then publish the L column and the U row
+    if(_a.gridCol() == kCol)
+    {
+      std::size_t lc = _a.localCol(k);
+      for(std::size_t lr = 0; lr < rows; ++lr)
+      {
+        if(_a.globalRow(lr) > k)
+        {
+          _a.local(lr,lc) /= best.value;
+        }
+        column[lr] = _a.local(lr,lc);
+      }
+      group.publish(column.data(),rows);
+    }
+    if(_a.gridRow() == kRow)
+    {
+      group.publish(&_a.local(_a.localRow(k),0),cols,second);
+    }
+    group.barrier();
+
+    // rank one update of the trailing matrix
+    const T* l = group.peer<T>(_a.rankOf(_a.gridRow(),kCol));
+    const T* u = group.peer<T>(_a.rankOf(kRow,_a.gridCol()),second);
+    for(std::size_t lr = 0; lr < rows; ++lr)
+    {
+      if(_a.globalRow(lr) <= k)
+      {
+        continue;
+      }
+      const T lik = l[lr];
+      for(std::size_t lc = 0; lc < cols; ++lc)
+      {
+        if(_a.globalCol(lc) > k)
+        {
+          _a.local(lr,lc) -= lik * u[lc];
+        }
+      }
+    }
+    group.barrier();
+  }
+
+  return pivots;
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // DISTRIBUTEDMATRIX_H
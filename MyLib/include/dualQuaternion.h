@@ -0,0 +1,540 @@
+#ifndef DUALQUATERNION_H
+#define DUALQUATERNION_H
+#include <cstddef>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include "quaternionBatch.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Dual quaternions r + εd for rigid transforms, r is the rotation and d = 0.5*t*r holds the translation t.
+/// Unlike a 4x4 matrix a unit dual quaternion can only hold a rotation and a translation, so blending them never
+/// adds scale or shear, which is what gives linear blend skinning its candy wrapper and collapsing joints.
+/// As with Quaternion the operators change the left operand and return it.
+/// skinVertices and skinMeshes in the second half of the file do dual quaternion linear blend skinning (Kavan et
+/// al. 2007), every vertex blends the dual quaternions of its joints by weight, normalizes the result and
+/// transforms its position (and normal) with it. The float versions blend SimdFloat::width vertices at a time,
+/// skinMeshes skins separate meshes on separate threads with parallelFor.
+///   DualQuaternion<float> joint(rotation,translation);
+///   Matrix<float,3,1> p = joint.transformPoint(v);
+
+//----------------------------------------------------------------------------------------------
+/// \class DualQuaternion
+/// \brief Rigid transform stored as a real (rotation) and dual (translation) quaternion
+template <typename T>
+class DualQuaternion
+{
+private:
+
+    // the rotation
+    Quaternion<T> m_real;
+    // half the translation times the rotation
+    Quaternion<T> m_dual;
+
+public:
+
+    // identity transform
+    DualQuaternion();
+    // from the two parts directly
+    DualQuaternion(const Quaternion<T>& _real, const Quaternion<T>& _dual);
+    // rotation by the unit quaternion _rotation followed by the translation _translation
+    DualQuaternion(const Quaternion<T>& _rotation, const Matrix<T,3,1>& _translation);
+
+    // the real (rotation) and dual parts
+    Quaternion<T>& real() { return m_real; }
+    Quaternion<T>& dual() { return m_dual; }
+    const Quaternion<T>& real() const { return m_real; }
+    const Quaternion<T>& dual() const { return m_dual; }
+
+    // the translation 2*d*r^-1 of a normalized dual quaternion
+    Matrix<T,3,1> translation() const;
+
+    // equility operator
+    bool operator== (const DualQuaternion<T>& _rhs);
+    // addition operator, for blending
+    DualQuaternion& operator+ (const DualQuaternion<T>& _rhs);
+    // multiply operator scalar, for blending
+    DualQuaternion& operator* (T _scalar);
+    // composition, the result applies _rhs first then the original transform
+    DualQuaternion& operator* (const DualQuaternion<T>& _rhs);
+
+    // conjugate of both parts, the inverse transform of a normalized dual quaternion
+    DualQuaternion<T>& conjugate();
+    // scales to a unit real part and removes the part of the dual that isn't orthogonal to it
+    DualQuaternion<T>& normalize();
+
+    // rotates then translates _p, the dual quaternion must be normalized
+    Matrix<T,3,1> transformPoint(const Matrix<T,3,1>& _p) const;
+    // rotates _v without translating it, for directions and normals
+    Matrix<T,3,1> transformVector(const Matrix<T,3,1>& _v) const;
+
+    // homogeneous matrix for column vectors, rotation in the top left and translation in the last column
+    Matrix<T,4,4> toMatrix4() const;
+    // dual quaternion of a homogeneous matrix, the top left 3x3 must be a rotation
+    static DualQuaternion<T> fromMatrix(const Matrix<T,4,4>& _mat);
+
+    // prints out the real and dual parts
+    void print();
+
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Default constructor, the identity transform (1,0,0,0) + ε(0,0,0,0)
+template <typename T>
+DualQuaternion<T>::DualQuaternion() : m_real(T(1),T(0),T(0),T(0)), m_dual()
+{
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Constructs a dual quaternion from its two parts
+/// param[in] _real, the real part
+/// param[in] _dual, the dual part
+template <typename T>
+DualQuaternion<T>::DualQuaternion(const Quaternion<T>& _real, const Quaternion<T>& _dual) :
+  m_real(_real), m_dual(_dual)
+{
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Constructs the transform that rotates then translates, d = 0.5*(0,t)*r
+/// param[in] _rotation, the rotation, must be normalized
+/// param[in] _translation, the translation applied after the rotation
+template <typename T>
+DualQuaternion<T>::DualQuaternion(const Quaternion<T>& _rotation, const Matrix<T,3,1>& _translation) :
+  m_real(_rotation)
+{
+  const T* t = _translation.data();
+  Quaternion<T> half(T(0),T(0.5)*t[0],T(0.5)*t[1],T(0.5)*t[2]);
+  quaternionMultiplyKernel(half.data(),m_real.data(),m_dual.data());
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the translation, the vector part of 2*d*r^*
+template <typename T>
+Matrix<T,3,1> DualQuaternion<T>::translation() const
+{
+  const T* r = m_real.data();
+  const T* d = m_dual.data();
+
+  // 2*(a_r*d_v - a_d*r_v + r_v x d_v), the vector part of 2*d*r^* without the scalar part
+  Matrix<T,3,1> result;
+  T* t = result.data();
+  t[0] = T(2)*((r[0]*d[1])-(d[0]*r[1])+(r[2]*d[3])-(r[3]*d[2]));
+  t[1] = T(2)*((r[0]*d[2])-(d[0]*r[2])+(r[3]*d[1])-(r[1]*d[3]));
+  t[2] = T(2)*((r[0]*d[3])-(d[0]*r[3])+(r[1]*d[2])-(r[2]*d[1]));
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Equility operator
+/// param[in] _rhs, the dual quaternion to check if equils the original
+template <typename T>
+bool DualQuaternion<T>::operator ==(const DualQuaternion<T>& _rhs)
+{
+  return m_real == _rhs.m_real && m_dual == _rhs.m_dual;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Addition operator
+/// param[in] _rhs, the dual quaternion to add to the original
+template <typename T>
+DualQuaternion<T>& DualQuaternion<T>::operator +(const DualQuaternion<T>& _rhs)
+{
+  m_real + _rhs.m_real;
+  m_dual + _rhs.m_dual;
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Multiplication operator (scalar)
+/// param[in] _scalar, the value both parts are multiplied by
+template <typename T>
+DualQuaternion<T>& DualQuaternion<T>::operator *(T _scalar)
+{
+  m_real * _scalar;
+  m_dual * _scalar;
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Composition, (r1 + εd1)(r2 + εd2) = r1*r2 + ε(r1*d2 + d1*r2)
+/// param[in] _rhs, the transform applied first, can be the original
+template <typename T>
+DualQuaternion<T>& DualQuaternion<T>::operator *(const DualQuaternion<T>& _rhs)
+{
+  Quaternion<T> real, dual, cross;
+  quaternionMultiplyKernel(m_real.data(),_rhs.m_real.data(),real.data());
+  quaternionMultiplyKernel(m_real.data(),_rhs.m_dual.data(),dual.data());
+  quaternionMultiplyKernel(m_dual.data(),_rhs.m_real.data(),cross.data());
+
+  m_real = real;
+  m_dual = dual + cross;
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Conjugates both parts, r^* + εd^*, for a normalized dual quaternion this is the inverse transform
+template <typename T>
+DualQuaternion<T>& DualQuaternion<T>::conjugate()
+{
+  m_real.conjugate();
+  m_dual.conjugate();
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Divides both parts by |r| then subtracts r*(r.d) from d so r.d = 0, a blend of rigid transforms
+/// becomes a rigid transform again. A zero real part is left as it is.
+template <typename T>
+DualQuaternion<T>& DualQuaternion<T>::normalize()
+{
+  T norm = m_real.norm();
+  if(norm == T(0))
+  {
+    return *this;
+  }
+
+  m_real / norm;
+  m_dual / norm;
+
+  Quaternion<T> parallel(m_real);
+  m_dual - (parallel * m_real.dot(m_dual));
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Rotates then translates a point
+/// param[in] _p, the point to transform, not changed
+template <typename T>
+Matrix<T,3,1> DualQuaternion<T>::transformPoint(const Matrix<T,3,1>& _p) const
+{
+  Matrix<T,3,1> result = m_real.rotate(_p);
+  Matrix<T,3,1> t = translation();
+
+  for(std::size_t i = 0; i < 3; ++i)
+  {
+    result.data()[i] += t.data()[i];
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Rotates a direction, the translation doesn't apply to directions
+/// param[in] _v, the direction to rotate, not changed
+template <typename T>
+Matrix<T,3,1> DualQuaternion<T>::transformVector(const Matrix<T,3,1>& _v) const
+{
+  return m_real.rotate(_v);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the homogeneous matrix of the transform
+template <typename T>
+Matrix<T,4,4> DualQuaternion<T>::toMatrix4() const
+{
+  Matrix<T,4,4> mat = m_real.toMatrix4();
+  Matrix<T,3,1> t = translation();
+
+  for(std::size_t r = 0; r < 3; ++r)
+  {
+    mat.data()[r*4+3] = t.data()[r];
+  }
+
+  return mat;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the dual quaternion of a homogeneous rigid transform
+/// param[in] _mat, rotation in the top left 3x3 and translation in the last column, the last row is ignored
+template <typename T>
+DualQuaternion<T> DualQuaternion<T>::fromMatrix(const Matrix<T,4,4>& _mat)
+{
+  Matrix<T,3,1> t;
+  for(std::size_t r = 0; r < 3; ++r)
+  {
+    t.data()[r] = _mat.data()[r*4+3];
+  }
+
+  return DualQuaternion<T>(Quaternion<T>::fromMatrix(_mat),t);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Prints out the real and dual parts
+template <typename T>
+void DualQuaternion<T>::print()
+{
+  m_real.print();
+  std::cout<<"+ e(";
+  std::cout<<m_dual.a()<<" + "<<m_dual.b()<<"i + "<<m_dual.c()<<"j + "<<m_dual.d()<<"k)\n";
+}
+
+//----------------------------------------------------------------------------------------------
+/// \struct SkinnedMesh
+/// \brief The arrays one mesh is skinned from and into, nothing is owned
+template <typename T>
+struct SkinnedMesh
+{
+  // number of vertices
+  std::size_t vertices = 0;
+  // joints each vertex is bound to, the joint and weight arrays have this many entries per vertex
+  std::size_t influences = 0;
+  // bind pose positions
+  const Matrix<T,3,1>* positions = nullptr;
+  // bind pose normals, can be null
+  const Matrix<T,3,1>* normals = nullptr;
+  // influences joint indices per vertex, indexing pose
+  const unsigned int* joints = nullptr;
+  // influences weights per vertex, they should add up to 1 but are normalized with the blend anyway
+  const T* weights = nullptr;
+  // the transform of every joint from the bind pose
+  const DualQuaternion<T>* pose = nullptr;
+  // skinned positions, vertices of them are overwritten
+  Matrix<T,3,1>* outPositions = nullptr;
+  // skinned normals, only written when normals isn't null
+  Matrix<T,3,1>* outNormals = nullptr;
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Dual quaternion blend of vertex _v, each joint is flipped onto the same side as the first so the
+/// blend takes the shorter path, then the blend is normalized
+template <typename T>
+DualQuaternion<T> blendVertex(const SkinnedMesh<T>& _mesh, std::size_t _v)
+{
+  const unsigned int* joints = _mesh.joints + _v*_mesh.influences;
+  const T* weights = _mesh.weights + _v*_mesh.influences;
+
+  Quaternion<T> zero;
+  DualQuaternion<T> blend(zero,zero);
+  const Quaternion<T>& pivot = _mesh.pose[joints[0]].real();
+  for(std::size_t k = 0; k < _mesh.influences; ++k)
+  {
+    DualQuaternion<T> joint = _mesh.pose[joints[k]];
+    T w = pivot.dot(joint.real()) < T(0) ? -weights[k] : weights[k];
+    blend + (joint * w);
+  }
+
+  return blend.normalize();
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Skins _mesh vertices [_first,_last) one at a time
+template <typename T>
+void skinVerticesKernel(const SkinnedMesh<T>& _mesh, std::size_t _first, std::size_t _last)
+{
+  for(std::size_t i = _first; i < _last; ++i)
+  {
+    DualQuaternion<T> blend = blendVertex(_mesh,i);
+    _mesh.outPositions[i] = blend.transformPoint(_mesh.positions[i]);
+    if(_mesh.normals)
+    {
+      _mesh.outNormals[i] = blend.transformVector(_mesh.normals[i]);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Normalizes width blended dual quaternions and transforms a point and a direction by each, the real
+/// part is normalized with the rsqrt estimate and a Newton step. The translation formula only sees the part of
+/// the dual that is orthogonal to the real part, so it doesn't need to be removed as DualQuaternion::normalize does.
+/// param[in] _blend, real (a,b,c,d) then dual (a,b,c,d) registers
+inline void skinLanes(const SimdFloat::reg* _blend, SimdFloat::reg& _x, SimdFloat::reg& _y, SimdFloat::reg& _z,
+                      SimdFloat::reg& _nx, SimdFloat::reg& _ny, SimdFloat::reg& _nz)
+{
+  typedef SimdFloat S;
+
+  S::reg normSqr = S::madd(_blend[0],_blend[0],S::madd(_blend[1],_blend[1],
+                   S::madd(_blend[2],_blend[2],S::mul(_blend[3],_blend[3]))));
+  S::reg y = S::rsqrt(normSqr);
+  y = S::mul(y,S::sub(S::set1(1.5f),S::mul(S::mul(S::set1(0.5f),normSqr),S::mul(y,y))));
+  y = S::select(S::gt(normSqr,S::zero()),y,S::zero());
+
+  S::reg r[4], d[4];
+  for(std::size_t k = 0; k < 4; ++k)
+  {
+    r[k] = S::mul(_blend[k],y);
+    d[k] = S::mul(_blend[k+4],y);
+  }
+
+  // 2*(a_r*d_v - a_d*r_v + r_v x d_v), as DualQuaternion::translation
+  S::reg tx = S::sub(S::madd(r[0],d[1],S::mul(r[2],d[3])),S::madd(d[0],r[1],S::mul(r[3],d[2])));
+  S::reg ty = S::sub(S::madd(r[0],d[2],S::mul(r[3],d[1])),S::madd(d[0],r[2],S::mul(r[1],d[3])));
+  S::reg tz = S::sub(S::madd(r[0],d[3],S::mul(r[1],d[2])),S::madd(d[0],r[3],S::mul(r[2],d[1])));
+
+  rotateLanes(r[0],r[1],r[2],r[3],_x,_y,_z);
+  rotateLanes(r[0],r[1],r[2],r[3],_nx,_ny,_nz);
+  _x = S::add(_x,S::add(tx,tx));
+  _y = S::add(_y,S::add(ty,ty));
+  _z = S::add(_z,S::add(tz,tz));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Skins float _mesh vertices [_first,_last) width at a time, the joint dual quaternions are gathered a
+/// lane at a time and missing lanes are blended from the identity
+inline void skinVerticesKernel(const SkinnedMesh<float>& _mesh, std::size_t _first, std::size_t _last)
+{
+  typedef SimdFloat S;
+
+  for(std::size_t i = _first; i < _last; i += S::width)
+  {
+    std::size_t lanes = std::min<std::size_t>(S::width,_last-i);
+
+    S::reg blend[8];
+    S::reg pivot[4];
+    for(std::size_t k = 0; k < _mesh.influences; ++k)
+    {
+      float soa[8][S::width];
+      float weight[S::width];
+      for(std::size_t l = 0; l < S::width; ++l)
+      {
+        if(l < lanes)
+        {
+          std::size_t entry = (i+l)*_mesh.influences + k;
+          const DualQuaternion<float>& joint = _mesh.pose[_mesh.joints[entry]];
+          const float* real = joint.real().data();
+          const float* dual = joint.dual().data();
+          for(std::size_t c = 0; c < 4; ++c)
+          {
+            soa[c][l] = real[c];
+            soa[c+4][l] = dual[c];
+          }
+          weight[l] = _mesh.weights[entry];
+        }
+        else
+        {
+          for(std::size_t c = 0; c < 8; ++c)
+          {
+            soa[c][l] = c == 0 ? 1.0f : 0.0f;
+          }
+          weight[l] = k == 0 ? 1.0f : 0.0f;
+        }
+      }
+
+      S::reg q[8];
+      for(std::size_t c = 0; c < 8; ++c)
+      {
+        q[c] = S::load(soa[c]);
+      }
+      S::reg w = S::load(weight);
+
+      if(k == 0)
+      {
+        for(std::size_t c = 0; c < 4; ++c)
+        {
+          pivot[c] = q[c];
+        }
+        for(std::size_t c = 0; c < 8; ++c)
+        {
+          blend[c] = S::mul(w,q[c]);
+        }
+      }
+      else
+      {
+        w = S::flipSign(w,dotLanes(pivot,q));
+        for(std::size_t c = 0; c < 8; ++c)
+        {
+          blend[c] = S::madd(w,q[c],blend[c]);
+        }
+      }
+    }
+
+    // the positions and normals are separate Matrix objects so they are gathered a lane at a time
+    float soa[6][S::width] = {};
+    for(std::size_t l = 0; l < lanes; ++l)
+    {
+      const float* p = _mesh.positions[i+l].data();
+      soa[0][l] = p[0];
+      soa[1][l] = p[1];
+      soa[2][l] = p[2];
+      if(_mesh.normals)
+      {
+        const float* n = _mesh.normals[i+l].data();
+        soa[3][l] = n[0];
+        soa[4][l] = n[1];
+        soa[5][l] = n[2];
+      }
+    }
+
+    S::reg v[6];
+    for(std::size_t c = 0; c < 6; ++c)
+    {
+      v[c] = S::load(soa[c]);
+    }
+    skinLanes(blend,v[0],v[1],v[2],v[3],v[4],v[5]);
+    for(std::size_t c = 0; c < 6; ++c)
+    {
+      S::store(soa[c],v[c]);
+    }
+
+    for(std::size_t l = 0; l < lanes; ++l)
+    {
+      float* p = _mesh.outPositions[i+l].data();
+      p[0] = soa[0][l];
+      p[1] = soa[1][l];
+      p[2] = soa[2][l];
+      if(_mesh.normals)
+      {
+        float* n = _mesh.outNormals[i+l].data();
+        n[0] = soa[3][l];
+        n[1] = soa[4][l];
+        n[2] = soa[5][l];
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Dual quaternion linear blend skinning of one mesh on the calling thread, float meshes are skinned
+/// SimdFloat::width vertices at a time
+/// param[in] _mesh, the mesh, every vertex needs at least one influence
+template <typename T>
+void skinVertices(const SkinnedMesh<T>& _mesh)
+{
+  if(_mesh.influences == 0)
+  {
+    throw std::out_of_range("Skinned vertices need at least one influence");
+  }
+
+  skinVerticesKernel(_mesh,0,_mesh.vertices);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Skins _n meshes, eg every character in a crowd, meshes are shared between threads with enough
+/// vertices in each thread's share to be worth starting it
+/// param[in] _n, number of meshes
+/// param[in] _meshes, the meshes, their outputs must not overlap
+template <typename T>
+void skinMeshes(std::size_t _n, const SkinnedMesh<T>* _meshes)
+{
+  std::size_t vertices = 0;
+  for(std::size_t m = 0; m < _n; ++m)
+  {
+    if(_meshes[m].influences == 0)
+    {
+      throw std::out_of_range("Skinned vertices need at least one influence");
+    }
+    vertices += _meshes[m].vertices*_meshes[m].influences;
+  }
+
+  // the work per mesh is roughly the average joint reads per mesh
+  std::size_t perMesh = _n ? vertices/_n + 1 : 1;
+
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / perMesh + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t m = _first; m < _last; ++m)
+    {
+      skinVerticesKernel(_meshes[m],0,_meshes[m].vertices);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // DUALQUATERNION_H
@@ -0,0 +1,616 @@
+#ifndef ITERATIVESOLVERS_H
+#define ITERATIVESOLVERS_H
+#include <cmath>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <memory>
+#include "matrix.h"
+#include "matrixBlas.h"
+#include "sparseMatrix.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Iterative solvers for A*x = b, for systems too large for Matrix::inverse().
+/// ConjugateGradient  - A must be symmetric positive definite
+/// BiCGStab           - any non singular A
+/// A can be a dense Matrix, a CsrMatrix or any callable applyA(const T* in, T* out) that writes A*in into out,
+/// so the matrix never has to be stored. Every vector the solver needs is allocated when it is constructed, solve()
+/// itself never allocates. The work vectors use the ALLOC template parameter, eg ArenaAllocator<T> to take them from an arena.
+/// setMonitor gives a callback that is told the relative residual after every iteration.
+///
+/// Preconditioners have apply(const T* r, T* z) writing z = M^-1 r:
+/// IdentityPreconditioner - no preconditioning
+/// JacobiPreconditioner   - divides by the diagonal
+/// IncompleteCholesky     - IC(0), Cholesky factor restricted to the non zeros of a symmetric positive definite CsrMatrix
+
+//----------------------------------------------------------------------------------------------
+/// \class SolverResult
+/// \brief How a solve finished
+template <typename T>
+struct SolverResult
+{
+    // iterations carried out
+    std::size_t iterations;
+    // final residual |b - A*x| / |b|
+    T residual;
+    // true if residual reached the tolerance
+    bool converged;
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns an operator callback for a dense square matrix, A is referenced not copied
+template <typename T, size_t N>
+std::function<void(const T*, T*)> matrixOperator(const Matrix<T,N,N>& _mat)
+{
+  const Matrix<T,N,N>* mat = &_mat;
+  return [mat](const T* _in, T* _out) { gemvKernel(N,N,T(1),mat->data(),_in,T(0),_out); };
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns an operator callback for a sparse matrix, A is referenced not copied
+template <typename T>
+std::function<void(const T*, T*)> matrixOperator(const CsrMatrix<T>& _mat)
+{
+  const CsrMatrix<T>* mat = &_mat;
+  return [mat](const T* _in, T* _out) { mat->multiply(_in,_out); };
+}
+
+//----------------------------------------------------------------------------------------------
+/// \class IdentityPreconditioner
+/// \brief No preconditioning, z = r
+template <typename T>
+class IdentityPreconditioner
+{
+public:
+
+    // z = r
+    void apply(const T* _r, T* _z, std::size_t _n) const { std::copy(_r,_r+_n,_z); }
+};
+
+//----------------------------------------------------------------------------------------------
+/// \class JacobiPreconditioner
+/// \brief Jacobi (diagonal) preconditioner, z = r / diag(A)
+template <typename T>
+class JacobiPreconditioner
+{
+private:
+
+    // 1 / A(i,i)
+    std::vector<T> m_inverseDiagonal;
+
+    // throws if a diagonal value is zero, then stores its inverse
+    void setDiagonal(std::size_t _i, T _value);
+
+public:
+
+    // takes the diagonal of a dense square matrix
+    template <size_t N>
+    explicit JacobiPreconditioner(const Matrix<T,N,N>& _mat);
+
+    // takes the diagonal of a sparse matrix
+    explicit JacobiPreconditioner(const CsrMatrix<T>& _mat);
+
+    // z = r / diag(A)
+    void apply(const T* _r, T* _z, std::size_t _n) const;
+};
+
+//----------------------------------------------------------------------------------------------
+/// \class IncompleteCholesky
+/// \brief IC(0) preconditioner, A ~ L*L^T where L has the same non zeros as the lower triangle of A.
+/// Throws std::out_of_range if a pivot is not positive (A is not positive definite enough for IC(0)).
+template <typename T>
+class IncompleteCholesky
+{
+private:
+
+    // lower triangular factor, each row is sorted so the diagonal is its last value
+    CsrMatrix<T> m_lower;
+
+public:
+
+    // factorises the lower triangle of a symmetric sparse matrix
+    explicit IncompleteCholesky(const CsrMatrix<T>& _mat);
+
+    // factorises the lower triangle of a symmetric dense matrix
+    template <size_t N>
+    explicit IncompleteCholesky(const Matrix<T,N,N>& _mat) : IncompleteCholesky(CsrMatrix<T>::fromDense(_mat)) {}
+
+    // the factor L
+    const CsrMatrix<T>& factor() const { return m_lower; }
+
+    // z = (L*L^T)^-1 r by a forward then a backward substitution
+    void apply(const T* _r, T* _z, std::size_t _n) const;
+};
+
+//----------------------------------------------------------------------------------------------
+/// \class ConjugateGradient
+/// \brief Preconditioned conjugate gradient solver for symmetric positive definite systems
+template <typename T, typename ALLOC = std::allocator<T> >
+class ConjugateGradient
+{
+private:
+
+    // size of the system
+    std::size_t m_size;
+    // iteration limit
+    std::size_t m_maxIterations;
+    // relative residual to stop at
+    T m_tolerance;
+    // residual, preconditioned residual, search direction and A times the search direction
+    std::vector<T,ALLOC> m_r;
+    std::vector<T,ALLOC> m_z;
+    std::vector<T,ALLOC> m_p;
+    std::vector<T,ALLOC> m_ap;
+    // called after each iteration with the iteration number and relative residual
+    std::function<void(std::size_t, T)> m_monitor;
+
+public:
+
+    // allocates the workspace for an _size system
+    ConjugateGradient(std::size_t _size, std::size_t _maxIterations = 1000, T _tolerance = T(1e-6), const ALLOC& _alloc = ALLOC());
+
+    // sets the callback that is given the relative residual after every iteration
+    void setMonitor(std::function<void(std::size_t, T)> _monitor) { m_monitor = _monitor; }
+
+    // solves A*x = b, x holds the initial guess and is overwritten with the solution,
+    // _b and _x must hold the size given to the constructor and _applyA must read and write that many values
+    template <typename OPERATOR, typename PRECONDITIONER>
+    SolverResult<T> solve(const OPERATOR& _applyA, const T* _b, T* _x, const PRECONDITIONER& _precond);
+
+    // solves A*x = b with no preconditioner
+    template <typename OPERATOR>
+    SolverResult<T> solve(const OPERATOR& _applyA, const T* _b, T* _x)
+    {
+      return solve(_applyA,_b,_x,IdentityPreconditioner<T>());
+    }
+
+    // solves A*x = b for a dense matrix and vectors, throws std::out_of_range if N isn't the solver size
+    template <size_t N, typename PRECONDITIONER = IdentityPreconditioner<T> >
+    SolverResult<T> solve(const Matrix<T,N,N>& _mat, const Matrix<T,N,1>& _b, Matrix<T,N,1>& _x,
+                          const PRECONDITIONER& _precond = PRECONDITIONER())
+    {
+      if(N != m_size)
+      {
+        throw std::out_of_range("matrix size must be equil to the solver size");
+      }
+      return solve(matrixOperator(_mat),_b.data(),_x.data(),_precond);
+    }
+};
+
+//----------------------------------------------------------------------------------------------
+/// \class BiCGStab
+/// \brief Right preconditioned BiCGSTAB solver (van der Vorst 1992) for general non singular systems
+template <typename T, typename ALLOC = std::allocator<T> >
+class BiCGStab
+{
+private:
+
+    // size of the system
+    std::size_t m_size;
+    // iteration limit
+    std::size_t m_maxIterations;
+    // relative residual to stop at
+    T m_tolerance;
+    // work vectors, see solve
+    std::vector<T,ALLOC> m_r;
+    std::vector<T,ALLOC> m_rHat;
+    std::vector<T,ALLOC> m_p;
+    std::vector<T,ALLOC> m_v;
+    std::vector<T,ALLOC> m_pHat;
+    std::vector<T,ALLOC> m_s;
+    std::vector<T,ALLOC> m_sHat;
+    std::vector<T,ALLOC> m_t;
+    // called after each iteration with the iteration number and relative residual
+    std::function<void(std::size_t, T)> m_monitor;
+
+public:
+
+    // allocates the workspace for an _size system
+    BiCGStab(std::size_t _size, std::size_t _maxIterations = 1000, T _tolerance = T(1e-6), const ALLOC& _alloc = ALLOC());
+
+    // sets the callback that is given the relative residual after every iteration
+    void setMonitor(std::function<void(std::size_t, T)> _monitor) { m_monitor = _monitor; }
+
+    // solves A*x = b, x holds the initial guess and is overwritten with the solution,
+    // _b and _x must hold the size given to the constructor and _applyA must read and write that many values
+    template <typename OPERATOR, typename PRECONDITIONER>
+    SolverResult<T> solve(const OPERATOR& _applyA, const T* _b, T* _x, const PRECONDITIONER& _precond);
+
+    // solves A*x = b with no preconditioner
+    template <typename OPERATOR>
+    SolverResult<T> solve(const OPERATOR& _applyA, const T* _b, T* _x)
+    {
+      return solve(_applyA,_b,_x,IdentityPreconditioner<T>());
+    }
+
+    // solves A*x = b for a dense matrix and vectors, throws std::out_of_range if N isn't the solver size
+    template <size_t N, typename PRECONDITIONER = IdentityPreconditioner<T> >
+    SolverResult<T> solve(const Matrix<T,N,N>& _mat, const Matrix<T,N,1>& _b, Matrix<T,N,1>& _x,
+                          const PRECONDITIONER& _precond = PRECONDITIONER())
+    {
+      if(N != m_size)
+      {
+        throw std::out_of_range("matrix size must be equil to the solver size");
+      }
+      return solve(matrixOperator(_mat),_b.data(),_x.data(),_precond);
+    }
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Stores the inverse of diagonal value _i, throws if it is zero
+template <typename T>
+void JacobiPreconditioner<T>::setDiagonal(std::size_t _i, T _value)
+{
+  if(_value == T(0))
+  {
+    throw std::out_of_range("Jacobi preconditioner needs a non zero diagonal");
+  }
+  m_inverseDiagonal[_i] = T(1) / _value;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Jacobi preconditioner from the diagonal of a dense matrix
+template <typename T>
+template <size_t N>
+JacobiPreconditioner<T>::JacobiPreconditioner(const Matrix<T,N,N>& _mat) : m_inverseDiagonal(N)
+{
+  for(std::size_t i = 0; i < N; ++i)
+  {
+    setDiagonal(i,_mat.data()[i*N+i]);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Jacobi preconditioner from the diagonal of a sparse matrix
+template <typename T>
+JacobiPreconditioner<T>::JacobiPreconditioner(const CsrMatrix<T>& _mat) : m_inverseDiagonal(_mat.getRows())
+{
+  for(std::size_t i = 0; i < _mat.getRows(); ++i)
+  {
+    setDiagonal(i,_mat(i+1,i+1));
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief z = r / diag(A)
+template <typename T>
+void JacobiPreconditioner<T>::apply(const T* _r, T* _z, std::size_t _n) const
+{
+  const T* inv = m_inverseDiagonal.data();
+  for(std::size_t i = 0; i < _n; ++i)
+  {
+    _z[i] = _r[i] * inv[i];
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief IC(0) factorisation, row by row:
+/// L(i,k) = (A(i,k) - sum_j L(i,j)L(k,j)) / L(k,k) for k < i and L(i,i) = sqrt(A(i,i) - sum_j L(i,j)^2)
+/// where the sums only run over positions that are non zero in A
+template <typename T>
+IncompleteCholesky<T>::IncompleteCholesky(const CsrMatrix<T>& _mat)
+{
+  if(_mat.getRows() != _mat.getCols())
+  {
+    throw std::out_of_range("You must use a square matrix for the incomplete Cholesky preconditioner");
+  }
+
+  // copy the lower triangle
+  std::vector< Triplet<T> > lower;
+  lower.reserve(_mat.nonZeros()/2 + _mat.getRows());
+  for(std::size_t i = 0; i < _mat.getRows(); ++i)
+  {
+    for(std::size_t k = _mat.rowStart()[i]; k < _mat.rowStart()[i+1]; ++k)
+    {
+      if(_mat.colIndex()[k] <= i)
+      {
+        Triplet<T> t = {i+1, _mat.colIndex()[k]+1, _mat.values()[k]};
+        lower.push_back(t);
+      }
+    }
+  }
+  m_lower = CsrMatrix<T>::fromTriplets(_mat.getRows(),_mat.getCols(),lower);
+
+  const std::vector<std::size_t>& start = m_lower.rowStart();
+  const std::vector<std::size_t>& col = m_lower.colIndex();
+  std::vector<T>& val = m_lower.values();
+
+  for(std::size_t i = 0; i < m_lower.getRows(); ++i)
+  {
+    if(start[i] == start[i+1] || col[start[i+1]-1] != i)
+    {
+      throw std::out_of_range("incomplete Cholesky needs every diagonal value to be stored");
+    }
+
+    for(std::size_t idx = start[i]; idx < start[i+1]; ++idx)
+    {
+      std::size_t k = col[idx];
+
+      // sum of L(i,j)*L(k,j) for j < k, merging the two sorted rows
+      T sum = 0;
+      std::size_t a = start[i];
+      std::size_t b = start[k];
+      while(a < idx && b < start[k+1] && col[b] < k)
+      {
+        if(col[a] == col[b])
+        {
+          sum += val[a++] * val[b++];
+        }
+        else if(col[a] < col[b])
+        {
+          ++a;
+        }
+        else
+        {
+          ++b;
+        }
+      }
+
+      if(k < i)
+      {
+        val[idx] = (val[idx] - sum) / val[start[k+1]-1];
+      }
+      else
+      {
+        T pivot = val[idx] - sum;
+        if(!(pivot > T(0)))
+        {
+          throw std::out_of_range("incomplete Cholesky failed, the matrix is not positive definite");
+        }
+        val[idx] = std::sqrt(pivot);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief z = (L*L^T)^-1 r, solves L*y = r going forward through the rows and then L^T*z = y going backward
+template <typename T>
+void IncompleteCholesky<T>::apply(const T* _r, T* _z, std::size_t _n) const
+{
+  const std::vector<std::size_t>& start = m_lower.rowStart();
+  const std::vector<std::size_t>& col = m_lower.colIndex();
+  const std::vector<T>& val = m_lower.values();
+
+  for(std::size_t i = 0; i < _n; ++i)
+  {
+    T sum = _r[i];
+    std::size_t diag = start[i+1]-1;
+    for(std::size_t k = start[i]; k < diag; ++k)
+    {
+      sum -= val[k] * _z[col[k]];
+    }
+    _z[i] = sum / val[diag];
+  }
+
+  // row i of L is column i of L^T, so once z(i) is known it is taken away from the earlier rows
+  for(std::size_t i = _n; i-- > 0;)
+  {
+    std::size_t diag = start[i+1]-1;
+    _z[i] /= val[diag];
+    for(std::size_t k = start[i]; k < diag; ++k)
+    {
+      _z[col[k]] -= val[k] * _z[i];
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Allocates the workspace for the conjugate gradient solver
+/// param[in] _size, number of unknowns
+/// param[in] _maxIterations, most iterations solve will do
+/// param[in] _tolerance, relative residual |b - A*x| / |b| solve stops at
+/// param[in] _alloc, allocator for the work vectors
+template <typename T, typename ALLOC>
+ConjugateGradient<T,ALLOC>::ConjugateGradient(std::size_t _size, std::size_t _maxIterations, T _tolerance, const ALLOC& _alloc) :
+  m_size(_size),
+  m_maxIterations(_maxIterations),
+  m_tolerance(_tolerance),
+  m_r(_size,T(0),_alloc),
+  m_z(_size,T(0),_alloc),
+  m_p(_size,T(0),_alloc),
+  m_ap(_size,T(0),_alloc)
+{
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Preconditioned conjugate gradient, algorithm 11.5.1 from Golub and Van Loan, Matrix Computations
+/// param[in] _applyA, callable _applyA(in,out) writing A*in into out
+/// param[in] _b, right hand side, the constructor's _size values
+/// param[in] _x, initial guess of the constructor's _size values, overwritten with the solution
+/// param[in] _precond, preconditioner with apply(r,z,n)
+template <typename T, typename ALLOC>
+template <typename OPERATOR, typename PRECONDITIONER>
+SolverResult<T> ConjugateGradient<T,ALLOC>::solve(const OPERATOR& _applyA, const T* _b, T* _x, const PRECONDITIONER& _precond)
+{
+  const std::size_t n = m_size;
+  T* r = m_r.data();
+  T* z = m_z.data();
+  T* p = m_p.data();
+  T* ap = m_ap.data();
+
+  T bNorm = std::sqrt(dotKernel(n,_b,_b));
+  if(bNorm == T(0))
+  {
+    bNorm = T(1);
+  }
+
+  // r = b - A*x
+  _applyA(_x,r);
+  axpbyKernel(n,T(1),_b,T(-1),r);
+
+  SolverResult<T> result = {0, std::sqrt(dotKernel(n,r,r)) / bNorm, false};
+  if(result.residual <= m_tolerance)
+  {
+    result.converged = true;
+    return result;
+  }
+
+  _precond.apply(r,z,n);
+  std::copy(z,z+n,p);
+  T rz = dotKernel(n,r,z);
+
+  while(result.iterations < m_maxIterations)
+  {
+    _applyA(p,ap);
+    T alpha = rz / dotKernel(n,p,ap);
+
+    axpyKernel(n,alpha,p,_x);
+    axpyKernel(n,-alpha,ap,r);
+
+    ++result.iterations;
+    result.residual = std::sqrt(dotKernel(n,r,r)) / bNorm;
+    if(m_monitor)
+    {
+      m_monitor(result.iterations,result.residual);
+    }
+    if(result.residual <= m_tolerance)
+    {
+      result.converged = true;
+      break;
+    }
+
+    _precond.apply(r,z,n);
+    T rzNext = dotKernel(n,r,z);
+    // p = z + beta*p
+    axpbyKernel(n,T(1),z,rzNext/rz,p);
+    rz = rzNext;
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Allocates the workspace for the BiCGSTAB solver
+/// param[in] _size, number of unknowns
+/// param[in] _maxIterations, most iterations solve will do
+/// param[in] _tolerance, relative residual |b - A*x| / |b| solve stops at
+/// param[in] _alloc, allocator for the work vectors
+template <typename T, typename ALLOC>
+BiCGStab<T,ALLOC>::BiCGStab(std::size_t _size, std::size_t _maxIterations, T _tolerance, const ALLOC& _alloc) :
+  m_size(_size),
+  m_maxIterations(_maxIterations),
+  m_tolerance(_tolerance),
+  m_r(_size,T(0),_alloc),
+  m_rHat(_size,T(0),_alloc),
+  m_p(_size,T(0),_alloc),
+  m_v(_size,T(0),_alloc),
+  m_pHat(_size,T(0),_alloc),
+  m_s(_size,T(0),_alloc),
+  m_sHat(_size,T(0),_alloc),
+  m_t(_size,T(0),_alloc)
+{
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Right preconditioned BiCGSTAB, from van der Vorst (1992) "Bi-CGSTAB: a fast and smoothly converging
+/// variant of Bi-CG for the solution of nonsymmetric linear systems". Stops early if the method breaks down.
+/// param[in] _applyA, callable _applyA(in,out) writing A*in into out
+/// param[in] _b, right hand side, the constructor's _size values
+/// param[in] _x, initial guess of the constructor's _size values, overwritten with the solution
+/// param[in] _precond, preconditioner with apply(r,z,n)
+template <typename T, typename ALLOC>
+template <typename OPERATOR, typename PRECONDITIONER>
+SolverResult<T> BiCGStab<T,ALLOC>::solve(const OPERATOR& _applyA, const T* _b, T* _x, const PRECONDITIONER& _precond)
+{
+  const std::size_t n = m_size;
+  T* r = m_r.data();
+  T* rHat = m_rHat.data();
+  T* p = m_p.data();
+  T* v = m_v.data();
+  T* pHat = m_pHat.data();
+  T* s = m_s.data();
+  T* sHat = m_sHat.data();
+  T* t = m_t.data();
+
+  T bNorm = std::sqrt(dotKernel(n,_b,_b));
+  if(bNorm == T(0))
+  {
+    bNorm = T(1);
+  }
+
+  // r = b - A*x
+  _applyA(_x,r);
+  axpbyKernel(n,T(1),_b,T(-1),r);
+  std::copy(r,r+n,rHat);
+  std::fill(p,p+n,T(0));
+  std::fill(v,v+n,T(0));
+
+  SolverResult<T> result = {0, std::sqrt(dotKernel(n,r,r)) / bNorm, false};
+  if(result.residual <= m_tolerance)
+  {
+    result.converged = true;
+    return result;
+  }
+
+  T rho = 1;
+  T alpha = 1;
+  T omega = 1;
+
+  while(result.iterations < m_maxIterations)
+  {
+    T rhoNext = dotKernel(n,rHat,r);
+    if(rhoNext == T(0) || omega == T(0))
+    {
+      break;
+    }
+
+    // p = r + beta*(p - omega*v)
+    T beta = (rhoNext / rho) * (alpha / omega);
+    axpyKernel(n,-omega,v,p);
+    axpbyKernel(n,T(1),r,beta,p);
+
+    _precond.apply(p,pHat,n);
+    _applyA(pHat,v);
+    alpha = rhoNext / dotKernel(n,rHat,v);
+
+    // s = r - alpha*v
+    std::copy(r,r+n,s);
+    axpyKernel(n,-alpha,v,s);
+
+    ++result.iterations;
+    T sNorm = std::sqrt(dotKernel(n,s,s)) / bNorm;
+    if(sNorm <= m_tolerance)
+    {
+      axpyKernel(n,alpha,pHat,_x);
+      result.residual = sNorm;
+      result.converged = true;
+      if(m_monitor)
+      {
+        m_monitor(result.iterations,result.residual);
+      }
+      break;
+    }
+
+    _precond.apply(s,sHat,n);
+    _applyA(sHat,t);
+    T tt = dotKernel(n,t,t);
+    omega = tt == T(0) ? T(0) : dotKernel(n,t,s) / tt;
+
+    // x = x + alpha*pHat + omega*sHat, r = s - omega*t
+    axpyKernel(n,alpha,pHat,_x);
+    axpyKernel(n,omega,sHat,_x);
+    std::copy(s,s+n,r);
+    axpyKernel(n,-omega,t,r);
+
+    result.residual = std::sqrt(dotKernel(n,r,r)) / bNorm;
+    if(m_monitor)
+    {
+      m_monitor(result.iterations,result.residual);
+    }
+    if(result.residual <= m_tolerance)
+    {
+      result.converged = true;
+      break;
+    }
+
+    rho = rhoNext;
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // ITERATIVESOLVERS_H
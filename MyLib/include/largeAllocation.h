@@ -0,0 +1,388 @@
+#ifndef LARGEALLOCATION_H
+#define LARGEALLOCATION_H
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <new>
+#include <memory>
+#include <utility>
+#include <type_traits>
+#include <vector>
+#include "parallel.h"
+#if defined(__linux__)
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Allocation policies for large matrices, which are too big for the stack and pay for TLB misses and remote NUMA memory.
+/// A MemoryPolicy picks the page size and where the pages are placed:
+/// PagePolicy::TransparentHuge  - 2MB aligned memory with madvise(MADV_HUGEPAGE) so the kernel backs it with huge pages
+/// PagePolicy::ExplicitHuge     - MAP_HUGETLB pages from the reserved pool, falls back to TransparentHuge if there are none
+/// NumaPolicy::FirstTouch       - the memory is pre-faulted by writing it in parallel, split the way parallelFor splits the
+///                                elements. The threads aren't pinned, so each page lands on whichever node the thread
+///                                that faulted it ran on, this spreads the faults rather than promising a placement
+/// NumaPolicy::Interleaved      - pages are spread round robin over every node (mbind MPOL_INTERLEAVE), for data every
+///                                thread reads
+/// makeLargeMatrix<Matrix<T,R,C> >(policy) returns a matrix allocated this way, LargeAllocator<T> does the same for std::vector.
+/// The page size and placement are hints, when the kernel refuses them (or on other systems) the memory is still allocated,
+/// LargeBlock::interleaved says whether an interleaved placement was applied.
+/// Allocations smaller than MYLIB_LARGE_MIN_BYTES come from the normal heap whatever the policy, rounding them up to a
+/// huge page would waste most of it.
+
+// huge page size the allocations are rounded and aligned to
+#ifndef MYLIB_HUGE_PAGE_SIZE
+#define MYLIB_HUGE_PAGE_SIZE (std::size_t(2) << 20)
+#endif
+
+// allocations smaller than this use the normal heap and ignore the policy
+#ifndef MYLIB_LARGE_MIN_BYTES
+#define MYLIB_LARGE_MIN_BYTES MYLIB_HUGE_PAGE_SIZE
+#endif
+
+//----------------------------------------------------------------------------------------------
+/// @brief Page size used for an allocation
+enum class PagePolicy
+{
+  Default,
+  TransparentHuge,
+  ExplicitHuge
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Placement of an allocation's pages on NUMA nodes
+enum class NumaPolicy
+{
+  Default,
+  FirstTouch,
+  Interleaved
+};
+
+//----------------------------------------------------------------------------------------------
+/// \class MemoryPolicy
+/// \brief Page size and NUMA placement for a large allocation
+struct MemoryPolicy
+{
+  PagePolicy pages;
+  NumaPolicy numa;
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Policy used when none is given, transparent huge pages pre-faulted in parallel
+inline MemoryPolicy defaultLargePolicy()
+{
+  MemoryPolicy policy = {PagePolicy::TransparentHuge, NumaPolicy::FirstTouch};
+  return policy;
+}
+
+//----------------------------------------------------------------------------------------------
+/// \class LargeBlock
+/// \brief Memory returned by allocateLarge, bytes is what has to be passed back to freeLarge
+struct LargeBlock
+{
+  void* data;
+  std::size_t bytes;
+  // true if the memory came from mmap rather than malloc
+  bool mapped;
+  // true if NumaPolicy::Interleaved was asked for and the kernel accepted it
+  bool interleaved;
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the ids of the NUMA nodes in /sys/devices/system/node in increasing order, empty if it can't be read
+inline std::vector<unsigned int> numaNodes()
+{
+  std::vector<unsigned int> nodes;
+#if defined(__linux__)
+  DIR* dir = opendir("/sys/devices/system/node");
+  if(!dir)
+  {
+    return nodes;
+  }
+
+  while(dirent* entry = readdir(dir))
+  {
+    unsigned int id;
+    char extra;
+    if(std::sscanf(entry->d_name,"node%u%c",&id,&extra) == 1)
+    {
+      nodes.push_back(id);
+    }
+  }
+  closedir(dir);
+
+  std::sort(nodes.begin(),nodes.end());
+#endif
+  return nodes;
+}
+
+#if defined(__linux__)
+//----------------------------------------------------------------------------------------------
+/// @brief Maps _bytes (a multiple of the huge page size) aligned to a huge page, the unaligned ends are unmapped
+inline void* mapHugeAligned(std::size_t _bytes)
+{
+  std::size_t padded = _bytes + MYLIB_HUGE_PAGE_SIZE;
+  void* raw = mmap(nullptr,padded,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+  if(raw == MAP_FAILED)
+  {
+    return nullptr;
+  }
+
+  char* base = static_cast<char*>(raw);
+  std::size_t head = (MYLIB_HUGE_PAGE_SIZE - reinterpret_cast<std::uintptr_t>(base) % MYLIB_HUGE_PAGE_SIZE) % MYLIB_HUGE_PAGE_SIZE;
+  if(head)
+  {
+    munmap(base,head);
+  }
+  std::size_t tail = padded - head - _bytes;
+  if(tail)
+  {
+    munmap(base + head + _bytes,tail);
+  }
+
+  return base + head;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Interleaves the pages of [_data,_data+_bytes) over every node, returns false if the kernel refused
+/// (the pages then keep the default placement)
+inline bool interleavePages(void* _data, std::size_t _bytes)
+{
+#if defined(SYS_mbind)
+  // the mask only covers the nodes there are, a mask wider than the kernel's MAX_NUMNODES fails with EINVAL
+  static const std::vector<unsigned int> nodes = numaNodes();
+  if(nodes.empty())
+  {
+    return false;
+  }
+
+  const std::size_t bitsPerLong = sizeof(unsigned long)*8;
+  const std::size_t bits = nodes.back() + 1;
+  std::vector<unsigned long> mask(bits / bitsPerLong + 1,0);
+  for(unsigned int node : nodes)
+  {
+    mask[node / bitsPerLong] |= 1ul << (node % bitsPerLong);
+  }
+
+  // MPOL_INTERLEAVE from <numaif.h>, the kernel reads one bit less than maxnode so it is given bits + 1 like libnuma
+  const int interleave = 3;
+  return syscall(SYS_mbind,_data,_bytes,interleave,mask.data(),bits + 1,0) == 0;
+#else
+  (void)_data;
+  (void)_bytes;
+  return false;
+#endif
+}
+#endif
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns true if allocateLarge maps _bytes with _policy rather than taking them from the heap,
+/// LargeAllocator::deallocate makes the same decision to free them
+inline bool mapsLarge(std::size_t _bytes, MemoryPolicy _policy)
+{
+#if defined(__linux__)
+  return _bytes >= MYLIB_LARGE_MIN_BYTES && (_policy.pages != PagePolicy::Default || _policy.numa != NumaPolicy::Default);
+#else
+  (void)_bytes;
+  (void)_policy;
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Rounds _bytes up to whole huge pages, the size of a mapped allocation
+inline std::size_t roundToHugePages(std::size_t _bytes)
+{
+  return (_bytes + MYLIB_HUGE_PAGE_SIZE - 1) / MYLIB_HUGE_PAGE_SIZE * MYLIB_HUGE_PAGE_SIZE;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Pre-faults [_data,_data+_count*_size) by writing zero to it split across threads the way parallelFor splits
+/// _count elements, so the page faults are taken in parallel. parallelFor's threads aren't pinned to nodes, so this
+/// doesn't say which node a page ends up on.
+inline void firstTouch(void* _data, std::size_t _count, std::size_t _size)
+{
+  char* bytes = static_cast<char*>(_data);
+  parallelFor(0,_count,MYLIB_PARALLEL_MIN_ELEMENTS,[bytes,_size](std::size_t _first, std::size_t _last)
+  {
+    std::memset(bytes + _first*_size,0,(_last - _first)*_size);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Allocates zeroed memory for _count elements of _size bytes following _policy, from the heap if it is smaller
+/// than MYLIB_LARGE_MIN_BYTES
+/// param[in] _count, number of elements, used to split the first touch the same way as the kernels
+/// param[in] _size, bytes per element
+/// param[in] _policy, page size and NUMA placement
+inline LargeBlock allocateLarge(std::size_t _count, std::size_t _size, MemoryPolicy _policy)
+{
+  std::size_t bytes = _count * _size;
+  LargeBlock block = {nullptr, bytes, false, false};
+
+#if defined(__linux__)
+  if(mapsLarge(bytes,_policy))
+  {
+    std::size_t rounded = roundToHugePages(bytes);
+    void* data = nullptr;
+
+    if(_policy.pages == PagePolicy::ExplicitHuge)
+    {
+      data = mmap(nullptr,rounded,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,-1,0);
+      if(data == MAP_FAILED)
+      {
+        data = nullptr;
+      }
+    }
+
+    if(!data)
+    {
+      data = mapHugeAligned(rounded);
+#if defined(MADV_HUGEPAGE)
+      if(data && _policy.pages != PagePolicy::Default)
+      {
+        madvise(data,rounded,MADV_HUGEPAGE);
+      }
+#endif
+    }
+
+    if(!data)
+    {
+      throw std::bad_alloc();
+    }
+
+    if(_policy.numa == NumaPolicy::Interleaved)
+    {
+      block.interleaved = interleavePages(data,rounded);
+    }
+
+    // fresh anonymous pages are already zero, touching them only takes the page faults now, in parallel
+    if(_policy.numa == NumaPolicy::FirstTouch)
+    {
+      firstTouch(data,_count,_size);
+    }
+
+    block.data = data;
+    block.bytes = rounded;
+    block.mapped = true;
+    return block;
+  }
+#endif
+
+  block.data = std::calloc(_count ? _count : 1,_size ? _size : 1);
+  if(!block.data)
+  {
+    throw std::bad_alloc();
+  }
+
+  return block;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Frees memory from allocateLarge
+inline void freeLarge(const LargeBlock& _block)
+{
+#if defined(__linux__)
+  if(_block.mapped)
+  {
+    munmap(_block.data,_block.bytes);
+    return;
+  }
+#endif
+  std::free(_block.data);
+}
+
+//----------------------------------------------------------------------------------------------
+/// \class LargeMatrixDeleter
+/// \brief Destroys a matrix made by makeLargeMatrix and frees its memory
+template <typename MATRIX>
+struct LargeMatrixDeleter
+{
+  LargeBlock block;
+
+  void operator()(MATRIX* _mat) const
+  {
+    _mat->~MATRIX();
+    freeLarge(block);
+  }
+};
+
+// owning pointer returned by makeLargeMatrix
+template <typename MATRIX>
+using LargeMatrixPtr = std::unique_ptr<MATRIX, LargeMatrixDeleter<MATRIX> >;
+
+//----------------------------------------------------------------------------------------------
+/// @brief Allocates and constructs a large matrix following _policy, eg makeLargeMatrix<Matrix<double,4096,4096> >()
+/// The storage is pre-faulted in parallel before the constructor zeroes it on this thread.
+/// param[in] _policy, page size and NUMA placement
+template <typename MATRIX>
+LargeMatrixPtr<MATRIX> makeLargeMatrix(MemoryPolicy _policy = defaultLargePolicy())
+{
+  typedef typename std::remove_pointer<decltype(std::declval<MATRIX&>().data())>::type Element;
+
+  // rounded up so the block covers the whole matrix even if it has padding that isn't a whole element
+  LargeBlock block = allocateLarge((sizeof(MATRIX) + sizeof(Element) - 1) / sizeof(Element),sizeof(Element),_policy);
+  MATRIX* mat = new (block.data) MATRIX();
+
+  LargeMatrixDeleter<MATRIX> deleter = {block};
+  return LargeMatrixPtr<MATRIX>(mat,deleter);
+}
+
+//----------------------------------------------------------------------------------------------
+/// \class LargeAllocator
+/// \brief Standard allocator following a MemoryPolicy, for large std::vector storage (eg the solver work vectors)
+template <typename T>
+class LargeAllocator
+{
+private:
+
+    MemoryPolicy m_policy;
+
+public:
+
+    typedef T value_type;
+
+    LargeAllocator() : m_policy(defaultLargePolicy()) {}
+    explicit LargeAllocator(MemoryPolicy _policy) : m_policy(_policy) {}
+    template <typename U>
+    LargeAllocator(const LargeAllocator<U>& _other) : m_policy(_other.policy()) {}
+
+    MemoryPolicy policy() const { return m_policy; }
+
+    T* allocate(std::size_t _n)
+    {
+      LargeBlock block = allocateLarge(_n,sizeof(T),m_policy);
+      return static_cast<T*>(block.data);
+    }
+
+    // whether allocateLarge mapped the memory and how far it rounded it up are worked out again from the size
+    void deallocate(T* _ptr, std::size_t _n)
+    {
+      std::size_t bytes = _n * sizeof(T);
+      bool mapped = mapsLarge(bytes,m_policy);
+      if(mapped)
+      {
+        bytes = roundToHugePages(bytes);
+      }
+      LargeBlock block = {_ptr, bytes, mapped, false};
+      freeLarge(block);
+    }
+
+    template <typename U>
+    bool operator==(const LargeAllocator<U>& _rhs) const
+    {
+      return m_policy.pages == _rhs.policy().pages && m_policy.numa == _rhs.policy().numa;
+    }
+    template <typename U>
+    bool operator!=(const LargeAllocator<U>& _rhs) const { return !(*this == _rhs); }
+};
+
+//----------------------------------------------------------------------------------------------
+#endif // LARGEALLOCATION_H
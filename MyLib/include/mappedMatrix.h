@@ -0,0 +1,737 @@
+#ifndef MAPPEDMATRIX_H
+#define MAPPEDMATRIX_H
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "matrix.h"
+#include "matrixTranspose.h"
+#include "parallel.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Out of core matrices, MappedMatrix<T> keeps its values in a file that is memory mapped so it can be larger than RAM.
+/// The file is stored in square tiles (tileSize x tileSize values, row major inside the tile and tiles in row major
+/// order) so a tile is one contiguous run of pages. Tiles on the right and bottom edges are padded with zeros.
+/// The operations below work a tile at a time, asking the kernel to read the next tiles in (madvise WILLNEED) while
+/// the current tile is being worked on, so the disk reads overlap the maths:
+/// multiply(A,B,C)    - C = A*B, a prefetch thread reads the next row of tiles in while the current one is multiplied
+/// transpose(A,B)     - B = A^T
+/// reduceTiles        - streams every tile through a function, sum, maxAbs and normFrobenius are built on it
+/// POSIX only (mmap).
+
+//----------------------------------------------------------------------------------------------
+/// \class MappedMatrixHeader
+/// \brief Written at the start of the file, the tiles start at the next page
+struct MappedMatrixHeader
+{
+  char magic[8];
+  std::uint64_t rows;
+  std::uint64_t cols;
+  std::uint64_t tileSize;
+  std::uint64_t elementSize;
+};
+
+//----------------------------------------------------------------------------------------------
+/// \class MappedMatrix
+/// \brief File backed rows x cols matrix stored in tiles, rows and columns start at 1 as with Matrix
+template <typename T>
+class MappedMatrix
+{
+  static_assert(std::is_trivially_copyable<T>::value, "MappedMatrix values are written straight to disk");
+
+private:
+
+    // file descriptor, -1 when nothing is open
+    int m_file = -1;
+    // the whole mapped file
+    char* m_map = nullptr;
+    std::size_t m_mapBytes = 0;
+    // first tile
+    T* m_tiles = nullptr;
+    std::size_t m_rows = 0;
+    std::size_t m_cols = 0;
+    std::size_t m_tileSize = 0;
+    std::size_t m_tileRows = 0;
+    std::size_t m_tileCols = 0;
+    // true if the mapping can be written to
+    bool m_writable = false;
+
+    // maps an open file, _writable maps it read/write
+    void map(bool _writable);
+
+    // unmaps and closes
+    void close();
+
+    // throws std::runtime_error with the errno message
+    static void fail(const std::string& _what);
+
+    // byte offset of the first tile
+    static std::size_t dataOffset();
+
+    // bytes a file for a _rows x _cols matrix in _tileSize tiles takes, false if that doesn't fit in a size_t
+    static bool fileBytes(std::size_t _rows, std::size_t _cols, std::size_t _tileSize, std::size_t& _bytes);
+
+public:
+
+    MappedMatrix() {}
+    ~MappedMatrix() { close(); }
+
+    // the mapping is owned so it can be moved but not copied
+    MappedMatrix(MappedMatrix&& _rhs) { *this = std::move(_rhs); }
+    MappedMatrix& operator=(MappedMatrix&& _rhs);
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+    // creates (or replaces) a zeroed _rows x _cols matrix file, disk space is only used as tiles are written
+    static MappedMatrix create(const std::string& _path, std::size_t _rows, std::size_t _cols, std::size_t _tileSize = 256);
+
+    // opens a file made by create, read only unless _writable
+    static MappedMatrix open(const std::string& _path, bool _writable = false);
+
+    std::size_t getRows() const { return m_rows; }
+    std::size_t getCols() const { return m_cols; }
+    std::size_t tileSize() const { return m_tileSize; }
+    // number of tiles down and across
+    std::size_t tileRows() const { return m_tileRows; }
+    std::size_t tileCols() const { return m_tileCols; }
+    // values in one tile
+    std::size_t tileElements() const { return m_tileSize*m_tileSize; }
+    // false for a matrix opened read only, writing to its tiles would fault
+    bool writable() const { return m_writable; }
+
+    // true if both matrices map the same file, even when it was opened twice
+    bool sameFile(const MappedMatrix& _rhs) const;
+
+    // tile (_tileRow,_tileCol), counted from 0, tileSize x tileSize row major values
+    T* tile(std::size_t _tileRow, std::size_t _tileCol) { return m_tiles + (_tileRow*m_tileCols + _tileCol)*tileElements(); }
+    const T* tile(std::size_t _tileRow, std::size_t _tileCol) const { return m_tiles + (_tileRow*m_tileCols + _tileCol)*tileElements(); }
+
+    // subscript operators, start at 1
+    T& operator()(std::size_t _rowID, std::size_t _colID);
+    const T& operator()(std::size_t _rowID, std::size_t _colID) const;
+
+    // asks the kernel to start reading a tile in, returns straight away
+    void prefetchTile(std::size_t _tileRow, std::size_t _tileCol) const;
+    // reads a value from every page of a tile, so it is in memory when this returns, used by prefetch threads
+    void touchTile(std::size_t _tileRow, std::size_t _tileCol) const;
+    // tells the kernel a tile won't be needed for a while so its pages can go first
+    void releaseTile(std::size_t _tileRow, std::size_t _tileCol) const;
+
+    // writes changed pages back to the file
+    void flush();
+
+    // copies a dense matrix in or out, the sizes must match
+    template <size_t ROWS, size_t COLS>
+    void load(const Matrix<T,ROWS,COLS>& _mat);
+    template <size_t ROWS, size_t COLS>
+    void store(Matrix<T,ROWS,COLS>& _mat) const;
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Throws std::runtime_error with the errno message
+template <typename T>
+void MappedMatrix<T>::fail(const std::string& _what)
+{
+  throw std::runtime_error(_what + ": " + std::strerror(errno));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Tiles start on the page after the header so each tile is page aligned when its size is a whole number of pages
+template <typename T>
+std::size_t MappedMatrix<T>::dataOffset()
+{
+  std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  return (sizeof(MappedMatrixHeader) + page - 1) / page * page;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Works out the file size for a matrix, returns false if it overflows (eg a corrupt header)
+template <typename T>
+bool MappedMatrix<T>::fileBytes(std::size_t _rows, std::size_t _cols, std::size_t _tileSize, std::size_t& _bytes)
+{
+  const std::size_t limit = static_cast<std::size_t>(-1);
+  std::size_t tileRows = _rows / _tileSize + (_rows % _tileSize != 0);
+  std::size_t tileCols = _cols / _tileSize + (_cols % _tileSize != 0);
+  if(tileCols > limit / tileRows || _tileSize > limit / _tileSize)
+  {
+    return false;
+  }
+
+  std::size_t tiles = tileRows*tileCols;
+  std::size_t tileBytes = _tileSize*_tileSize;
+  if(tileBytes > limit / sizeof(T))
+  {
+    return false;
+  }
+  tileBytes *= sizeof(T);
+  if(tiles > (limit - dataOffset()) / tileBytes)
+  {
+    return false;
+  }
+
+  _bytes = dataOffset() + tiles*tileBytes;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Move assignment, takes over the other matrix's mapping
+template <typename T>
+MappedMatrix<T>& MappedMatrix<T>::operator=(MappedMatrix&& _rhs)
+{
+  if(this != &_rhs)
+  {
+    close();
+    m_file = _rhs.m_file;
+    m_map = _rhs.m_map;
+    m_mapBytes = _rhs.m_mapBytes;
+    m_tiles = _rhs.m_tiles;
+    m_rows = _rhs.m_rows;
+    m_cols = _rhs.m_cols;
+    m_tileSize = _rhs.m_tileSize;
+    m_tileRows = _rhs.m_tileRows;
+    m_tileCols = _rhs.m_tileCols;
+    m_writable = _rhs.m_writable;
+    _rhs.m_file = -1;
+    _rhs.m_map = nullptr;
+    _rhs.m_mapBytes = 0;
+    _rhs.m_writable = false;
+  }
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Unmaps and closes the file
+template <typename T>
+void MappedMatrix<T>::close()
+{
+  if(m_map)
+  {
+    munmap(m_map,m_mapBytes);
+    m_map = nullptr;
+  }
+  m_writable = false;
+  if(m_file >= 0)
+  {
+    ::close(m_file);
+    m_file = -1;
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Maps the whole file, the sizes must already be set
+template <typename T>
+void MappedMatrix<T>::map(bool _writable)
+{
+  m_tileRows = (m_rows + m_tileSize - 1) / m_tileSize;
+  m_tileCols = (m_cols + m_tileSize - 1) / m_tileSize;
+  m_mapBytes = dataOffset() + m_tileRows*m_tileCols*tileElements()*sizeof(T);
+
+  void* data = mmap(nullptr,m_mapBytes,PROT_READ | (_writable ? PROT_WRITE : 0),MAP_SHARED,m_file,0);
+  if(data == MAP_FAILED)
+  {
+    fail("mmap failed");
+  }
+
+  m_map = static_cast<char*>(data);
+  m_tiles = reinterpret_cast<T*>(m_map + dataOffset());
+  m_writable = _writable;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Compares the device and inode of the two files, so two opens of one file count as the same
+template <typename T>
+bool MappedMatrix<T>::sameFile(const MappedMatrix& _rhs) const
+{
+  if(this == &_rhs)
+  {
+    return true;
+  }
+  if(m_file < 0 || _rhs.m_file < 0)
+  {
+    return false;
+  }
+
+  struct stat info;
+  struct stat rhsInfo;
+  if(fstat(m_file,&info) != 0 || fstat(_rhs.m_file,&rhsInfo) != 0)
+  {
+    fail("fstat failed");
+  }
+
+  return info.st_dev == rhsInfo.st_dev && info.st_ino == rhsInfo.st_ino;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Creates a zeroed matrix file, the file is sparse so blocks are only allocated when tiles are written
+/// param[in] _path, the file, replaced if it already exists
+/// param[in] _rows, number of rows
+/// param[in] _cols, number of columns
+/// param[in] _tileSize, rows and columns in each square tile
+template <typename T>
+MappedMatrix<T> MappedMatrix<T>::create(const std::string& _path, std::size_t _rows, std::size_t _cols, std::size_t _tileSize)
+{
+  if(_rows == 0 || _cols == 0 || _tileSize == 0)
+  {
+    throw std::out_of_range("A mapped matrix needs at least one row, column and tile size");
+  }
+
+  std::size_t bytes;
+  if(!fileBytes(_rows,_cols,_tileSize,bytes))
+  {
+    throw std::out_of_range("A mapped matrix of that size doesn't fit in memory");
+  }
+
+  MappedMatrix mat;
+  mat.m_file = ::open(_path.c_str(),O_RDWR | O_CREAT | O_TRUNC,0644);
+  if(mat.m_file < 0)
+  {
+    fail("could not create " + _path);
+  }
+
+  mat.m_rows = _rows;
+  mat.m_cols = _cols;
+  mat.m_tileSize = _tileSize;
+  if(ftruncate(mat.m_file,static_cast<off_t>(bytes)) != 0)
+  {
+    fail("could not size " + _path);
+  }
+
+  mat.map(true);
+
+  MappedMatrixHeader header = {{'M','Y','L','I','B','M','A','T'}, _rows, _cols, _tileSize, sizeof(T)};
+  std::memcpy(mat.m_map,&header,sizeof(header));
+
+  return mat;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Opens a matrix file made by create, throws if it isn't one, was written with a different value type or
+/// its header doesn't describe a matrix of the file's size
+/// param[in] _path, the file
+/// param[in] _writable, maps the file read/write, otherwise it is read only
+template <typename T>
+MappedMatrix<T> MappedMatrix<T>::open(const std::string& _path, bool _writable)
+{
+  MappedMatrix mat;
+  mat.m_file = ::open(_path.c_str(),_writable ? O_RDWR : O_RDONLY);
+  if(mat.m_file < 0)
+  {
+    fail("could not open " + _path);
+  }
+
+  MappedMatrixHeader header;
+  if(pread(mat.m_file,&header,sizeof(header),0) != static_cast<ssize_t>(sizeof(header)) ||
+     std::memcmp(header.magic,"MYLIBMAT",8) != 0)
+  {
+    throw std::runtime_error(_path + " is not a mapped matrix file");
+  }
+  if(header.elementSize != sizeof(T))
+  {
+    throw std::runtime_error(_path + " holds a different value type");
+  }
+
+  const std::uint64_t limit = static_cast<std::size_t>(-1);
+  std::size_t bytes;
+  if(header.rows == 0 || header.cols == 0 || header.tileSize == 0 ||
+     header.rows > limit || header.cols > limit || header.tileSize > limit ||
+     !fileBytes(header.rows,header.cols,header.tileSize,bytes))
+  {
+    throw std::runtime_error(_path + " has a corrupt header");
+  }
+
+  struct stat info;
+  if(fstat(mat.m_file,&info) != 0)
+  {
+    fail("could not stat " + _path);
+  }
+  if(info.st_size < 0 || static_cast<std::uint64_t>(info.st_size) != bytes)
+  {
+    throw std::runtime_error(_path + " is not the size its header says");
+  }
+
+  mat.m_rows = header.rows;
+  mat.m_cols = header.cols;
+  mat.m_tileSize = header.tileSize;
+
+  mat.map(_writable);
+
+  return mat;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Subscript operator, rows and columns start at 1
+template <typename T>
+T& MappedMatrix<T>::operator()(std::size_t _rowID, std::size_t _colID)
+{
+  if(_rowID < 1 || _rowID > m_rows || _colID < 1 || _colID > m_cols)
+  {
+    throw std::out_of_range("row or column out of range");
+  }
+
+  std::size_t r = _rowID-1;
+  std::size_t c = _colID-1;
+  return tile(r / m_tileSize,c / m_tileSize)[(r % m_tileSize)*m_tileSize + c % m_tileSize];
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Subscript operator (read only)
+template <typename T>
+const T& MappedMatrix<T>::operator()(std::size_t _rowID, std::size_t _colID) const
+{
+  return const_cast<MappedMatrix<T>&>(*this)(_rowID,_colID);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Rounds a tile out to whole pages for madvise
+inline void mappedTileRange(const void* _data, std::size_t _bytes, char*& _start, std::size_t& _length)
+{
+  std::uintptr_t page = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+  std::uintptr_t first = reinterpret_cast<std::uintptr_t>(_data) / page * page;
+  std::uintptr_t last = reinterpret_cast<std::uintptr_t>(_data) + _bytes;
+  _start = reinterpret_cast<char*>(first);
+  _length = last - first;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Starts reading a tile in (madvise WILLNEED), the kernel reads it in the background
+template <typename T>
+void MappedMatrix<T>::prefetchTile(std::size_t _tileRow, std::size_t _tileCol) const
+{
+  if(_tileRow >= m_tileRows || _tileCol >= m_tileCols)
+  {
+    return;
+  }
+
+  char* start;
+  std::size_t length;
+  mappedTileRange(tile(_tileRow,_tileCol),tileElements()*sizeof(T),start,length);
+  madvise(start,length,MADV_WILLNEED);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Reads one value from each page of a tile, blocking on the disk reads so the caller (a prefetch thread)
+/// waits for them instead of the threads doing the maths
+template <typename T>
+void MappedMatrix<T>::touchTile(std::size_t _tileRow, std::size_t _tileCol) const
+{
+  if(_tileRow >= m_tileRows || _tileCol >= m_tileCols)
+  {
+    return;
+  }
+
+  const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  const std::size_t bytes = tileElements()*sizeof(T);
+  const volatile char* data = reinterpret_cast<const volatile char*>(tile(_tileRow,_tileCol));
+  char sink = 0;
+  for(std::size_t offset = 0; offset < bytes; offset += page)
+  {
+    sink ^= data[offset];
+  }
+  sink ^= data[bytes - 1];
+  (void)sink;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Lets the kernel drop a tile's pages first (MADV_COLD where available), the data stays in the file
+template <typename T>
+void MappedMatrix<T>::releaseTile(std::size_t _tileRow, std::size_t _tileCol) const
+{
+#if defined(MADV_COLD)
+  char* start;
+  std::size_t length;
+  mappedTileRange(tile(_tileRow,_tileCol),tileElements()*sizeof(T),start,length);
+  madvise(start,length,MADV_COLD);
+#else
+  (void)_tileRow;
+  (void)_tileCol;
+#endif
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Writes every changed page back to the file
+template <typename T>
+void MappedMatrix<T>::flush()
+{
+  if(m_map && msync(m_map,m_mapBytes,MS_SYNC) != 0)
+  {
+    fail("msync failed");
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Copies a dense matrix into the file
+template <typename T>
+template <size_t ROWS, size_t COLS>
+void MappedMatrix<T>::load(const Matrix<T,ROWS,COLS>& _mat)
+{
+  if(ROWS != m_rows || COLS != m_cols)
+  {
+    throw std::out_of_range("the matrix must be the same size as the mapped matrix");
+  }
+
+  for(std::size_t r = 0; r < ROWS; ++r)
+  {
+    for(std::size_t c = 0; c < COLS; ++c)
+    {
+      (*this)(r+1,c+1) = _mat.data()[r*COLS + c];
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Copies the file into a dense matrix
+template <typename T>
+template <size_t ROWS, size_t COLS>
+void MappedMatrix<T>::store(Matrix<T,ROWS,COLS>& _mat) const
+{
+  if(ROWS != m_rows || COLS != m_cols)
+  {
+    throw std::out_of_range("the matrix must be the same size as the mapped matrix");
+  }
+
+  for(std::size_t r = 0; r < ROWS; ++r)
+  {
+    for(std::size_t c = 0; c < COLS; ++c)
+    {
+      _mat.data()[r*COLS + c] = (*this)(r+1,c+1);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief C += A*B for three _n x _n row major tiles, i-k-j so the inner loop is contiguous
+template <typename T>
+void multiplyTile(std::size_t _n, const T* __restrict__ _a, const T* __restrict__ _b, T* __restrict__ _c)
+{
+  for(std::size_t i = 0; i < _n; ++i)
+  {
+    for(std::size_t k = 0; k < _n; ++k)
+    {
+      const T aik = _a[i*_n + k];
+      for(std::size_t j = 0; j < _n; ++j)
+      {
+        _c[i*_n + j] += aik * _b[k*_n + j];
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief C = A*B a tile at a time. Step (ti,tk) adds A tile (ti,tk) times row tk of B's tiles into row ti of C's tiles,
+/// with the tiles of the row split across threads. While a step is multiplied a prefetch thread reads in the tiles of
+/// the next step, so the disk reads overlap the maths instead of stalling the threads that do it.
+/// Every value of C still adds its products in k order. The padding in the edge tiles is zero so whole tiles are multiplied.
+/// param[in] _a, the left hand matrix
+/// param[in] _b, the right hand matrix
+/// param[in] _c, the result, must be writable with A's rows, B's columns and the same tile size, and a different file to
+/// A and B since its tiles are cleared while theirs are still being read
+template <typename T>
+void multiply(const MappedMatrix<T>& _a, const MappedMatrix<T>& _b, MappedMatrix<T>& _c)
+{
+  if(!_c.writable())
+  {
+    throw std::invalid_argument("the result of a mapped multiply must be opened writable");
+  }
+  if(_c.sameFile(_a) || _c.sameFile(_b))
+  {
+    throw std::invalid_argument("the result of a mapped multiply can't be one of its inputs");
+  }
+  if(_a.getCols() != _b.getRows() || _c.getRows() != _a.getRows() || _c.getCols() != _b.getCols())
+  {
+    throw std::out_of_range("number of columns of matrix 1 must be equil to number of rows of matrix 2");
+  }
+  if(_a.tileSize() != _b.tileSize() || _a.tileSize() != _c.tileSize())
+  {
+    throw std::out_of_range("mapped matrices must use the same tile size");
+  }
+
+  const std::size_t n = _a.tileSize();
+  const std::size_t inner = _a.tileCols();
+  const std::size_t steps = _c.tileRows()*inner;
+
+  // reads in the A tile and the row of B tiles step _step uses
+  auto touchStep = [&](std::size_t _step)
+  {
+    std::size_t ti = _step / inner;
+    std::size_t tk = _step % inner;
+    _a.touchTile(ti,tk);
+    for(std::size_t tj = 0; tj < _b.tileCols(); ++tj)
+    {
+      _b.touchTile(tk,tj);
+    }
+  };
+
+  touchStep(0);
+  for(std::size_t step = 0; step < steps; ++step)
+  {
+    std::size_t ti = step / inner;
+    std::size_t tk = step % inner;
+
+    std::thread prefetch;
+    if(step + 1 < steps)
+    {
+      prefetch = std::thread(touchStep,step + 1);
+    }
+
+    parallelFor(0,_c.tileCols(),1,[&](std::size_t _first, std::size_t _last)
+    {
+      for(std::size_t tj = _first; tj < _last; ++tj)
+      {
+        T* c = _c.tile(ti,tj);
+        if(tk == 0)
+        {
+          std::fill(c,c + _c.tileElements(),T(0));
+        }
+        multiplyTile(n,_a.tile(ti,tk),_b.tile(tk,tj),c);
+      }
+    });
+
+    if(prefetch.joinable())
+    {
+      prefetch.join();
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief B = A^T a tile at a time, tile (i,j) of A is transposed into tile (j,i) of B with the SIMD transpose kernel
+/// param[in] _a, the matrix to transpose
+/// param[in] _b, the result, must be writable with A's columns as rows and A's rows as columns, same tile size,
+/// and a different file to A
+template <typename T>
+void transpose(const MappedMatrix<T>& _a, MappedMatrix<T>& _b)
+{
+  if(!_b.writable())
+  {
+    throw std::invalid_argument("the result of a mapped transpose must be opened writable");
+  }
+  if(_b.sameFile(_a))
+  {
+    throw std::invalid_argument("a mapped matrix can't be transposed into itself");
+  }
+  if(_b.getRows() != _a.getCols() || _b.getCols() != _a.getRows() || _a.tileSize() != _b.tileSize())
+  {
+    throw std::out_of_range("the result must have the transposed size and the same tile size");
+  }
+
+  const std::size_t n = _a.tileSize();
+  const std::size_t tiles = _a.tileRows()*_a.tileCols();
+
+  parallelFor(0,tiles,1,[&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t t = _first; t < _last; ++t)
+    {
+      std::size_t ti = t / _a.tileCols();
+      std::size_t tj = t % _a.tileCols();
+      if(t + 1 < _last)
+      {
+        _a.prefetchTile((t+1) / _a.tileCols(),(t+1) % _a.tileCols());
+      }
+      transposeKernel(n,n,_a.tile(ti,tj),_b.tile(tj,ti));
+      _a.releaseTile(ti,tj);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Streams every tile through _tileFunc(tile, rows, cols, tileSize) in file order, prefetching the next tile.
+/// rows and cols are how much of the tile is inside the matrix (less on the edges), tileSize is the row stride.
+/// The tiles are split across threads and the partial results combined in order with _combine.
+template <typename T, typename RESULT, typename TILEFUNC, typename COMBINE>
+RESULT reduceTiles(const MappedMatrix<T>& _mat, RESULT _init, TILEFUNC _tileFunc, COMBINE _combine)
+{
+  const std::size_t n = _mat.tileSize();
+  const std::size_t tiles = _mat.tileRows()*_mat.tileCols();
+
+  return parallelReduce(0,tiles,1,_init,[&](std::size_t _first, std::size_t _last)
+  {
+    RESULT result = _init;
+    for(std::size_t t = _first; t < _last; ++t)
+    {
+      std::size_t ti = t / _mat.tileCols();
+      std::size_t tj = t % _mat.tileCols();
+      if(t + 1 < _last)
+      {
+        _mat.prefetchTile((t+1) / _mat.tileCols(),(t+1) % _mat.tileCols());
+      }
+      std::size_t rows = std::min(n,_mat.getRows() - ti*n);
+      std::size_t cols = std::min(n,_mat.getCols() - tj*n);
+      result = _combine(result,_tileFunc(_mat.tile(ti,tj),rows,cols,n));
+      _mat.releaseTile(ti,tj);
+    }
+    return result;
+  },_combine);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the sum of every value
+template <typename T>
+T sum(const MappedMatrix<T>& _mat)
+{
+  return reduceTiles(_mat,T(0),[](const T* _tile, std::size_t _rows, std::size_t _cols, std::size_t _stride)
+  {
+    T total = 0;
+    for(std::size_t r = 0; r < _rows; ++r)
+    {
+      for(std::size_t c = 0; c < _cols; ++c)
+      {
+        total += _tile[r*_stride + c];
+      }
+    }
+    return total;
+  },[](T _x, T _y) { return _x + _y; });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the largest absolute value
+template <typename T>
+T maxAbs(const MappedMatrix<T>& _mat)
+{
+  return reduceTiles(_mat,T(0),[](const T* _tile, std::size_t _rows, std::size_t _cols, std::size_t _stride)
+  {
+    T largest = 0;
+    for(std::size_t r = 0; r < _rows; ++r)
+    {
+      for(std::size_t c = 0; c < _cols; ++c)
+      {
+        largest = std::max<T>(largest,std::abs(_tile[r*_stride + c]));
+      }
+    }
+    return largest;
+  },[](T _x, T _y) { return std::max(_x,_y); });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the Frobenius norm, the square root of the sum of the squares of every value
+template <typename T>
+T normFrobenius(const MappedMatrix<T>& _mat)
+{
+  return std::sqrt(reduceTiles(_mat,T(0),[](const T* _tile, std::size_t _rows, std::size_t _cols, std::size_t _stride)
+  {
+    T total = 0;
+    for(std::size_t r = 0; r < _rows; ++r)
+    {
+      for(std::size_t c = 0; c < _cols; ++c)
+      {
+        total += _tile[r*_stride + c] * _tile[r*_stride + c];
+      }
+    }
+    return total;
+  },[](T _x, T _y) { return _x + _y; }));
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // MAPPEDMATRIX_H
@@ -3,7 +3,10 @@
 #include <stdexcept>
 #include <math.h>
 #include <iostream>
-#include "quaternion.h"
+#include "arena.h"
+#include "reducedPrecision.h"
+#include "complexMatrix.h"
+#include "matrixTranspose.h"
 
 
 /// \author Kate Edge
@@ -33,7 +36,7 @@ private:
     bool m_vector = false;
 
     // function to check for a valid row and column range.
-    void rangeCheck(std::size_t rowID, std::size_t _colID);
+    void rangeCheck(std::size_t rowID, std::size_t _colID) const;
 
     // function to check if matrix is a vector, used when you want to check if its a vector without throwing an error if it is
     void vectorCheck();
@@ -56,10 +59,15 @@ public:
     const int getCols() const { return m_cols; }
 
 
-    // read only data
-    const T* data(int _row, int _col) const { return m_data[_row][_col]; }
+    // read only data, indexed with the current shape so a transposed or resized matrix reads correctly
+    const T& data(int _row, int _col) const { return data()[_row*m_cols + _col]; }
     // accessible data
-    T data(int _row, int _col) { return m_data[_row][_col]; }
+    T data(int _row, int _col) { return data()[_row*m_cols + _col]; }
+
+    // contiguous row major storage, used by the kernels that walk the whole matrix
+    T* data() { return &m_data[0][0]; }
+    // contiguous row major storage (read only)
+    const T* data() const { return &m_data[0][0]; }
 
 
     // subscript operators
@@ -107,6 +115,10 @@ public:
     Matrix& inverse();
     // transposes matrix
     Matrix& transpose();
+    // conjugates every element (no change for real types)
+    Matrix& conjugate();
+    // conjugate transpose (Hermitian adjoint), the same as transpose for real types
+    Matrix& conjugateTranspose();
     // tests if matrix is orthogonal
     bool orthogonal();
     // determinant of a matrix
@@ -119,13 +131,13 @@ public:
     /// Vector only methods
 
     // finds the magnitude of a vector
-    float magnitude();
+    typename ScalarTraits<T>::real magnitude();
     // divide one vector by another
     Matrix& operator/ (Matrix<T,ROWS,COLS>& _rhs);
-    // dot product
-    float dot(Matrix<T,ROWS,COLS>& _rhs);
+    // dot product (Hermitian for complex vectors)
+    typename ScalarTraits<T>::value dot(Matrix<T,ROWS,COLS>& _rhs);
     // angle between vectors
-    float angle(Matrix<T,ROWS,COLS>& _rhs);
+    typename ScalarTraits<T>::real angle(Matrix<T,ROWS,COLS>& _rhs);
     // cross product
     Matrix& cross(Matrix<T,ROWS,COLS>& _rhs);
     // rotates vector by angle _angle around axis _axis (if 3d)
@@ -377,37 +389,30 @@ Matrix<T,ROWS,COLS>& Matrix< T,ROWS,COLS>::operator* ( Matrix<T,COLS, N>& _rhs)
   // matrix-matrix multiplication
   if(m_vector == false)
   {
-    // initialize tmp matrix values to 0
-    T tmp[m_rows][_rhs.getCols()];
-
-    for(int i=0; i<ROWS; i++)
-    {
-      for(int j=0; j<COLS; j++)
-      {
-        tmp[i][j]=0;
-      }
-    }
+    // product is built in an arena temporary (zeroed) then copied back, 16 bit types are summed in float
+    typedef typename AccumulatorType<T>::type Sum;
+    TempBuffer<Sum> tmp(ROWS*N);
 
-    // For loop structure referenced from http://stackoverflow.com/questions/10162467/matrix-multiplication-in-c
-    // Multiplying matrices and storing values in matrix tmp
+    // i-k-j order so the inner loop walks both _rhs and tmp contiguously
     for(int i = 0; i < m_rows; ++i)
     {
-      for(int j = 0; j < _rhs.getCols(); ++j)
+      for(int k=0; k<m_cols; ++k)
       {
-        for(int k=0; k<m_cols; ++k)
+        const Sum aik = data(i,k);
+        for(int j = 0; j < _rhs.getCols(); ++j)
         {
-            tmp[i][j] += m_data[i][k] * _rhs.data(k,j);
+          tmp[i*N+j] += aik * _rhs.data(k,j);
         }
       }
     }
 
-    // assignning the tmp matrix's values to m_data
+    // the product is copied back with this matrix's COLS stride, a narrower product leaves the extra columns
+    // at zero and a wider one keeps its first COLS columns
+    const std::size_t cols = N < COLS ? N : COLS;
     for(int i=0; i<m_rows; i++)
     {
-      for(int j=0; j<m_cols; j++)
-      {
-        m_data[i][j]=tmp[i][j];
-      }
+      std::fill(data()+i*COLS+cols,data()+(i+1)*COLS,T(0));
+      convertKernel(cols,tmp.data()+i*N,data()+i*COLS);
     }
   }
 
@@ -451,7 +456,7 @@ Matrix<T,ROWS,COLS>& Matrix< T,ROWS,COLS>::operator* (T _scalar)
 template <typename T, size_t ROWS, size_t COLS>
 Matrix<T,ROWS,COLS>& Matrix< T,ROWS,COLS>::operator/ (T _scalar)
 {
-  if(_scalar==0)
+  if(_scalar==T(0))
   {
     throw std::out_of_range("Cannot divide by 0");
   }
@@ -475,12 +480,13 @@ Matrix<T,ROWS,COLS>& Matrix< T,ROWS,COLS>::operator/ (T _scalar)
 /// param[in] _rowID, the row you would like to check is within 0 and the number of rows.
 /// param[in] _colID, the column you would like to check is within 0 and the number of columns.
 template <typename T, size_t ROWS, size_t COLS>
-void Matrix<T,ROWS,COLS>::rangeCheck(std::size_t _rowID,std::size_t _colID)
+void Matrix<T,ROWS,COLS>::rangeCheck(std::size_t _rowID,std::size_t _colID) const
 {
-  if( _rowID>ROWS || _rowID<1)
+  // checked against the current shape, a rectangular transpose swaps the rows and columns
+  if( _rowID>static_cast<std::size_t>(m_rows) || _rowID<1)
       throw std::out_of_range("row out of range");
 
-  if( _colID>COLS || _colID<1)
+  if( _colID>static_cast<std::size_t>(m_cols) || _colID<1)
       throw std::out_of_range("column out of range");
 }
 
@@ -504,7 +510,7 @@ template <typename T, size_t ROWS, size_t COLS>
 T& Matrix< T,ROWS,COLS>::operator()(std::size_t _rowID,std::size_t _colID)
 {
   rangeCheck(_rowID,_colID);
-  return m_data[_rowID-1][_colID-1];
+  return data()[(_rowID-1)*m_cols + (_colID-1)];
 }
 
 
@@ -516,7 +522,7 @@ template <typename T, size_t ROWS, size_t COLS>
 const T& Matrix< T,ROWS,COLS>::operator()(std::size_t _rowID,std::size_t _colID) const
 {
   rangeCheck(_rowID,_colID);
-  return const_cast<T&>(m_data[_rowID-1][_colID-1]);
+  return data()[(_rowID-1)*m_cols + (_colID-1)];
 }
 
 //----------------------------------------------------------------------------------------------
@@ -549,20 +555,21 @@ Matrix<T,ROWS,COLS>& Matrix< T,ROWS,COLS>::operator/ ( Matrix<T,ROWS,COLS>& _rhs
 }
 
 //----------------------------------------------------------------------------------------------
-/// @brief Returns the magnitude of the given vector
+/// @brief Returns the magnitude of the given vector, for complex vectors the sum of |x|^2 is used
 template <typename T, size_t ROWS, size_t COLS>
-float Matrix<T, ROWS, COLS>::magnitude()
+typename ScalarTraits<T>::real Matrix<T, ROWS, COLS>::magnitude()
 {
   vectorCheck();
 
-  T sum = 0;
-  float mag = 0;
+  typedef typename ScalarTraits<T>::real Real;
+  Real sum = 0;
+  Real mag = 0;
 
   if(m_rows == 1)
   {
     for( int i = 0; i< COLS; i++)
     {
-      sum += (m_data[0][i] * m_data[0][i]);
+      sum += ScalarTraits<T>::abs2(m_data[0][i]);
     }
   }
 
@@ -570,7 +577,7 @@ float Matrix<T, ROWS, COLS>::magnitude()
   {
     for( int i = 0; i< ROWS; i++)
     {
-      sum += (m_data[i][0] * m_data[i][0]);
+      sum += ScalarTraits<T>::abs2(m_data[i][0]);
     }
   }
 
@@ -581,29 +588,31 @@ float Matrix<T, ROWS, COLS>::magnitude()
 }
 
 //----------------------------------------------------------------------------------------------
-/// @brief The dot product of the given vector and another vector passed in as a parameter
+/// @brief The dot product of the given vector and another vector passed in as a parameter, for complex vectors
+/// this vector is conjugated (x^H*y) so x.dot(x) is the magnitude squared
 /// param[in] _rhs, the second vector that will be used to find the dot product
 template <typename T, size_t ROWS, size_t COLS>
-float Matrix<T,ROWS,COLS>::dot( Matrix<T,ROWS,COLS>& _rhs)
+typename ScalarTraits<T>::value Matrix<T,ROWS,COLS>::dot( Matrix<T,ROWS,COLS>& _rhs)
 {
   vectorCheck();
   _rhs.vectorCheck();
 
-  float dotProd = 0;
+  typedef typename ScalarTraits<T>::value Value;
+  Value dotProd = Value(0);
 
   if(m_rows == 1)
   {
     for(int i = 0; i<COLS; i++)
     {
-      dotProd+=m_data[0][i]*_rhs.m_data[0][i];
+      dotProd+=Value(ScalarTraits<T>::conj(m_data[0][i]))*Value(_rhs.m_data[0][i]);
     }
   }
 
   else if(m_cols == 1)
   {
-    for(int i = 0; i<COLS; i++)
+    for(int i = 0; i<ROWS; i++)
     {
-      dotProd+=m_data[i][0]*_rhs.m_data[i][0];
+      dotProd+=Value(ScalarTraits<T>::conj(m_data[i][0]))*Value(_rhs.m_data[i][0]);
     }
   }
 
@@ -612,25 +621,26 @@ float Matrix<T,ROWS,COLS>::dot( Matrix<T,ROWS,COLS>& _rhs)
 }
 
 //----------------------------------------------------------------------------------------------
-/// @brief Returns the angle between two vectors
+/// @brief Returns the angle between two vectors, complex vectors use the real part of the dot product
 /// param[in] _rhs, the angle is found between the applied to vector and this vector
 template <typename T, size_t ROWS, size_t COLS>
-float Matrix<T,ROWS,COLS>::angle( Matrix<T,ROWS,COLS>& _rhs)
+typename ScalarTraits<T>::real Matrix<T,ROWS,COLS>::angle( Matrix<T,ROWS,COLS>& _rhs)
 {
   vectorCheck();
   _rhs.vectorCheck();
 
-  float angle = 0;
-  float cosAngle = 0;
-  float dotProd = 0;
-  float mag1;
-  float mag2;
+  typedef typename ScalarTraits<T>::real Real;
+  Real angle = 0;
+  Real cosAngle = 0;
+  Real dotProd = 0;
+  Real mag1;
+  Real mag2;
 
   // calculate angles of each vector
   mag1=magnitude();
   mag2=_rhs.magnitude();
   // calculate dot product of vectors
-  dotProd= dot(_rhs);
+  dotProd= ScalarTraits<typename ScalarTraits<T>::value>::realPart(dot(_rhs));
 
   // calculate cos angle
   cosAngle=dotProd / (mag1 * mag2);
@@ -711,44 +721,29 @@ template <typename T, size_t ROWS, size_t COLS>
 Matrix<T,ROWS,COLS>& Matrix< T,ROWS,COLS>::minorMatrix(int _row, int _col)
 {
 
-  // temporary matrix to store the minor matrices data
-  T tmp[ROWS-1][COLS-1];
+  // temporary matrix to store the minor matrices data, (ROWS-1)x(COLS-1) row major
+  TempBuffer<T> tmp((ROWS-1)*(COLS-1));
 
-  // new matrix row index
+  // new matrix index
   int k=0;
-  // nex matrix column index
-  int l=0;
-
-  for(int i=0; i<ROWS-1; i++)
-  {
-    for(int j=0; j<COLS-1; j++)
-    {
-      tmp[i][j]=0;
-    }
-  }
 
   // row of minor matrix
-  for(int i = 0; i<m_rows; i++)
+  for(int i = 0; i<ROWS; i++)
   {
     if(i==_row-1)
     {
-        i++;
+      continue;
     }
 
     // col of minor matrix
-    for(int j = 0; j<m_cols; j++)
+    for(int j = 0; j<COLS; j++)
     {
       if(j==_col-1)
       {
-        j++;
+        continue;
       }
-      tmp[k][l]=m_data[i][j];
-      l++;
+      tmp[k++]=m_data[i][j];
     }
-    // go back to first column
-    l=0;
-    k++;
-
   }
 
   // m_data row 1 disquilified so m-data row 2 equils tmp row 1
@@ -757,7 +752,7 @@ Matrix<T,ROWS,COLS>& Matrix< T,ROWS,COLS>::minorMatrix(int _row, int _col)
   {
     for(int j=0; j<COLS-1; j++)
     {
-      m_data[i][j]=tmp[i][j];
+      m_data[i][j]=tmp[i*(COLS-1)+j];
     }
 
   }
@@ -848,35 +843,31 @@ Matrix<T,ROWS,COLS>& Matrix< T,ROWS,COLS>::inverse()
    throw std::out_of_range("You must use a square matrix for the inverse function");
   }
 
-  if( determinant()==0)
+  // determinant is only worked out once, it is reused for every element below
+  const T determ = determinant();
+
+  if( determ==T(0))
   {
     throw std::out_of_range("An inverse doesnt exist, the determinant is 0");
   }
 
-  T tmp[ROWS][COLS];
-
-  for(int i=0; i<ROWS; i++)
-  {
-    for(int j=0; j<COLS; j++)
-    {
-      tmp[i][j]=0;
-    }
-  }
+  // result is built in a zeroed arena temporary, m_data is read until the end
+  TempBuffer<T> tmp(ROWS*COLS);
 
   // find inverse of 2x2 matrix
   if(ROWS==2)
   {
-    tmp[0][0]= m_data[1][1];
-    tmp[0][1]=-m_data[0][1];
-    tmp[1][0]=-m_data[1][0];
-    tmp[1][1]= m_data[0][0];
+    tmp[0]     = m_data[1][1];
+    tmp[1]     =-m_data[0][1];
+    tmp[COLS]  =-m_data[1][0];
+    tmp[COLS+1]= m_data[0][0];
 
     for(int i = 0; i<ROWS; i++)
     {
       for( int j = 0; j<COLS; j++)
       {
 
-        tmp[i][j]=tmp[i][j]/determinant();
+        tmp[i*COLS+j]=tmp[i*COLS+j]/determ;
       }
     }
   }
@@ -890,8 +881,8 @@ Matrix<T,ROWS,COLS>& Matrix< T,ROWS,COLS>::inverse()
 
       for(int j=0;j<3;j++)
       {
-        tmp[j][i] = ((m_data[(i+1)%3][(j+1)%3] * m_data[(i+2)%3][(j+2)%3]) -
-                    (m_data[(i+1)%3][(j+2)%3]*m_data[(i+2)%3][(j+1)%3]))/ determinant();
+        tmp[j*COLS+i] = ((m_data[(i+1)%3][(j+1)%3] * m_data[(i+2)%3][(j+2)%3]) -
+                    (m_data[(i+1)%3][(j+2)%3]*m_data[(i+2)%3][(j+1)%3]))/ determ;
       }
     }
   }
@@ -1007,7 +998,7 @@ Matrix<T,ROWS,COLS>& Matrix< T,ROWS,COLS>::inverse()
                  m_data[2][1] * m_data[0][2] * m_data[1][3] +
                  m_data[2][1] * m_data[0][3] * m_data[1][2];
 
-    inv[0][7] = m_data[0][0] * m_data[1][2] * m_data[2][3] - //7
+    inv[1][3] = m_data[0][0] * m_data[1][2] * m_data[2][3] - //7
                 m_data[0][0] * m_data[1][3] * m_data[2][2] -
                 m_data[1][0] * m_data[0][2] * m_data[2][3] +
                 m_data[1][0] * m_data[0][3] * m_data[2][2] +
@@ -1029,13 +1020,13 @@ Matrix<T,ROWS,COLS>& Matrix< T,ROWS,COLS>::inverse()
                 m_data[2][0] * m_data[0][2] * m_data[1][1];
 
 
-    det=1.0/determinant();
+    det=T(1)/determ;
 
     for(int i = 0; i<ROWS; i++)
     {
       for( int j = 0; j<COLS; j++)
       {
-        tmp[i][j] = inv[i][j] * det;
+        tmp[i*COLS+j] = inv[i][j] * det;
       }
     }
   }
@@ -1044,7 +1035,7 @@ Matrix<T,ROWS,COLS>& Matrix< T,ROWS,COLS>::inverse()
   {
     for( int j = 0; j<COLS; j++)
     {
-      m_data[i][j]=tmp[i][j];
+      m_data[i][j]=tmp[i*COLS+j];
     }
   }
 
@@ -1052,43 +1043,51 @@ Matrix<T,ROWS,COLS>& Matrix< T,ROWS,COLS>::inverse()
 }
 
 //----------------------------------------------------------------------------------------------
-/// @brief returns the transpose version of a matrix
+/// @brief Transposes the matrix. Square matrices are transposed in place, rectangular ones are transposed through an
+/// arena copy (never the stack, so large matrices are fine) and then read back with the rows and columns swapped.
+/// Both use the cache oblivious kernels from matrixTranspose.h, to get a new COLS x ROWS matrix use transposed().
 template <typename T, size_t ROWS, size_t COLS>
 Matrix<T,ROWS, COLS>& Matrix< T,ROWS,COLS>::transpose()
-{ 
-
-  T tmp[COLS][ROWS];
-
-  for(int i = 0;i<COLS;i++)
+{
+  if(m_rows == m_cols)
   {
-    for(int j = 0;j< ROWS;j++)
-    {
-      tmp[i][j]=0;      
-    }      
+    transposeInPlaceKernel(m_rows,data());
   }
-
-  for(int i = 0; i< COLS; i++)
+  else
   {
-    for(int j = 0; j < ROWS; j++)
-    {
-      tmp[i][j]= m_data[j][i];      
-    }
+    TempBuffer<T> tmp(ROWS*COLS);
+    std::copy(data(),data()+ROWS*COLS,tmp.data());
+    transposeKernel(m_rows,m_cols,tmp.data(),data());
+
+    // resize matrix/vector to have reversed number of cols and rows
+    std::swap(m_rows,m_cols);
   }
 
-  // resize matrix/vector to have reversed number of cols and rows
-  resize(COLS,ROWS);
+  return *this;
+}
 
-  for(int i = 0; i<m_rows; i++)
+//----------------------------------------------------------------------------------------------
+/// @brief Conjugates every element of a complex matrix, real matrices are left as they are
+template <typename T, size_t ROWS, size_t COLS>
+Matrix<T,ROWS, COLS>& Matrix< T,ROWS,COLS>::conjugate()
+{
+  for(std::size_t i = 0; i < ROWS*COLS; ++i)
   {
-    for( int j = 0; j<m_cols; j++)
-    {
-      m_data[i][j]=tmp[i][j];
-    }
+    data()[i] = ScalarTraits<T>::conj(data()[i]);
   }
 
   return *this;
 }
 
+//----------------------------------------------------------------------------------------------
+/// @brief Replaces the matrix with its conjugate transpose (Hermitian adjoint), rows and columns swap as transpose()
+template <typename T, size_t ROWS, size_t COLS>
+Matrix<T,ROWS, COLS>& Matrix< T,ROWS,COLS>::conjugateTranspose()
+{
+  transpose();
+  return conjugate();
+}
+
 //----------------------------------------------------------------------------------------------
 /// @brief Tests if the matrix is orthogonal (if the inversed matrix equils the transposed matrix)
 template <typename T, size_t ROWS, size_t COLS>
@@ -1272,19 +1271,11 @@ void Matrix< T,ROWS,COLS>::resize(int _rows, int _cols)
     throw std::out_of_range("Must resize to matrix with same number of elements, eg 2x3 to 3x2");
   }
 
-  m_data[m_rows][m_cols]=m_data[_rows][_cols];
-
   m_rows=_rows;
   m_cols=_cols;
 
-  for(int i = 0;i<m_rows;i++)
-  {
-    for(int j = 0;j< m_cols;j++)
-    {
-      m_data[i][j]=0;
-    }
-
-  }
+  // the storage is the same size whatever the shape, so it is cleared as one block
+  std::fill(data(),data()+ROWS*COLS,T(0));
 
 }
 
@@ -1308,4 +1299,20 @@ void Matrix< T,ROWS,COLS>::print()
 }
 
 //----------------------------------------------------------------------------------------------
+/// @brief Reads the type, number of rows and number of columns out of a Matrix type
+template <typename M>
+struct MatrixDims;
+
+template <typename T, size_t ROWS, size_t COLS>
+struct MatrixDims< Matrix<T,ROWS,COLS> >
+{
+  typedef T type;
+  static constexpr size_t rows = ROWS;
+  static constexpr size_t cols = COLS;
+};
+
+//----------------------------------------------------------------------------------------------
+// included last so Quaternion can use the complete Matrix whichever header is included first
+#include "quaternion.h"
+
 #endif // MATRIX_H
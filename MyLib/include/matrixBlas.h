@@ -0,0 +1,638 @@
+#ifndef MATRIXBLAS_H
+#define MATRIXBLAS_H
+#include <cstddef>
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include "matrix.h"
+#include "parallel.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Fused BLAS level 1, 2 and 3 operations (axpy, axpby, scal, dot, gemv, ger and gemm).
+/// Each operation walks memory once instead of chaining in place operators, eg y=a*x+y instead of x*a then y+x
+/// (which also changes x). The kernels work on contiguous row major storage so they are used for Matrix of any size,
+/// the Matrix overloads below check the sizes at compile time and then call the kernels.
+/// The half and bfloat16 kernels convert MYLIB_REDUCED_BLOCK elements at a time to float, run the float kernel on them
+/// and convert the results back, so memory traffic is half that of float while every sum is accumulated in float.
+/// std::complex<float> and std::complex<double> use the interleaved SIMD kernels from complexMatrix.h.
+
+//----------------------------------------------------------------------------------------------
+/// @brief y = _alpha*x + y over _n contiguous elements
+template <typename T>
+void axpyKernel(std::size_t _n, T _alpha, const T* __restrict__ _x, T* __restrict__ _y)
+{
+  for(std::size_t i = 0; i < _n; ++i)
+  {
+    _y[i] += _alpha * _x[i];
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief y = _alpha*x + _beta*y over _n contiguous elements
+template <typename T>
+void axpbyKernel(std::size_t _n, T _alpha, const T* __restrict__ _x, T _beta, T* __restrict__ _y)
+{
+  for(std::size_t i = 0; i < _n; ++i)
+  {
+    _y[i] = _alpha * _x[i] + _beta * _y[i];
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief x = _alpha*x over _n contiguous elements
+template <typename T>
+void scalKernel(std::size_t _n, T _alpha, T* _x)
+{
+  for(std::size_t i = 0; i < _n; ++i)
+  {
+    _x[i] *= _alpha;
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the dot product of _n contiguous elements, four partial sums keep the adds pipelined
+template <typename T>
+T dotKernel(std::size_t _n, const T* _x, const T* _y)
+{
+  T sum0 = 0;
+  T sum1 = 0;
+  T sum2 = 0;
+  T sum3 = 0;
+
+  std::size_t i = 0;
+  for(; i + 4 <= _n; i += 4)
+  {
+    sum0 += _x[i]   * _y[i];
+    sum1 += _x[i+1] * _y[i+1];
+    sum2 += _x[i+2] * _y[i+2];
+    sum3 += _x[i+3] * _y[i+3];
+  }
+  for(; i < _n; ++i)
+  {
+    sum0 += _x[i] * _y[i];
+  }
+
+  return (sum0 + sum1) + (sum2 + sum3);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns true if the _aBytes at _a and the _bBytes at _b share any memory
+inline bool memoryOverlaps(const void* _a, std::size_t _aBytes, const void* _b, std::size_t _bBytes)
+{
+  std::uintptr_t a = reinterpret_cast<std::uintptr_t>(_a);
+  std::uintptr_t b = reinterpret_cast<std::uintptr_t>(_b);
+  return a < b + _bBytes && b < a + _aBytes;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief y = _alpha*A*x + _beta*y for a row major _rows x _cols matrix A
+/// Each row is a dot product with four independent partial sums, which keeps the adds pipelined and lets the compiler vectorise.
+template <typename T>
+void gemvKernel(std::size_t _rows, std::size_t _cols, T _alpha, const T* __restrict__ _a,
+                const T* __restrict__ _x, T _beta, T* __restrict__ _y)
+{
+  for(std::size_t i = 0; i < _rows; ++i)
+  {
+    T dot = dotKernel(_cols, _a + i*_cols, _x);
+    // beta of 0 must not read y, it may not be initialised (BLAS convention)
+    _y[i] = (_beta == T(0)) ? _alpha * dot : _alpha * dot + _beta * _y[i];
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief A = A + _alpha*x*y^T (rank 1 update) for a row major _rows x _cols matrix A
+/// x or y may be part of A, they are copied first so every row is updated with their values from before the call.
+template <typename T>
+void gerKernel(std::size_t _rows, std::size_t _cols, T _alpha, const T* _x, const T* _y, T* _a)
+{
+  const std::size_t aBytes = _rows*_cols*sizeof(T);
+  if(memoryOverlaps(_x, _rows*sizeof(T), _a, aBytes) || memoryOverlaps(_y, _cols*sizeof(T), _a, aBytes))
+  {
+    TempBuffer<T> x(_rows);
+    TempBuffer<T> y(_cols);
+    std::copy(_x, _x + _rows, x.data());
+    std::copy(_y, _y + _cols, y.data());
+    gerKernel(_rows, _cols, _alpha, static_cast<const T*>(x.data()), static_cast<const T*>(y.data()), _a);
+    return;
+  }
+
+  for(std::size_t i = 0; i < _rows; ++i)
+  {
+    axpyKernel(_cols, _alpha * _x[i], _y, _a + i*_cols);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief C = _alpha*A*B + _beta*C for row major A (_m x _k), B (_k x _n) and C (_m x _n)
+/// Each row of C is built from axpys over the rows of B so the inner loop walks B and C contiguously.
+/// The rows are done in blocks of 32 and the inner dimension in blocks of 64, so a block of rows of B is reused
+/// from cache by every row of C in the block. Each element of C still adds its products in k order.
+template <typename T>
+void gemmKernel(std::size_t _m, std::size_t _n, std::size_t _k, T _alpha, const T* __restrict__ _a,
+                const T* __restrict__ _b, T _beta, T* __restrict__ _c)
+{
+  const std::size_t blockM = 32;
+  const std::size_t blockK = 64;
+
+  for(std::size_t i0 = 0; i0 < _m; i0 += blockM)
+  {
+    std::size_t mb = std::min(blockM, _m - i0);
+    for(std::size_t i = i0; i < i0 + mb; ++i)
+    {
+      T* c = _c + i*_n;
+      // beta of 0 must not read C (BLAS convention)
+      if(_beta == T(0))
+      {
+        std::fill(c,c+_n,T(0));
+      }
+      else
+      {
+        scalKernel(_n, _beta, c);
+      }
+    }
+
+    for(std::size_t k0 = 0; k0 < _k; k0 += blockK)
+    {
+      std::size_t kb = std::min(blockK, _k - k0);
+      for(std::size_t i = i0; i < i0 + mb; ++i)
+      {
+        for(std::size_t k = k0; k < k0 + kb; ++k)
+        {
+          axpyKernel(_n, _alpha * _a[i*_k + k], _b + k*_n, _c + i*_n);
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief axpy on 16 bit storage, a block at a time in float
+template <typename T>
+void reducedAxpyKernel(std::size_t _n, float _alpha, const T* _x, T* _y)
+{
+  float x[MYLIB_REDUCED_BLOCK];
+  float y[MYLIB_REDUCED_BLOCK];
+
+  for(std::size_t i = 0; i < _n; i += MYLIB_REDUCED_BLOCK)
+  {
+    std::size_t n = std::min<std::size_t>(MYLIB_REDUCED_BLOCK, _n - i);
+    convertKernel(n, _x + i, x);
+    convertKernel(n, _y + i, y);
+    axpyKernel(n, _alpha, x, y);
+    convertKernel(n, static_cast<const float*>(y), _y + i);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief axpby on 16 bit storage, a block at a time in float
+template <typename T>
+void reducedAxpbyKernel(std::size_t _n, float _alpha, const T* _x, float _beta, T* _y)
+{
+  float x[MYLIB_REDUCED_BLOCK];
+  float y[MYLIB_REDUCED_BLOCK];
+
+  for(std::size_t i = 0; i < _n; i += MYLIB_REDUCED_BLOCK)
+  {
+    std::size_t n = std::min<std::size_t>(MYLIB_REDUCED_BLOCK, _n - i);
+    convertKernel(n, _x + i, x);
+    convertKernel(n, _y + i, y);
+    axpbyKernel(n, _alpha, x, _beta, y);
+    convertKernel(n, static_cast<const float*>(y), _y + i);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief scal on 16 bit storage, a block at a time in float
+template <typename T>
+void reducedScalKernel(std::size_t _n, float _alpha, T* _x)
+{
+  float x[MYLIB_REDUCED_BLOCK];
+
+  for(std::size_t i = 0; i < _n; i += MYLIB_REDUCED_BLOCK)
+  {
+    std::size_t n = std::min<std::size_t>(MYLIB_REDUCED_BLOCK, _n - i);
+    convertKernel(n, _x + i, x);
+    scalKernel(n, _alpha, x);
+    convertKernel(n, static_cast<const float*>(x), _x + i);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief dot product of 16 bit storage, accumulated in float
+template <typename T>
+float reducedDotKernel(std::size_t _n, const T* _x, const T* _y)
+{
+  float x[MYLIB_REDUCED_BLOCK];
+  float y[MYLIB_REDUCED_BLOCK];
+  float sum = 0.0f;
+
+  for(std::size_t i = 0; i < _n; i += MYLIB_REDUCED_BLOCK)
+  {
+    std::size_t n = std::min<std::size_t>(MYLIB_REDUCED_BLOCK, _n - i);
+    convertKernel(n, _x + i, x);
+    convertKernel(n, _y + i, y);
+    sum += dotKernel(n, static_cast<const float*>(x), static_cast<const float*>(y));
+  }
+
+  return sum;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief gemv on 16 bit storage, x is converted once and each row of A a block at a time
+template <typename T>
+void reducedGemvKernel(std::size_t _rows, std::size_t _cols, float _alpha, const T* _a,
+                       const T* _x, float _beta, T* _y)
+{
+  TempBuffer<float> x(_cols);
+  convertKernel(_cols, _x, x.data());
+  float a[MYLIB_REDUCED_BLOCK];
+
+  for(std::size_t i = 0; i < _rows; ++i)
+  {
+    float dot = 0.0f;
+    for(std::size_t j = 0; j < _cols; j += MYLIB_REDUCED_BLOCK)
+    {
+      std::size_t n = std::min<std::size_t>(MYLIB_REDUCED_BLOCK, _cols - j);
+      convertKernel(n, _a + i*_cols + j, a);
+      dot += dotKernel(n, static_cast<const float*>(a), x.data() + j);
+    }
+    _y[i] = (_beta == 0.0f) ? _alpha * dot : _alpha * dot + _beta * float(_y[i]);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief ger on 16 bit storage, x and y are converted once and each row of A a block at a time
+template <typename T>
+void reducedGerKernel(std::size_t _rows, std::size_t _cols, float _alpha, const T* _x,
+                      const T* _y, T* _a)
+{
+  // y is converted up front and x too, so both keep their values if they are part of A
+  TempBuffer<float> x(_rows);
+  TempBuffer<float> y(_cols);
+  convertKernel(_rows, _x, x.data());
+  convertKernel(_cols, _y, y.data());
+  float a[MYLIB_REDUCED_BLOCK];
+
+  for(std::size_t i = 0; i < _rows; ++i)
+  {
+    float scale = _alpha * x.data()[i];
+    for(std::size_t j = 0; j < _cols; j += MYLIB_REDUCED_BLOCK)
+    {
+      std::size_t n = std::min<std::size_t>(MYLIB_REDUCED_BLOCK, _cols - j);
+      T* row = _a + i*_cols + j;
+      convertKernel(n, row, a);
+      axpyKernel(n, scale, y.data() + j, a);
+      convertKernel(n, static_cast<const float*>(a), row);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief gemm on 16 bit storage, blocked so a float copy of a panel of B and the sums for a block of C
+/// stay in cache, every sum is accumulated in float and C is rounded once at the end
+template <typename T>
+void reducedGemmKernel(std::size_t _m, std::size_t _n, std::size_t _k, float _alpha, const T* _a,
+                       const T* _b, float _beta, T* _c)
+{
+  const std::size_t blockM = 32;
+  const std::size_t blockN = MYLIB_REDUCED_BLOCK;
+  const std::size_t blockK = 64;
+
+  TempBuffer<float> sum(blockM*blockN);
+  TempBuffer<float> panel(blockK*blockN);
+  float a[blockK];
+  float c[blockN];
+
+  for(std::size_t i0 = 0; i0 < _m; i0 += blockM)
+  {
+    std::size_t mb = std::min(blockM, _m - i0);
+    for(std::size_t j0 = 0; j0 < _n; j0 += blockN)
+    {
+      std::size_t nb = std::min(blockN, _n - j0);
+      std::fill(sum.data(), sum.data() + mb*nb, 0.0f);
+
+      for(std::size_t k0 = 0; k0 < _k; k0 += blockK)
+      {
+        std::size_t kb = std::min(blockK, _k - k0);
+        for(std::size_t k = 0; k < kb; ++k)
+        {
+          convertKernel(nb, _b + (k0 + k)*_n + j0, panel.data() + k*nb);
+        }
+
+        for(std::size_t i = 0; i < mb; ++i)
+        {
+          convertKernel(kb, _a + (i0 + i)*_k + k0, a);
+          for(std::size_t k = 0; k < kb; ++k)
+          {
+            axpyKernel(nb, a[k], panel.data() + k*nb, sum.data() + i*nb);
+          }
+        }
+      }
+
+      for(std::size_t i = 0; i < mb; ++i)
+      {
+        T* row = _c + (i0 + i)*_n + j0;
+        // beta of 0 must not read C (BLAS convention)
+        if(_beta == 0.0f)
+        {
+          std::fill(c, c + nb, 0.0f);
+        }
+        else
+        {
+          convertKernel(nb, row, c);
+        }
+        axpbyKernel(nb, _alpha, sum.data() + i*nb, _beta, c);
+        convertKernel(nb, static_cast<const float*>(c), row);
+      }
+    }
+  }
+}
+
+// half and bfloat16 versions of the kernels, exact matches so they are picked over the generic templates
+inline void axpyKernel(std::size_t _n, half _alpha, const half* _x, half* _y) { reducedAxpyKernel(_n, float(_alpha), _x, _y); }
+inline void axpyKernel(std::size_t _n, bfloat16 _alpha, const bfloat16* _x, bfloat16* _y) { reducedAxpyKernel(_n, float(_alpha), _x, _y); }
+
+inline void axpbyKernel(std::size_t _n, half _alpha, const half* _x, half _beta, half* _y)
+{
+  reducedAxpbyKernel(_n, float(_alpha), _x, float(_beta), _y);
+}
+inline void axpbyKernel(std::size_t _n, bfloat16 _alpha, const bfloat16* _x, bfloat16 _beta, bfloat16* _y)
+{
+  reducedAxpbyKernel(_n, float(_alpha), _x, float(_beta), _y);
+}
+
+inline void scalKernel(std::size_t _n, half _alpha, half* _x) { reducedScalKernel(_n, float(_alpha), _x); }
+inline void scalKernel(std::size_t _n, bfloat16 _alpha, bfloat16* _x) { reducedScalKernel(_n, float(_alpha), _x); }
+
+inline float dotKernel(std::size_t _n, const half* _x, const half* _y) { return reducedDotKernel(_n, _x, _y); }
+inline float dotKernel(std::size_t _n, const bfloat16* _x, const bfloat16* _y) { return reducedDotKernel(_n, _x, _y); }
+
+inline void gemvKernel(std::size_t _rows, std::size_t _cols, half _alpha, const half* _a,
+                       const half* _x, half _beta, half* _y)
+{
+  reducedGemvKernel(_rows, _cols, float(_alpha), _a, _x, float(_beta), _y);
+}
+inline void gemvKernel(std::size_t _rows, std::size_t _cols, bfloat16 _alpha, const bfloat16* _a,
+                       const bfloat16* _x, bfloat16 _beta, bfloat16* _y)
+{
+  reducedGemvKernel(_rows, _cols, float(_alpha), _a, _x, float(_beta), _y);
+}
+
+inline void gerKernel(std::size_t _rows, std::size_t _cols, half _alpha, const half* _x,
+                      const half* _y, half* _a)
+{
+  reducedGerKernel(_rows, _cols, float(_alpha), _x, _y, _a);
+}
+inline void gerKernel(std::size_t _rows, std::size_t _cols, bfloat16 _alpha, const bfloat16* _x,
+                      const bfloat16* _y, bfloat16* _a)
+{
+  reducedGerKernel(_rows, _cols, float(_alpha), _x, _y, _a);
+}
+
+inline void gemmKernel(std::size_t _m, std::size_t _n, std::size_t _k, half _alpha, const half* _a,
+                       const half* _b, half _beta, half* _c)
+{
+  reducedGemmKernel(_m, _n, _k, float(_alpha), _a, _b, float(_beta), _c);
+}
+inline void gemmKernel(std::size_t _m, std::size_t _n, std::size_t _k, bfloat16 _alpha, const bfloat16* _a,
+                       const bfloat16* _b, bfloat16 _beta, bfloat16* _c)
+{
+  reducedGemmKernel(_m, _n, _k, float(_alpha), _a, _b, float(_beta), _c);
+}
+
+// std::complex versions of the kernels, interleaved SIMD instead of std::complex operator*
+inline void axpyKernel(std::size_t _n, std::complex<float> _alpha, const std::complex<float>* _x, std::complex<float>* _y)
+{
+  complexAxpyKernel(_n, _alpha, _x, _y);
+}
+inline void axpyKernel(std::size_t _n, std::complex<double> _alpha, const std::complex<double>* _x, std::complex<double>* _y)
+{
+  complexAxpyKernel(_n, _alpha, _x, _y);
+}
+
+inline void scalKernel(std::size_t _n, std::complex<float> _alpha, std::complex<float>* _x) { complexScalKernel(_n, _alpha, _x); }
+inline void scalKernel(std::size_t _n, std::complex<double> _alpha, std::complex<double>* _x) { complexScalKernel(_n, _alpha, _x); }
+
+inline std::complex<float> dotKernel(std::size_t _n, const std::complex<float>* _x, const std::complex<float>* _y)
+{
+  return complexDotKernel(_n, _x, _y);
+}
+inline std::complex<double> dotKernel(std::size_t _n, const std::complex<double>* _x, const std::complex<double>* _y)
+{
+  return complexDotKernel(_n, _x, _y);
+}
+
+inline void gemvKernel(std::size_t _rows, std::size_t _cols, std::complex<float> _alpha, const std::complex<float>* _a,
+                       const std::complex<float>* _x, std::complex<float> _beta, std::complex<float>* _y)
+{
+  complexGemvKernel(_rows, _cols, _alpha, _a, false, _x, _beta, _y);
+}
+inline void gemvKernel(std::size_t _rows, std::size_t _cols, std::complex<double> _alpha, const std::complex<double>* _a,
+                       const std::complex<double>* _x, std::complex<double> _beta, std::complex<double>* _y)
+{
+  complexGemvKernel(_rows, _cols, _alpha, _a, false, _x, _beta, _y);
+}
+
+inline void gemmKernel(std::size_t _m, std::size_t _n, std::size_t _k, std::complex<float> _alpha,
+                       const std::complex<float>* _a, const std::complex<float>* _b, std::complex<float> _beta,
+                       std::complex<float>* _c)
+{
+  complexGemmKernel(_m, _n, _k, _alpha, _a, _k, 1, false, _b, _beta, _c);
+}
+inline void gemmKernel(std::size_t _m, std::size_t _n, std::size_t _k, std::complex<double> _alpha,
+                       const std::complex<double>* _a, const std::complex<double>* _b, std::complex<double> _beta,
+                       std::complex<double>* _c)
+{
+  complexGemmKernel(_m, _n, _k, _alpha, _a, _k, 1, false, _b, _beta, _c);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief gemvKernel with the rows of A split across threads once A has more than MYLIB_PARALLEL_MIN_ELEMENTS elements,
+/// every row is still done by the same kernel so the result doesn't depend on the thread count
+template <typename T>
+void gemvRows(std::size_t _rows, std::size_t _cols, T _alpha, const T* _a, const T* _x, T _beta, T* _y)
+{
+  parallelFor(0, _rows, MYLIB_PARALLEL_MIN_ELEMENTS / (_cols + 1) + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    gemvKernel(_last - _first, _cols, _alpha, _a + _first*_cols, _x, _beta, _y + _first);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief gerKernel with the rows of A split across threads once A is large, x and y must not share memory with A
+template <typename T>
+void gerRows(std::size_t _rows, std::size_t _cols, T _alpha, const T* _x, const T* _y, T* _a)
+{
+  parallelFor(0, _rows, MYLIB_PARALLEL_MIN_ELEMENTS / (_cols + 1) + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    gerKernel(_last - _first, _cols, _alpha, _x + _first, _y, _a + _first*_cols);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief gemmKernel with the rows of A and C split across threads once the product has more than
+/// MYLIB_PARALLEL_MIN_ELEMENTS multiply adds, each thread runs the blocked kernel on its own panel of rows
+template <typename T>
+void gemmRows(std::size_t _m, std::size_t _n, std::size_t _k, T _alpha, const T* _a, const T* _b, T _beta, T* _c)
+{
+  parallelFor(0, _m, MYLIB_PARALLEL_MIN_ELEMENTS / (_n*_k + 1) + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    gemmKernel(_last - _first, _n, _k, _alpha, _a + _first*_k, _b, _beta, _c + _first*_n);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief y = _alpha*x + y, x and y must be the same size
+/// param[in] _alpha, the scalar x is multiplied by
+/// param[in] _x, the vector (or matrix) that is scaled and added, not changed
+/// param[in] _y, the vector (or matrix) that is accumulated into
+template <typename T, size_t ROWS, size_t COLS>
+Matrix<T,ROWS,COLS>& axpy(T _alpha, const Matrix<T,ROWS,COLS>& _x, Matrix<T,ROWS,COLS>& _y)
+{
+  if(&_x == &_y)
+  {
+    scalKernel(ROWS*COLS, T(1) + _alpha, _y.data());
+    return _y;
+  }
+
+  axpyKernel(ROWS*COLS, _alpha, _x.data(), _y.data());
+  return _y;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief y = _alpha*x + _beta*y, x and y must be the same size
+/// param[in] _alpha, the scalar x is multiplied by
+/// param[in] _x, the vector (or matrix) that is scaled and added, not changed
+/// param[in] _beta, the scalar y is multiplied by
+/// param[in] _y, the vector (or matrix) that is accumulated into
+template <typename T, size_t ROWS, size_t COLS>
+Matrix<T,ROWS,COLS>& axpby(T _alpha, const Matrix<T,ROWS,COLS>& _x, T _beta, Matrix<T,ROWS,COLS>& _y)
+{
+  if(&_x == &_y)
+  {
+    scalKernel(ROWS*COLS, _alpha + _beta, _y.data());
+    return _y;
+  }
+
+  axpbyKernel(ROWS*COLS, _alpha, _x.data(), _beta, _y.data());
+  return _y;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief x = _alpha*x
+/// param[in] _alpha, the scalar x is multiplied by
+/// param[in] _x, the vector (or matrix) to scale
+template <typename T, size_t ROWS, size_t COLS>
+Matrix<T,ROWS,COLS>& scal(T _alpha, Matrix<T,ROWS,COLS>& _x)
+{
+  scalKernel(ROWS*COLS, _alpha, _x.data());
+  return _x;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief y = _alpha*A*x + _beta*y, A is a ROWS x COLS matrix, x a COLS column vector and y a ROWS column vector
+/// param[in] _alpha, the scalar A*x is multiplied by
+/// param[in] _a, the matrix, not changed
+/// param[in] _x, the column vector A multiplies, not changed
+/// param[in] _beta, the scalar y is multiplied by, if 0 the previous values of y are ignored
+/// param[in] _y, the column vector that is accumulated into
+template <typename T, size_t ROWS, size_t COLS>
+Matrix<T,ROWS,1>& gemv(T _alpha, const Matrix<T,ROWS,COLS>& _a, const Matrix<T,COLS,1>& _x,
+                       T _beta, Matrix<T,ROWS,1>& _y)
+{
+  // x and y can only be the same vector if A is square, in which case x is copied first
+  if(static_cast<const void*>(_x.data()) == static_cast<const void*>(_y.data()))
+  {
+    Matrix<T,COLS,1> x(_x);
+    gemvRows(ROWS, COLS, _alpha, _a.data(), x.data(), _beta, _y.data());
+    return _y;
+  }
+
+  gemvRows(ROWS, COLS, _alpha, _a.data(), _x.data(), _beta, _y.data());
+  return _y;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief A = A + _alpha*x*y^T (rank 1 update), x is a ROWS column vector and y a COLS column vector
+/// param[in] _alpha, the scalar the outer product is multiplied by
+/// param[in] _x, the column vector, not changed
+/// param[in] _y, the column vector, not changed
+/// param[in] _a, the ROWS x COLS matrix that is updated, if _x or _y share its memory their values from before the call are used
+template <typename T, size_t ROWS, size_t COLS>
+Matrix<T,ROWS,COLS>& ger(T _alpha, const Matrix<T,ROWS,1>& _x, const Matrix<T,COLS,1>& _y,
+                         Matrix<T,ROWS,COLS>& _a)
+{
+  const std::size_t aBytes = ROWS*COLS*sizeof(T);
+  if(memoryOverlaps(_x.data(), ROWS*sizeof(T), _a.data(), aBytes) ||
+     memoryOverlaps(_y.data(), COLS*sizeof(T), _a.data(), aBytes))
+  {
+    Matrix<T,ROWS,1> x(_x);
+    Matrix<T,COLS,1> y(_y);
+    gerRows(ROWS, COLS, _alpha, x.data(), y.data(), _a.data());
+    return _a;
+  }
+
+  gerRows(ROWS, COLS, _alpha, _x.data(), _y.data(), _a.data());
+  return _a;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief C = _alpha*A*B + _beta*C, A is ROWS x INNER, B INNER x COLS and C ROWS x COLS
+/// param[in] _alpha, the scalar A*B is multiplied by
+/// param[in] _a, the left matrix, not changed
+/// param[in] _b, the right matrix, not changed
+/// param[in] _beta, the scalar C is multiplied by, if 0 the previous values of C are ignored
+/// param[in] _c, the matrix that is accumulated into, must not be _a or _b
+template <typename T, size_t ROWS, size_t INNER, size_t COLS>
+Matrix<T,ROWS,COLS>& gemm(T _alpha, const Matrix<T,ROWS,INNER>& _a, const Matrix<T,INNER,COLS>& _b,
+                          T _beta, Matrix<T,ROWS,COLS>& _c)
+{
+  gemmRows(ROWS, COLS, INNER, _alpha, _a.data(), _b.data(), _beta, _c.data());
+  return _c;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief C[i] = _alpha*A[i]*B[i] + _beta*C[i] for _count independent products of small matrices, eg a block of
+/// signal processing matrices. Each product runs on one thread, the batch is split across threads when it is large.
+/// param[in] _count, number of products
+/// param[in] _a, _count left matrices, not changed
+/// param[in] _b, _count right matrices, not changed
+/// param[in] _c, _count matrices that are accumulated into
+template <typename T, size_t ROWS, size_t INNER, size_t COLS>
+void gemmBatch(std::size_t _count, T _alpha, const Matrix<T,ROWS,INNER>* _a, const Matrix<T,INNER,COLS>* _b,
+               T _beta, Matrix<T,ROWS,COLS>* _c)
+{
+  // a chunk gets at least MYLIB_PARALLEL_MIN_ELEMENTS multiply adds
+  const std::size_t minChunk = MYLIB_PARALLEL_MIN_ELEMENTS / (ROWS*INNER*COLS) + 1;
+
+  parallelFor(0, _count, minChunk, [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      gemmKernel(ROWS, COLS, INNER, _alpha, _a[i].data(), _b[i].data(), _beta, _c[i].data());
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief y[i] = _alpha*A[i]*x[i] + _beta*y[i] for _count independent matrix vector products, split across threads
+/// when the batch is large
+template <typename T, size_t ROWS, size_t COLS>
+void gemvBatch(std::size_t _count, T _alpha, const Matrix<T,ROWS,COLS>* _a, const Matrix<T,COLS,1>* _x,
+               T _beta, Matrix<T,ROWS,1>* _y)
+{
+  const std::size_t minChunk = MYLIB_PARALLEL_MIN_ELEMENTS / (ROWS*COLS) + 1;
+
+  parallelFor(0, _count, minChunk, [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      gemvKernel(ROWS, COLS, _alpha, _a[i].data(), _x[i].data(), _beta, _y[i].data());
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // MATRIXBLAS_H
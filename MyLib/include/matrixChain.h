@@ -0,0 +1,157 @@
+#ifndef MATRIXCHAIN_H
+#define MATRIXCHAIN_H
+#include <tuple>
+#include <type_traits>
+#include "matrix.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Matrix chain multiplication, multiplyChain(a,b,c,...) picks the cheapest order to multiply a chain of
+/// matrices in at compile time (from the template dimensions) and then multiplies them in that order.
+/// Unlike operator* the matrices passed in are not changed, the product is returned as a new matrix.
+
+//----------------------------------------------------------------------------------------------
+/// @brief Table filled in by the matrix chain dynamic programme
+/// cost[i][j] is the fewest scalar multiplications needed to multiply matrices i to j
+/// split[i][j] is where the chain i to j is split, eg (i..k)(k+1..j)
+template <size_t N>
+struct MatrixChainTable
+{
+  unsigned long long cost[N][N];
+  size_t split[N][N];
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Works out the cheapest parenthesisation of a chain of matrices at compile time.
+/// DIMS are the chain dimensions, matrix i is DIMS[i] x DIMS[i+1]
+/// Classic O(n^3) dynamic programme, from Cormen et al. Introduction to Algorithms (15.2)
+template <size_t... DIMS>
+struct MatrixChainOrder
+{
+  // number of matrices in the chain
+  static constexpr size_t count = sizeof...(DIMS)-1;
+
+  // runs the dynamic programme
+  static constexpr MatrixChainTable<count> table()
+  {
+    const size_t dims[] = {DIMS...};
+    MatrixChainTable<count> t{};
+
+    for(size_t length = 2; length <= count; ++length)
+    {
+      for(size_t i = 0; i + length - 1 < count; ++i)
+      {
+        size_t j = i + length - 1;
+        t.cost[i][j] = ~0ull;
+
+        for(size_t k = i; k < j; ++k)
+        {
+          unsigned long long c = t.cost[i][k] + t.cost[k+1][j] +
+                                 (unsigned long long)dims[i] * dims[k+1] * dims[j+1];
+          if(c < t.cost[i][j])
+          {
+            t.cost[i][j] = c;
+            t.split[i][j] = k;
+          }
+        }
+      }
+    }
+
+    return t;
+  }
+
+  // where the chain _i to _j is split
+  static constexpr size_t split(size_t _i, size_t _j) { return table().split[_i][_j]; }
+
+  // number of scalar multiplications needed for the whole chain
+  static constexpr unsigned long long cost() { return table().cost[0][count-1]; }
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Multiplies two matrices into a new matrix, neither matrix is changed
+/// param[in] _lhs, the left hand matrix (ROWS x INNER)
+/// param[in] _rhs, the right hand matrix (INNER x COLS)
+template <typename T, size_t ROWS, size_t INNER, size_t COLS>
+Matrix<T,ROWS,COLS> multiplyPair(const Matrix<T,ROWS,INNER>& _lhs, const Matrix<T,INNER,COLS>& _rhs)
+{
+  Matrix<T,ROWS,COLS> result;
+
+  const T* a = _lhs.data();
+  const T* b = _rhs.data();
+  T* c = result.data();
+
+  // i-k-j order so the inner loop walks both b and c contiguously
+  for(size_t i = 0; i < ROWS; ++i)
+  {
+    for(size_t k = 0; k < INNER; ++k)
+    {
+      const T aik = a[i*INNER+k];
+      for(size_t j = 0; j < COLS; ++j)
+      {
+        c[i*COLS+j] += aik * b[k*COLS+j];
+      }
+    }
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Multiplies matrices I to J of the chain in the order given by ORDER
+template <typename ORDER, size_t I, size_t J>
+struct MatrixChainEvaluator
+{
+  template <typename TUPLE>
+  static auto eval(const TUPLE& _chain)
+  {
+    return multiplyPair(MatrixChainEvaluator<ORDER,I,ORDER::split(I,J)>::eval(_chain),
+                        MatrixChainEvaluator<ORDER,ORDER::split(I,J)+1,J>::eval(_chain));
+  }
+};
+
+/// @brief A single matrix of the chain, returned by reference so it isn't copied
+template <typename ORDER, size_t I>
+struct MatrixChainEvaluator<ORDER,I,I>
+{
+  template <typename TUPLE>
+  static const typename std::tuple_element<I,TUPLE>::type& eval(const TUPLE& _chain)
+  {
+    return std::get<I>(_chain);
+  }
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Checks every matrix in the chain has as many columns as the next one has rows
+template <typename FIRST>
+constexpr bool matrixChainConforms() { return true; }
+
+template <typename FIRST, typename SECOND, typename... REST>
+constexpr bool matrixChainConforms()
+{
+  return MatrixDims<FIRST>::cols == MatrixDims<SECOND>::rows &&
+         std::is_same<typename MatrixDims<FIRST>::type, typename MatrixDims<SECOND>::type>::value &&
+         matrixChainConforms<SECOND,REST...>();
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Multiplies a chain of matrices and/or vectors in the cheapest order, eg multiplyChain(P,V,M,S,v)
+/// works out P*(V*(M*(S*v))) so only matrix-vector products are done.
+/// param[in] _mats, the matrices to multiply, in order
+template <typename FIRST, typename... REST>
+Matrix<typename MatrixDims<FIRST>::type,
+       MatrixDims<FIRST>::rows,
+       MatrixDims<typename std::tuple_element<sizeof...(REST)-1, std::tuple<REST...> >::type>::cols>
+multiplyChain(const FIRST& _first, const REST&... _rest)
+{
+  static_assert(sizeof...(REST) >= 1, "multiplyChain needs at least two matrices");
+  static_assert(matrixChainConforms<FIRST,REST...>(),
+                "number of columns of each matrix must equil the number of rows of the next matrix");
+
+  typedef MatrixChainOrder<MatrixDims<FIRST>::rows, MatrixDims<FIRST>::cols, MatrixDims<REST>::cols...> Order;
+
+  return MatrixChainEvaluator<Order,0,sizeof...(REST)>::eval(std::tie(_first,_rest...));
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // MATRIXCHAIN_H
@@ -0,0 +1,337 @@
+#ifndef MATRIXFUNCTIONS_H
+#define MATRIXFUNCTIONS_H
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <type_traits>
+#include "matrix.h"
+#include "matrixChain.h"
+#include "matrixReductions.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Powers, exponential and logarithm of square matrices, eg pow(M,k), exp(M) and log(M).
+/// As with multiplyChain the matrix passed in is not changed, the result is returned as a new matrix.
+/// 2x2, 3x3 and 4x4 matrices use the closed form Matrix::inverse(), larger matrices use Gaussian elimination.
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the N x N identity matrix
+template <typename T, size_t N>
+Matrix<T,N,N> identityMatrix()
+{
+  Matrix<T,N,N> id;
+
+  for(size_t i = 0; i < N; ++i)
+  {
+    id.data()[i*N+i] = 1;
+  }
+
+  return id;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Solves _lhs * X = _rhs for X using the closed form inverse (2x2, 3x3 and 4x4 matrices)
+template <typename T, size_t N>
+Matrix<T,N,N> solveSquare(const Matrix<T,N,N>& _lhs, const Matrix<T,N,N>& _rhs, std::true_type)
+{
+  Matrix<T,N,N> inv(_lhs);
+  inv.inverse();
+
+  return multiplyPair(inv,_rhs);
+}
+
+/// @brief Solves _lhs * X = _rhs for X using Gaussian elimination with partial pivoting (any size)
+template <typename T, size_t N>
+Matrix<T,N,N> solveSquare(const Matrix<T,N,N>& _lhs, const Matrix<T,N,N>& _rhs, std::false_type)
+{
+  Matrix<T,N,N> a(_lhs);
+  Matrix<T,N,N> x(_rhs);
+  T* A = a.data();
+  T* X = x.data();
+
+  for(size_t col = 0; col < N; ++col)
+  {
+    // pick the largest pivot in this column
+    size_t pivot = col;
+    for(size_t r = col+1; r < N; ++r)
+    {
+      if(std::abs(A[r*N+col]) > std::abs(A[pivot*N+col]))
+      {
+        pivot = r;
+      }
+    }
+
+    if(A[pivot*N+col] == T(0))
+    {
+      throw std::out_of_range("An inverse doesnt exist, the matrix is singular");
+    }
+
+    if(pivot != col)
+    {
+      for(size_t j = 0; j < N; ++j)
+      {
+        std::swap(A[col*N+j],A[pivot*N+j]);
+        std::swap(X[col*N+j],X[pivot*N+j]);
+      }
+    }
+
+    // eliminate below the pivot
+    for(size_t r = col+1; r < N; ++r)
+    {
+      T factor = A[r*N+col] / A[col*N+col];
+      for(size_t j = col; j < N; ++j)
+      {
+        A[r*N+j] -= factor * A[col*N+j];
+      }
+      for(size_t j = 0; j < N; ++j)
+      {
+        X[r*N+j] -= factor * X[col*N+j];
+      }
+    }
+  }
+
+  // back substitution
+  for(size_t r = N; r-- > 0;)
+  {
+    for(size_t k = r+1; k < N; ++k)
+    {
+      T factor = A[r*N+k];
+      for(size_t j = 0; j < N; ++j)
+      {
+        X[r*N+j] -= factor * X[k*N+j];
+      }
+    }
+    for(size_t j = 0; j < N; ++j)
+    {
+      X[r*N+j] /= A[r*N+r];
+    }
+  }
+
+  return x;
+}
+
+/// @brief Solves _lhs * X = _rhs for X, picking the closed form inverse for 2x2, 3x3 and 4x4 matrices
+template <typename T, size_t N>
+Matrix<T,N,N> solveSquare(const Matrix<T,N,N>& _lhs, const Matrix<T,N,N>& _rhs)
+{
+  return solveSquare(_lhs,_rhs,std::integral_constant<bool,(N>=2 && N<=4)>());
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the matrix raised to the power _k, using repeated squaring (log2(k) multiplications)
+/// A negative power raises the inverse of the matrix to -_k.
+/// param[in] _mat, the square matrix
+/// param[in] _k, the power
+template <typename T, size_t N>
+Matrix<T,N,N> pow(const Matrix<T,N,N>& _mat, int _k)
+{
+  Matrix<T,N,N> base(_mat);
+  Matrix<T,N,N> result = identityMatrix<T,N>();
+
+  unsigned int k = _k;
+  if(_k < 0)
+  {
+    base = solveSquare(_mat,identityMatrix<T,N>());
+    k = -(long long)_k;
+  }
+
+  while(k)
+  {
+    if(k & 1u)
+    {
+      result = multiplyPair(result,base);
+    }
+    k >>= 1;
+    if(k)
+    {
+      base = multiplyPair(base,base);
+    }
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the matrix exponential e^M, using scaling and squaring with a [6/6] Pade approximant.
+/// Algorithm 11.3.1 from Golub and Van Loan, Matrix Computations (3rd edition).
+/// param[in] _mat, the square matrix
+template <typename T, size_t N>
+Matrix<T,N,N> exp(const Matrix<T,N,N>& _mat)
+{
+  // scale so that the norm of A/2^s is at most 1/2
+  int s = 0;
+  T norm = normInf(_mat);
+  if(norm > T(0.5))
+  {
+    s = (int)std::ceil(std::log2(norm / T(0.5)));
+  }
+
+  Matrix<T,N,N> a(_mat);
+  a * (T(1) / std::ldexp(T(1),s));
+
+  // Pade [6/6] coefficients c_k = (2q-k)! q! / ((2q)! k! (q-k)!)
+  const int q = 6;
+  T c = 1;
+  Matrix<T,N,N> x = identityMatrix<T,N>();
+  Matrix<T,N,N> numerator = identityMatrix<T,N>();
+  Matrix<T,N,N> denominator = identityMatrix<T,N>();
+
+  for(int k = 1; k <= q; ++k)
+  {
+    c = c * T(q-k+1) / T(k*(2*q-k+1));
+    x = multiplyPair(a,x);
+
+    Matrix<T,N,N> term(x);
+    term * c;
+    numerator + term;
+    if(k % 2)
+    {
+      denominator - term;
+    }
+    else
+    {
+      denominator + term;
+    }
+  }
+
+  Matrix<T,N,N> result = solveSquare(denominator,numerator);
+
+  // undo the scaling by squaring s times
+  for(int k = 0; k < s; ++k)
+  {
+    result = multiplyPair(result,result);
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the principal matrix logarithm log(M), using inverse scaling and squaring.
+/// Square roots are taken with the Denman-Beavers iteration until M is close to the identity, the
+/// log of the remainder is found with the Gregory series and then scaled back up.
+/// Throws std::out_of_range if the matrix has no real logarithm (eg negative real eigenvalues).
+/// param[in] _mat, the square matrix
+template <typename T, size_t N>
+Matrix<T,N,N> log(const Matrix<T,N,N>& _mat)
+{
+  const Matrix<T,N,N> id = identityMatrix<T,N>();
+  const T tolerance = std::numeric_limits<T>::epsilon() * 16;
+
+  Matrix<T,N,N> a(_mat);
+  int s = 0;
+
+  // take square roots until A is close enough to the identity for the series to converge quickly
+  Matrix<T,N,N> diff(a);
+  diff - id;
+  while(normInf(diff) > T(0.25))
+  {
+    if(s == 64)
+    {
+      throw std::out_of_range("Matrix logarithm doesnt exist, square roots did not converge");
+    }
+
+    Matrix<T,N,N> y(a);
+    Matrix<T,N,N> z(id);
+    for(int it = 0; it < 100; ++it)
+    {
+      Matrix<T,N,N> yNext = solveSquare(z,id);
+      Matrix<T,N,N> zNext = solveSquare(y,id);
+      yNext + y;
+      yNext * T(0.5);
+      zNext + z;
+      zNext * T(0.5);
+
+      Matrix<T,N,N> change(yNext);
+      change - y;
+      y = yNext;
+      z = zNext;
+
+      if(normInf(change) <= tolerance * normInf(y))
+      {
+        break;
+      }
+    }
+
+    if(!std::isfinite(normInf(y)))
+    {
+      throw std::out_of_range("Matrix logarithm doesnt exist, the square root is not real");
+    }
+
+    a = y;
+    diff = a;
+    diff - id;
+    ++s;
+  }
+
+  // log(A) = 2 * sum_{k odd} Z^k / k with Z = (A-I)(A+I)^-1
+  Matrix<T,N,N> sum(a);
+  sum + id;
+  Matrix<T,N,N> z = solveSquare(sum,diff);
+  // (A+I)^-1 (A-I) equals (A-I)(A+I)^-1 as both are functions of A
+  Matrix<T,N,N> zSquared = multiplyPair(z,z);
+  Matrix<T,N,N> power(z);
+  Matrix<T,N,N> result(z);
+
+  for(int k = 3; k < 200; k += 2)
+  {
+    power = multiplyPair(power,zSquared);
+    Matrix<T,N,N> term(power);
+    term * (T(1) / T(k));
+    result + term;
+
+    if(normInf(term) <= tolerance * normInf(result))
+    {
+      break;
+    }
+  }
+
+  result * std::ldexp(T(2),s);
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// \class MatrixPowers
+/// \brief Caches the repeated squares M, M^2, M^4, M^8 ... of a matrix so that many powers of the same
+/// matrix (eg stepping the same linear system forward k steps with pow(exp(A*dt),k)) reuse the squares
+/// already worked out instead of squaring again for every call.
+template <typename T, size_t N>
+class MatrixPowers
+{
+private:
+
+    // m_squares[i] = M^(2^i), grown as higher powers are asked for
+    std::vector< Matrix<T,N,N> > m_squares;
+
+public:
+
+    // constructs the cache for the matrix _mat
+    MatrixPowers(const Matrix<T,N,N>& _mat) : m_squares(1,_mat) {}
+
+    // returns M^_k, squaring only the first time a power of two is needed
+    Matrix<T,N,N> power(unsigned int _k)
+    {
+      Matrix<T,N,N> result = identityMatrix<T,N>();
+
+      for(size_t i = 0; _k; ++i, _k >>= 1)
+      {
+        if(i == m_squares.size())
+        {
+          m_squares.push_back(multiplyPair(m_squares.back(),m_squares.back()));
+        }
+        if(_k & 1u)
+        {
+          result = multiplyPair(result,m_squares[i]);
+        }
+      }
+
+      return result;
+    }
+
+    // number of squares currently cached
+    size_t cached() const { return m_squares.size(); }
+};
+
+//----------------------------------------------------------------------------------------------
+#endif // MATRIXFUNCTIONS_H
@@ -0,0 +1,136 @@
+#ifndef MATRIXMAP_H
+#define MATRIXMAP_H
+#include <cmath>
+#include <cstdlib>
+#include <type_traits>
+#include "matrix.h"
+#include "parallel.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Element wise map and zip, eg map(f,A) applies f to every element of A and zip(f,A,B) applies f(a,b) to every pair
+/// of elements of A and B. The function can be a lambda, the loop is a single pass over contiguous memory so it inlines
+/// and vectorises for float, double, std::complex or any numeric type. Large matrices are split across threads.
+/// map and zip return a new matrix, mapInPlace and zipInPlace write the result into the first matrix instead.
+
+//----------------------------------------------------------------------------------------------
+/// @brief Checks a set of matrices all have the same number of rows and columns
+template <typename FIRST>
+constexpr bool matrixShapesMatch() { return true; }
+
+template <typename FIRST, typename SECOND, typename... REST>
+constexpr bool matrixShapesMatch()
+{
+  return MatrixDims<FIRST>::rows == MatrixDims<SECOND>::rows &&
+         MatrixDims<FIRST>::cols == MatrixDims<SECOND>::cols &&
+         matrixShapesMatch<SECOND,REST...>();
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Writes _func(in0[i],in1[i],...) to _out[i] for _n contiguous elements, split across threads when large
+template <typename OUT, typename FUNC, typename... IN>
+void mapKernel(std::size_t _n, OUT* _out, FUNC& _func, const IN*... _in)
+{
+  parallelFor(0,_n,MYLIB_PARALLEL_MIN_ELEMENTS,[&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      _out[i] = _func(_in[i]...);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns a new matrix with _func applied to every element, the element type is whatever _func returns
+/// param[in] _func, the function to apply, eg [](float x){ return x*x; }
+/// param[in] _mat, the matrix, not changed
+template <typename FUNC, typename T, size_t ROWS, size_t COLS>
+Matrix<typename std::decay<typename std::result_of<FUNC&(const T&)>::type>::type,ROWS,COLS>
+map(FUNC _func, const Matrix<T,ROWS,COLS>& _mat)
+{
+  Matrix<typename std::decay<typename std::result_of<FUNC&(const T&)>::type>::type,ROWS,COLS> result;
+  mapKernel(ROWS*COLS,result.data(),_func,_mat.data());
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Applies _func to every element of the matrix, in place
+/// param[in] _func, the function to apply
+/// param[in] _mat, the matrix to change
+template <typename FUNC, typename T, size_t ROWS, size_t COLS>
+Matrix<T,ROWS,COLS>& mapInPlace(FUNC _func, Matrix<T,ROWS,COLS>& _mat)
+{
+  mapKernel(ROWS*COLS,_mat.data(),_func,static_cast<const T*>(_mat.data()));
+
+  return _mat;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns a new matrix with _func applied to the matching elements of each matrix, eg zip(f,A,B)(i,j)=f(A(i,j),B(i,j))
+/// All matrices must be the same size, none of them are changed.
+/// param[in] _func, the function to apply, it takes one argument per matrix
+/// param[in] _first, the first matrix
+/// param[in] _rest, the other matrices
+template <typename FUNC, typename T, size_t ROWS, size_t COLS, typename... REST>
+Matrix<typename std::decay<typename std::result_of<FUNC&(const T&, const typename MatrixDims<REST>::type&...)>::type>::type,ROWS,COLS>
+zip(FUNC _func, const Matrix<T,ROWS,COLS>& _first, const REST&... _rest)
+{
+  static_assert(matrixShapesMatch<Matrix<T,ROWS,COLS>,REST...>(), "zip needs matrices of the same size");
+
+  Matrix<typename std::decay<typename std::result_of<FUNC&(const T&, const typename MatrixDims<REST>::type&...)>::type>::type,ROWS,COLS> result;
+  mapKernel(ROWS*COLS,result.data(),_func,_first.data(),_rest.data()...);
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Applies _func to the matching elements of each matrix and writes the result into the first matrix
+/// param[in] _func, the function to apply, it takes one argument per matrix
+/// param[in] _first, the matrix to change, also passed as the first argument of _func
+/// param[in] _rest, the other matrices, not changed
+template <typename FUNC, typename T, size_t ROWS, size_t COLS, typename... REST>
+Matrix<T,ROWS,COLS>& zipInPlace(FUNC _func, Matrix<T,ROWS,COLS>& _first, const REST&... _rest)
+{
+  static_assert(matrixShapesMatch<Matrix<T,ROWS,COLS>,REST...>(), "zipInPlace needs matrices of the same size");
+
+  mapKernel(ROWS*COLS,_first.data(),_func,static_cast<const T*>(_first.data()),_rest.data()...);
+
+  return _first;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the absolute value of every element
+template <typename T, size_t ROWS, size_t COLS>
+Matrix<T,ROWS,COLS> abs(const Matrix<T,ROWS,COLS>& _mat)
+{
+  return map([](const T& _x) { using std::abs; return abs(_x); },_mat);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns every element clamped between _low and _high
+template <typename T, size_t ROWS, size_t COLS>
+Matrix<T,ROWS,COLS> clamp(const Matrix<T,ROWS,COLS>& _mat, T _low, T _high)
+{
+  return map([_low,_high](const T& _x) { return _x < _low ? _low : (_high < _x ? _high : _x); },_mat);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns a + _t*(b - a) for every element
+template <typename T, size_t ROWS, size_t COLS>
+Matrix<T,ROWS,COLS> lerp(const Matrix<T,ROWS,COLS>& _a, const Matrix<T,ROWS,COLS>& _b, T _t)
+{
+  return zip([_t](const T& _x, const T& _y) { return _x + _t*(_y - _x); },_a,_b);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns a*b + c for every element
+template <typename T, size_t ROWS, size_t COLS>
+Matrix<T,ROWS,COLS> fma(const Matrix<T,ROWS,COLS>& _a, const Matrix<T,ROWS,COLS>& _b, const Matrix<T,ROWS,COLS>& _c)
+{
+  return zip([](const T& _x, const T& _y, const T& _z) { return _x*_y + _z; },_a,_b,_c);
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // MATRIXMAP_H
@@ -0,0 +1,283 @@
+#ifndef MATRIXREDUCTIONS_H
+#define MATRIXREDUCTIONS_H
+#include <cmath>
+#include <cstdlib>
+#include <complex>
+#include <utility>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+#include "matrix.h"
+#include "parallel.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Reductions over every element of a matrix or vector: sum, product, min, max, argMin, argMax, trace,
+/// maxAbs and the Frobenius, 1 and infinity norms. None of them change the matrix.
+/// maxAbs and the norms use the modulus of complex elements and return the real type, see ScalarTraits.
+/// The accumulator type can be given as the first template parameter, eg sum<double>(floatMatrix) adds up a float
+/// matrix in double precision. Large matrices are split across threads (see parallel.h), the partial results are always
+/// combined in the same order so the answer doesn't change from run to run.
+
+//----------------------------------------------------------------------------------------------
+/// @brief Reduces _n contiguous elements using four independent accumulators so the loop pipelines and vectorises
+/// param[in] _data, the first element
+/// param[in] _n, number of elements
+/// param[in] _init, the starting value of each accumulator (the identity of _combine)
+/// param[in] _op, folds an element into an accumulator, _op(ACC,T)
+/// param[in] _combine, combines two accumulators, _combine(ACC,ACC)
+template <typename ACC, typename T, typename OP, typename COMBINE>
+ACC reduceKernel(const T* _data, std::size_t _n, ACC _init, OP _op, COMBINE _combine)
+{
+  ACC acc0 = _init;
+  ACC acc1 = _init;
+  ACC acc2 = _init;
+  ACC acc3 = _init;
+
+  std::size_t i = 0;
+  for(; i + 4 <= _n; i += 4)
+  {
+    acc0 = _op(acc0,_data[i]);
+    acc1 = _op(acc1,_data[i+1]);
+    acc2 = _op(acc2,_data[i+2]);
+    acc3 = _op(acc3,_data[i+3]);
+  }
+  for(; i < _n; ++i)
+  {
+    acc0 = _op(acc0,_data[i]);
+  }
+
+  return _combine(_combine(acc0,acc1),_combine(acc2,acc3));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Reduces _n contiguous elements, splitting the work across threads when there are enough of them
+template <typename ACC, typename T, typename OP, typename COMBINE>
+ACC reduceElements(const T* _data, std::size_t _n, ACC _init, OP _op, COMBINE _combine)
+{
+  return parallelReduce(std::size_t(0),_n,MYLIB_PARALLEL_MIN_ELEMENTS,_init,
+                        [&](std::size_t _first, std::size_t _last)
+                        {
+                          return reduceKernel(_data+_first,_last-_first,_init,_op,_combine);
+                        },
+                        _combine);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the sum of every element
+template <typename ACC = void, typename T, size_t ROWS, size_t COLS,
+          typename R = typename std::conditional<std::is_void<ACC>::value,T,ACC>::type>
+R sum(const Matrix<T,ROWS,COLS>& _mat)
+{
+  return reduceElements(_mat.data(),ROWS*COLS,R(0),
+                        [](R _acc, T _value) { return _acc + R(_value); },
+                        [](R _a, R _b) { return _a + _b; });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the product of every element
+template <typename ACC = void, typename T, size_t ROWS, size_t COLS,
+          typename R = typename std::conditional<std::is_void<ACC>::value,T,ACC>::type>
+R product(const Matrix<T,ROWS,COLS>& _mat)
+{
+  return reduceElements(_mat.data(),ROWS*COLS,R(1),
+                        [](R _acc, T _value) { return _acc * R(_value); },
+                        [](R _a, R _b) { return _a * _b; });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the smallest element
+template <typename T, size_t ROWS, size_t COLS>
+T min(const Matrix<T,ROWS,COLS>& _mat)
+{
+  return reduceElements(_mat.data(),ROWS*COLS,_mat.data()[0],
+                        [](T _acc, T _value) { return _value < _acc ? _value : _acc; },
+                        [](T _a, T _b) { return _b < _a ? _b : _a; });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the largest element
+template <typename T, size_t ROWS, size_t COLS>
+T max(const Matrix<T,ROWS,COLS>& _mat)
+{
+  return reduceElements(_mat.data(),ROWS*COLS,_mat.data()[0],
+                        [](T _acc, T _value) { return _acc < _value ? _value : _acc; },
+                        [](T _a, T _b) { return _a < _b ? _b : _a; });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the largest absolute value of any element, the modulus for complex elements
+template <typename T, size_t ROWS, size_t COLS, typename R = typename ScalarTraits<T>::abs_type>
+R maxAbs(const Matrix<T,ROWS,COLS>& _mat)
+{
+  return reduceElements(_mat.data(),ROWS*COLS,R(0),
+                        [](R _acc, T _value)
+                        {
+                          const R a = ScalarTraits<T>::abs(_value);
+                          return _acc < a ? a : _acc;
+                        },
+                        [](R _a, R _b) { return _a < _b ? _b : _a; });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Finds the position of the first element for which _better(element,best) is true against every other element
+/// Returns the position as a (row,column) pair starting at 1, to match operator()
+template <typename T, size_t ROWS, size_t COLS, typename BETTER>
+std::pair<std::size_t,std::size_t> argReduce(const Matrix<T,ROWS,COLS>& _mat, BETTER _better)
+{
+  const T* data = _mat.data();
+
+  std::size_t index = parallelReduce(std::size_t(0),ROWS*COLS,MYLIB_PARALLEL_MIN_ELEMENTS,std::size_t(0),
+                                     [&](std::size_t _first, std::size_t _last)
+                                     {
+                                       std::size_t best = _first;
+                                       for(std::size_t i = _first+1; i < _last; ++i)
+                                       {
+                                         if(_better(data[i],data[best]))
+                                         {
+                                           best = i;
+                                         }
+                                       }
+                                       return best;
+                                     },
+                                     [&](std::size_t _a, std::size_t _b)
+                                     {
+                                       // _a is always the earlier chunk, so ties keep the first position
+                                       return _better(data[_b],data[_a]) ? _b : _a;
+                                     });
+
+  return std::make_pair(index/COLS + 1, index%COLS + 1);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the (row,column) of the smallest element, starting at 1, the first one if there are several
+template <typename T, size_t ROWS, size_t COLS>
+std::pair<std::size_t,std::size_t> argMin(const Matrix<T,ROWS,COLS>& _mat)
+{
+  return argReduce(_mat,[](const T& _a, const T& _b) { return _a < _b; });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the (row,column) of the largest element, starting at 1, the first one if there are several
+template <typename T, size_t ROWS, size_t COLS>
+std::pair<std::size_t,std::size_t> argMax(const Matrix<T,ROWS,COLS>& _mat)
+{
+  return argReduce(_mat,[](const T& _a, const T& _b) { return _b < _a; });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the trace (sum of the diagonal) of a square matrix
+template <typename ACC = void, typename T, size_t ROWS, size_t COLS,
+          typename R = typename std::conditional<std::is_void<ACC>::value,T,ACC>::type>
+R trace(const Matrix<T,ROWS,COLS>& _mat)
+{
+  if(ROWS != COLS)
+  {
+    throw std::out_of_range("You must use a square matrix for the trace function");
+  }
+
+  R result = 0;
+  for(std::size_t i = 0; i < ROWS; ++i)
+  {
+    result += R(_mat.data()[i*COLS+i]);
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Squared modulus of an element, worked out in the accumulator type R so a wider R keeps its precision
+template <typename R, typename T>
+R absSquared(const T& _x)
+{
+  return R(_x)*R(_x);
+}
+
+template <typename R, typename U>
+R absSquared(const std::complex<U>& _x)
+{
+  return R(_x.real())*R(_x.real()) + R(_x.imag())*R(_x.imag());
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the Frobenius norm (square root of the sum of every element's squared modulus)
+/// For a vector this is the same as magnitude() but returns the element type (the real type for complex elements)
+/// instead of float.
+template <typename ACC = void, typename T, size_t ROWS, size_t COLS,
+          typename R = typename std::conditional<std::is_void<ACC>::value,typename ScalarTraits<T>::abs_type,ACC>::type>
+auto normFrobenius(const Matrix<T,ROWS,COLS>& _mat) -> decltype(std::sqrt(R(0)))
+{
+  R sumSquares = reduceElements(_mat.data(),ROWS*COLS,R(0),
+                                [](R _acc, T _value) { return _acc + absSquared<R>(_value); },
+                                [](R _a, R _b) { return _a + _b; });
+
+  return std::sqrt(sumSquares);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the 1 norm (largest absolute column sum)
+template <typename ACC = void, typename T, size_t ROWS, size_t COLS,
+          typename R = typename std::conditional<std::is_void<ACC>::value,typename ScalarTraits<T>::abs_type,ACC>::type>
+R norm1(const Matrix<T,ROWS,COLS>& _mat)
+{
+  const T* data = _mat.data();
+
+  // each chunk of rows adds into its own column sums, walking the rows contiguously
+  std::vector<R> colSums = parallelReduce(std::size_t(0),ROWS,MYLIB_PARALLEL_MIN_ELEMENTS/COLS + 1,std::vector<R>(COLS,R(0)),
+                                          [&](std::size_t _first, std::size_t _last)
+                                          {
+                                            std::vector<R> sums(COLS,R(0));
+                                            for(std::size_t i = _first; i < _last; ++i)
+                                            {
+                                              for(std::size_t j = 0; j < COLS; ++j)
+                                              {
+                                                sums[j] += R(ScalarTraits<T>::abs(data[i*COLS+j]));
+                                              }
+                                            }
+                                            return sums;
+                                          },
+                                          [](std::vector<R> _a, const std::vector<R>& _b)
+                                          {
+                                            for(std::size_t j = 0; j < _a.size(); ++j)
+                                            {
+                                              _a[j] += _b[j];
+                                            }
+                                            return _a;
+                                          });
+
+  R norm = 0;
+  for(std::size_t j = 0; j < COLS; ++j)
+  {
+    norm = norm < colSums[j] ? colSums[j] : norm;
+  }
+
+  return norm;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the infinity norm (largest absolute row sum)
+template <typename ACC = void, typename T, size_t ROWS, size_t COLS,
+          typename R = typename std::conditional<std::is_void<ACC>::value,typename ScalarTraits<T>::abs_type,ACC>::type>
+R normInf(const Matrix<T,ROWS,COLS>& _mat)
+{
+  const T* data = _mat.data();
+
+  return parallelReduce(std::size_t(0),ROWS,MYLIB_PARALLEL_MIN_ELEMENTS/COLS + 1,R(0),
+                        [&](std::size_t _first, std::size_t _last)
+                        {
+                          R norm = 0;
+                          for(std::size_t i = _first; i < _last; ++i)
+                          {
+                            R rowSum = reduceKernel(data + i*COLS,COLS,R(0),
+                                                    [](R _acc, T _value) { return _acc + R(ScalarTraits<T>::abs(_value)); },
+                                                    [](R _a, R _b) { return _a + _b; });
+                            norm = norm < rowSum ? rowSum : norm;
+                          }
+                          return norm;
+                        },
+                        [](R _a, R _b) { return _a < _b ? _b : _a; });
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // MATRIXREDUCTIONS_H
@@ -0,0 +1,317 @@
+#ifndef MATRIXTRANSPOSE_H
+#define MATRIXTRANSPOSE_H
+#include <cstddef>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Transpose kernels on contiguous row major storage, used by Matrix::transpose() and transposed().
+/// transposeKernel copies a rows x cols block into a cols x rows block, transposeInPlaceKernel transposes a
+/// square block without any extra storage. Both are cache oblivious, the matrix is split in half along its
+/// longest side until the pieces fit in cache whatever its size. The smallest pieces are transposed as
+/// tiles with SIMD shuffles (4x4 floats with SSE, 8x8 floats and 4x4 doubles with AVX, 2x2 doubles with SSE2),
+/// other types are copied one element at a time.
+
+template <typename T, size_t ROWS, size_t COLS> class Matrix;
+
+// blocks with fewer elements than this are transposed tile by tile instead of being split again
+#ifndef MYLIB_TRANSPOSE_BLOCK
+#define MYLIB_TRANSPOSE_BLOCK 1024
+#endif
+
+//----------------------------------------------------------------------------------------------
+/// @brief Transposes one SIZE x SIZE tile, out(j,i) = in(i,j), the generic version works on single elements
+template <typename T>
+struct TransposeTile
+{
+  static constexpr std::size_t size = 1;
+
+  static void transpose(const T* _in, std::size_t, T* _out, std::size_t) { *_out = *_in; }
+};
+
+#if defined(__AVX__)
+/// @brief 8x8 floats, unpack then shuffle then swap 128 bit lanes
+template <>
+struct TransposeTile<float>
+{
+  static constexpr std::size_t size = 8;
+
+  static void transpose(const float* _in, std::size_t _inStride, float* _out, std::size_t _outStride)
+  {
+    __m256 r0 = _mm256_loadu_ps(_in);
+    __m256 r1 = _mm256_loadu_ps(_in + _inStride);
+    __m256 r2 = _mm256_loadu_ps(_in + 2*_inStride);
+    __m256 r3 = _mm256_loadu_ps(_in + 3*_inStride);
+    __m256 r4 = _mm256_loadu_ps(_in + 4*_inStride);
+    __m256 r5 = _mm256_loadu_ps(_in + 5*_inStride);
+    __m256 r6 = _mm256_loadu_ps(_in + 6*_inStride);
+    __m256 r7 = _mm256_loadu_ps(_in + 7*_inStride);
+
+    __m256 t0 = _mm256_unpacklo_ps(r0,r1);
+    __m256 t1 = _mm256_unpackhi_ps(r0,r1);
+    __m256 t2 = _mm256_unpacklo_ps(r2,r3);
+    __m256 t3 = _mm256_unpackhi_ps(r2,r3);
+    __m256 t4 = _mm256_unpacklo_ps(r4,r5);
+    __m256 t5 = _mm256_unpackhi_ps(r4,r5);
+    __m256 t6 = _mm256_unpacklo_ps(r6,r7);
+    __m256 t7 = _mm256_unpackhi_ps(r6,r7);
+
+    __m256 s0 = _mm256_shuffle_ps(t0,t2,_MM_SHUFFLE(1,0,1,0));
+    __m256 s1 = _mm256_shuffle_ps(t0,t2,_MM_SHUFFLE(3,2,3,2));
+    __m256 s2 = _mm256_shuffle_ps(t1,t3,_MM_SHUFFLE(1,0,1,0));
+    __m256 s3 = _mm256_shuffle_ps(t1,t3,_MM_SHUFFLE(3,2,3,2));
+    __m256 s4 = _mm256_shuffle_ps(t4,t6,_MM_SHUFFLE(1,0,1,0));
+    __m256 s5 = _mm256_shuffle_ps(t4,t6,_MM_SHUFFLE(3,2,3,2));
+    __m256 s6 = _mm256_shuffle_ps(t5,t7,_MM_SHUFFLE(1,0,1,0));
+    __m256 s7 = _mm256_shuffle_ps(t5,t7,_MM_SHUFFLE(3,2,3,2));
+
+    _mm256_storeu_ps(_out,                _mm256_permute2f128_ps(s0,s4,0x20));
+    _mm256_storeu_ps(_out + _outStride,   _mm256_permute2f128_ps(s1,s5,0x20));
+    _mm256_storeu_ps(_out + 2*_outStride, _mm256_permute2f128_ps(s2,s6,0x20));
+    _mm256_storeu_ps(_out + 3*_outStride, _mm256_permute2f128_ps(s3,s7,0x20));
+    _mm256_storeu_ps(_out + 4*_outStride, _mm256_permute2f128_ps(s0,s4,0x31));
+    _mm256_storeu_ps(_out + 5*_outStride, _mm256_permute2f128_ps(s1,s5,0x31));
+    _mm256_storeu_ps(_out + 6*_outStride, _mm256_permute2f128_ps(s2,s6,0x31));
+    _mm256_storeu_ps(_out + 7*_outStride, _mm256_permute2f128_ps(s3,s7,0x31));
+  }
+};
+
+/// @brief 4x4 doubles, unpack pairs then swap 128 bit lanes
+template <>
+struct TransposeTile<double>
+{
+  static constexpr std::size_t size = 4;
+
+  static void transpose(const double* _in, std::size_t _inStride, double* _out, std::size_t _outStride)
+  {
+    __m256d r0 = _mm256_loadu_pd(_in);
+    __m256d r1 = _mm256_loadu_pd(_in + _inStride);
+    __m256d r2 = _mm256_loadu_pd(_in + 2*_inStride);
+    __m256d r3 = _mm256_loadu_pd(_in + 3*_inStride);
+
+    __m256d t0 = _mm256_unpacklo_pd(r0,r1);
+    __m256d t1 = _mm256_unpackhi_pd(r0,r1);
+    __m256d t2 = _mm256_unpacklo_pd(r2,r3);
+    __m256d t3 = _mm256_unpackhi_pd(r2,r3);
+
+    _mm256_storeu_pd(_out,                _mm256_permute2f128_pd(t0,t2,0x20));
+    _mm256_storeu_pd(_out + _outStride,   _mm256_permute2f128_pd(t1,t3,0x20));
+    _mm256_storeu_pd(_out + 2*_outStride, _mm256_permute2f128_pd(t0,t2,0x31));
+    _mm256_storeu_pd(_out + 3*_outStride, _mm256_permute2f128_pd(t1,t3,0x31));
+  }
+};
+
+#elif defined(__SSE2__)
+/// @brief 4x4 floats with the SSE transpose macro
+template <>
+struct TransposeTile<float>
+{
+  static constexpr std::size_t size = 4;
+
+  static void transpose(const float* _in, std::size_t _inStride, float* _out, std::size_t _outStride)
+  {
+    __m128 r0 = _mm_loadu_ps(_in);
+    __m128 r1 = _mm_loadu_ps(_in + _inStride);
+    __m128 r2 = _mm_loadu_ps(_in + 2*_inStride);
+    __m128 r3 = _mm_loadu_ps(_in + 3*_inStride);
+
+    _MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+
+    _mm_storeu_ps(_out,                r0);
+    _mm_storeu_ps(_out + _outStride,   r1);
+    _mm_storeu_ps(_out + 2*_outStride, r2);
+    _mm_storeu_ps(_out + 3*_outStride, r3);
+  }
+};
+
+/// @brief 2x2 doubles, one unpack each way
+template <>
+struct TransposeTile<double>
+{
+  static constexpr std::size_t size = 2;
+
+  static void transpose(const double* _in, std::size_t _inStride, double* _out, std::size_t _outStride)
+  {
+    __m128d r0 = _mm_loadu_pd(_in);
+    __m128d r1 = _mm_loadu_pd(_in + _inStride);
+
+    _mm_storeu_pd(_out,              _mm_unpacklo_pd(r0,r1));
+    _mm_storeu_pd(_out + _outStride, _mm_unpackhi_pd(r0,r1));
+  }
+};
+#endif
+
+//----------------------------------------------------------------------------------------------
+/// @brief Transposes rows [_r0,_r1) and columns [_c0,_c1) of _in into _out, whole tiles use the SIMD tile kernel
+template <typename T>
+void transposeLeaf(const T* _in, std::size_t _inStride, T* _out, std::size_t _outStride,
+                   std::size_t _r0, std::size_t _r1, std::size_t _c0, std::size_t _c1)
+{
+  const std::size_t tile = TransposeTile<T>::size;
+  std::size_t rTiles = _r0 + (_r1 - _r0) / tile * tile;
+  std::size_t cTiles = _c0 + (_c1 - _c0) / tile * tile;
+
+  for(std::size_t r = _r0; r < rTiles; r += tile)
+  {
+    for(std::size_t c = _c0; c < cTiles; c += tile)
+    {
+      TransposeTile<T>::transpose(_in + r*_inStride + c,_inStride,_out + c*_outStride + r,_outStride);
+    }
+  }
+
+  // the edges that don't fill a tile
+  for(std::size_t r = _r0; r < _r1; ++r)
+  {
+    for(std::size_t c = (r < rTiles ? cTiles : _c0); c < _c1; ++c)
+    {
+      _out[c*_outStride + r] = _in[r*_inStride + c];
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Cache oblivious transpose of rows [_r0,_r1) and columns [_c0,_c1), halves the longest side until the block is small
+template <typename T>
+void transposeBlock(const T* _in, std::size_t _inStride, T* _out, std::size_t _outStride,
+                    std::size_t _r0, std::size_t _r1, std::size_t _c0, std::size_t _c1)
+{
+  const std::size_t tile = TransposeTile<T>::size;
+  std::size_t rows = _r1 - _r0;
+  std::size_t cols = _c1 - _c0;
+
+  if(rows * cols <= MYLIB_TRANSPOSE_BLOCK || (rows <= tile && cols <= tile))
+  {
+    transposeLeaf(_in,_inStride,_out,_outStride,_r0,_r1,_c0,_c1);
+  }
+  // splits are kept on tile boundaries so the leaves stay full of whole tiles
+  else if(rows >= cols)
+  {
+    std::size_t mid = _r0 + std::max(rows / 2 / tile * tile, tile);
+    transposeBlock(_in,_inStride,_out,_outStride,_r0,mid,_c0,_c1);
+    transposeBlock(_in,_inStride,_out,_outStride,mid,_r1,_c0,_c1);
+  }
+  else
+  {
+    std::size_t mid = _c0 + std::max(cols / 2 / tile * tile, tile);
+    transposeBlock(_in,_inStride,_out,_outStride,_r0,_r1,_c0,mid);
+    transposeBlock(_in,_inStride,_out,_outStride,_r0,_r1,mid,_c1);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Writes the transpose of the row major _rows x _cols matrix _in into _out (_cols x _rows), they must not overlap
+template <typename T>
+void transposeKernel(std::size_t _rows, std::size_t _cols, const T* __restrict__ _in, T* __restrict__ _out)
+{
+  transposeBlock(_in,_cols,_out,_rows,0,_rows,0,_cols);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Swaps block (rows [_r0,_r1), columns [_c0,_c1)) of the square matrix _a with its mirror image, transposing both.
+/// The block must lie entirely above the diagonal.
+template <typename T>
+void transposeSwapBlock(T* _a, std::size_t _n, std::size_t _r0, std::size_t _r1, std::size_t _c0, std::size_t _c1)
+{
+  const std::size_t tile = TransposeTile<T>::size;
+  std::size_t rows = _r1 - _r0;
+  std::size_t cols = _c1 - _c0;
+
+  if(rows * cols > MYLIB_TRANSPOSE_BLOCK && (rows > tile || cols > tile))
+  {
+    if(rows >= cols)
+    {
+      std::size_t mid = _r0 + std::max(rows / 2 / tile * tile, tile);
+      transposeSwapBlock(_a,_n,_r0,mid,_c0,_c1);
+      transposeSwapBlock(_a,_n,mid,_r1,_c0,_c1);
+    }
+    else
+    {
+      std::size_t mid = _c0 + std::max(cols / 2 / tile * tile, tile);
+      transposeSwapBlock(_a,_n,_r0,_r1,_c0,mid);
+      transposeSwapBlock(_a,_n,_r0,_r1,mid,_c1);
+    }
+    return;
+  }
+
+  std::size_t rTiles = _r0 + rows / tile * tile;
+  std::size_t cTiles = _c0 + cols / tile * tile;
+
+  // whole tiles, one tile is held in registers sized scratch while its mirror is moved across
+  T scratch[TransposeTile<T>::size * TransposeTile<T>::size];
+  for(std::size_t r = _r0; r < rTiles; r += tile)
+  {
+    for(std::size_t c = _c0; c < cTiles; c += tile)
+    {
+      TransposeTile<T>::transpose(_a + r*_n + c,_n,scratch,tile);
+      TransposeTile<T>::transpose(_a + c*_n + r,_n,_a + r*_n + c,_n);
+      for(std::size_t i = 0; i < tile; ++i)
+      {
+        std::copy(scratch + i*tile,scratch + (i+1)*tile,_a + (c+i)*_n + r);
+      }
+    }
+  }
+
+  for(std::size_t r = _r0; r < _r1; ++r)
+  {
+    for(std::size_t c = (r < rTiles ? cTiles : _c0); c < _c1; ++c)
+    {
+      std::swap(_a[r*_n + c],_a[c*_n + r]);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Transposes the diagonal block [_d0,_d1) of the square matrix _a in place
+template <typename T>
+void transposeDiagonalBlock(T* _a, std::size_t _n, std::size_t _d0, std::size_t _d1)
+{
+  std::size_t size = _d1 - _d0;
+
+  if(size * size <= MYLIB_TRANSPOSE_BLOCK)
+  {
+    for(std::size_t r = _d0; r < _d1; ++r)
+    {
+      for(std::size_t c = r + 1; c < _d1; ++c)
+      {
+        std::swap(_a[r*_n + c],_a[c*_n + r]);
+      }
+    }
+    return;
+  }
+
+  // [A B; C D] -> [A^T C^T; B^T D^T]
+  const std::size_t tile = TransposeTile<T>::size;
+  std::size_t mid = _d0 + std::max(size / 2 / tile * tile, tile);
+  transposeDiagonalBlock(_a,_n,_d0,mid);
+  transposeDiagonalBlock(_a,_n,mid,_d1);
+  transposeSwapBlock(_a,_n,_d0,mid,mid,_d1);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Transposes the row major _n x _n matrix _a in place, no extra storage is used
+template <typename T>
+void transposeInPlaceKernel(std::size_t _n, T* _a)
+{
+  transposeDiagonalBlock(_a,_n,0,_n);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the transpose of a matrix as a new COLS x ROWS matrix, _mat isn't changed
+template <typename T, size_t ROWS, size_t COLS>
+Matrix<T,COLS,ROWS> transposed(const Matrix<T,ROWS,COLS>& _mat)
+{
+  Matrix<T,COLS,ROWS> result;
+  transposeKernel(ROWS,COLS,_mat.data(),result.data());
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // MATRIXTRANSPOSE_H
@@ -0,0 +1,149 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Small helpers for splitting work on large matrices across threads.
+/// Work is only split when there is enough of it for every thread to be worth starting,
+/// below that the function is just called on the calling thread.
+
+// fewest elements a thread is given before splitting work across threads is worth it
+#ifndef MYLIB_PARALLEL_MIN_ELEMENTS
+#define MYLIB_PARALLEL_MIN_ELEMENTS 65536
+#endif
+
+//----------------------------------------------------------------------------------------------
+/// @brief Thread count set with setParallelThreads, 0 means use every hardware thread
+inline unsigned int& parallelThreadsSetting()
+{
+  static unsigned int threads = 0;
+  return threads;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Sets how many threads the parallel kernels use, 0 (the default) uses every hardware thread
+/// param[in] _threads, the number of threads, 1 runs everything on the calling thread
+inline void setParallelThreads(unsigned int _threads)
+{
+  parallelThreadsSetting() = _threads;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the number of threads the parallel kernels use (at least 1)
+inline unsigned int parallelThreads()
+{
+  // hardware_concurrency can be a system call so it is only asked for once
+  static const unsigned int hardware = std::thread::hardware_concurrency();
+
+  unsigned int threads = parallelThreadsSetting() ? parallelThreadsSetting() : hardware;
+  return threads ? threads : 1;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns how many chunks [_begin,_end) is split into so each chunk has at least _minChunk items
+inline std::size_t parallelChunks(std::size_t _begin, std::size_t _end, std::size_t _minChunk)
+{
+  std::size_t count = _end > _begin ? _end - _begin : 0;
+  std::size_t chunks = _minChunk ? count / _minChunk : count;
+
+  // small jobs (most fixed size matrices) never look at the thread count
+  if(chunks <= 1)
+  {
+    return 1;
+  }
+
+  return std::min<std::size_t>(chunks, parallelThreads());
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Calls _func(chunkBegin,chunkEnd,chunkIndex) over [_begin,_end) split into _chunks equal contiguous chunks,
+/// one per thread. The calling thread does the first chunk itself.
+/// param[in] _begin, first index
+/// param[in] _end, one past the last index
+/// param[in] _chunks, the number of chunks from parallelChunks, at least 1
+/// param[in] _func, the work to do on each chunk
+template <typename FUNC>
+void parallelRunChunks(std::size_t _begin, std::size_t _end, std::size_t _chunks, FUNC& _func)
+{
+  if(_chunks <= 1)
+  {
+    _func(_begin,_end,std::size_t(0));
+    return;
+  }
+
+  std::size_t count = _end - _begin;
+  std::vector<std::thread> workers;
+  workers.reserve(_chunks-1);
+
+  for(std::size_t c = 1; c < _chunks; ++c)
+  {
+    std::size_t first = _begin + count * c / _chunks;
+    std::size_t last = _begin + count * (c+1) / _chunks;
+    workers.emplace_back([=, &_func]() { _func(first,last,c); });
+  }
+
+  _func(_begin,_begin + count / _chunks,std::size_t(0));
+
+  for(std::thread& worker : workers)
+  {
+    worker.join();
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Calls _func(chunkBegin,chunkEnd,chunkIndex) over [_begin,_end) split into equal contiguous chunks,
+/// one per thread. The calling thread does the first chunk itself.
+/// param[in] _begin, first index
+/// param[in] _end, one past the last index
+/// param[in] _minChunk, fewest indices given to a thread
+/// param[in] _func, the work to do on each chunk
+template <typename FUNC>
+void parallelForChunks(std::size_t _begin, std::size_t _end, std::size_t _minChunk, FUNC _func)
+{
+  parallelRunChunks(_begin,_end,parallelChunks(_begin,_end,_minChunk),_func);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Calls _func(chunkBegin,chunkEnd) over [_begin,_end), split across threads when it is large enough
+template <typename FUNC>
+void parallelFor(std::size_t _begin, std::size_t _end, std::size_t _minChunk, FUNC _func)
+{
+  parallelForChunks(_begin,_end,_minChunk,[&_func](std::size_t _first, std::size_t _last, std::size_t)
+  {
+    _func(_first,_last);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Reduces [_begin,_end) in parallel, each chunk is reduced with _chunkFunc(chunkBegin,chunkEnd)
+/// and the partial results are combined in chunk order with _combine, so the result doesn't depend on timing.
+template <typename RESULT, typename CHUNKFUNC, typename COMBINE>
+RESULT parallelReduce(std::size_t _begin, std::size_t _end, std::size_t _minChunk,
+                      RESULT _init, CHUNKFUNC _chunkFunc, COMBINE _combine)
+{
+  // the thread count can change between two calls to parallelChunks, so the chunks are counted once
+  std::size_t chunks = parallelChunks(_begin,_end,_minChunk);
+  std::vector<RESULT> partials(chunks,_init);
+
+  auto reduceChunk = [&](std::size_t _first, std::size_t _last, std::size_t _chunk)
+  {
+    partials[_chunk] = _chunkFunc(_first,_last);
+  };
+  parallelRunChunks(_begin,_end,chunks,reduceChunk);
+
+  RESULT result = partials[0];
+  for(std::size_t c = 1; c < partials.size(); ++c)
+  {
+    result = _combine(result,partials[c]);
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // PARALLEL_H
@@ -1,12 +1,294 @@
 #ifndef QUARTERNION_H
 #define QUARTERNION_H
+#include <cstddef>
+#include <cmath>
 #include <complex>
+#include <stdexcept>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
 #include "matrix.h"
 
 /// \author Kate Edge
 /// \version 1.0
 /// \date 13/3/17 \n
 
+/// The quaternion is stored as (a,b,c,d) in one aligned array. Multiplication, conjugate, normalize, inverse and
+/// dot go through the quaternion*Kernel functions below, the generic versions work one component at a time and
+/// there are overloads that keep a Quaternion<float> in one SSE register (and a Quaternion<double> in one AVX
+/// register) and use shuffles instead of moving components around.
+
+//----------------------------------------------------------------------------------------------
+/// @brief Alignment of the quaternion storage, 16 bytes for float so an array of them can be loaded with aligned
+/// loads, double is also 16 as that is all new guarantees before C++17
+template <typename T>
+struct QuaternionAlignment
+{
+  static constexpr std::size_t value = alignof(T);
+};
+
+template <>
+struct QuaternionAlignment<float>
+{
+  static constexpr std::size_t value = 16;
+};
+
+template <>
+struct QuaternionAlignment<double>
+{
+  static constexpr std::size_t value = 16;
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Hamilton product _out = _l*_r, _out can be _l or _r
+template <typename T>
+void quaternionMultiplyKernel(const T* _l, const T* _r, T* _out)
+{
+  T a = (_l[0]*_r[0])-(_l[1]*_r[1])-(_l[2]*_r[2])-(_l[3]*_r[3]);
+  T b = (_l[0]*_r[1])+(_l[1]*_r[0])+(_l[2]*_r[3])-(_l[3]*_r[2]);
+  T c = (_l[0]*_r[2])-(_l[1]*_r[3])+(_l[2]*_r[0])+(_l[3]*_r[1]);
+  T d = (_l[0]*_r[3])+(_l[1]*_r[2])-(_l[2]*_r[1])+(_l[3]*_r[0]);
+
+  _out[0]=a;
+  _out[1]=b;
+  _out[2]=c;
+  _out[3]=d;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Negates the vector part of _q
+template <typename T>
+void quaternionConjugateKernel(T* _q)
+{
+  _q[1]=-_q[1];
+  _q[2]=-_q[2];
+  _q[3]=-_q[3];
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the 4 component dot product of _l and _r
+template <typename T>
+T quaternionDotKernel(const T* _l, const T* _r)
+{
+  return (_l[0]*_r[0])+(_l[1]*_r[1])+(_l[2]*_r[2])+(_l[3]*_r[3]);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Divides _q by its norm, a zero quaternion is left as it is
+template <typename T>
+void quaternionNormalizeKernel(T* _q)
+{
+  T normSqr = quaternionDotKernel(_q,_q);
+  if(normSqr == T(0))
+  {
+    return;
+  }
+
+  T n = sqrt(normSqr);
+  _q[0]/=n;
+  _q[1]/=n;
+  _q[2]/=n;
+  _q[3]/=n;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Normalizes _q, the generic version is the same as quaternionNormalizeKernel
+template <typename T>
+void quaternionNormalizeFastKernel(T* _q)
+{
+  quaternionNormalizeKernel(_q);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Replaces _q with its inverse, conjugate/|q|^2, a zero quaternion is left as it is
+template <typename T>
+void quaternionInverseKernel(T* _q)
+{
+  T normSqr = quaternionDotKernel(_q,_q);
+  if(normSqr == T(0))
+  {
+    return;
+  }
+
+  _q[0]=_q[0]/normSqr;
+  _q[1]=-_q[1]/normSqr;
+  _q[2]=-_q[2]/normSqr;
+  _q[3]=-_q[3]/normSqr;
+}
+
+#if defined(__SSE2__)
+//----------------------------------------------------------------------------------------------
+/// @brief Dot product of two float quaternions in every lane, two shuffles and adds
+inline __m128 quaternionDotLanes(__m128 _l, __m128 _r)
+{
+  __m128 m = _mm_mul_ps(_l,_r);
+  m = _mm_add_ps(m,_mm_shuffle_ps(m,m,_MM_SHUFFLE(2,3,0,1)));
+  return _mm_add_ps(m,_mm_shuffle_ps(m,m,_MM_SHUFFLE(1,0,3,2)));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Hamilton product of float quaternions, _l[k] times _r shuffled and sign flipped for each k
+/// param[in] _l, _r, _out four floats each, they don't have to be aligned and _out can be _l or _r
+inline void quaternionMultiplyKernel(const float* _l, const float* _r, float* _out)
+{
+  __m128 r = _mm_loadu_ps(_r);
+  __m128 r1 = _mm_xor_ps(_mm_shuffle_ps(r,r,_MM_SHUFFLE(2,3,0,1)),_mm_setr_ps(-0.0f,0.0f,-0.0f,0.0f));
+  __m128 r2 = _mm_xor_ps(_mm_shuffle_ps(r,r,_MM_SHUFFLE(1,0,3,2)),_mm_setr_ps(-0.0f,0.0f,0.0f,-0.0f));
+  __m128 r3 = _mm_xor_ps(_mm_shuffle_ps(r,r,_MM_SHUFFLE(0,1,2,3)),_mm_setr_ps(-0.0f,-0.0f,0.0f,0.0f));
+
+  __m128 l = _mm_loadu_ps(_l);
+  __m128 out = _mm_mul_ps(_mm_shuffle_ps(l,l,_MM_SHUFFLE(0,0,0,0)),r);
+  out = _mm_add_ps(out,_mm_mul_ps(_mm_shuffle_ps(l,l,_MM_SHUFFLE(1,1,1,1)),r1));
+  out = _mm_add_ps(out,_mm_mul_ps(_mm_shuffle_ps(l,l,_MM_SHUFFLE(2,2,2,2)),r2));
+  out = _mm_add_ps(out,_mm_mul_ps(_mm_shuffle_ps(l,l,_MM_SHUFFLE(3,3,3,3)),r3));
+
+  _mm_storeu_ps(_out,out);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Conjugate of a float quaternion, one xor
+inline void quaternionConjugateKernel(float* _q)
+{
+  _mm_storeu_ps(_q,_mm_xor_ps(_mm_loadu_ps(_q),_mm_setr_ps(0.0f,-0.0f,-0.0f,-0.0f)));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Dot product of float quaternions
+inline float quaternionDotKernel(const float* _l, const float* _r)
+{
+  return _mm_cvtss_f32(quaternionDotLanes(_mm_loadu_ps(_l),_mm_loadu_ps(_r)));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Normalizes a float quaternion, dividing by the square root so the result is correctly
+/// rounded
+inline void quaternionNormalizeKernel(float* _q)
+{
+  __m128 q = _mm_loadu_ps(_q);
+  __m128 normSqr = quaternionDotLanes(q,q);
+  if(_mm_cvtss_f32(normSqr) == 0.0f)
+  {
+    return;
+  }
+
+  _mm_storeu_ps(_q,_mm_div_ps(q,_mm_sqrt_ps(normSqr)));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Normalizes a float quaternion with the rsqrt estimate and one Newton step,
+/// y' = y*(1.5 - 0.5*x*y*y), which is within a couple of ulp and avoids the square root and divide
+inline void quaternionNormalizeFastKernel(float* _q)
+{
+  __m128 q = _mm_loadu_ps(_q);
+  __m128 normSqr = quaternionDotLanes(q,q);
+  if(_mm_cvtss_f32(normSqr) == 0.0f)
+  {
+    return;
+  }
+
+  __m128 y = _mm_rsqrt_ps(normSqr);
+  __m128 halfX = _mm_mul_ps(_mm_set1_ps(0.5f),normSqr);
+  y = _mm_mul_ps(y,_mm_sub_ps(_mm_set1_ps(1.5f),_mm_mul_ps(halfX,_mm_mul_ps(y,y))));
+
+  _mm_storeu_ps(_q,_mm_mul_ps(q,y));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Inverse of a float quaternion, the conjugate divided by the dot product
+inline void quaternionInverseKernel(float* _q)
+{
+  __m128 q = _mm_loadu_ps(_q);
+  __m128 normSqr = quaternionDotLanes(q,q);
+  if(_mm_cvtss_f32(normSqr) == 0.0f)
+  {
+    return;
+  }
+
+  q = _mm_xor_ps(q,_mm_setr_ps(0.0f,-0.0f,-0.0f,-0.0f));
+  _mm_storeu_ps(_q,_mm_div_ps(q,normSqr));
+}
+#endif
+
+#if defined(__AVX__)
+//----------------------------------------------------------------------------------------------
+/// @brief Dot product of two double quaternions in every lane, the halves are swapped with a permute
+inline __m256d quaternionDotLanes(__m256d _l, __m256d _r)
+{
+  __m256d m = _mm256_mul_pd(_l,_r);
+  m = _mm256_add_pd(m,_mm256_permute_pd(m,0x5));
+  return _mm256_add_pd(m,_mm256_permute2f128_pd(m,m,0x01));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Hamilton product of double quaternions in AVX registers, _out can be _l or _r
+inline void quaternionMultiplyKernel(const double* _l, const double* _r, double* _out)
+{
+  __m256d r = _mm256_loadu_pd(_r);
+  __m256d swapped = _mm256_permute2f128_pd(r,r,0x01);
+  __m256d r1 = _mm256_xor_pd(_mm256_permute_pd(r,0x5),_mm256_setr_pd(-0.0,0.0,-0.0,0.0));
+  __m256d r2 = _mm256_xor_pd(swapped,_mm256_setr_pd(-0.0,0.0,0.0,-0.0));
+  __m256d r3 = _mm256_xor_pd(_mm256_permute_pd(swapped,0x5),_mm256_setr_pd(-0.0,-0.0,0.0,0.0));
+
+  __m256d out = _mm256_mul_pd(_mm256_broadcast_sd(_l),r);
+  out = _mm256_add_pd(out,_mm256_mul_pd(_mm256_broadcast_sd(_l + 1),r1));
+  out = _mm256_add_pd(out,_mm256_mul_pd(_mm256_broadcast_sd(_l + 2),r2));
+  out = _mm256_add_pd(out,_mm256_mul_pd(_mm256_broadcast_sd(_l + 3),r3));
+
+  _mm256_storeu_pd(_out,out);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Conjugate of a double quaternion, one xor
+inline void quaternionConjugateKernel(double* _q)
+{
+  _mm256_storeu_pd(_q,_mm256_xor_pd(_mm256_loadu_pd(_q),_mm256_setr_pd(0.0,-0.0,-0.0,-0.0)));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Dot product of double quaternions
+inline double quaternionDotKernel(const double* _l, const double* _r)
+{
+  return _mm256_cvtsd_f64(quaternionDotLanes(_mm256_loadu_pd(_l),_mm256_loadu_pd(_r)));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Normalizes a double quaternion, there is no double rsqrt before AVX-512 so the fast version is the same
+inline void quaternionNormalizeKernel(double* _q)
+{
+  __m256d q = _mm256_loadu_pd(_q);
+  __m256d normSqr = quaternionDotLanes(q,q);
+  if(_mm256_cvtsd_f64(normSqr) == 0.0)
+  {
+    return;
+  }
+
+  _mm256_storeu_pd(_q,_mm256_div_pd(q,_mm256_sqrt_pd(normSqr)));
+}
+
+inline void quaternionNormalizeFastKernel(double* _q)
+{
+  quaternionNormalizeKernel(_q);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Inverse of a double quaternion, the conjugate divided by the dot product
+inline void quaternionInverseKernel(double* _q)
+{
+  __m256d q = _mm256_loadu_pd(_q);
+  __m256d normSqr = quaternionDotLanes(q,q);
+  if(_mm256_cvtsd_f64(normSqr) == 0.0)
+  {
+    return;
+  }
+
+  q = _mm256_xor_pd(q,_mm256_setr_pd(0.0,-0.0,-0.0,-0.0));
+  _mm256_storeu_pd(_q,_mm256_div_pd(q,normSqr));
+}
+#endif
+
 template <typename T>
 
 /// \class Quaternions
@@ -15,12 +297,18 @@ class Quaternion
 {
 private:
 
-    /// Quaternion in the form of a+bi+cj+dk
-    T m_a;
-    T m_b;
-    T m_c;
-    T m_d;
+    /// Quaternion in the form of a+bi+cj+dk, stored as (a,b,c,d) aligned so float and double quaternions load
+    /// into one register
+    alignas(QuaternionAlignment<T>::value) T m_data[4];
 
+    // writes the rotation matrix into _out, row r starting at _out[r*_stride]
+    void rotationMatrix(T* _out, std::size_t _stride) const;
+    // Shepperd's method on the 3x3 rotation in _in, row r starting at _in[r*_stride]
+    static Quaternion<T> fromRotation(const T* _in, std::size_t _stride);
+    // _w0*_q0 + _w1*_q1, for the interpolations
+    static Quaternion<T> weightedSum(T _w0, const Quaternion<T>& _q0, T _w1, const Quaternion<T>& _q1);
+    // index of the component named "a" to "d"
+    static std::size_t componentIndex(const char* _data);
 
 public:
 
@@ -32,9 +320,29 @@ public:
     Quaternion(const Quaternion<T>& _rhs);
 
     // access data
-    void setData(char *_data, T _value);
+    void setData(const char *_data, T _value);
     // returns a,b,c or d (read only)
-    const T getData(const char *_data);
+    const T getData(const char *_data) const;
+
+    // components by name, a is the scalar part
+    T& a() { return m_data[0]; }
+    T& b() { return m_data[1]; }
+    T& c() { return m_data[2]; }
+    T& d() { return m_data[3]; }
+    const T& a() const { return m_data[0]; }
+    const T& b() const { return m_data[1]; }
+    const T& c() const { return m_data[2]; }
+    const T& d() const { return m_data[3]; }
+
+    // component I (0 to 3 for a to d), checked at compile time
+    template <std::size_t I>
+    T& get() { static_assert(I < 4, "a quaternion has 4 components"); return m_data[I]; }
+    template <std::size_t I>
+    const T& get() const { static_assert(I < 4, "a quaternion has 4 components"); return m_data[I]; }
+
+    // the 4 contiguous components (a,b,c,d), aligned as QuaternionAlignment<T>
+    T* data() { return m_data; }
+    const T* data() const { return m_data; }
 
 
     // assignment operator
@@ -59,11 +367,46 @@ public:
     // division operator scalar
     Quaternion& operator/ (T _scalar);
 
-    T norm();
+    T norm() const;
+    // 4 component dot product, for unit quaternions the cosine of half the angle between them
+    T dot(const Quaternion<T>& _rhs) const;
     Quaternion<T>& conjugate();
     Quaternion<T>& normalize();
+    // normalize with the reciprocal square root estimate and a Newton step for floats, within a couple of ulp
+    Quaternion<T>& normalizeFast();
     Quaternion<T>& inverse();
 
+    // rotates _v by the quaternion (q*v*q^-1), the quaternion must be normalized
+    Matrix<T,3,1> rotate(const Matrix<T,3,1>& _v) const;
+
+    // rotation matrix for column vectors (v' = R*v), the quaternion doesn't have to be normalized
+    Matrix<T,3,3> toMatrix3() const;
+    // homogeneous rotation matrix, the last row and column are from the identity
+    Matrix<T,4,4> toMatrix4() const;
+    // unit quaternion with a >= 0 from a rotation matrix or the rotation part of a homogeneous matrix
+    static Quaternion<T> fromMatrix(const Matrix<T,3,3>& _mat);
+    static Quaternion<T> fromMatrix(const Matrix<T,4,4>& _mat);
+
+    // interpolation between unit quaternions along the shorter arc, _t = 0 gives _q0 and _t = 1 gives _q1
+    // constant angular velocity
+    static Quaternion<T> slerp(const Quaternion<T>& _q0, const Quaternion<T>& _q1, T _t);
+    // normalized linear interpolation, cheapest but speeds up in the middle of large angles
+    static Quaternion<T> nlerp(const Quaternion<T>& _q0, const Quaternion<T>& _q1, T _t);
+    // nlerp with _t corrected by a polynomial so it follows slerp to about 1e-3 radians, at nlerp cost
+    static Quaternion<T> slerpFast(const Quaternion<T>& _q0, const Quaternion<T>& _q1, T _t);
+
+    // quaternion exponential, exp(a)*(cos|v| + v/|v| sin|v|), exp((0,θ/2*axis)) is the rotation by θ about axis
+    static Quaternion<T> exp(const Quaternion<T>& _q);
+    // principal logarithm, (ln|q|, v/|v| * the angle between q and the real axis), the inverse of exp
+    static Quaternion<T> log(const Quaternion<T>& _q);
+    // exp(_t*log(_q)), for a unit quaternion the rotation about the same axis by _t times the angle
+    static Quaternion<T> pow(const Quaternion<T>& _q, T _t);
+
+    // unit quaternion of the rotation by _angle radians about _axis, which doesn't have to be normalized
+    static Quaternion<T> fromAxisAngle(const Matrix<T,3,1>& _axis, T _angle);
+    // unit axis and angle in [0,2π] of the rotation, the quaternion doesn't have to be normalized
+    void toAxisAngle(Matrix<T,3,1>& _axis, T& _angle) const;
+
     // prints out the quaternion in the form a+bi+cj+dk
     void print();
 
@@ -74,26 +417,26 @@ public:
 template <typename T>
 Quaternion<T>::Quaternion()
 {
-  m_a=0;
-  m_b=0;
-  m_c=0;
-  m_d=0;
+  m_data[0]=0;
+  m_data[1]=0;
+  m_data[2]=0;
+  m_data[3]=0;
 
 }
 
 //----------------------------------------------------------------------------------------------
 /// @brief Constructs and initializes a quaternion
-/// param[in] _a, the value m_a will be initialized to
-/// param[in] _b, the value m_b will be initialized to
-/// param[in] _c, the value m_c will be initialized to
-/// param[in] _d, the value m_d will be initialized to
+/// param[in] _a, the value a will be initialized to
+/// param[in] _b, the value b will be initialized to
+/// param[in] _c, the value c will be initialized to
+/// param[in] _d, the value d will be initialized to
 template <typename T>
 Quaternion<T>::Quaternion(T _a, T _b, T _c, T _d)
 {
-  m_a=_a;
-  m_b=_b;
-  m_c=_c;
-  m_d=_d;
+  m_data[0]=_a;
+  m_data[1]=_b;
+  m_data[2]=_c;
+  m_data[3]=_d;
 
 }
 
@@ -103,40 +446,45 @@ Quaternion<T>::Quaternion(T _a, T _b, T _c, T _d)
 template <typename T>
 Quaternion<T>::Quaternion(const Quaternion<T> &_rhs)
 {
-  m_a=_rhs.m_a;
-  m_b=_rhs.m_b;
-  m_c=_rhs.m_c;
-  m_d=_rhs.m_d;
+  m_data[0]=_rhs.m_data[0];
+  m_data[1]=_rhs.m_data[1];
+  m_data[2]=_rhs.m_data[2];
+  m_data[3]=_rhs.m_data[3];
 
 }
 
 //----------------------------------------------------------------------------------------------
-/// @brief Accesses  m_a,m_b,m_c or m_d and changes value
-/// param[in] _data, the data to access
-/// param[in] _value, the value to change the data to
+/// @brief Returns the index of the component named by _data, kept for getData and setData, use a() to d() or get<I>()
+/// where the component is known at compile time
+/// param[in] _data, "a", "b", "c" or "d"
 template <typename T>
-void Quaternion<T>::setData(char* _data, T _value)
+std::size_t Quaternion<T>::componentIndex(const char* _data)
 {
+  if(_data == nullptr || _data[0] < 'a' || _data[0] > 'd' || _data[1] != '\0')
+  {
+    throw std::out_of_range("Quaternion component must be a, b, c or d");
+  }
 
-  if(_data == "a") {m_a = _value;}
-  if(_data == "b") {m_b = _value;}
-  if(_data == "c") {m_c = _value;}
-  if(_data == "d") {m_d = _value;}
+  return static_cast<std::size_t>(_data[0] - 'a');
+}
 
+//----------------------------------------------------------------------------------------------
+/// @brief Accesses a,b,c or d and changes value
+/// param[in] _data, the data to access
+/// param[in] _value, the value to change the data to
+template <typename T>
+void Quaternion<T>::setData(const char* _data, T _value)
+{
+  m_data[componentIndex(_data)] = _value;
 }
 
 //----------------------------------------------------------------------------------------------
-/// @brief Returns the value of m_a,m_b,m_c or m_d (read only)
+/// @brief Returns the value of a,b,c or d (read only)
 /// param[in] _data, the value to return
 template <typename T>
-const T Quaternion<T>::getData(const char* _data)
+const T Quaternion<T>::getData(const char* _data) const
 {
-
-  if(_data == "a") {return m_a;}
-  if(_data == "b") {return m_b;}
-  if(_data == "c") {return m_c;}
-  if(_data == "d") {return m_d;}
-
+  return m_data[componentIndex(_data)];
 }
 
 //----------------------------------------------------------------------------------------------
@@ -145,10 +493,10 @@ const T Quaternion<T>::getData(const char* _data)
 template <typename T>
 Quaternion<T>& Quaternion<T>::operator =(const Quaternion<T>& _rhs)
 {
-  m_a=_rhs.m_a;
-  m_b=_rhs.m_b;
-  m_c=_rhs.m_c;
-  m_d=_rhs.m_d;
+  m_data[0]=_rhs.m_data[0];
+  m_data[1]=_rhs.m_data[1];
+  m_data[2]=_rhs.m_data[2];
+  m_data[3]=_rhs.m_data[3];
 
   return *this;
 }
@@ -159,7 +507,7 @@ Quaternion<T>& Quaternion<T>::operator =(const Quaternion<T>& _rhs)
 template <typename T>
 bool Quaternion<T>::operator ==(const Quaternion<T>& _rhs)
 {
-  if(m_a==_rhs.m_a && m_b==_rhs.m_b&& m_c==_rhs.m_c && m_d==_rhs.m_d)
+  if(m_data[0]==_rhs.m_data[0] && m_data[1]==_rhs.m_data[1]&& m_data[2]==_rhs.m_data[2] && m_data[3]==_rhs.m_data[3])
   {
     return true;
   }
@@ -176,10 +524,10 @@ bool Quaternion<T>::operator ==(const Quaternion<T>& _rhs)
 template <typename T>
 Quaternion<T>& Quaternion<T>::operator +(const Quaternion<T>& _rhs)
 {
-  m_a+=_rhs.m_a;
-  m_b+=_rhs.m_b;
-  m_c+=_rhs.m_c;
-  m_d+=_rhs.m_d;
+  m_data[0]+=_rhs.m_data[0];
+  m_data[1]+=_rhs.m_data[1];
+  m_data[2]+=_rhs.m_data[2];
+  m_data[3]+=_rhs.m_data[3];
 
   return *this;
 
@@ -191,10 +539,10 @@ Quaternion<T>& Quaternion<T>::operator +(const Quaternion<T>& _rhs)
 template <typename T>
 Quaternion<T>& Quaternion<T>::operator +(T _scalar)
 {
-  m_a+=_scalar;
-  m_b+=_scalar;
-  m_c+=_scalar;
-  m_d+=_scalar;
+  m_data[0]+=_scalar;
+  m_data[1]+=_scalar;
+  m_data[2]+=_scalar;
+  m_data[3]+=_scalar;
 
   return *this;
 
@@ -206,10 +554,10 @@ Quaternion<T>& Quaternion<T>::operator +(T _scalar)
 template <typename T>
 Quaternion<T>& Quaternion<T>::operator -(const Quaternion<T>& _rhs)
 {
-  m_a-=_rhs.m_a;
-  m_b-=_rhs.m_b;
-  m_c-=_rhs.m_c;
-  m_d-=_rhs.m_d;
+  m_data[0]-=_rhs.m_data[0];
+  m_data[1]-=_rhs.m_data[1];
+  m_data[2]-=_rhs.m_data[2];
+  m_data[3]-=_rhs.m_data[3];
 
   return *this;
 
@@ -221,10 +569,10 @@ Quaternion<T>& Quaternion<T>::operator -(const Quaternion<T>& _rhs)
 template <typename T>
 Quaternion<T>& Quaternion<T>::operator -(T _scalar)
 {
-  m_a-=_scalar;
-  m_b-=_scalar;
-  m_c-=_scalar;
-  m_d-=_scalar;
+  m_data[0]-=_scalar;
+  m_data[1]-=_scalar;
+  m_data[2]-=_scalar;
+  m_data[3]-=_scalar;
 
   return *this;
 
@@ -235,10 +583,10 @@ Quaternion<T>& Quaternion<T>::operator -(T _scalar)
 template <typename T>
 Quaternion<T>& Quaternion<T>::operator -()
 {
-  m_a=-m_a;
-  m_b=-m_b;
-  m_c=-m_c;
-  m_d=-m_d;
+  m_data[0]=-m_data[0];
+  m_data[1]=-m_data[1];
+  m_data[2]=-m_data[2];
+  m_data[3]=-m_data[3];
 
   return *this;
 
@@ -250,17 +598,7 @@ Quaternion<T>& Quaternion<T>::operator -()
 template <typename T>
 Quaternion<T>& Quaternion<T>::operator *(const Quaternion<T>& _rhs)
 {
-
-  T tmp[3];
-  tmp[0]=(_rhs.m_a*m_a)-(_rhs.m_b*m_b)-(_rhs.m_c*m_c)-(_rhs.m_d*m_d);
-  tmp[1]=(_rhs.m_a*m_b)+(_rhs.m_b*m_a)-(_rhs.m_c*m_d)+(_rhs.m_d*m_c);
-  tmp[2]=(_rhs.m_a*m_c)+(_rhs.m_b*m_d)+(_rhs.m_c*m_a)-(_rhs.m_d*m_b);
-  tmp[3]=(_rhs.m_a*m_d)-(_rhs.m_b*m_c)+(_rhs.m_c*m_b)+(_rhs.m_d*m_a);
-
-  m_a=tmp[0];
-  m_b=tmp[1];
-  m_c=tmp[2];
-  m_d=tmp[3];
+  quaternionMultiplyKernel(m_data,_rhs.m_data,m_data);
 
   return *this;
 
@@ -272,10 +610,10 @@ Quaternion<T>& Quaternion<T>::operator *(const Quaternion<T>& _rhs)
 template <typename T>
 Quaternion<T>& Quaternion<T>::operator *(T _scalar)
 {
-  m_a*=_scalar;
-  m_b*=_scalar;
-  m_c*=_scalar;
-  m_d*=_scalar;
+  m_data[0]*=_scalar;
+  m_data[1]*=_scalar;
+  m_data[2]*=_scalar;
+  m_data[3]*=_scalar;
 
   return *this;
 
@@ -319,10 +657,10 @@ Quaternion<T>& Quaternion<T>::operator /(T _scalar)
     throw std::out_of_range("Cannot divide by 0");
   }
 
-  m_a/=_scalar;
-  m_b/=_scalar;
-  m_c/=_scalar;
-  m_d/=_scalar;
+  m_data[0]/=_scalar;
+  m_data[1]/=_scalar;
+  m_data[2]/=_scalar;
+  m_data[3]/=_scalar;
 
   return *this;
 
@@ -333,74 +671,393 @@ Quaternion<T>& Quaternion<T>::operator /(T _scalar)
 template <typename T>
 void Quaternion<T>::print()
 {
-  std::cout<<m_a<<" + "<<m_b<<"i + "<<m_c<<"j + "<<m_d<<"k\n";
+  std::cout<<m_data[0]<<" + "<<m_data[1]<<"i + "<<m_data[2]<<"j + "<<m_data[3]<<"k\n";
 }
 
 //----------------------------------------------------------------------------------------------
 /// @brief Returns the norm of a quaternion (sometimes referred to as legnth)
 template <typename T>
-T Quaternion<T>::norm()
+T Quaternion<T>::norm() const
 {
-  T norm = sqrt((m_a*m_a)+(m_b*m_b)+(m_c*m_c)+(m_d*m_d));
+  return sqrt(quaternionDotKernel(m_data,m_data));
+}
 
-  return norm;
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the dot product of the two quaternions
+/// param[in] _rhs, the other quaternion
+template <typename T>
+T Quaternion<T>::dot(const Quaternion<T>& _rhs) const
+{
+  return quaternionDotKernel(m_data,_rhs.m_data);
 }
 
 //----------------------------------------------------------------------------------------------
-/// Returns the normalized version of the quaternion
+/// Returns the normalized version of the quaternion, a zero quaternion is left as it is
 template <typename T>
 Quaternion<T>& Quaternion<T>::normalize()
+{
+  quaternionNormalizeKernel(m_data);
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// Normalizes the quaternion without a square root or divide where the type has a fast path, for renormalizing
+/// quaternions that are already close to unit length
+template <typename T>
+Quaternion<T>& Quaternion<T>::normalizeFast()
+{
+  quaternionNormalizeFastKernel(m_data);
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the conjugate of the quaternion
+template <typename T>
+Quaternion<T>& Quaternion<T>::conjugate()
+{
+  quaternionConjugateKernel(m_data);
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the inverse of the quaternion, the norm is only worked out once
+template <typename T>
+Quaternion<T>& Quaternion<T>::inverse()
 {
   // if norm is 0 quaternion must be 0,0,0,0 hence just return the original quaternion
-  if(norm()==0)
+  quaternionInverseKernel(m_data);
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Rotates a vector by a unit quaternion without building q*v*q^-1, with u = (b,c,d) and t = 2(u x v)
+/// the result is v + a*t + u x t, 15 multiplies (the doubling is an add) instead of the 32 of two products
+/// param[in] _v, the vector to rotate, not changed
+template <typename T>
+Matrix<T,3,1> Quaternion<T>::rotate(const Matrix<T,3,1>& _v) const
+{
+  const T* v = _v.data();
+
+  T tx = (m_data[2]*v[2])-(m_data[3]*v[1]);
+  T ty = (m_data[3]*v[0])-(m_data[1]*v[2]);
+  T tz = (m_data[1]*v[1])-(m_data[2]*v[0]);
+  tx+=tx;
+  ty+=ty;
+  tz+=tz;
+
+  Matrix<T,3,1> result;
+  T* r = result.data();
+  r[0] = v[0]+(m_data[0]*tx)+(m_data[2]*tz)-(m_data[3]*ty);
+  r[1] = v[1]+(m_data[0]*ty)+(m_data[3]*tx)-(m_data[1]*tz);
+  r[2] = v[2]+(m_data[0]*tz)+(m_data[1]*ty)-(m_data[2]*tx);
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Writes the rotation matrix of the quaternion, using s = 2/|q|^2 so it doesn't need to be normalized
+/// param[in] _out, the first element of the matrix to write
+/// param[in] _stride, the number of elements between rows
+template <typename T>
+void Quaternion<T>::rotationMatrix(T* _out, std::size_t _stride) const
+{
+  T normSqr = (m_data[0]*m_data[0])+(m_data[1]*m_data[1])+(m_data[2]*m_data[2])+(m_data[3]*m_data[3]);
+  // a zero quaternion gives the identity rather than NaNs
+  T s = normSqr > T(0) ? T(2)/normSqr : T(0);
+
+  T bs = m_data[1]*s;
+  T cs = m_data[2]*s;
+  T ds = m_data[3]*s;
+  T ab = m_data[0]*bs, ac = m_data[0]*cs, ad = m_data[0]*ds;
+  T bb = m_data[1]*bs, bc = m_data[1]*cs, bd = m_data[1]*ds;
+  T cc = m_data[2]*cs, cd = m_data[2]*ds, dd = m_data[3]*ds;
+
+  T* r0 = _out;
+  T* r1 = _out + _stride;
+  T* r2 = _out + 2*_stride;
+  r0[0] = T(1)-(cc+dd); r0[1] = bc-ad;         r0[2] = bd+ac;
+  r1[0] = bc+ad;         r1[1] = T(1)-(bb+dd); r1[2] = cd-ab;
+  r2[0] = bd-ac;         r2[1] = cd+ab;         r2[2] = T(1)-(bb+cc);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the 3x3 rotation matrix of the quaternion
+template <typename T>
+Matrix<T,3,3> Quaternion<T>::toMatrix3() const
+{
+  Matrix<T,3,3> mat;
+  rotationMatrix(mat.data(),3);
+
+  return mat;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the 4x4 homogeneous rotation matrix of the quaternion
+template <typename T>
+Matrix<T,4,4> Quaternion<T>::toMatrix4() const
+{
+  Matrix<T,4,4> mat;
+  rotationMatrix(mat.data(),4);
+  mat.data()[15] = T(1);
+
+  return mat;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Shepperd's method, builds the quaternion from whichever of 4a^2, 4b^2, 4c^2 or 4d^2 is largest so the
+/// square root is never of a small number. The largest is picked with two comparisons instead of finding the
+/// largest diagonal term, any choice whose t is at least 1 is accurate.
+/// param[in] _in, the first element of the rotation matrix
+/// param[in] _stride, the number of elements between rows
+template <typename T>
+Quaternion<T> Quaternion<T>::fromRotation(const T* _in, std::size_t _stride)
+{
+  const T* r0 = _in;
+  const T* r1 = _in + _stride;
+  const T* r2 = _in + 2*_stride;
+
+  T t;
+  Quaternion<T> q;
+  if(r2[2] < T(0))
   {
-    return *this;
+    if(r0[0] > r1[1])
+    {
+      t = T(1)+r0[0]-r1[1]-r2[2];
+      q = Quaternion<T>(r2[1]-r1[2], t, r0[1]+r1[0], r0[2]+r2[0]);
+    }
+    else
+    {
+      t = T(1)-r0[0]+r1[1]-r2[2];
+      q = Quaternion<T>(r0[2]-r2[0], r0[1]+r1[0], t, r1[2]+r2[1]);
+    }
   }
   else
   {
-    T n =norm();
+    if(r0[0] < -r1[1])
+    {
+      t = T(1)-r0[0]-r1[1]+r2[2];
+      q = Quaternion<T>(r1[0]-r0[1], r0[2]+r2[0], r1[2]+r2[1], t);
+    }
+    else
+    {
+      t = T(1)+r0[0]+r1[1]+r2[2];
+      q = Quaternion<T>(t, r2[1]-r1[2], r0[2]-r2[0], r1[0]-r0[1]);
+    }
+  }
+
+  // keep a >= 0 so the same rotation always gives the same quaternion
+  T scale = T(0.5)/sqrt(t);
+  if(q.m_data[0] < T(0))
+  {
+    scale = -scale;
+  }
+
+  q.m_data[0]*=scale;
+  q.m_data[1]*=scale;
+  q.m_data[2]*=scale;
+  q.m_data[3]*=scale;
+
+  return q;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the unit quaternion of a 3x3 rotation matrix
+/// param[in] _mat, the rotation matrix, for column vectors as toMatrix3
+template <typename T>
+Quaternion<T> Quaternion<T>::fromMatrix(const Matrix<T,3,3>& _mat)
+{
+  return fromRotation(_mat.data(),3);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the unit quaternion of the rotation part of a 4x4 homogeneous matrix
+/// param[in] _mat, the homogeneous matrix, translation is ignored
+template <typename T>
+Quaternion<T> Quaternion<T>::fromMatrix(const Matrix<T,4,4>& _mat)
+{
+  return fromRotation(_mat.data(),4);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns _w0*_q0 + _w1*_q1 without changing either
+template <typename T>
+Quaternion<T> Quaternion<T>::weightedSum(T _w0, const Quaternion<T>& _q0, T _w1, const Quaternion<T>& _q1)
+{
+  Quaternion<T> q;
+  for(std::size_t i = 0; i < 4; ++i)
+  {
+    q.m_data[i] = (_w0*_q0.m_data[i])+(_w1*_q1.m_data[i]);
+  }
 
-    m_a=m_a/n;
-    m_b=m_b/n;
-    m_c=m_c/n;
-    m_d=m_d/n;
+  return q;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Spherical linear interpolation, sin((1-t)θ)/sinθ * q0 + sin(tθ)/sinθ * q1 where cosθ = |q0.q1|.
+/// q1 is negated when the dot product is negative (q1 and -q1 are the same rotation) by taking the sign of the
+/// dot product with copysign rather than a branch. Nearly equal quaternions use nlerp, where sinθ is too small
+/// to divide by and the two agree.
+/// param[in] _q0, the start, normalized
+/// param[in] _q1, the end, normalized
+/// param[in] _t, how far from _q0 to _q1
+template <typename T>
+Quaternion<T> Quaternion<T>::slerp(const Quaternion<T>& _q0, const Quaternion<T>& _q1, T _t)
+{
+  T cosTheta = _q0.dot(_q1);
+  T sign = std::copysign(T(1),cosTheta);
+  cosTheta = std::fabs(cosTheta);
 
-    return *this;
+  if(cosTheta > T(0.9995))
+  {
+    return weightedSum(T(1)-_t,_q0,sign*_t,_q1).normalize();
   }
+
+  T theta = std::acos(cosTheta);
+  T sinTheta = std::sqrt(T(1)-cosTheta*cosTheta);
+  T w0 = std::sin((T(1)-_t)*theta)/sinTheta;
+  T w1 = sign*std::sin(_t*theta)/sinTheta;
+
+  return weightedSum(w0,_q0,w1,_q1);
 }
 
 //----------------------------------------------------------------------------------------------
-/// @brief Returns the conjugate of the quaternion
+/// @brief Normalized linear interpolation along the shorter arc
+/// param[in] _q0, the start, normalized
+/// param[in] _q1, the end, normalized
+/// param[in] _t, how far from _q0 to _q1
 template <typename T>
-Quaternion<T>& Quaternion<T>::conjugate()
+Quaternion<T> Quaternion<T>::nlerp(const Quaternion<T>& _q0, const Quaternion<T>& _q1, T _t)
 {
-  if(m_b!=0) {m_b= -m_b;}
-  if(m_c!=0) {m_c= -m_c;}
-  if(m_d!=0) {m_d= -m_d;}
+  T sign = std::copysign(T(1),_q0.dot(_q1));
 
-  return *this;
+  return weightedSum(T(1)-_t,_q0,sign*_t,_q1).normalize();
 }
 
 //----------------------------------------------------------------------------------------------
-/// @brief Returns the inverse of the quaternion
+/// @brief Fast approximate slerp, nlerp with t' = t + t(t-0.5)(t-1)k. nlerp moves too slowly near the ends and
+/// too fast in the middle by an amount that depends on the angle, k fits that from d = |q0.q1| with
+/// k = A(d)(t-0.5)^2 + B(d) (polynomials fitted by A. Kapoulkine), which corrects the speed instead of only
+/// renormalizing. The error stays around 1e-3 radians or less for any angle.
+/// param[in] _q0, the start, normalized
+/// param[in] _q1, the end, normalized
+/// param[in] _t, how far from _q0 to _q1
 template <typename T>
-Quaternion<T>& Quaternion<T>::inverse()
+Quaternion<T> Quaternion<T>::slerpFast(const Quaternion<T>& _q0, const Quaternion<T>& _q1, T _t)
 {
-  // if norm is 0 quaternion must be 0,0,0,0 hence just return the original quaternion
-  if(norm()==0)
+  T cosTheta = _q0.dot(_q1);
+  T sign = std::copysign(T(1),cosTheta);
+  T d = std::fabs(cosTheta);
+
+  T a = T(1.0904)+d*(T(-3.2452)+d*(T(3.55645)-d*T(1.43519)));
+  T b = T(0.848013)+d*(T(-1.06021)+d*T(0.215638));
+  T centred = _t-T(0.5);
+  T k = a*centred*centred+b;
+  T t = _t+_t*centred*(_t-T(1))*k;
+
+  return weightedSum(T(1)-t,_q0,sign*t,_q1).normalize();
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Quaternion exponential, with θ = |v| it is exp(a)*(cosθ, sin(θ)/θ * v)
+/// param[in] _q, any quaternion
+template <typename T>
+Quaternion<T> Quaternion<T>::exp(const Quaternion<T>& _q)
+{
+  const T* q = _q.m_data;
+  T theta = std::sqrt((q[1]*q[1])+(q[2]*q[2])+(q[3]*q[3]));
+  T scale = std::exp(q[0]);
+  // sin(θ)/θ is exact in floating point all the way down to the smallest θ, only 0 needs the limit
+  T sinc = theta > T(0) ? std::sin(theta)/theta : T(1);
+
+  return Quaternion<T>(scale*std::cos(theta),scale*sinc*q[1],scale*sinc*q[2],scale*sinc*q[3]);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Principal logarithm, (ln|q|, atan2(|v|,a)/|v| * v). atan2 keeps the angle accurate near 0 and π where
+/// acos(a/|q|) loses digits. A negative real quaternion has no unique log, it gets the angle π about b.
+/// param[in] _q, a non zero quaternion, the log of zero has -inf as its real part
+template <typename T>
+Quaternion<T> Quaternion<T>::log(const Quaternion<T>& _q)
+{
+  const T* q = _q.m_data;
+  T vectorNorm = std::sqrt((q[1]*q[1])+(q[2]*q[2])+(q[3]*q[3]));
+  T real = std::log(_q.norm());
+
+  if(vectorNorm == T(0))
   {
-    return *this;
+    return Quaternion<T>(real,q[0] < T(0) ? T(M_PI) : T(0),T(0),T(0));
   }
 
-  T normSqr= norm()*norm();
+  T scale = std::atan2(vectorNorm,q[0])/vectorNorm;
 
-  m_a=m_a/normSqr;
-  if(m_b!=0) {m_b= -m_b/normSqr;}
-  if(m_c!=0) {m_c= -m_c/normSqr;}
-  if(m_d!=0) {m_d= -m_d/normSqr;}
+  return Quaternion<T>(real,scale*q[1],scale*q[2],scale*q[3]);
+}
 
+//----------------------------------------------------------------------------------------------
+/// @brief Power of a quaternion, exp(_t*log(_q)), zero to any power is zero
+/// param[in] _q, the quaternion
+/// param[in] _t, the power, for a unit quaternion the fraction of its rotation
+template <typename T>
+Quaternion<T> Quaternion<T>::pow(const Quaternion<T>& _q, T _t)
+{
+  if(_q.norm() == T(0))
+  {
+    return Quaternion<T>();
+  }
 
-  return *this;
+  Quaternion<T> l = log(_q);
+
+  return exp(l*_t);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns (cos(θ/2), sin(θ/2)*axis/|axis|), a zero axis gives the identity
+/// param[in] _axis, the axis to rotate about
+/// param[in] _angle, the angle in radians, anticlockwise looking down the axis
+template <typename T>
+Quaternion<T> Quaternion<T>::fromAxisAngle(const Matrix<T,3,1>& _axis, T _angle)
+{
+  const T* axis = _axis.data();
+  T length = std::sqrt((axis[0]*axis[0])+(axis[1]*axis[1])+(axis[2]*axis[2]));
+
+  if(length == T(0))
+  {
+    return Quaternion<T>(T(1),T(0),T(0),T(0));
+  }
+
+  T s = std::sin(_angle/T(2))/length;
+
+  return Quaternion<T>(std::cos(_angle/T(2)),s*axis[0],s*axis[1],s*axis[2]);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Writes the axis and angle of the rotation, the angle is 2*atan2(|v|,a) so the scale of the quaternion
+/// cancels, and -q gives the same rotation the other way round the axis (2π - θ). No rotation gives the b axis.
+/// param[in] _axis, overwritten with the unit axis
+/// param[in] _angle, overwritten with the angle in radians
+template <typename T>
+void Quaternion<T>::toAxisAngle(Matrix<T,3,1>& _axis, T& _angle) const
+{
+  T* axis = _axis.data();
+  T vectorNorm = std::sqrt((m_data[1]*m_data[1])+(m_data[2]*m_data[2])+(m_data[3]*m_data[3]));
+
+  _angle = T(2)*std::atan2(vectorNorm,m_data[0]);
+
+  if(vectorNorm == T(0))
+  {
+    axis[0] = T(1);
+    axis[1] = T(0);
+    axis[2] = T(0);
+    return;
+  }
+
+  axis[0] = m_data[1]/vectorNorm;
+  axis[1] = m_data[2]/vectorNorm;
+  axis[2] = m_data[3]/vectorNorm;
 }
 
 //----------------------------------------------------------------------------------------------
@@ -0,0 +1,391 @@
+#ifndef QUATERNIONARRAY_H
+#define QUATERNIONARRAY_H
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <algorithm>
+#include "quaternionBatch.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Structure of arrays storage for many float quaternions. Where a std::vector<Quaternion<float> > keeps (a,b,c,d)
+/// together, a QuaternionArray keeps all the a values in one array, then all the b values and so on, so the
+/// element wise operations load SimdFloat::width (16 with AVX-512, 8 with AVX) of each component straight into a
+/// register with no shuffles. Each component array is 64 byte aligned and padded with identity quaternions up to
+/// a multiple of MYLIB_QUATERNION_ARRAY_PAD, so the kernels never need a scalar tail.
+/// fromAoS/toAoS convert to and from ordinary arrays of Quaternion<float> with the register transposes.
+/// Large arrays are split across threads with parallelFor.
+///   QuaternionArray local(joints.size(),joints.data());
+///   multiply(parents,local,world);
+///   world.normalize();
+///   world.toAoS(out.data());
+
+// the component arrays are padded to a multiple of this many elements, the widest SimdFloat
+#ifndef MYLIB_QUATERNION_ARRAY_PAD
+#define MYLIB_QUATERNION_ARRAY_PAD 16
+#endif
+
+//----------------------------------------------------------------------------------------------
+/// \class QuaternionArray
+/// \brief Float quaternions stored as four aligned, padded component arrays
+class QuaternionArray
+{
+private:
+
+    std::size_t m_size;
+    // elements in each component array including the padding
+    std::size_t m_stride;
+    // the four component arrays one after another, m_stride floats each
+    float* m_data;
+
+    // allocates the padded storage for _n quaternions, every element an identity
+    void allocate(std::size_t _n);
+
+public:
+
+    // empty array
+    QuaternionArray() : m_size(0), m_stride(0), m_data(nullptr) {}
+    // _n identity quaternions
+    explicit QuaternionArray(std::size_t _n) : m_size(0), m_stride(0), m_data(nullptr) { allocate(_n); }
+    // _n quaternions copied from an ordinary array
+    QuaternionArray(std::size_t _n, const Quaternion<float>* _q);
+
+    QuaternionArray(const QuaternionArray& _rhs);
+    QuaternionArray(QuaternionArray&& _rhs);
+    QuaternionArray& operator=(QuaternionArray _rhs);
+    ~QuaternionArray() { std::free(m_data); }
+
+    // number of quaternions
+    std::size_t size() const { return m_size; }
+    // number of elements in each component array, a multiple of MYLIB_QUATERNION_ARRAY_PAD
+    std::size_t paddedSize() const { return m_stride; }
+
+    // component arrays, eg a()[i] is the scalar part of quaternion i
+    float* a() { return m_data; }
+    float* b() { return m_data + m_stride; }
+    float* c() { return m_data + 2*m_stride; }
+    float* d() { return m_data + 3*m_stride; }
+    const float* a() const { return m_data; }
+    const float* b() const { return m_data + m_stride; }
+    const float* c() const { return m_data + 2*m_stride; }
+    const float* d() const { return m_data + 3*m_stride; }
+
+    // one quaternion, out of range throws
+    Quaternion<float> get(std::size_t _i) const;
+    void set(std::size_t _i, const Quaternion<float>& _q);
+
+    // replaces the contents with _n quaternions from an ordinary array
+    void fromAoS(std::size_t _n, const Quaternion<float>* _q);
+    // writes the size() quaternions to an ordinary array
+    void toAoS(Quaternion<float>* _q) const;
+
+    // element wise, this[i] = this[i]*_rhs[i]
+    QuaternionArray& multiply(const QuaternionArray& _rhs);
+    QuaternionArray& conjugate();
+    // zero quaternions stay zero
+    QuaternionArray& inverse();
+    // reciprocal square root estimate and a Newton step, zero quaternions stay zero
+    QuaternionArray& normalize();
+    // _out[i] = this[i].dot(_rhs[i]) for size() elements
+    void dot(const QuaternionArray& _rhs, float* _out) const;
+
+    void swap(QuaternionArray& _rhs);
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Allocates 64 byte aligned storage for _n quaternions padded to MYLIB_QUATERNION_ARRAY_PAD, all identities
+/// param[in] _n, the number of quaternions
+inline void QuaternionArray::allocate(std::size_t _n)
+{
+  std::size_t stride = (_n + MYLIB_QUATERNION_ARRAY_PAD - 1) / MYLIB_QUATERNION_ARRAY_PAD * MYLIB_QUATERNION_ARRAY_PAD;
+  float* data = nullptr;
+  if(stride > 0)
+  {
+    void* memory = nullptr;
+    if(posix_memalign(&memory,64,4*stride*sizeof(float)) != 0)
+    {
+      throw std::bad_alloc();
+    }
+    data = static_cast<float*>(memory);
+    std::fill(data,data + stride,1.0f);
+    std::fill(data + stride,data + 4*stride,0.0f);
+  }
+
+  std::free(m_data);
+  m_data = data;
+  m_size = _n;
+  m_stride = stride;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Copies _n quaternions from an ordinary array
+inline QuaternionArray::QuaternionArray(std::size_t _n, const Quaternion<float>* _q) :
+  m_size(0),
+  m_stride(0),
+  m_data(nullptr)
+{
+  fromAoS(_n,_q);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Copy constructor, copies the padding too
+inline QuaternionArray::QuaternionArray(const QuaternionArray& _rhs) :
+  m_size(0),
+  m_stride(0),
+  m_data(nullptr)
+{
+  allocate(_rhs.m_size);
+  std::copy(_rhs.m_data,_rhs.m_data + 4*m_stride,m_data);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Move constructor, _rhs is left empty
+inline QuaternionArray::QuaternionArray(QuaternionArray&& _rhs) :
+  m_size(_rhs.m_size),
+  m_stride(_rhs.m_stride),
+  m_data(_rhs.m_data)
+{
+  _rhs.m_size = 0;
+  _rhs.m_stride = 0;
+  _rhs.m_data = nullptr;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Assignment, copy and swap
+inline QuaternionArray& QuaternionArray::operator=(QuaternionArray _rhs)
+{
+  swap(_rhs);
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Swaps the storage of two arrays
+inline void QuaternionArray::swap(QuaternionArray& _rhs)
+{
+  std::swap(m_size,_rhs.m_size);
+  std::swap(m_stride,_rhs.m_stride);
+  std::swap(m_data,_rhs.m_data);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns quaternion _i
+/// param[in] _i, the index, must be less than size()
+inline Quaternion<float> QuaternionArray::get(std::size_t _i) const
+{
+  if(_i >= m_size)
+  {
+    throw std::out_of_range("Quaternion index out of range");
+  }
+
+  return Quaternion<float>(a()[_i],b()[_i],c()[_i],d()[_i]);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Sets quaternion _i
+/// param[in] _i, the index, must be less than size()
+/// param[in] _q, the new value
+inline void QuaternionArray::set(std::size_t _i, const Quaternion<float>& _q)
+{
+  if(_i >= m_size)
+  {
+    throw std::out_of_range("Quaternion index out of range");
+  }
+
+  a()[_i] = _q.a();
+  b()[_i] = _q.b();
+  c()[_i] = _q.c();
+  d()[_i] = _q.d();
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Replaces the contents with _n quaternions, transposed width at a time
+/// param[in] _n, the number of quaternions
+/// param[in] _q, the quaternions in the usual (a,b,c,d) layout
+inline void QuaternionArray::fromAoS(std::size_t _n, const Quaternion<float>* _q)
+{
+  typedef SimdFloat S;
+  if(_n != m_size)
+  {
+    allocate(_n);
+  }
+
+  parallelFor(0, m_stride / S::width, MYLIB_PARALLEL_MIN_ELEMENTS / (4*S::width) + 1,
+              [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t block = _first; block < _last; ++block)
+    {
+      std::size_t i = block*S::width;
+      std::size_t lanes = i < _n ? std::min<std::size_t>(S::width,_n-i) : 0;
+
+      // blocks that are all padding become identities
+      S::reg qa, qb, qc, qd;
+      loadQuaternionLanes(lanes > 0 ? _q + i : _q,lanes,qa,qb,qc,qd);
+      S::store(a() + i,qa);
+      S::store(b() + i,qb);
+      S::store(c() + i,qc);
+      S::store(d() + i,qd);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Writes every quaternion to an ordinary array, transposed width at a time
+/// param[in] _q, size() quaternions that are overwritten
+inline void QuaternionArray::toAoS(Quaternion<float>* _q) const
+{
+  typedef SimdFloat S;
+
+  parallelFor(0, (m_size + S::width - 1) / S::width, MYLIB_PARALLEL_MIN_ELEMENTS / (4*S::width) + 1,
+              [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t block = _first; block < _last; ++block)
+    {
+      std::size_t i = block*S::width;
+      storeQuaternionLanes(_q + i,std::min<std::size_t>(S::width,m_size-i),
+                           S::load(a() + i),S::load(b() + i),S::load(c() + i),S::load(d() + i));
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Runs _func(i) on the start of every width block of an array with _padded elements, across threads for
+/// large arrays
+template <typename FUNC>
+void forEachLaneBlock(std::size_t _padded, FUNC _func)
+{
+  parallelFor(0, _padded / SimdFloat::width, MYLIB_PARALLEL_MIN_ELEMENTS / (4*SimdFloat::width) + 1,
+              [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t block = _first; block < _last; ++block)
+    {
+      _func(block*SimdFloat::width);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief _out[i] = _l[i]*_r[i], _out is resized to match and can be _l or _r
+/// param[in] _l, the left quaternions
+/// param[in] _r, the right quaternions, the same size as _l
+/// param[in] _out, the products
+inline void multiply(const QuaternionArray& _l, const QuaternionArray& _r, QuaternionArray& _out)
+{
+  typedef SimdFloat S;
+  if(_l.size() != _r.size())
+  {
+    throw std::out_of_range("Quaternion arrays are different sizes");
+  }
+  if(_out.size() != _l.size())
+  {
+    _out = QuaternionArray(_l.size());
+  }
+
+  forEachLaneBlock(_l.paddedSize(),[&](std::size_t _i)
+  {
+    S::reg l[4] = {S::load(_l.a() + _i),S::load(_l.b() + _i),S::load(_l.c() + _i),S::load(_l.d() + _i)};
+    S::reg r[4] = {S::load(_r.a() + _i),S::load(_r.b() + _i),S::load(_r.c() + _i),S::load(_r.d() + _i)};
+    S::reg out[4];
+    multiplyLanes(l,r,out);
+    S::store(_out.a() + _i,out[0]);
+    S::store(_out.b() + _i,out[1]);
+    S::store(_out.c() + _i,out[2]);
+    S::store(_out.d() + _i,out[3]);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief this[i] = this[i]*_rhs[i]
+/// param[in] _rhs, the right quaternions, the same size
+inline QuaternionArray& QuaternionArray::multiply(const QuaternionArray& _rhs)
+{
+  ::multiply(*this,_rhs,*this);
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Negates the b, c and d arrays
+inline QuaternionArray& QuaternionArray::conjugate()
+{
+  typedef SimdFloat S;
+
+  forEachLaneBlock(m_stride,[&](std::size_t _i)
+  {
+    S::reg minusOne = S::set1(-1.0f);
+    S::store(b() + _i,S::mul(S::load(b() + _i),minusOne));
+    S::store(c() + _i,S::mul(S::load(c() + _i),minusOne));
+    S::store(d() + _i,S::mul(S::load(d() + _i),minusOne));
+  });
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Replaces every quaternion with its inverse, the conjugate divided by |q|^2
+inline QuaternionArray& QuaternionArray::inverse()
+{
+  typedef SimdFloat S;
+
+  forEachLaneBlock(m_stride,[&](std::size_t _i)
+  {
+    S::reg q[4] = {S::load(a() + _i),S::load(b() + _i),S::load(c() + _i),S::load(d() + _i)};
+    S::reg normSqr = dotLanes(q,q);
+    S::reg scale = S::select(S::gt(normSqr,S::zero()),S::div(S::set1(1.0f),normSqr),S::zero());
+    S::reg negative = S::sub(S::zero(),scale);
+
+    S::store(a() + _i,S::mul(q[0],scale));
+    S::store(b() + _i,S::mul(q[1],negative));
+    S::store(c() + _i,S::mul(q[2],negative));
+    S::store(d() + _i,S::mul(q[3],negative));
+  });
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Normalizes every quaternion
+inline QuaternionArray& QuaternionArray::normalize()
+{
+  typedef SimdFloat S;
+
+  forEachLaneBlock(m_stride,[&](std::size_t _i)
+  {
+    S::reg qa = S::load(a() + _i), qb = S::load(b() + _i), qc = S::load(c() + _i), qd = S::load(d() + _i);
+    normalizeLanes(qa,qb,qc,qd);
+    S::store(a() + _i,qa);
+    S::store(b() + _i,qb);
+    S::store(c() + _i,qc);
+    S::store(d() + _i,qd);
+  });
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Writes the dot product of each pair
+/// param[in] _rhs, the other quaternions, the same size
+/// param[in] _out, size() floats that are overwritten
+inline void QuaternionArray::dot(const QuaternionArray& _rhs, float* _out) const
+{
+  typedef SimdFloat S;
+  if(_rhs.m_size != m_size)
+  {
+    throw std::out_of_range("Quaternion arrays are different sizes");
+  }
+
+  forEachLaneBlock(m_stride,[&](std::size_t _i)
+  {
+    S::reg l[4] = {S::load(a() + _i),S::load(b() + _i),S::load(c() + _i),S::load(d() + _i)};
+    S::reg r[4] = {S::load(_rhs.a() + _i),S::load(_rhs.b() + _i),S::load(_rhs.c() + _i),S::load(_rhs.d() + _i)};
+
+    // the padding isn't written to _out
+    float lanes[S::width];
+    S::store(lanes,dotLanes(l,r));
+    std::size_t count = _i < m_size ? std::min<std::size_t>(S::width,m_size-_i) : 0;
+    std::copy(lanes,lanes + count,_out + std::min(_i,m_size));
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // QUATERNIONARRAY_H
@@ -0,0 +1,824 @@
+#ifndef QUATERNIONBATCH_H
+#define QUATERNIONBATCH_H
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include "matrix.h"
+#include "parallel.h"
+#include "simdFloat.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Batched conversions between arrays of quaternions and rotation matrices, eg every joint of a skeleton each frame.
+/// The generic versions call Quaternion::toMatrix3/toMatrix4/fromMatrix on each element. The float versions load
+/// SimdFloat::width quaternions at a time, transpose them to one register per component and work out every lane
+/// together, fromMatrices picks Shepperd's case with selects instead of branches so lanes with different cases
+/// don't slow it down. Results are the same as the scalar functions to within rounding.
+/// rotateVectors rotates an array of Matrix<T,3,1> by one quaternion or by one quaternion each, the float versions
+/// gather width vectors into one register per coordinate and use the same cross product form as Quaternion::rotate.
+/// nlerpBatch, slerpFastBatch and slerpBatch interpolate arrays of quaternion pairs with a t each, eg blending two
+/// animation poses. The float versions use the same branch free lanes, the shorter arc is taken by flipping the
+/// sign of the weight with the sign of the dot product. slerpBatch uses D. Eberly's polynomial form of the slerp
+/// weights, which needs no acos, sin or divide and is within 1e-6 of the exact weights for every angle.
+/// integrateOrientations steps an array of orientations by their angular velocities with the exponential map,
+/// the float version works out cos and sin of the half angles with short series so it needs no trig calls.
+/// Large batches are split across threads with parallelFor.
+
+// the kernels read arrays of quaternions through the first one's data() as 4 floats each
+static_assert(sizeof(Quaternion<float>) == 4*sizeof(float), "the batched kernels read Quaternion<float> as 4 floats");
+
+//----------------------------------------------------------------------------------------------
+/// @brief Loads _lanes (at most width) quaternions into one register per component, missing lanes are identities
+inline void loadQuaternionLanes(const Quaternion<float>* _q, std::size_t _lanes, SimdFloat::reg& _a,
+                                SimdFloat::reg& _b, SimdFloat::reg& _c, SimdFloat::reg& _d)
+{
+  typedef SimdFloat S;
+  const float* q = _q->data();
+
+  if(_lanes == S::width)
+  {
+    S::loadQuaternions(q,_a,_b,_c,_d);
+    return;
+  }
+
+  float pad[4*S::width] = {};
+  std::copy(q,q + 4*_lanes,pad);
+  for(std::size_t l = _lanes; l < S::width; ++l)
+  {
+    pad[4*l] = 1.0f;
+  }
+  S::loadQuaternions(pad,_a,_b,_c,_d);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Stores the first _lanes quaternions of one register per component
+inline void storeQuaternionLanes(Quaternion<float>* _q, std::size_t _lanes, SimdFloat::reg _a, SimdFloat::reg _b,
+                                 SimdFloat::reg _c, SimdFloat::reg _d)
+{
+  typedef SimdFloat S;
+  float* q = _q->data();
+
+  if(_lanes == S::width)
+  {
+    S::storeQuaternions(q,_a,_b,_c,_d);
+    return;
+  }
+
+  float pad[4*S::width];
+  S::storeQuaternions(pad,_a,_b,_c,_d);
+  std::copy(pad,pad + 4*_lanes,q);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Loads _lanes (at most width) floats, missing lanes are zero
+inline SimdFloat::reg loadLanes(const float* _p, std::size_t _lanes)
+{
+  if(_lanes == SimdFloat::width)
+  {
+    return SimdFloat::load(_p);
+  }
+
+  float pad[SimdFloat::width] = {};
+  std::copy(_p,_p + _lanes,pad);
+  return SimdFloat::load(pad);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Rotation matrices of width quaternions in SoA form, _m[r*3+c] is element (r,c) of every lane
+inline void rotationMatrixLanes(SimdFloat::reg _a, SimdFloat::reg _b, SimdFloat::reg _c, SimdFloat::reg _d,
+                                SimdFloat::reg* _m)
+{
+  typedef SimdFloat S;
+
+  S::reg normSqr = S::madd(_a,_a,S::madd(_b,_b,S::madd(_c,_c,S::mul(_d,_d))));
+  // zero quaternions give the identity as the scalar version
+  S::reg s = S::select(S::gt(normSqr,S::zero()),S::div(S::set1(2.0f),normSqr),S::zero());
+
+  S::reg bs = S::mul(_b,s);
+  S::reg cs = S::mul(_c,s);
+  S::reg ds = S::mul(_d,s);
+  S::reg ab = S::mul(_a,bs), ac = S::mul(_a,cs), ad = S::mul(_a,ds);
+  S::reg bb = S::mul(_b,bs), bc = S::mul(_b,cs), bd = S::mul(_b,ds);
+  S::reg cc = S::mul(_c,cs), cd = S::mul(_c,ds), dd = S::mul(_d,ds);
+  S::reg one = S::set1(1.0f);
+
+  _m[0] = S::sub(one,S::add(cc,dd)); _m[1] = S::sub(bc,ad);             _m[2] = S::add(bd,ac);
+  _m[3] = S::add(bc,ad);             _m[4] = S::sub(one,S::add(bb,dd)); _m[5] = S::sub(cd,ab);
+  _m[6] = S::sub(bd,ac);             _m[7] = S::add(cd,ab);             _m[8] = S::sub(one,S::add(bb,cc));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Shepperd's method on width rotation matrices in SoA form, the case is picked per lane with selects
+/// param[in] _m, _m[r*3+c] is element (r,c) of every lane
+inline void quaternionLanes(const SimdFloat::reg* _m, SimdFloat::reg& _a, SimdFloat::reg& _b, SimdFloat::reg& _c,
+                            SimdFloat::reg& _d)
+{
+  typedef SimdFloat S;
+
+  S::reg one = S::set1(1.0f);
+  S::reg d21 = S::sub(_m[7],_m[5]);
+  S::reg d02 = S::sub(_m[2],_m[6]);
+  S::reg d10 = S::sub(_m[3],_m[1]);
+  S::reg s01 = S::add(_m[1],_m[3]);
+  S::reg s02 = S::add(_m[2],_m[6]);
+  S::reg s12 = S::add(_m[5],_m[7]);
+
+  // the same two comparisons as Quaternion::fromRotation
+  S::mask neg22 = S::lt(_m[8],S::zero());
+  S::mask bOverC = S::gt(_m[0],_m[4]);
+  S::mask dOverA = S::lt(_m[0],S::sub(S::zero(),_m[4]));
+
+  S::reg tA = S::add(one,S::add(_m[0],S::add(_m[4],_m[8])));
+  S::reg tB = S::add(one,S::sub(_m[0],S::add(_m[4],_m[8])));
+  S::reg tC = S::add(one,S::sub(_m[4],S::add(_m[0],_m[8])));
+  S::reg tD = S::add(one,S::sub(_m[8],S::add(_m[0],_m[4])));
+
+  S::reg t = S::select(neg22,S::select(bOverC,tB,tC),S::select(dOverA,tD,tA));
+  S::reg a = S::select(neg22,S::select(bOverC,d21,d02),S::select(dOverA,d10,t));
+  S::reg b = S::select(neg22,S::select(bOverC,t,s01),S::select(dOverA,s02,d21));
+  S::reg c = S::select(neg22,S::select(bOverC,s01,t),S::select(dOverA,s12,d02));
+  S::reg d = S::select(neg22,S::select(bOverC,s02,s12),S::select(dOverA,t,d10));
+
+  // 0.5/sqrt(t) with the sign of a so a >= 0
+  S::reg scale = S::flipSign(S::div(S::set1(0.5f),S::sqrt(t)),a);
+  _a = S::mul(a,scale);
+  _b = S::mul(b,scale);
+  _c = S::mul(c,scale);
+  _d = S::mul(d,scale);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Writes lane _lane of the SoA rotation _lanes into a 3x3 or homogeneous 4x4 matrix
+template <std::size_t DIM>
+void storeRotationLane(const float (*_lanes)[SimdFloat::width], std::size_t _lane, Matrix<float,DIM,DIM>& _out)
+{
+  float* out = _out.data();
+  for(std::size_t r = 0; r < 3; ++r)
+  {
+    for(std::size_t c = 0; c < 3; ++c)
+    {
+      out[r*DIM+c] = _lanes[r*3+c][_lane];
+    }
+  }
+  for(std::size_t i = 3; i < DIM; ++i)
+  {
+    for(std::size_t j = 0; j < DIM; ++j)
+    {
+      out[i*DIM+j] = i == j ? 1.0f : 0.0f;
+      out[j*DIM+i] = i == j ? 1.0f : 0.0f;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Converts _n float quaternions to matrices width at a time, the last partial block is padded
+template <std::size_t DIM>
+void quaternionsToMatricesKernel(std::size_t _n, const Quaternion<float>* _q, Matrix<float,DIM,DIM>* _out)
+{
+  typedef SimdFloat S;
+
+  for(std::size_t i = 0; i < _n; i += S::width)
+  {
+    std::size_t lanes = std::min<std::size_t>(S::width,_n-i);
+
+    S::reg a, b, c, d;
+    loadQuaternionLanes(_q + i,lanes,a,b,c,d);
+
+    S::reg m[9];
+    rotationMatrixLanes(a,b,c,d,m);
+
+    float soa[9][S::width];
+    for(std::size_t k = 0; k < 9; ++k)
+    {
+      S::store(soa[k],m[k]);
+    }
+    for(std::size_t l = 0; l < lanes; ++l)
+    {
+      storeRotationLane(soa,l,_out[i+l]);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Converts _n float rotation matrices to quaternions width at a time, the last partial block is padded
+/// with identities
+template <std::size_t DIM>
+void matricesToQuaternionsKernel(std::size_t _n, const Matrix<float,DIM,DIM>* _in, Quaternion<float>* _q)
+{
+  typedef SimdFloat S;
+
+  for(std::size_t i = 0; i < _n; i += S::width)
+  {
+    std::size_t lanes = std::min<std::size_t>(S::width,_n-i);
+
+    float soa[9][S::width];
+    for(std::size_t l = 0; l < S::width; ++l)
+    {
+      for(std::size_t r = 0; r < 3; ++r)
+      {
+        for(std::size_t c = 0; c < 3; ++c)
+        {
+          soa[r*3+c][l] = l < lanes ? _in[i+l].data()[r*DIM+c] : (r == c ? 1.0f : 0.0f);
+        }
+      }
+    }
+
+    S::reg m[9];
+    for(std::size_t k = 0; k < 9; ++k)
+    {
+      m[k] = S::load(soa[k]);
+    }
+
+    S::reg a, b, c, d;
+    quaternionLanes(m,a,b,c,d);
+    storeQuaternionLanes(_q + i,lanes,a,b,c,d);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Rotates width vectors in SoA form in place by width unit quaternions, as Quaternion::rotate
+inline void rotateLanes(SimdFloat::reg _a, SimdFloat::reg _b, SimdFloat::reg _c, SimdFloat::reg _d,
+                        SimdFloat::reg& _x, SimdFloat::reg& _y, SimdFloat::reg& _z)
+{
+  typedef SimdFloat S;
+
+  S::reg tx = S::sub(S::mul(_c,_z),S::mul(_d,_y));
+  S::reg ty = S::sub(S::mul(_d,_x),S::mul(_b,_z));
+  S::reg tz = S::sub(S::mul(_b,_y),S::mul(_c,_x));
+  tx = S::add(tx,tx);
+  ty = S::add(ty,ty);
+  tz = S::add(tz,tz);
+
+  _x = S::add(_x,S::sub(S::madd(_a,tx,S::mul(_c,tz)),S::mul(_d,ty)));
+  _y = S::add(_y,S::sub(S::madd(_a,ty,S::mul(_d,tx)),S::mul(_b,tz)));
+  _z = S::add(_z,S::sub(S::madd(_a,tz,S::mul(_b,ty)),S::mul(_c,tx)));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Rotates _n float vectors width at a time, by _q[i] each or by _q[0] when _single is true
+inline void rotateVectorsKernel(std::size_t _n, const Quaternion<float>* _q, bool _single,
+                                const Matrix<float,3,1>* _in, Matrix<float,3,1>* _out)
+{
+  typedef SimdFloat S;
+  const float* q = _q->data();
+
+  S::reg a = S::zero(), b = S::zero(), c = S::zero(), d = S::zero();
+  if(_single)
+  {
+    a = S::set1(q[0]);
+    b = S::set1(q[1]);
+    c = S::set1(q[2]);
+    d = S::set1(q[3]);
+  }
+
+  for(std::size_t i = 0; i < _n; i += S::width)
+  {
+    std::size_t lanes = std::min<std::size_t>(S::width,_n-i);
+
+    if(!_single)
+    {
+      loadQuaternionLanes(_q + i,lanes,a,b,c,d);
+    }
+
+    // the vectors are separate Matrix objects so they are gathered a lane at a time
+    float soa[3][S::width] = {};
+    for(std::size_t l = 0; l < lanes; ++l)
+    {
+      const float* v = _in[i+l].data();
+      soa[0][l] = v[0];
+      soa[1][l] = v[1];
+      soa[2][l] = v[2];
+    }
+
+    S::reg x = S::load(soa[0]);
+    S::reg y = S::load(soa[1]);
+    S::reg z = S::load(soa[2]);
+    rotateLanes(a,b,c,d,x,y,z);
+    S::store(soa[0],x);
+    S::store(soa[1],y);
+    S::store(soa[2],z);
+
+    for(std::size_t l = 0; l < lanes; ++l)
+    {
+      float* v = _out[i+l].data();
+      v[0] = soa[0][l];
+      v[1] = soa[1][l];
+      v[2] = soa[2][l];
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Writes the 3x3 or 4x4 rotation matrix of each of _n quaternions
+/// param[in] _n, number of quaternions
+/// param[in] _q, the quaternions, they don't have to be normalized
+/// param[in] _out, _n matrices that are overwritten
+template <typename T, std::size_t DIM>
+void quaternionsToMatrices(std::size_t _n, const Quaternion<T>* _q, Matrix<T,DIM,DIM>* _out)
+{
+  static_assert(DIM == 3 || DIM == 4, "rotation matrices are 3x3 or 4x4");
+
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / (DIM*DIM) + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      Matrix<T,4,4> mat = _q[i].toMatrix4();
+      for(std::size_t r = 0; r < DIM; ++r)
+      {
+        for(std::size_t c = 0; c < DIM; ++c)
+        {
+          _out[i].data()[r*DIM+c] = mat.data()[r*4+c];
+        }
+      }
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Float version of quaternionsToMatrices, SimdFloat::width quaternions at a time
+template <std::size_t DIM>
+void quaternionsToMatrices(std::size_t _n, const Quaternion<float>* _q, Matrix<float,DIM,DIM>* _out)
+{
+  static_assert(DIM == 3 || DIM == 4, "rotation matrices are 3x3 or 4x4");
+
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / (DIM*DIM) + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    quaternionsToMatricesKernel(_last-_first, _q + _first, _out + _first);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Writes the unit quaternion of each of _n rotation matrices, as Quaternion::fromMatrix
+/// param[in] _n, number of matrices
+/// param[in] _in, 3x3 rotations or 4x4 homogeneous matrices, only the rotation part is read
+/// param[in] _q, _n quaternions that are overwritten
+template <typename T, std::size_t DIM>
+void matricesToQuaternions(std::size_t _n, const Matrix<T,DIM,DIM>* _in, Quaternion<T>* _q)
+{
+  static_assert(DIM == 3 || DIM == 4, "rotation matrices are 3x3 or 4x4");
+
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / (DIM*DIM) + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      _q[i] = Quaternion<T>::fromMatrix(_in[i]);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Float version of matricesToQuaternions, SimdFloat::width matrices at a time without branches
+template <std::size_t DIM>
+void matricesToQuaternions(std::size_t _n, const Matrix<float,DIM,DIM>* _in, Quaternion<float>* _q)
+{
+  static_assert(DIM == 3 || DIM == 4, "rotation matrices are 3x3 or 4x4");
+
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / (DIM*DIM) + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    matricesToQuaternionsKernel(_last-_first, _in + _first, _q + _first);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Rotates _n vectors by the same unit quaternion, _in and _out can be the same array
+/// param[in] _n, number of vectors
+/// param[in] _q, the rotation, must be normalized
+/// param[in] _in, the vectors to rotate
+/// param[in] _out, _n vectors that are overwritten
+template <typename T>
+void rotateVectors(std::size_t _n, const Quaternion<T>& _q, const Matrix<T,3,1>* _in, Matrix<T,3,1>* _out)
+{
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 3 + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      _out[i] = _q.rotate(_in[i]);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Rotates vector i by quaternion i for _n vectors, eg joint offsets by their joint orientations
+/// param[in] _n, number of vectors
+/// param[in] _q, _n unit quaternions
+/// param[in] _in, the vectors to rotate
+/// param[in] _out, _n vectors that are overwritten, can be _in
+template <typename T>
+void rotateVectors(std::size_t _n, const Quaternion<T>* _q, const Matrix<T,3,1>* _in, Matrix<T,3,1>* _out)
+{
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 3 + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      _out[i] = _q[i].rotate(_in[i]);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Float version of rotateVectors by one quaternion, SimdFloat::width vectors at a time
+inline void rotateVectors(std::size_t _n, const Quaternion<float>& _q, const Matrix<float,3,1>* _in,
+                          Matrix<float,3,1>* _out)
+{
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 3 + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    rotateVectorsKernel(_last-_first, &_q, true, _in + _first, _out + _first);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Float version of rotateVectors by a quaternion each, SimdFloat::width vectors at a time
+inline void rotateVectors(std::size_t _n, const Quaternion<float>* _q, const Matrix<float,3,1>* _in,
+                          Matrix<float,3,1>* _out)
+{
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 3 + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    rotateVectorsKernel(_last-_first, _q + _first, false, _in + _first, _out + _first);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Hamilton product of width pairs of quaternions in SoA form, _out can be _l or _r
+inline void multiplyLanes(const SimdFloat::reg* _l, const SimdFloat::reg* _r, SimdFloat::reg* _out)
+{
+  typedef SimdFloat S;
+
+  S::reg a = S::sub(S::mul(_l[0],_r[0]),S::madd(_l[1],_r[1],S::madd(_l[2],_r[2],S::mul(_l[3],_r[3]))));
+  S::reg b = S::add(S::madd(_l[0],_r[1],S::mul(_l[1],_r[0])),S::sub(S::mul(_l[2],_r[3]),S::mul(_l[3],_r[2])));
+  S::reg c = S::add(S::madd(_l[0],_r[2],S::mul(_l[2],_r[0])),S::sub(S::mul(_l[3],_r[1]),S::mul(_l[1],_r[3])));
+  S::reg d = S::add(S::madd(_l[0],_r[3],S::mul(_l[3],_r[0])),S::sub(S::mul(_l[1],_r[2]),S::mul(_l[2],_r[1])));
+
+  _out[0] = a;
+  _out[1] = b;
+  _out[2] = c;
+  _out[3] = d;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Normalizes width quaternions with the rsqrt estimate and a Newton step, zero quaternions stay zero
+inline void normalizeLanes(SimdFloat::reg& _a, SimdFloat::reg& _b, SimdFloat::reg& _c, SimdFloat::reg& _d)
+{
+  typedef SimdFloat S;
+
+  S::reg normSqr = S::madd(_a,_a,S::madd(_b,_b,S::madd(_c,_c,S::mul(_d,_d))));
+  S::reg y = S::rsqrt(normSqr);
+  y = S::mul(y,S::sub(S::set1(1.5f),S::mul(S::mul(S::set1(0.5f),normSqr),S::mul(y,y))));
+  y = S::select(S::gt(normSqr,S::zero()),y,S::zero());
+
+  _a = S::mul(_a,y);
+  _b = S::mul(_b,y);
+  _c = S::mul(_c,y);
+  _d = S::mul(_d,y);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief _w0*q0 + _w1*q1 for width pairs, _q0 and _q1 are (a,b,c,d) registers
+inline void weightedSumLanes(SimdFloat::reg _w0, const SimdFloat::reg* _q0, SimdFloat::reg _w1,
+                             const SimdFloat::reg* _q1, SimdFloat::reg* _out)
+{
+  for(std::size_t k = 0; k < 4; ++k)
+  {
+    _out[k] = SimdFloat::madd(_w0,_q0[k],SimdFloat::mul(_w1,_q1[k]));
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Dot product of width pairs of quaternions
+inline SimdFloat::reg dotLanes(const SimdFloat::reg* _q0, const SimdFloat::reg* _q1)
+{
+  typedef SimdFloat S;
+  return S::madd(_q0[0],_q1[0],S::madd(_q0[1],_q1[1],S::madd(_q0[2],_q1[2],S::mul(_q0[3],_q1[3]))));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief nlerp of width pairs, as Quaternion::nlerp
+inline void nlerpLanes(const SimdFloat::reg* _q0, const SimdFloat::reg* _q1, SimdFloat::reg _t, SimdFloat::reg* _out)
+{
+  typedef SimdFloat S;
+
+  S::reg w1 = S::flipSign(_t,dotLanes(_q0,_q1));
+  weightedSumLanes(S::sub(S::set1(1.0f),_t),_q0,w1,_q1,_out);
+  normalizeLanes(_out[0],_out[1],_out[2],_out[3]);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Corrected nlerp of width pairs, as Quaternion::slerpFast
+inline void slerpFastLanes(const SimdFloat::reg* _q0, const SimdFloat::reg* _q1, SimdFloat::reg _t,
+                           SimdFloat::reg* _out)
+{
+  typedef SimdFloat S;
+
+  S::reg cosTheta = dotLanes(_q0,_q1);
+  S::reg d = S::abs(cosTheta);
+  S::reg a = S::madd(d,S::madd(d,S::madd(d,S::set1(-1.43519f),S::set1(3.55645f)),S::set1(-3.2452f)),
+                     S::set1(1.0904f));
+  S::reg b = S::madd(d,S::madd(d,S::set1(0.215638f),S::set1(-1.06021f)),S::set1(0.848013f));
+  S::reg centred = S::sub(_t,S::set1(0.5f));
+  S::reg k = S::madd(S::mul(a,centred),centred,b);
+  S::reg t = S::madd(S::mul(S::mul(_t,centred),S::sub(_t,S::set1(1.0f))),k,_t);
+
+  weightedSumLanes(S::sub(S::set1(1.0f),t),_q0,S::flipSign(t,cosTheta),_q1,_out);
+  normalizeLanes(_out[0],_out[1],_out[2],_out[3]);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief sin(_t*θ)/sinθ for cosθ = _x + 1, from D. Eberly "A Fast and Accurate Algorithm for Computing SLERP".
+/// The power series of the weight in x-1 is nested as t(1 + b0(1 + b1(... (1 + b11)))) with
+/// b_i = (t^2/(i(2i+1)) - i/(2i+1))(x-1), the last term is scaled by mu to make up for the rest of the series
+/// (mu fitted for 12 terms over 0 to 180 degrees).
+inline SimdFloat::reg slerpWeightLanes(SimdFloat::reg _t, SimdFloat::reg _xm1)
+{
+  typedef SimdFloat S;
+  static const float mu = 1.8937372f;
+  static const float u[12] = {1.0f/3.0f, 1.0f/10.0f, 1.0f/21.0f, 1.0f/36.0f, 1.0f/55.0f, 1.0f/78.0f,
+                              1.0f/105.0f, 1.0f/136.0f, 1.0f/171.0f, 1.0f/210.0f, 1.0f/253.0f, mu/300.0f};
+  static const float v[12] = {1.0f/3.0f, 2.0f/5.0f, 3.0f/7.0f, 4.0f/9.0f, 5.0f/11.0f, 6.0f/13.0f,
+                              7.0f/15.0f, 8.0f/17.0f, 9.0f/19.0f, 10.0f/21.0f, 11.0f/23.0f, mu*12.0f/25.0f};
+
+  S::reg sqrT = S::mul(_t,_t);
+  S::reg one = S::set1(1.0f);
+  S::reg r = one;
+  for(std::size_t k = 12; k-- > 0;)
+  {
+    S::reg b = S::mul(S::sub(S::mul(S::set1(u[k]),sqrT),S::set1(v[k])),_xm1);
+    r = S::madd(b,r,one);
+  }
+
+  return S::mul(_t,r);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief slerp of width pairs without branches, acos or sin
+inline void slerpLanes(const SimdFloat::reg* _q0, const SimdFloat::reg* _q1, SimdFloat::reg _t, SimdFloat::reg* _out)
+{
+  typedef SimdFloat S;
+
+  S::reg cosTheta = dotLanes(_q0,_q1);
+  // rounding can take |cosθ| just over 1, where the series grows
+  S::reg xm1 = S::sub(S::min(S::abs(cosTheta),S::set1(1.0f)),S::set1(1.0f));
+  S::reg w0 = slerpWeightLanes(S::sub(S::set1(1.0f),_t),xm1);
+  S::reg w1 = S::flipSign(slerpWeightLanes(_t,xm1),cosTheta);
+
+  weightedSumLanes(w0,_q0,w1,_q1,_out);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Runs one of the interpolation lanes over _n float pairs width at a time
+template <typename LANES>
+void interpolateKernel(std::size_t _n, const Quaternion<float>* _q0, const Quaternion<float>* _q1, const float* _t,
+                       Quaternion<float>* _out, LANES _lanes)
+{
+  typedef SimdFloat S;
+
+  for(std::size_t i = 0; i < _n; i += S::width)
+  {
+    std::size_t lanes = std::min<std::size_t>(S::width,_n-i);
+
+    S::reg q0[4], q1[4], out[4];
+    loadQuaternionLanes(_q0 + i,lanes,q0[0],q0[1],q0[2],q0[3]);
+    loadQuaternionLanes(_q1 + i,lanes,q1[0],q1[1],q1[2],q1[3]);
+    _lanes(q0,q1,loadLanes(_t + i,lanes),out);
+    storeQuaternionLanes(_out + i,lanes,out[0],out[1],out[2],out[3]);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief _out[i] = slerp(_q0[i],_q1[i],_t[i]) for _n unit quaternion pairs, _out can be _q0 or _q1
+template <typename T>
+void slerpBatch(std::size_t _n, const Quaternion<T>* _q0, const Quaternion<T>* _q1, const T* _t, Quaternion<T>* _out)
+{
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 4 + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      _out[i] = Quaternion<T>::slerp(_q0[i],_q1[i],_t[i]);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief _out[i] = nlerp(_q0[i],_q1[i],_t[i]) for _n unit quaternion pairs, _out can be _q0 or _q1
+template <typename T>
+void nlerpBatch(std::size_t _n, const Quaternion<T>* _q0, const Quaternion<T>* _q1, const T* _t, Quaternion<T>* _out)
+{
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 4 + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      _out[i] = Quaternion<T>::nlerp(_q0[i],_q1[i],_t[i]);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief _out[i] = slerpFast(_q0[i],_q1[i],_t[i]) for _n unit quaternion pairs, _out can be _q0 or _q1
+template <typename T>
+void slerpFastBatch(std::size_t _n, const Quaternion<T>* _q0, const Quaternion<T>* _q1, const T* _t,
+                    Quaternion<T>* _out)
+{
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 4 + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      _out[i] = Quaternion<T>::slerpFast(_q0[i],_q1[i],_t[i]);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Float version of slerpBatch, width pairs at a time with Eberly's polynomial weights
+inline void slerpBatch(std::size_t _n, const Quaternion<float>* _q0, const Quaternion<float>* _q1, const float* _t,
+                       Quaternion<float>* _out)
+{
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 4 + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    interpolateKernel(_last-_first, _q0 + _first, _q1 + _first, _t + _first, _out + _first, slerpLanes);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Float version of nlerpBatch, width pairs at a time
+inline void nlerpBatch(std::size_t _n, const Quaternion<float>* _q0, const Quaternion<float>* _q1, const float* _t,
+                       Quaternion<float>* _out)
+{
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 4 + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    interpolateKernel(_last-_first, _q0 + _first, _q1 + _first, _t + _first, _out + _first, nlerpLanes);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Float version of slerpFastBatch, width pairs at a time
+inline void slerpFastBatch(std::size_t _n, const Quaternion<float>* _q0, const Quaternion<float>* _q1,
+                           const float* _t, Quaternion<float>* _out)
+{
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 4 + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    interpolateKernel(_last-_first, _q0 + _first, _q1 + _first, _t + _first, _out + _first, slerpFastLanes);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Steps orientation i by angular velocity i over _dt for _n bodies, q = exp((0,ω*_dt/2))*q, which is
+/// exact for an angular velocity that is constant over the step. The product of unit quaternions only drifts from
+/// unit length by rounding, so an orientation is only renormalized once ||q|^2 - 1| is above _threshold.
+/// param[in] _n, number of bodies
+/// param[in] _q, _n unit orientations that are updated
+/// param[in] _omega, _n angular velocities in radians per second, in the world frame
+/// param[in] _dt, the time step
+/// param[in] _threshold, how far |q|^2 can drift from 1 before the orientation is renormalized
+/// returns the number of orientations that were renormalized
+template <typename T>
+std::size_t integrateOrientations(std::size_t _n, Quaternion<T>* _q, const Matrix<T,3,1>* _omega, T _dt,
+                                  T _threshold = T(1e-5))
+{
+  return parallelReduce(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 8 + 1, std::size_t(0),
+                        [&](std::size_t _first, std::size_t _last)
+  {
+    std::size_t renormalized = 0;
+    T halfDt = T(0.5)*_dt;
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      const T* w = _omega[i].data();
+      Quaternion<T> step = Quaternion<T>::exp(Quaternion<T>(T(0),halfDt*w[0],halfDt*w[1],halfDt*w[2]));
+      _q[i] = step * _q[i];
+
+      if(std::abs(_q[i].dot(_q[i])-T(1)) > _threshold)
+      {
+        _q[i].normalize();
+        ++renormalized;
+      }
+    }
+    return renormalized;
+  },
+  [](std::size_t _a, std::size_t _b) { return _a + _b; });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief cos(θ) and sin(θ)/θ of width angles from θ^2, Taylor series in θ^2 up to θ^12 which are within float
+/// rounding up to θ = π/2 (the next terms are below 1e-8 there)
+inline void cosSincLanes(SimdFloat::reg _thetaSqr, SimdFloat::reg& _cos, SimdFloat::reg& _sinc)
+{
+  typedef SimdFloat S;
+
+  // (-1)^k/(2k)! and (-1)^k/(2k+1)! for k = 6 down to 0
+  static const float cosTerms[7] = {1.0f/479001600.0f, -1.0f/3628800.0f, 1.0f/40320.0f, -1.0f/720.0f, 1.0f/24.0f,
+                                    -0.5f, 1.0f};
+  static const float sincTerms[7] = {1.0f/6227020800.0f, -1.0f/39916800.0f, 1.0f/362880.0f, -1.0f/5040.0f,
+                                     1.0f/120.0f, -1.0f/6.0f, 1.0f};
+
+  _cos = S::set1(cosTerms[0]);
+  _sinc = S::set1(sincTerms[0]);
+  for(std::size_t k = 1; k < 7; ++k)
+  {
+    _cos = S::madd(_cos,_thetaSqr,S::set1(cosTerms[k]));
+    _sinc = S::madd(_sinc,_thetaSqr,S::set1(sincTerms[k]));
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Float version of the integration step width bodies at a time, steps turning more than π (half angle
+/// over π/2) are rare enough to be redone with Quaternion::exp for the lanes that need it
+inline std::size_t integrateOrientationsKernel(std::size_t _n, Quaternion<float>* _q, const Matrix<float,3,1>* _omega,
+                                               float _dt, float _threshold)
+{
+  typedef SimdFloat S;
+
+  S::reg halfDt = S::set1(0.5f*_dt);
+  S::reg limit = S::set1(float(M_PI*M_PI/4.0));
+  S::reg one = S::set1(1.0f);
+  std::size_t renormalized = 0;
+
+  for(std::size_t i = 0; i < _n; i += S::width)
+  {
+    std::size_t lanes = std::min<std::size_t>(S::width,_n-i);
+
+    // the angular velocities are separate Matrix objects so they are gathered a lane at a time
+    float soa[4][S::width] = {};
+    for(std::size_t l = 0; l < lanes; ++l)
+    {
+      const float* w = _omega[i+l].data();
+      soa[1][l] = w[0];
+      soa[2][l] = w[1];
+      soa[3][l] = w[2];
+    }
+
+    S::reg x = S::mul(S::load(soa[1]),halfDt);
+    S::reg y = S::mul(S::load(soa[2]),halfDt);
+    S::reg z = S::mul(S::load(soa[3]),halfDt);
+    S::reg thetaSqr = S::madd(x,x,S::madd(y,y,S::mul(z,z)));
+
+    S::reg cosTheta, sinc;
+    cosSincLanes(thetaSqr,cosTheta,sinc);
+    S::reg step[4] = {cosTheta,S::mul(sinc,x),S::mul(sinc,y),S::mul(sinc,z)};
+
+    S::mask large = S::gt(thetaSqr,limit);
+    if(S::any(large))
+    {
+      float half[4][S::width];
+      for(std::size_t k = 0; k < 4; ++k)
+      {
+        S::store(half[k],step[k]);
+      }
+      S::store(soa[0],thetaSqr);
+      for(std::size_t l = 0; l < lanes; ++l)
+      {
+        if(soa[0][l] > float(M_PI*M_PI/4.0))
+        {
+          const float* w = _omega[i+l].data();
+          float h = 0.5f*_dt;
+          Quaternion<float> exact = Quaternion<float>::exp(Quaternion<float>(0.0f,h*w[0],h*w[1],h*w[2]));
+          for(std::size_t k = 0; k < 4; ++k)
+          {
+            half[k][l] = exact.data()[k];
+          }
+        }
+      }
+      for(std::size_t k = 0; k < 4; ++k)
+      {
+        step[k] = S::load(half[k]);
+      }
+    }
+
+    S::reg q[4];
+    loadQuaternionLanes(_q + i,lanes,q[0],q[1],q[2],q[3]);
+    multiplyLanes(step,q,q);
+
+    // padding lanes are identities with no angular velocity so they never drift
+    S::reg normSqr = dotLanes(q,q);
+    S::mask drift = S::gt(S::abs(S::sub(normSqr,one)),S::set1(_threshold));
+    if(S::any(drift))
+    {
+      S::reg r = S::rsqrt(normSqr);
+      r = S::mul(r,S::sub(S::set1(1.5f),S::mul(S::mul(S::set1(0.5f),normSqr),S::mul(r,r))));
+      r = S::select(drift,r,one);
+      for(std::size_t k = 0; k < 4; ++k)
+      {
+        q[k] = S::mul(q[k],r);
+      }
+      renormalized += S::count(drift);
+    }
+
+    storeQuaternionLanes(_q + i,lanes,q[0],q[1],q[2],q[3]);
+  }
+
+  return renormalized;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Float version of integrateOrientations, width bodies at a time with the lazy renormalization done with
+/// a select, blocks where no body has drifted skip it
+inline std::size_t integrateOrientations(std::size_t _n, Quaternion<float>* _q, const Matrix<float,3,1>* _omega,
+                                         float _dt, float _threshold = 1e-5f)
+{
+  return parallelReduce(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 8 + 1, std::size_t(0),
+                        [&](std::size_t _first, std::size_t _last)
+  {
+    return integrateOrientationsKernel(_last-_first, _q + _first, _omega + _first, _dt, _threshold);
+  },
+  [](std::size_t _a, std::size_t _b) { return _a + _b; });
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // QUATERNIONBATCH_H
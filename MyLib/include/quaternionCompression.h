@@ -0,0 +1,411 @@
+#ifndef QUATERNIONCOMPRESSION_H
+#define QUATERNIONCOMPRESSION_H
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include "quaternionBatch.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Unit quaternions packed into 32, 48 or 64 bits with the smallest three method, for storing and streaming
+/// orientation keyframes. q and -q are the same rotation so the sign is picked to make the largest component
+/// positive, the largest is then dropped (2 bits say which) and worked out again from the other three when the
+/// quaternion is decoded. The other three are at most 1/sqrt(2) in size so they are quantized over
+/// [-1/sqrt(2),1/sqrt(2)] with (BITS-2)/3 bits each, 10 bits for 32, 15 for 48 and 20 for 64.
+/// CompressedQuaternion<BITS> is BITS/8 bytes with no padding, so a 48 bit keyframe is 6 bytes instead of 16.
+/// compressQuaternions/decompressQuaternions convert whole arrays, SimdFloat::width quaternions at a time with
+/// the largest component picked with selects. angularErrorBound gives the worst case rotation error of a bit
+/// depth and compressionError measures the actual error of packed arrays against the originals.
+///   std::vector< CompressedQuaternion<48> > keys(n);
+///   compressQuaternions(n,rotations,keys.data());
+
+//----------------------------------------------------------------------------------------------
+/// \class CompressedQuaternion
+/// \brief Smallest three packing of a unit Quaternion<float> in BITS bits
+template <std::size_t BITS>
+class CompressedQuaternion
+{
+    static_assert(BITS == 32 || BITS == 48 || BITS == 64, "quaternions are packed into 32, 48 or 64 bits");
+
+private:
+
+    // the packed bits, least significant byte first so 48 bits don't need to be aligned
+    unsigned char m_bytes[BITS/8];
+
+public:
+
+    // bits for each of the three stored components
+    enum : std::size_t { componentBits = (BITS-2)/3 };
+    // the largest quantized component, even so zero is maxValue/2 exactly, and the mask of one component
+    enum : std::uint64_t { maxValue = (std::uint64_t(1) << componentBits) - 2,
+                           componentMask = (std::uint64_t(1) << componentBits) - 1 };
+
+    // the identity rotation
+    CompressedQuaternion();
+    // packs _q, which is normalized first
+    explicit CompressedQuaternion(const Quaternion<float>& _q);
+
+    // the unit quaternion, with a positive largest component
+    Quaternion<float> decode() const;
+
+    // the packed bits, the index of the dropped component then the three stored components
+    std::uint64_t bits() const;
+    void setBits(std::uint64_t _bits);
+
+    // the three stored components, each at most 1/sqrt(2) in size
+    static float range() { return 0.70710678f; }
+    // worst case angle in radians between the rotation of a unit quaternion and its packed version
+    static float angularErrorBound();
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Packs the index of the dropped component and three quantized components
+/// param[in] _index, which of a, b, c or d was dropped
+/// param[in] _q, the quantized components in order, each at most maxValue
+template <std::size_t BITS>
+std::uint64_t packSmallestThree(std::uint64_t _index, const std::uint64_t* _q)
+{
+  const std::size_t n = CompressedQuaternion<BITS>::componentBits;
+  return (_index << (3*n)) | (_q[0] << (2*n)) | (_q[1] << n) | _q[2];
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Default constructor, the identity with a dropped and the others at the middle step, which is zero
+template <std::size_t BITS>
+CompressedQuaternion<BITS>::CompressedQuaternion()
+{
+  std::uint64_t zero[3] = {maxValue/2,maxValue/2,maxValue/2};
+  setBits(packSmallestThree<BITS>(0,zero));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Packs a quaternion, normalizing it, flipping it so the largest component is positive and quantizing the
+/// other three to the nearest step. A zero quaternion becomes the identity.
+/// param[in] _q, the rotation
+template <std::size_t BITS>
+CompressedQuaternion<BITS>::CompressedQuaternion(const Quaternion<float>& _q)
+{
+  Quaternion<float> q(_q);
+  q.normalize();
+  const float* v = q.data();
+
+  std::size_t largest = 0;
+  for(std::size_t i = 1; i < 4; ++i)
+  {
+    if(std::fabs(v[i]) > std::fabs(v[largest]))
+    {
+      largest = i;
+    }
+  }
+  if(v[largest] == 0.0f)
+  {
+    *this = CompressedQuaternion<BITS>();
+    return;
+  }
+
+  // v/range maps to [-1,1], then to [0,maxValue] plus a half for rounding by truncation
+  float sign = std::copysign(1.0f,v[largest]);
+  float scale = float(maxValue/2)/range();
+  std::uint64_t quantized[3];
+  for(std::size_t i = 0, k = 0; i < 4; ++i)
+  {
+    if(i != largest)
+    {
+      float x = std::max(0.0f,(sign*v[i])*scale+(float(maxValue/2)+0.5f));
+      quantized[k++] = std::min<std::uint64_t>(static_cast<std::uint64_t>(x),maxValue);
+    }
+  }
+
+  setBits(packSmallestThree<BITS>(largest,quantized));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Unpacks the quaternion, the dropped component is sqrt(1 - the sum of the squares of the others)
+template <std::size_t BITS>
+Quaternion<float> CompressedQuaternion<BITS>::decode() const
+{
+  std::uint64_t packed = bits();
+  std::size_t largest = static_cast<std::size_t>(packed >> (3*componentBits));
+  float step = range()/float(maxValue/2);
+
+  // the middle step is subtracted as an integer so it decodes to exactly zero
+  float kept[3];
+  float sumSqr = 0.0f;
+  for(std::size_t k = 0; k < 3; ++k)
+  {
+    std::int64_t q = static_cast<std::int64_t>((packed >> ((2-k)*componentBits)) & componentMask);
+    kept[k] = float(q-std::int64_t(maxValue/2))*step;
+    sumSqr += kept[k]*kept[k];
+  }
+
+  Quaternion<float> result;
+  float* v = result.data();
+  for(std::size_t i = 0, k = 0; i < 4; ++i)
+  {
+    v[i] = i == largest ? std::sqrt(std::max(0.0f,1.0f-sumSqr)) : kept[k++];
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the packed bits, read a byte at a time so it doesn't depend on the byte order
+template <std::size_t BITS>
+std::uint64_t CompressedQuaternion<BITS>::bits() const
+{
+  std::uint64_t packed = 0;
+  for(std::size_t i = 0; i < BITS/8; ++i)
+  {
+    packed |= std::uint64_t(m_bytes[i]) << (8*i);
+  }
+
+  return packed;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Sets the packed bits, bits above BITS are dropped
+/// param[in] _bits, the dropped index and three components as packSmallestThree
+template <std::size_t BITS>
+void CompressedQuaternion<BITS>::setBits(std::uint64_t _bits)
+{
+  for(std::size_t i = 0; i < BITS/8; ++i)
+  {
+    m_bytes[i] = static_cast<unsigned char>(_bits >> (8*i));
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Worst case rotation error. Each stored component is within e = range/maxValue of the original, so the
+/// three together are within sqrt(3)e. The sum of their squares s then changes by at most 3e + 3e^2 (they are at
+/// most sqrt(3)/2 long as the dropped component is at least 1/2), and the dropped sqrt(1-s) by at most twice that.
+/// The distance between the quaternions c gives a rotation angle of 4*asin(c/2). A few float roundings are added.
+template <std::size_t BITS>
+float CompressedQuaternion<BITS>::angularErrorBound()
+{
+  double e = double(range())/double(maxValue);
+  double dropped = 6.0*e+6.0*e*e;
+  double chord = std::sqrt(3.0*e*e+dropped*dropped)+8.0*FLT_EPSILON;
+
+  return float(4.0*std::asin(std::min(1.0,chord/2.0)));
+}
+
+static_assert(sizeof(CompressedQuaternion<48>) == 6, "a 48 bit compressed quaternion is 6 bytes");
+
+//----------------------------------------------------------------------------------------------
+/// @brief Packs _n float quaternions width at a time, the lanes are normalized and flipped together and the
+/// largest component is found with selects, only the bit packing is done a lane at a time
+template <std::size_t BITS>
+void compressQuaternionsKernel(std::size_t _n, const Quaternion<float>* _q, CompressedQuaternion<BITS>* _out)
+{
+  typedef SimdFloat S;
+  typedef CompressedQuaternion<BITS> C;
+
+  S::reg scale = S::set1(float(C::maxValue/2)/C::range());
+  S::reg offset = S::set1(float(C::maxValue/2)+0.5f);
+  S::reg half = S::set1(0.5f), oneHalf = S::set1(1.5f), twoHalves = S::set1(2.5f);
+
+  for(std::size_t i = 0; i < _n; i += S::width)
+  {
+    std::size_t lanes = std::min<std::size_t>(S::width,_n-i);
+
+    S::reg q[4];
+    loadQuaternionLanes(_q + i,lanes,q[0],q[1],q[2],q[3]);
+    normalizeLanes(q[0],q[1],q[2],q[3]);
+
+    // index and value of the largest component, ties go to the first as in the scalar version
+    S::reg largest = S::abs(q[0]);
+    S::reg value = q[0];
+    S::reg index = S::zero();
+    for(std::size_t k = 1; k < 4; ++k)
+    {
+      S::mask larger = S::gt(S::abs(q[k]),largest);
+      largest = S::select(larger,S::abs(q[k]),largest);
+      value = S::select(larger,q[k],value);
+      index = S::select(larger,S::set1(float(k)),index);
+    }
+
+    // the three kept components in order, with the sign that makes the dropped one positive
+    S::reg kept[3];
+    kept[0] = S::select(S::gt(index,half),q[0],q[1]);
+    kept[1] = S::select(S::gt(index,oneHalf),q[1],q[2]);
+    kept[2] = S::select(S::gt(index,twoHalves),q[2],q[3]);
+
+    float soa[4][S::width];
+    S::store(soa[0],index);
+    for(std::size_t k = 0; k < 3; ++k)
+    {
+      S::store(soa[k+1],S::max(S::zero(),S::madd(S::flipSign(kept[k],value),scale,offset)));
+    }
+
+    // zero quaternions normalize to zero, they are stored as the identity
+    float zero[S::width];
+    S::store(zero,largest);
+
+    for(std::size_t l = 0; l < lanes; ++l)
+    {
+      if(zero[l] == 0.0f)
+      {
+        _out[i+l] = C();
+        continue;
+      }
+      std::uint64_t quantized[3];
+      for(std::size_t k = 0; k < 3; ++k)
+      {
+        quantized[k] = std::min<std::uint64_t>(static_cast<std::uint64_t>(soa[k+1][l]),C::maxValue);
+      }
+      _out[i+l].setBits(packSmallestThree<BITS>(static_cast<std::uint64_t>(soa[0][l]),quantized));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Unpacks _n quaternions width at a time, the bits are split a lane at a time then the components are
+/// scaled, the dropped one worked out and all four put in place with selects
+template <std::size_t BITS>
+void decompressQuaternionsKernel(std::size_t _n, const CompressedQuaternion<BITS>* _in, Quaternion<float>* _q)
+{
+  typedef SimdFloat S;
+  typedef CompressedQuaternion<BITS> C;
+
+  const std::size_t n = C::componentBits;
+  S::reg step = S::set1(C::range()/float(C::maxValue/2));
+  S::reg one = S::set1(1.0f);
+  S::reg half = S::set1(0.5f), oneHalf = S::set1(1.5f), twoHalves = S::set1(2.5f);
+
+  for(std::size_t i = 0; i < _n; i += S::width)
+  {
+    std::size_t lanes = std::min<std::size_t>(S::width,_n-i);
+
+    // missing lanes are identities
+    float soa[4][S::width];
+    for(std::size_t l = 0; l < S::width; ++l)
+    {
+      std::uint64_t packed = l < lanes ? _in[i+l].bits() : C().bits();
+      soa[0][l] = float(packed >> (3*n));
+      for(std::size_t k = 0; k < 3; ++k)
+      {
+        std::int64_t q = static_cast<std::int64_t>((packed >> ((2-k)*n)) & C::componentMask);
+        soa[k+1][l] = float(q-std::int64_t(C::maxValue/2));
+      }
+    }
+
+    S::reg index = S::load(soa[0]);
+    S::reg v0 = S::mul(S::load(soa[1]),step);
+    S::reg v1 = S::mul(S::load(soa[2]),step);
+    S::reg v2 = S::mul(S::load(soa[3]),step);
+    S::reg sumSqr = S::madd(v0,v0,S::madd(v1,v1,S::mul(v2,v2)));
+    S::reg w = S::sqrt(S::max(S::zero(),S::sub(one,sumSqr)));
+
+    S::mask over0 = S::gt(index,half);
+    S::mask over1 = S::gt(index,oneHalf);
+    S::mask over2 = S::gt(index,twoHalves);
+    S::reg a = S::select(over0,v0,w);
+    S::reg b = S::select(over0,S::select(over1,v1,w),v0);
+    S::reg c = S::select(over1,S::select(over2,v2,w),v1);
+    S::reg d = S::select(over2,w,v2);
+
+    storeQuaternionLanes(_q + i,lanes,a,b,c,d);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Packs _n quaternions, large arrays are split across threads
+/// param[in] _n, number of quaternions
+/// param[in] _q, the rotations, they don't have to be normalized
+/// param[in] _out, _n packed quaternions that are overwritten
+template <std::size_t BITS>
+void compressQuaternions(std::size_t _n, const Quaternion<float>* _q, CompressedQuaternion<BITS>* _out)
+{
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 4 + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    compressQuaternionsKernel(_last-_first, _q + _first, _out + _first);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Unpacks _n quaternions, large arrays are split across threads
+/// param[in] _n, number of quaternions
+/// param[in] _in, the packed quaternions
+/// param[in] _q, _n unit quaternions that are overwritten
+template <std::size_t BITS>
+void decompressQuaternions(std::size_t _n, const CompressedQuaternion<BITS>* _in, Quaternion<float>* _q)
+{
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 4 + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    decompressQuaternionsKernel(_last-_first, _in + _first, _q + _first);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// \struct QuaternionCompressionError
+/// \brief Rotation error of packed quaternions in radians
+struct QuaternionCompressionError
+{
+  // the largest and mean angle between an original rotation and its packed version
+  double maxAngle = 0.0;
+  double meanAngle = 0.0;
+  // the worst case for the bit depth, maxAngle is never above it
+  double bound = 0.0;
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Measures the rotation error of _n packed quaternions against the originals, worked out in double with
+/// 4*asin(|q - q'|/2) which stays accurate for the tiny angles of the deeper packings where acos doesn't
+/// param[in] _n, number of quaternions
+/// param[in] _original, the rotations before packing, they don't have to be normalized
+/// param[in] _packed, the packed rotations
+template <std::size_t BITS>
+QuaternionCompressionError compressionError(std::size_t _n, const Quaternion<float>* _original,
+                                            const CompressedQuaternion<BITS>* _packed)
+{
+  QuaternionCompressionError error = parallelReduce(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 16 + 1,
+                                                    QuaternionCompressionError(),
+                                                    [&](std::size_t _first, std::size_t _last)
+  {
+    QuaternionCompressionError chunk;
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      const float* o = _original[i].data();
+      Quaternion<float> decoded = _packed[i].decode();
+      const float* d = decoded.data();
+
+      double norm = std::sqrt(double(o[0])*o[0]+double(o[1])*o[1]+double(o[2])*o[2]+double(o[3])*o[3]);
+      if(norm == 0.0)
+      {
+        continue;
+      }
+      // q and -q are the same rotation, so take the nearer of the two
+      double minus = 0.0, plus = 0.0;
+      for(std::size_t k = 0; k < 4; ++k)
+      {
+        double x = double(o[k])/norm;
+        minus += (x-d[k])*(x-d[k]);
+        plus += (x+d[k])*(x+d[k]);
+      }
+      double chord = std::sqrt(std::min(minus,plus));
+      double angle = 4.0*std::asin(std::min(1.0,chord/2.0));
+
+      chunk.maxAngle = std::max(chunk.maxAngle,angle);
+      chunk.meanAngle += angle;
+    }
+    return chunk;
+  },
+  [](const QuaternionCompressionError& _a, const QuaternionCompressionError& _b)
+  {
+    QuaternionCompressionError combined;
+    combined.maxAngle = std::max(_a.maxAngle,_b.maxAngle);
+    combined.meanAngle = _a.meanAngle+_b.meanAngle;
+    return combined;
+  });
+
+  error.meanAngle = _n ? error.meanAngle/double(_n) : 0.0;
+  error.bound = CompressedQuaternion<BITS>::angularErrorBound();
+
+  return error;
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // QUATERNIONCOMPRESSION_H
@@ -0,0 +1,341 @@
+#ifndef QUATERNIONSPLINE_H
+#define QUATERNIONSPLINE_H
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include "quaternionBatch.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Spherical cubic interpolation (SQUAD, Shoemake 1987) through quaternion keyframes, eg a camera path. Between
+/// keys i and i+1 the rotation is slerp(slerp(q_i,q_i+1,h), slerp(s_i,s_i+1,h), 2h(1-h)) where the tangent
+/// quaternions s_i = q_i*exp(-(log(q_i^-1*q_i+1) + log(q_i^-1*q_i-1))/4) make the path smooth through every key.
+/// The tangents only depend on the keys so QuaternionSpline works them out once when it is built and keeps them.
+/// Finding the segment of a time is a binary search, a Cursor remembers the last segment so times that only move
+/// forward (playing back an animation) are found by stepping on from it instead, which is O(1) per query.
+/// The batched evaluate keeps a cursor for each thread's share of the times, the float version works out the
+/// three slerps of width times at a time with the polynomial slerp lanes of slerpBatch.
+///   QuaternionSpline<float> path(n,times,keys);
+///   QuaternionSpline<float>::Cursor cursor;
+///   camera = path.evaluate(time,cursor);
+
+// forward steps a cursor takes before it falls back to a binary search
+#ifndef MYLIB_SPLINE_CURSOR_STEPS
+#define MYLIB_SPLINE_CURSOR_STEPS 4
+#endif
+
+//----------------------------------------------------------------------------------------------
+/// \class QuaternionSpline
+/// \brief SQUAD spline through timed quaternion keys with cached tangents
+template <typename T>
+class QuaternionSpline
+{
+private:
+
+    std::vector<T> m_times;
+    // the keys normalized and with their signs flipped so neighbours are on the same side
+    std::vector< Quaternion<T> > m_keys;
+    // the tangent quaternion of each key
+    std::vector< Quaternion<T> > m_tangents;
+
+public:
+
+    /// \struct Cursor
+    /// \brief The segment of the last query, one per sequence of queries
+    struct Cursor
+    {
+      std::size_t segment = 0;
+    };
+
+    // spline through _n keys at increasing times, the keys don't have to be normalized
+    QuaternionSpline(std::size_t _n, const T* _times, const Quaternion<T>* _keys);
+
+    // number of keys
+    std::size_t size() const { return m_keys.size(); }
+    // time of the first and last keys, times outside them are clamped
+    T startTime() const { return m_times.front(); }
+    T endTime() const { return m_times.back(); }
+    // key, tangent and time _i
+    const Quaternion<T>& key(std::size_t _i) const;
+    const Quaternion<T>& tangent(std::size_t _i) const;
+    T time(std::size_t _i) const;
+
+    // segment _t is in (from key i to i+1) and how far along it is in [0,1], moving _cursor on to it
+    std::size_t segment(T _t, Cursor& _cursor, T& _h) const;
+
+    // rotation at time _t, finding the segment with a binary search
+    Quaternion<T> evaluate(T _t) const;
+    // rotation at time _t, stepping on from the segment of the last query
+    Quaternion<T> evaluate(T _t, Cursor& _cursor) const;
+    // rotations at _n times, fastest when the times are sorted but any order works
+    void evaluate(std::size_t _n, const T* _t, Quaternion<T>* _out) const;
+
+    // SQUAD of one segment, _h from 0 at _q0 to 1 at _q1
+    static Quaternion<T> squad(const Quaternion<T>& _q0, const Quaternion<T>& _q1, const Quaternion<T>& _s0,
+                               const Quaternion<T>& _s1, T _h);
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Builds the spline, each key is normalized and negated if needed so it is on the same side as the one
+/// before (the slerps then follow the shorter arc between keys), then the tangents are worked out. The first and
+/// last keys are their own tangents.
+/// param[in] _n, number of keys, at least 1
+/// param[in] _times, _n strictly increasing times
+/// param[in] _keys, _n rotations
+template <typename T>
+QuaternionSpline<T>::QuaternionSpline(std::size_t _n, const T* _times, const Quaternion<T>* _keys)
+{
+  if(_n == 0)
+  {
+    throw std::out_of_range("A spline needs at least one key");
+  }
+  for(std::size_t i = 1; i < _n; ++i)
+  {
+    if(!(_times[i] > _times[i-1]))
+    {
+      throw std::out_of_range("Spline key times must be strictly increasing");
+    }
+  }
+
+  m_times.assign(_times,_times + _n);
+  m_keys.assign(_keys,_keys + _n);
+  for(std::size_t i = 0; i < _n; ++i)
+  {
+    m_keys[i].normalize();
+    if(i > 0 && m_keys[i].dot(m_keys[i-1]) < T(0))
+    {
+      -m_keys[i];
+    }
+  }
+
+  m_tangents = m_keys;
+  for(std::size_t i = 1; i + 1 < _n; ++i)
+  {
+    Quaternion<T> inverse(m_keys[i]);
+    inverse.conjugate();
+    Quaternion<T> next(inverse);
+    next * m_keys[i+1];
+    Quaternion<T> previous(inverse);
+    previous * m_keys[i-1];
+
+    Quaternion<T> sum = Quaternion<T>::log(next);
+    sum + Quaternion<T>::log(previous);
+    Quaternion<T> offset = Quaternion<T>::exp(sum * T(-0.25));
+
+    m_tangents[i] = m_keys[i];
+    m_tangents[i] * offset;
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns key _i after normalizing and sign flipping
+/// param[in] _i, the key, less than size()
+template <typename T>
+const Quaternion<T>& QuaternionSpline<T>::key(std::size_t _i) const
+{
+  if(_i >= m_keys.size())
+  {
+    throw std::out_of_range("Spline key index out of range");
+  }
+  return m_keys[_i];
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the tangent quaternion of key _i
+/// param[in] _i, the key, less than size()
+template <typename T>
+const Quaternion<T>& QuaternionSpline<T>::tangent(std::size_t _i) const
+{
+  if(_i >= m_tangents.size())
+  {
+    throw std::out_of_range("Spline key index out of range");
+  }
+  return m_tangents[_i];
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the time of key _i
+/// param[in] _i, the key, less than size()
+template <typename T>
+T QuaternionSpline<T>::time(std::size_t _i) const
+{
+  if(_i >= m_times.size())
+  {
+    throw std::out_of_range("Spline key index out of range");
+  }
+  return m_times[_i];
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Finds the segment of _t. If _t is at or after the cursor's segment the cursor steps forward, a few
+/// steps cover any sequence of queries that moves forward by less than a few keys each time, further jumps and
+/// backward moves binary search the rest of the keys.
+/// param[in] _t, the time, clamped to the keys
+/// param[in] _cursor, the segment of the last query, moved on to the segment of _t
+/// param[in] _h, set to how far _t is through the segment in [0,1]
+template <typename T>
+std::size_t QuaternionSpline<T>::segment(T _t, Cursor& _cursor, T& _h) const
+{
+  // one key has one empty segment
+  if(m_times.size() == 1)
+  {
+    _h = T(0);
+    return 0;
+  }
+
+  std::size_t last = m_times.size()-2;
+  std::size_t i = std::min(_cursor.segment,last);
+
+  if(_t < m_times[i])
+  {
+    // moved back, search the keys before the cursor
+    i = std::upper_bound(m_times.begin() + 1,m_times.begin() + i + 1,_t) - m_times.begin() - 1;
+  }
+  else
+  {
+    std::size_t steps = 0;
+    while(i < last && _t >= m_times[i+1] && steps < MYLIB_SPLINE_CURSOR_STEPS)
+    {
+      ++i;
+      ++steps;
+    }
+    if(i < last && _t >= m_times[i+1])
+    {
+      i = std::upper_bound(m_times.begin() + i + 1,m_times.end() - 1,_t) - m_times.begin() - 1;
+    }
+  }
+
+  _cursor.segment = i;
+  _h = (_t-m_times[i])/(m_times[i+1]-m_times[i]);
+  _h = std::min(T(1),std::max(T(0),_h));
+
+  return i;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief SQUAD of one segment, slerp(slerp(q0,q1,h), slerp(s0,s1,h), 2h(1-h))
+/// param[in] _q0, the key at the start of the segment
+/// param[in] _q1, the key at the end of the segment
+/// param[in] _s0, the tangent of _q0
+/// param[in] _s1, the tangent of _q1
+/// param[in] _h, how far through the segment
+template <typename T>
+Quaternion<T> QuaternionSpline<T>::squad(const Quaternion<T>& _q0, const Quaternion<T>& _q1,
+                                         const Quaternion<T>& _s0, const Quaternion<T>& _s1, T _h)
+{
+  return Quaternion<T>::slerp(Quaternion<T>::slerp(_q0,_q1,_h),Quaternion<T>::slerp(_s0,_s1,_h),
+                              T(2)*_h*(T(1)-_h));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the rotation at time _t
+/// param[in] _t, the time, clamped to the keys
+template <typename T>
+Quaternion<T> QuaternionSpline<T>::evaluate(T _t) const
+{
+  Cursor cursor;
+  cursor.segment = m_times.size();
+  T h;
+  std::size_t i = segment(_t,cursor,h);
+
+  if(m_keys.size() == 1)
+  {
+    return m_keys[0];
+  }
+  return squad(m_keys[i],m_keys[i+1],m_tangents[i],m_tangents[i+1],h);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the rotation at time _t, for sequences of queries
+/// param[in] _t, the time, clamped to the keys
+/// param[in] _cursor, the cursor of the sequence, a new Cursor starts at the first key
+template <typename T>
+Quaternion<T> QuaternionSpline<T>::evaluate(T _t, Cursor& _cursor) const
+{
+  T h;
+  std::size_t i = segment(_t,_cursor,h);
+
+  if(m_keys.size() == 1)
+  {
+    return m_keys[0];
+  }
+  return squad(m_keys[i],m_keys[i+1],m_tangents[i],m_tangents[i+1],h);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Evaluates _n times one at a time with one cursor
+template <typename T>
+void squadKernel(const QuaternionSpline<T>& _spline, std::size_t _n, const T* _t, Quaternion<T>* _out)
+{
+  typename QuaternionSpline<T>::Cursor cursor;
+  for(std::size_t i = 0; i < _n; ++i)
+  {
+    _out[i] = _spline.evaluate(_t[i],cursor);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Evaluates _n float times width at a time, the segments are found a lane at a time with one cursor and
+/// the keys and tangents gathered, then the three slerps are done together with slerpLanes
+inline void squadKernel(const QuaternionSpline<float>& _spline, std::size_t _n, const float* _t,
+                        Quaternion<float>* _out)
+{
+  typedef SimdFloat S;
+
+  if(_spline.size() == 1)
+  {
+    std::fill(_out,_out + _n,_spline.key(0));
+    return;
+  }
+
+  QuaternionSpline<float>::Cursor cursor;
+  for(std::size_t i = 0; i < _n; i += S::width)
+  {
+    std::size_t lanes = std::min<std::size_t>(S::width,_n-i);
+
+    Quaternion<float> q0[S::width], q1[S::width], s0[S::width], s1[S::width];
+    float h[S::width] = {};
+    for(std::size_t l = 0; l < lanes; ++l)
+    {
+      std::size_t k = _spline.segment(_t[i+l],cursor,h[l]);
+      q0[l] = _spline.key(k);
+      q1[l] = _spline.key(k+1);
+      s0[l] = _spline.tangent(k);
+      s1[l] = _spline.tangent(k+1);
+    }
+
+    S::reg keys0[4], keys1[4], tangents0[4], tangents1[4];
+    loadQuaternionLanes(q0,lanes,keys0[0],keys0[1],keys0[2],keys0[3]);
+    loadQuaternionLanes(q1,lanes,keys1[0],keys1[1],keys1[2],keys1[3]);
+    loadQuaternionLanes(s0,lanes,tangents0[0],tangents0[1],tangents0[2],tangents0[3]);
+    loadQuaternionLanes(s1,lanes,tangents1[0],tangents1[1],tangents1[2],tangents1[3]);
+
+    S::reg t = S::load(h);
+    S::reg onKeys[4], onTangents[4], out[4];
+    slerpLanes(keys0,keys1,t,onKeys);
+    slerpLanes(tangents0,tangents1,t,onTangents);
+    S::reg blend = S::mul(S::add(t,t),S::sub(S::set1(1.0f),t));
+    slerpLanes(onKeys,onTangents,blend,out);
+
+    storeQuaternionLanes(_out + i,lanes,out[0],out[1],out[2],out[3]);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Evaluates the spline at _n times, large batches are split across threads each with its own cursor
+/// param[in] _n, number of times
+/// param[in] _t, the times, sorted times only step the cursors
+/// param[in] _out, _n rotations that are overwritten
+template <typename T>
+void QuaternionSpline<T>::evaluate(std::size_t _n, const T* _t, Quaternion<T>* _out) const
+{
+  parallelFor(0, _n, MYLIB_PARALLEL_MIN_ELEMENTS / 16 + 1, [&](std::size_t _first, std::size_t _last)
+  {
+    squadKernel(*this, _last-_first, _t + _first, _out + _first);
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // QUATERNIONSPLINE_H
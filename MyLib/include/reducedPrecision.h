@@ -0,0 +1,326 @@
+#ifndef REDUCEDPRECISION_H
+#define REDUCEDPRECISION_H
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// 16 bit storage types for data that doesn't need full precision, half (IEEE 754 binary16, 10 bit mantissa,
+/// range +-65504) and bfloat16 (the top 16 bits of a float, 7 bit mantissa, same range as float).
+/// Both only store values, any arithmetic converts them to float so Matrix<half,R,C> and Matrix<bfloat16,R,C>
+/// work with every Matrix function while using half the memory of Matrix<float,R,C>.
+/// Conversions round to nearest even. Half uses the F16C instructions when they are enabled (-mf16c or -mavx2),
+/// convertKernel converts whole arrays with SIMD (F16C for half, SSE2 for bfloat16).
+/// AccumulatorType<T> is the type sums of T are built in, float for both, the matrix product and the kernels in
+/// matrixBlas.h use it so long sums don't lose precision.
+
+// number of elements the reduced precision kernels convert to float at a time, small enough to stay in L1
+#ifndef MYLIB_REDUCED_BLOCK
+#define MYLIB_REDUCED_BLOCK 256
+#endif
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the bits of _value as a binary16, rounded to nearest even
+inline std::uint16_t floatToHalfBits(float _value)
+{
+#if defined(__F16C__)
+  return static_cast<std::uint16_t>(_cvtss_sh(_value,_MM_FROUND_TO_NEAREST_INT));
+#else
+  std::uint32_t bits;
+  std::memcpy(&bits,&_value,sizeof(bits));
+
+  std::uint16_t sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000);
+  bits &= 0x7fffffff;
+
+  // infinity and NaN, NaNs stay quiet NaNs
+  if(bits >= 0x7f800000)
+  {
+    return sign | 0x7c00 | (bits > 0x7f800000 ? 0x0200 : 0);
+  }
+  // 65520 and above round up to infinity
+  if(bits >= 0x477ff000)
+  {
+    return sign | 0x7c00;
+  }
+  // below the smallest normal half, adding 0.5 lines the subnormal bits up with the bottom of the float
+  // mantissa and the float add does the rounding
+  if(bits < 0x38800000)
+  {
+    float value;
+    std::memcpy(&value,&bits,sizeof(value));
+    value += 0.5f;
+    std::memcpy(&bits,&value,sizeof(bits));
+    return sign | static_cast<std::uint16_t>(bits - 0x3f000000);
+  }
+
+  // rebias the exponent from 127 to 15 and round the 13 dropped bits to nearest even
+  std::uint32_t odd = (bits >> 13) & 1;
+  bits += 0xc8000fff + odd;
+  return sign | static_cast<std::uint16_t>(bits >> 13);
+#endif
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the float value of binary16 bits, exact
+inline float halfBitsToFloat(std::uint16_t _bits)
+{
+#if defined(__F16C__)
+  return _cvtsh_ss(_bits);
+#else
+  std::uint32_t sign = static_cast<std::uint32_t>(_bits & 0x8000) << 16;
+  std::uint32_t exponent = (_bits >> 10) & 0x1f;
+  std::uint32_t mantissa = _bits & 0x3ff;
+  std::uint32_t bits;
+
+  if(exponent == 0x1f)
+  {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  }
+  else if(exponent == 0)
+  {
+    // zero or subnormal, mantissa * 2^-24
+    float value = static_cast<float>(mantissa) * 5.9604644775390625e-8f;
+    std::memcpy(&bits,&value,sizeof(bits));
+    bits |= sign;
+  }
+  else
+  {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+
+  float value;
+  std::memcpy(&value,&bits,sizeof(value));
+  return value;
+#endif
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the bits of _value as a bfloat16, rounded to nearest even
+inline std::uint16_t floatToBfloat16Bits(float _value)
+{
+  std::uint32_t bits;
+  std::memcpy(&bits,&_value,sizeof(bits));
+
+  // NaNs are kept quiet, rounding could otherwise carry them into infinity
+  if((bits & 0x7fffffff) > 0x7f800000)
+  {
+    return static_cast<std::uint16_t>((bits >> 16) | 0x0040);
+  }
+
+  bits += 0x7fff + ((bits >> 16) & 1);
+  return static_cast<std::uint16_t>(bits >> 16);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the float value of bfloat16 bits, exact
+inline float bfloat16BitsToFloat(std::uint16_t _bits)
+{
+  std::uint32_t bits = static_cast<std::uint32_t>(_bits) << 16;
+  float value;
+  std::memcpy(&value,&bits,sizeof(value));
+  return value;
+}
+
+//----------------------------------------------------------------------------------------------
+/// \class half
+/// \brief IEEE 754 binary16 storage, converts to float for arithmetic
+class half
+{
+private:
+
+    std::uint16_t m_bits;
+
+public:
+
+    // zero
+    half() : m_bits(0) {}
+
+    // rounds any arithmetic value to the nearest half
+    template <typename U, typename = typename std::enable_if<std::is_arithmetic<U>::value>::type>
+    half(U _value) : m_bits(floatToHalfBits(static_cast<float>(_value))) {}
+
+    // the value as a float, exact
+    operator float() const { return halfBitsToFloat(m_bits); }
+
+    // the stored bits
+    std::uint16_t bits() const { return m_bits; }
+    static half fromBits(std::uint16_t _bits) { half h; h.m_bits = _bits; return h; }
+
+    // compound operators work out the result in float and round it once
+    half& operator+=(float _rhs) { return *this = float(*this) + _rhs; }
+    half& operator-=(float _rhs) { return *this = float(*this) - _rhs; }
+    half& operator*=(float _rhs) { return *this = float(*this) * _rhs; }
+    half& operator/=(float _rhs) { return *this = float(*this) / _rhs; }
+};
+
+//----------------------------------------------------------------------------------------------
+/// \class bfloat16
+/// \brief Brain floating point storage (the top half of a float), converts to float for arithmetic
+class bfloat16
+{
+private:
+
+    std::uint16_t m_bits;
+
+public:
+
+    // zero
+    bfloat16() : m_bits(0) {}
+
+    // rounds any arithmetic value to the nearest bfloat16
+    template <typename U, typename = typename std::enable_if<std::is_arithmetic<U>::value>::type>
+    bfloat16(U _value) : m_bits(floatToBfloat16Bits(static_cast<float>(_value))) {}
+
+    // the value as a float, exact
+    operator float() const { return bfloat16BitsToFloat(m_bits); }
+
+    // the stored bits
+    std::uint16_t bits() const { return m_bits; }
+    static bfloat16 fromBits(std::uint16_t _bits) { bfloat16 b; b.m_bits = _bits; return b; }
+
+    // compound operators work out the result in float and round it once
+    bfloat16& operator+=(float _rhs) { return *this = float(*this) + _rhs; }
+    bfloat16& operator-=(float _rhs) { return *this = float(*this) - _rhs; }
+    bfloat16& operator*=(float _rhs) { return *this = float(*this) * _rhs; }
+    bfloat16& operator/=(float _rhs) { return *this = float(*this) / _rhs; }
+};
+
+inline std::ostream& operator<<(std::ostream& _out, half _value) { return _out << float(_value); }
+inline std::ostream& operator<<(std::ostream& _out, bfloat16 _value) { return _out << float(_value); }
+
+//----------------------------------------------------------------------------------------------
+/// @brief Type sums of T are accumulated in, T itself unless it is a 16 bit storage type
+template <typename T>
+struct AccumulatorType
+{
+  typedef T type;
+};
+
+template <>
+struct AccumulatorType<half>
+{
+  typedef float type;
+};
+
+template <>
+struct AccumulatorType<bfloat16>
+{
+  typedef float type;
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Converts _n elements from _in into _out, the generic version converts one element at a time
+template <typename IN, typename OUT>
+void convertKernel(std::size_t _n, const IN* _in, OUT* _out)
+{
+  for(std::size_t i = 0; i < _n; ++i)
+  {
+    _out[i] = static_cast<OUT>(_in[i]);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Converts _n halves to floats, 8 at a time with F16C
+inline void convertKernel(std::size_t _n, const half* _in, float* _out)
+{
+  std::size_t i = 0;
+#if defined(__F16C__)
+  for(; i + 8 <= _n; i += 8)
+  {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_in + i));
+    _mm256_storeu_ps(_out + i,_mm256_cvtph_ps(h));
+  }
+#endif
+  for(; i < _n; ++i)
+  {
+    _out[i] = float(_in[i]);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Converts _n floats to halves rounded to nearest even, 8 at a time with F16C
+inline void convertKernel(std::size_t _n, const float* _in, half* _out)
+{
+  std::size_t i = 0;
+#if defined(__F16C__)
+  for(; i + 8 <= _n; i += 8)
+  {
+    __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(_in + i),_MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(_out + i),h);
+  }
+#endif
+  for(; i < _n; ++i)
+  {
+    _out[i] = half(_in[i]);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Converts _n bfloat16s to floats, 8 at a time with SSE2 by interleaving them with zero low halves
+inline void convertKernel(std::size_t _n, const bfloat16* _in, float* _out)
+{
+  std::size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for(; i + 8 <= _n; i += 8)
+  {
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_in + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(_out + i),_mm_unpacklo_epi16(zero,b));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(_out + i + 4),_mm_unpackhi_epi16(zero,b));
+  }
+#endif
+  for(; i < _n; ++i)
+  {
+    _out[i] = float(_in[i]);
+  }
+}
+
+#if defined(__SSE2__)
+//----------------------------------------------------------------------------------------------
+/// @brief Rounds 4 floats to bfloat16, returned sign extended in the 32 bit lanes so they can be packed with saturation
+inline __m128i roundBfloat16(__m128 _value)
+{
+  __m128i bits = _mm_castps_si128(_value);
+  __m128i odd = _mm_and_si128(_mm_srli_epi32(bits,16),_mm_set1_epi32(1));
+  __m128i rounded = _mm_add_epi32(bits,_mm_add_epi32(odd,_mm_set1_epi32(0x7fff)));
+
+  // NaNs are made quiet instead of rounded
+  __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(_value,_value));
+  __m128i quiet = _mm_or_si128(bits,_mm_set1_epi32(0x00400000));
+  rounded = _mm_or_si128(_mm_andnot_si128(nan,rounded),_mm_and_si128(nan,quiet));
+
+  return _mm_srai_epi32(rounded,16);
+}
+#endif
+
+//----------------------------------------------------------------------------------------------
+/// @brief Converts _n floats to bfloat16s rounded to nearest even, 8 at a time with SSE2
+inline void convertKernel(std::size_t _n, const float* _in, bfloat16* _out)
+{
+  std::size_t i = 0;
+#if defined(__SSE2__)
+  for(; i + 8 <= _n; i += 8)
+  {
+    __m128i lo = roundBfloat16(_mm_loadu_ps(_in + i));
+    __m128i hi = roundBfloat16(_mm_loadu_ps(_in + i + 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(_out + i),_mm_packs_epi32(lo,hi));
+  }
+#endif
+  for(; i < _n; ++i)
+  {
+    _out[i] = bfloat16(_in[i]);
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // REDUCEDPRECISION_H
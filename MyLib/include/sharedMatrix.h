@@ -0,0 +1,158 @@
+#ifndef SHAREDMATRIX_H
+#define SHAREDMATRIX_H
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <initializer_list>
+#include "matrix.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Copy on write storage. CowPtr<VALUE> keeps VALUE in a reference counted heap buffer, copying a CowPtr only copies
+/// the pointer, so large matrices can be passed and returned by value cheaply. read() (or * and ->) gives const access
+/// to the shared value, write() gives a private copy the first time it is called on a shared value and then
+/// changes it in place, the other copies don't see the change.
+/// SharedMatrix<T,ROWS,COLS> is a CowPtr to a Matrix, eg
+///   SharedMatrix<double,512,512> a = makeSharedMatrix<double,512,512>();
+///   SharedMatrix<double,512,512> b = a;   // no copy
+///   b.write().transpose();                // b now has its own data, a is unchanged
+/// CowPtr works for any copyable value, eg CowPtr<CsrMatrix<double> > for matrices sized at runtime.
+/// Copies can be handed to other threads. Each value keeps its own atomic count of the CowPtrs sharing it, released
+/// when a CowPtr lets go and acquired by write(), so a write in place only happens after every other owner has finished
+/// with the value (shared_ptr::use_count is only approximate across threads so it isn't used for this).
+/// A single CowPtr must not be written from two threads at once.
+
+//----------------------------------------------------------------------------------------------
+/// \class CowPtr
+/// \brief Reference counted value that is copied on the first write while it is shared
+template <typename VALUE>
+class CowPtr
+{
+private:
+
+    // the value and the number of CowPtrs sharing it, the shared_ptr only looks after the memory
+    struct Shared
+    {
+      std::atomic<long> owners;
+      VALUE value;
+
+      template <typename... ARGS>
+      explicit Shared(ARGS&&... _args) : owners(1), value(std::forward<ARGS>(_args)...) {}
+
+      Shared(const Shared&) = delete;
+      Shared& operator=(const Shared&) = delete;
+    };
+
+    std::shared_ptr<Shared> m_shared;
+
+    explicit CowPtr(std::shared_ptr<Shared> _shared) : m_shared(std::move(_shared)) {}
+
+    // lets go of the value, the release pairs with the acquire in write() so this owner's reads come first
+    void drop();
+
+public:
+
+    // default constructed value
+    CowPtr() : m_shared(std::make_shared<Shared>()) {}
+
+    // takes a copy of _value
+    explicit CowPtr(const VALUE& _value) : m_shared(std::make_shared<Shared>(_value)) {}
+
+    // copies share the value
+    CowPtr(const CowPtr& _rhs) : m_shared(_rhs.m_shared) { m_shared->owners.fetch_add(1,std::memory_order_relaxed); }
+    CowPtr& operator=(const CowPtr& _rhs);
+    ~CowPtr() { drop(); }
+
+    // constructs the value in place from _args
+    template <typename... ARGS>
+    static CowPtr make(ARGS&&... _args) { return CowPtr(std::make_shared<Shared>(std::forward<ARGS>(_args)...)); }
+
+    // constructs the value in place with memory from _alloc (eg LargeAllocator for huge pages),
+    // private copies made later by write() come from the normal heap
+    template <typename ALLOC, typename... ARGS>
+    static CowPtr allocate(const ALLOC& _alloc, ARGS&&... _args)
+    {
+      return CowPtr(std::allocate_shared<Shared>(_alloc,std::forward<ARGS>(_args)...));
+    }
+
+    // read only access, never copies
+    const VALUE& read() const { return m_shared->value; }
+    const VALUE& operator*() const { return m_shared->value; }
+    const VALUE* operator->() const { return &m_shared->value; }
+
+    // write access, copies the value first if another CowPtr shares it
+    VALUE& write();
+
+    // true if another CowPtr shares the value
+    bool shared() const { return useCount() > 1; }
+
+    // number of CowPtrs sharing the value
+    long useCount() const { return m_shared->owners.load(std::memory_order_acquire); }
+
+    // true if both share the same value
+    bool sameAs(const CowPtr& _rhs) const { return m_shared == _rhs.m_shared; }
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Lets go of the value, only called when the CowPtr is destroyed or about to share another value
+template <typename VALUE>
+void CowPtr<VALUE>::drop()
+{
+  m_shared->owners.fetch_sub(1,std::memory_order_release);
+  m_shared.reset();
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Copy assignment, shares _rhs's value
+template <typename VALUE>
+CowPtr<VALUE>& CowPtr<VALUE>::operator=(const CowPtr& _rhs)
+{
+  if(m_shared != _rhs.m_shared)
+  {
+    _rhs.m_shared->owners.fetch_add(1,std::memory_order_relaxed);
+    drop();
+    m_shared = _rhs.m_shared;
+  }
+
+  return *this;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the value to change, copying it first if it is shared. The acquire load means every other owner
+/// that has let go has finished with the value before it is changed in place.
+template <typename VALUE>
+VALUE& CowPtr<VALUE>::write()
+{
+  if(m_shared->owners.load(std::memory_order_acquire) > 1)
+  {
+    std::shared_ptr<Shared> copy = std::make_shared<Shared>(static_cast<const VALUE&>(m_shared->value));
+    drop();
+    m_shared = std::move(copy);
+  }
+
+  return m_shared->value;
+}
+
+// copy on write matrix
+template <typename T, size_t ROWS, size_t COLS>
+using SharedMatrix = CowPtr< Matrix<T,ROWS,COLS> >;
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns a new zeroed shared matrix
+template <typename T, size_t ROWS, size_t COLS>
+SharedMatrix<T,ROWS,COLS> makeSharedMatrix()
+{
+  return SharedMatrix<T,ROWS,COLS>::make();
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns a new shared matrix set from an initializer list, as the Matrix constructor
+template <typename T, size_t ROWS, size_t COLS>
+SharedMatrix<T,ROWS,COLS> makeSharedMatrix(std::initializer_list<T> _data)
+{
+  return SharedMatrix<T,ROWS,COLS>::make(_data);
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // SHAREDMATRIX_H
@@ -0,0 +1,298 @@
+#ifndef SIMDFLOAT_H
+#define SIMDFLOAT_H
+#include <cstddef>
+#include <cmath>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Lanes of floats for the batched kernels, 16 with AVX-512, 8 with AVX, 4 with SSE2 and 1 otherwise. The batched quaternion
+/// functions work on SimdFloat::width elements at a time in structure of arrays form (one register per component)
+/// so the same code is vectorised whatever the instruction set. mask is the result of a comparison and is only
+/// used with select, any and count. loadQuaternions/storeQuaternions move width (a,b,c,d) quaternions between
+/// memory and one register per component with shuffles.
+
+#if defined(__AVX512F__)
+//----------------------------------------------------------------------------------------------
+/// \class SimdFloat
+/// \brief 16 floats in an AVX-512 register, comparisons give bit masks
+struct SimdFloat
+{
+  typedef __m512 reg;
+  typedef __mmask16 mask;
+  enum : std::size_t { width = 16 };
+
+  static reg load(const float* _p) { return _mm512_loadu_ps(_p); }
+  static void store(float* _p, reg _v) { _mm512_storeu_ps(_p,_v); }
+  static reg set1(float _v) { return _mm512_set1_ps(_v); }
+  static reg zero() { return _mm512_setzero_ps(); }
+
+  static reg add(reg _a, reg _b) { return _mm512_add_ps(_a,_b); }
+  static reg sub(reg _a, reg _b) { return _mm512_sub_ps(_a,_b); }
+  static reg mul(reg _a, reg _b) { return _mm512_mul_ps(_a,_b); }
+  static reg div(reg _a, reg _b) { return _mm512_div_ps(_a,_b); }
+  static reg madd(reg _a, reg _b, reg _c) { return _mm512_fmadd_ps(_a,_b,_c); }
+  static reg sqrt(reg _a) { return _mm512_sqrt_ps(_a); }
+  static reg rsqrt(reg _a) { return _mm512_rsqrt14_ps(_a); }
+  static reg min(reg _a, reg _b) { return _mm512_min_ps(_a,_b); }
+  static reg max(reg _a, reg _b) { return _mm512_max_ps(_a,_b); }
+  static reg abs(reg _a) { return _mm512_abs_ps(_a); }
+  // _a with its sign flipped where _sign is negative, the float logic instructions need AVX512DQ so use integers
+  static reg flipSign(reg _a, reg _sign)
+  {
+    __m512i sign = _mm512_and_si512(_mm512_castps_si512(_sign),_mm512_set1_epi32(static_cast<int>(0x80000000u)));
+    return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(_a),sign));
+  }
+
+  static mask lt(reg _a, reg _b) { return _mm512_cmp_ps_mask(_a,_b,_CMP_LT_OQ); }
+  static mask gt(reg _a, reg _b) { return _mm512_cmp_ps_mask(_a,_b,_CMP_GT_OQ); }
+  static mask maskAnd(mask _a, mask _b) { return static_cast<mask>(_a & _b); }
+  static mask maskOr(mask _a, mask _b) { return static_cast<mask>(_a | _b); }
+  static bool any(mask _m) { return _m != 0; }
+  static std::size_t count(mask _m) { return static_cast<std::size_t>(__builtin_popcount(_m)); }
+  // _m ? _a : _b per lane
+  static reg select(mask _m, reg _a, reg _b) { return _mm512_mask_blend_ps(_m,_b,_a); }
+
+  // 4x4 transpose in each 128 bit quarter
+  static void transpose(reg& _r0, reg& _r1, reg& _r2, reg& _r3)
+  {
+    reg t0 = _mm512_unpacklo_ps(_r0,_r1);
+    reg t1 = _mm512_unpackhi_ps(_r0,_r1);
+    reg t2 = _mm512_unpacklo_ps(_r2,_r3);
+    reg t3 = _mm512_unpackhi_ps(_r2,_r3);
+    _r0 = _mm512_shuffle_ps(t0,t2,_MM_SHUFFLE(1,0,1,0));
+    _r1 = _mm512_shuffle_ps(t0,t2,_MM_SHUFFLE(3,2,3,2));
+    _r2 = _mm512_shuffle_ps(t1,t3,_MM_SHUFFLE(1,0,1,0));
+    _r3 = _mm512_shuffle_ps(t1,t3,_MM_SHUFFLE(3,2,3,2));
+  }
+
+  // quaternions _q, _q + 4, _q + 8 and _q + 12 (in floats from _p) in the four quarters
+  static reg loadQuarters(const float* _p)
+  {
+    reg r = _mm512_castps128_ps512(_mm_loadu_ps(_p));
+    r = _mm512_insertf32x4(r,_mm_loadu_ps(_p + 16),1);
+    r = _mm512_insertf32x4(r,_mm_loadu_ps(_p + 32),2);
+    return _mm512_insertf32x4(r,_mm_loadu_ps(_p + 48),3);
+  }
+
+  static void storeQuarters(float* _p, reg _r)
+  {
+    _mm_storeu_ps(_p,_mm512_extractf32x4_ps(_r,0));
+    _mm_storeu_ps(_p + 16,_mm512_extractf32x4_ps(_r,1));
+    _mm_storeu_ps(_p + 32,_mm512_extractf32x4_ps(_r,2));
+    _mm_storeu_ps(_p + 48,_mm512_extractf32x4_ps(_r,3));
+  }
+
+  static void loadQuaternions(const float* _q, reg& _a, reg& _b, reg& _c, reg& _d)
+  {
+    _a = loadQuarters(_q);
+    _b = loadQuarters(_q + 4);
+    _c = loadQuarters(_q + 8);
+    _d = loadQuarters(_q + 12);
+    transpose(_a,_b,_c,_d);
+  }
+
+  static void storeQuaternions(float* _q, reg _a, reg _b, reg _c, reg _d)
+  {
+    transpose(_a,_b,_c,_d);
+    storeQuarters(_q,_a);
+    storeQuarters(_q + 4,_b);
+    storeQuarters(_q + 8,_c);
+    storeQuarters(_q + 12,_d);
+  }
+};
+#elif defined(__AVX__)
+//----------------------------------------------------------------------------------------------
+/// \class SimdFloat
+/// \brief 8 floats in an AVX register
+struct SimdFloat
+{
+  typedef __m256 reg;
+  typedef __m256 mask;
+  enum : std::size_t { width = 8 };
+
+  static reg load(const float* _p) { return _mm256_loadu_ps(_p); }
+  static void store(float* _p, reg _v) { _mm256_storeu_ps(_p,_v); }
+  static reg set1(float _v) { return _mm256_set1_ps(_v); }
+  static reg zero() { return _mm256_setzero_ps(); }
+
+  static reg add(reg _a, reg _b) { return _mm256_add_ps(_a,_b); }
+  static reg sub(reg _a, reg _b) { return _mm256_sub_ps(_a,_b); }
+  static reg mul(reg _a, reg _b) { return _mm256_mul_ps(_a,_b); }
+  static reg div(reg _a, reg _b) { return _mm256_div_ps(_a,_b); }
+#if defined(__FMA__)
+  static reg madd(reg _a, reg _b, reg _c) { return _mm256_fmadd_ps(_a,_b,_c); }
+#else
+  static reg madd(reg _a, reg _b, reg _c) { return _mm256_add_ps(_mm256_mul_ps(_a,_b),_c); }
+#endif
+  static reg sqrt(reg _a) { return _mm256_sqrt_ps(_a); }
+  static reg rsqrt(reg _a) { return _mm256_rsqrt_ps(_a); }
+  static reg min(reg _a, reg _b) { return _mm256_min_ps(_a,_b); }
+  static reg max(reg _a, reg _b) { return _mm256_max_ps(_a,_b); }
+  static reg abs(reg _a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f),_a); }
+  // _a with its sign flipped where _sign is negative
+  static reg flipSign(reg _a, reg _sign) { return _mm256_xor_ps(_a,_mm256_and_ps(_sign,_mm256_set1_ps(-0.0f))); }
+
+  static mask lt(reg _a, reg _b) { return _mm256_cmp_ps(_a,_b,_CMP_LT_OQ); }
+  static mask gt(reg _a, reg _b) { return _mm256_cmp_ps(_a,_b,_CMP_GT_OQ); }
+  static mask maskAnd(mask _a, mask _b) { return _mm256_and_ps(_a,_b); }
+  static mask maskOr(mask _a, mask _b) { return _mm256_or_ps(_a,_b); }
+  static bool any(mask _m) { return _mm256_movemask_ps(_m) != 0; }
+  static std::size_t count(mask _m) { return static_cast<std::size_t>(__builtin_popcount(_mm256_movemask_ps(_m))); }
+  // _m ? _a : _b per lane
+  static reg select(mask _m, reg _a, reg _b) { return _mm256_blendv_ps(_b,_a,_m); }
+
+  // 4x4 transpose in each 128 bit half, quaternions 0-3 go in the low half and 4-7 in the high half
+  static void transpose(reg& _r0, reg& _r1, reg& _r2, reg& _r3)
+  {
+    reg t0 = _mm256_unpacklo_ps(_r0,_r1);
+    reg t1 = _mm256_unpackhi_ps(_r0,_r1);
+    reg t2 = _mm256_unpacklo_ps(_r2,_r3);
+    reg t3 = _mm256_unpackhi_ps(_r2,_r3);
+    _r0 = _mm256_shuffle_ps(t0,t2,_MM_SHUFFLE(1,0,1,0));
+    _r1 = _mm256_shuffle_ps(t0,t2,_MM_SHUFFLE(3,2,3,2));
+    _r2 = _mm256_shuffle_ps(t1,t3,_MM_SHUFFLE(1,0,1,0));
+    _r3 = _mm256_shuffle_ps(t1,t3,_MM_SHUFFLE(3,2,3,2));
+  }
+
+  static void loadQuaternions(const float* _q, reg& _a, reg& _b, reg& _c, reg& _d)
+  {
+    _a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(_q)),_mm_loadu_ps(_q + 16),1);
+    _b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(_q + 4)),_mm_loadu_ps(_q + 20),1);
+    _c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(_q + 8)),_mm_loadu_ps(_q + 24),1);
+    _d = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(_q + 12)),_mm_loadu_ps(_q + 28),1);
+    transpose(_a,_b,_c,_d);
+  }
+
+  static void storeQuaternions(float* _q, reg _a, reg _b, reg _c, reg _d)
+  {
+    transpose(_a,_b,_c,_d);
+    _mm_storeu_ps(_q,_mm256_castps256_ps128(_a));
+    _mm_storeu_ps(_q + 4,_mm256_castps256_ps128(_b));
+    _mm_storeu_ps(_q + 8,_mm256_castps256_ps128(_c));
+    _mm_storeu_ps(_q + 12,_mm256_castps256_ps128(_d));
+    _mm_storeu_ps(_q + 16,_mm256_extractf128_ps(_a,1));
+    _mm_storeu_ps(_q + 20,_mm256_extractf128_ps(_b,1));
+    _mm_storeu_ps(_q + 24,_mm256_extractf128_ps(_c,1));
+    _mm_storeu_ps(_q + 28,_mm256_extractf128_ps(_d,1));
+  }
+};
+#elif defined(__SSE2__)
+//----------------------------------------------------------------------------------------------
+/// \class SimdFloat
+/// \brief 4 floats in an SSE register
+struct SimdFloat
+{
+  typedef __m128 reg;
+  typedef __m128 mask;
+  enum : std::size_t { width = 4 };
+
+  static reg load(const float* _p) { return _mm_loadu_ps(_p); }
+  static void store(float* _p, reg _v) { _mm_storeu_ps(_p,_v); }
+  static reg set1(float _v) { return _mm_set1_ps(_v); }
+  static reg zero() { return _mm_setzero_ps(); }
+
+  static reg add(reg _a, reg _b) { return _mm_add_ps(_a,_b); }
+  static reg sub(reg _a, reg _b) { return _mm_sub_ps(_a,_b); }
+  static reg mul(reg _a, reg _b) { return _mm_mul_ps(_a,_b); }
+  static reg div(reg _a, reg _b) { return _mm_div_ps(_a,_b); }
+  static reg madd(reg _a, reg _b, reg _c) { return _mm_add_ps(_mm_mul_ps(_a,_b),_c); }
+  static reg sqrt(reg _a) { return _mm_sqrt_ps(_a); }
+  static reg rsqrt(reg _a) { return _mm_rsqrt_ps(_a); }
+  static reg min(reg _a, reg _b) { return _mm_min_ps(_a,_b); }
+  static reg max(reg _a, reg _b) { return _mm_max_ps(_a,_b); }
+  static reg abs(reg _a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f),_a); }
+  // _a with its sign flipped where _sign is negative
+  static reg flipSign(reg _a, reg _sign) { return _mm_xor_ps(_a,_mm_and_ps(_sign,_mm_set1_ps(-0.0f))); }
+
+  static mask lt(reg _a, reg _b) { return _mm_cmplt_ps(_a,_b); }
+  static mask gt(reg _a, reg _b) { return _mm_cmpgt_ps(_a,_b); }
+  static mask maskAnd(mask _a, mask _b) { return _mm_and_ps(_a,_b); }
+  static mask maskOr(mask _a, mask _b) { return _mm_or_ps(_a,_b); }
+  static bool any(mask _m) { return _mm_movemask_ps(_m) != 0; }
+  static std::size_t count(mask _m) { return static_cast<std::size_t>(__builtin_popcount(_mm_movemask_ps(_m))); }
+  // _m ? _a : _b per lane
+  static reg select(mask _m, reg _a, reg _b) { return _mm_or_ps(_mm_and_ps(_m,_a),_mm_andnot_ps(_m,_b)); }
+
+  static void transpose(reg& _r0, reg& _r1, reg& _r2, reg& _r3) { _MM_TRANSPOSE4_PS(_r0,_r1,_r2,_r3); }
+
+  static void loadQuaternions(const float* _q, reg& _a, reg& _b, reg& _c, reg& _d)
+  {
+    _a = _mm_loadu_ps(_q);
+    _b = _mm_loadu_ps(_q + 4);
+    _c = _mm_loadu_ps(_q + 8);
+    _d = _mm_loadu_ps(_q + 12);
+    transpose(_a,_b,_c,_d);
+  }
+
+  static void storeQuaternions(float* _q, reg _a, reg _b, reg _c, reg _d)
+  {
+    transpose(_a,_b,_c,_d);
+    _mm_storeu_ps(_q,_a);
+    _mm_storeu_ps(_q + 4,_b);
+    _mm_storeu_ps(_q + 8,_c);
+    _mm_storeu_ps(_q + 12,_d);
+  }
+};
+#else
+//----------------------------------------------------------------------------------------------
+/// \class SimdFloat
+/// \brief One float, when there is no SIMD
+struct SimdFloat
+{
+  typedef float reg;
+  typedef bool mask;
+  enum : std::size_t { width = 1 };
+
+  static reg load(const float* _p) { return *_p; }
+  static void store(float* _p, reg _v) { *_p = _v; }
+  static reg set1(float _v) { return _v; }
+  static reg zero() { return 0.0f; }
+
+  static reg add(reg _a, reg _b) { return _a + _b; }
+  static reg sub(reg _a, reg _b) { return _a - _b; }
+  static reg mul(reg _a, reg _b) { return _a * _b; }
+  static reg div(reg _a, reg _b) { return _a / _b; }
+  static reg madd(reg _a, reg _b, reg _c) { return _a * _b + _c; }
+  static reg sqrt(reg _a) { return std::sqrt(_a); }
+  static reg rsqrt(reg _a) { return 1.0f / std::sqrt(_a); }
+  static reg min(reg _a, reg _b) { return _a < _b ? _a : _b; }
+  static reg max(reg _a, reg _b) { return _a > _b ? _a : _b; }
+  static reg abs(reg _a) { return std::fabs(_a); }
+  // _a with its sign flipped where _sign is negative
+  static reg flipSign(reg _a, reg _sign) { return std::signbit(_sign) ? -_a : _a; }
+
+  static mask lt(reg _a, reg _b) { return _a < _b; }
+  static mask gt(reg _a, reg _b) { return _a > _b; }
+  static mask maskAnd(mask _a, mask _b) { return _a && _b; }
+  static mask maskOr(mask _a, mask _b) { return _a || _b; }
+  static bool any(mask _m) { return _m; }
+  static std::size_t count(mask _m) { return _m ? 1 : 0; }
+  static reg select(mask _m, reg _a, reg _b) { return _m ? _a : _b; }
+
+  static void loadQuaternions(const float* _q, reg& _a, reg& _b, reg& _c, reg& _d)
+  {
+    _a = _q[0];
+    _b = _q[1];
+    _c = _q[2];
+    _d = _q[3];
+  }
+
+  static void storeQuaternions(float* _q, reg _a, reg _b, reg _c, reg _d)
+  {
+    _q[0] = _a;
+    _q[1] = _b;
+    _q[2] = _c;
+    _q[3] = _d;
+  }
+};
+#endif
+
+//----------------------------------------------------------------------------------------------
+#endif // SIMDFLOAT_H
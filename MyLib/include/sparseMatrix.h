@@ -0,0 +1,606 @@
+#ifndef SPARSEMATRIX_H
+#define SPARSEMATRIX_H
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "matrix.h"
+#include "parallel.h"
+
+/// \version 1.1
+/// \date 19/10/26 \n
+
+/// Sparse matrices, only the non zero values are stored.
+/// CsrMatrix   - compressed sparse row, the general purpose format, fast (multithreaded) matrix-vector products
+/// CscMatrix   - compressed sparse column, the transpose of a CsrMatrix without moving any data
+/// BsrMatrix   - block sparse row, stores dense BxB blocks, for FEM matrices with several values per node
+/// Unlike Matrix the size is set at runtime. As with Matrix, rows and columns start at 1.
+/// Matrices are built from a list of (row,column,value) triplets, values given for the same position are added together.
+
+//----------------------------------------------------------------------------------------------
+/// \class Triplet
+/// \brief A single (row,column,value) entry used to build a sparse matrix, row and column start at 1
+template <typename T>
+struct Triplet
+{
+    std::size_t row;
+    std::size_t col;
+    T value;
+};
+
+template <typename T> class CscMatrix;
+
+//----------------------------------------------------------------------------------------------
+/// \class CsrMatrix
+/// \brief Compressed sparse row matrix, row i's values are m_values[m_rowStart[i]] to m_values[m_rowStart[i+1]-1]
+/// and m_colIndex holds the column of each value (starting at 0), sorted within each row.
+template <typename T>
+class CsrMatrix
+{
+private:
+
+    // number of rows
+    std::size_t m_rows = 0;
+    // number of columns
+    std::size_t m_cols = 0;
+    // index of the first value of each row, plus one past the end
+    std::vector<std::size_t> m_rowStart;
+    // column of each value
+    std::vector<std::size_t> m_colIndex;
+    // the non zero values
+    std::vector<T> m_values;
+
+    // throws if the dense matrix sizes don't match the sparse matrix
+    void sizeCheck(std::size_t _rhsRows, std::size_t _outRows, std::size_t _rhsCols, std::size_t _outCols) const;
+
+public:
+
+    // empty 0x0 matrix
+    CsrMatrix() : m_rowStart(1,0) {}
+
+    // empty matrix with _rows rows and _cols columns
+    CsrMatrix(std::size_t _rows, std::size_t _cols) : m_rows(_rows), m_cols(_cols), m_rowStart(_rows+1,0) {}
+
+    // builds a matrix from (row,column,value) triplets, duplicates are added together
+    static CsrMatrix fromTriplets(std::size_t _rows, std::size_t _cols, const std::vector< Triplet<T> >& _triplets);
+
+    // builds a matrix from the non zero values of a dense matrix
+    template <size_t ROWS, size_t COLS>
+    static CsrMatrix fromDense(const Matrix<T,ROWS,COLS>& _dense);
+
+    // read only returns number of rows
+    std::size_t getRows() const { return m_rows; }
+    // read only returns number of cols
+    std::size_t getCols() const { return m_cols; }
+    // number of values stored
+    std::size_t nonZeros() const { return m_values.size(); }
+
+    // raw storage, for solvers and other kernels
+    const std::vector<std::size_t>& rowStart() const { return m_rowStart; }
+    const std::vector<std::size_t>& colIndex() const { return m_colIndex; }
+    const std::vector<T>& values() const { return m_values; }
+    std::vector<T>& values() { return m_values; }
+
+    // value at (_rowID,_colID) starting at 1, 0 if it isn't stored
+    T operator()(std::size_t _rowID, std::size_t _colID) const;
+
+    // y = A*x on raw contiguous arrays (x has getCols() values, y has getRows()), split across threads when large
+    void multiply(const T* _x, T* _y) const;
+
+    // Y = A*X for a dense matrix or column vector X, the result is written into _out
+    template <size_t ROWS, size_t COLS, size_t N>
+    void multiply(const Matrix<T,COLS,N>& _rhs, Matrix<T,ROWS,N>& _out) const;
+
+    // returns the transpose as a new CSR matrix
+    CsrMatrix transpose() const;
+
+    // returns the same matrix in compressed sparse column format
+    CscMatrix<T> toCsc() const;
+
+    // copies the values into a dense matrix of the same size
+    template <size_t ROWS, size_t COLS>
+    void toDense(Matrix<T,ROWS,COLS>& _dense) const;
+};
+
+//----------------------------------------------------------------------------------------------
+/// \class CscMatrix
+/// \brief Compressed sparse column matrix, stored as the CSR form of its transpose
+template <typename T>
+class CscMatrix
+{
+private:
+
+    // the transpose of this matrix in CSR format, its rows are this matrix's columns
+    CsrMatrix<T> m_transpose;
+
+public:
+
+    // empty 0x0 matrix
+    CscMatrix() {}
+
+    // wraps the CSR form of the transpose, no data is moved
+    explicit CscMatrix(CsrMatrix<T> _transpose) : m_transpose(std::move(_transpose)) {}
+
+    // builds a matrix from (row,column,value) triplets, duplicates are added together
+    static CscMatrix fromTriplets(std::size_t _rows, std::size_t _cols, const std::vector< Triplet<T> >& _triplets);
+
+    // read only returns number of rows
+    std::size_t getRows() const { return m_transpose.getCols(); }
+    // read only returns number of cols
+    std::size_t getCols() const { return m_transpose.getRows(); }
+    // number of values stored
+    std::size_t nonZeros() const { return m_transpose.nonZeros(); }
+
+    // raw storage, index of the first value of each column, the row of each value and the values
+    const std::vector<std::size_t>& colStart() const { return m_transpose.rowStart(); }
+    const std::vector<std::size_t>& rowIndex() const { return m_transpose.colIndex(); }
+    const std::vector<T>& values() const { return m_transpose.values(); }
+
+    // value at (_rowID,_colID) starting at 1, 0 if it isn't stored
+    T operator()(std::size_t _rowID, std::size_t _colID) const { return m_transpose(_colID,_rowID); }
+
+    // y = A*x on raw contiguous arrays, each column is scattered into y
+    void multiply(const T* _x, T* _y) const;
+
+    // returns the transpose, which is the stored CSR matrix
+    const CsrMatrix<T>& transpose() const { return m_transpose; }
+
+    // returns the same matrix in compressed sparse row format
+    CsrMatrix<T> toCsr() const { return m_transpose.transpose(); }
+};
+
+//----------------------------------------------------------------------------------------------
+/// \class BsrMatrix
+/// \brief Block sparse row matrix, stores dense BLOCK x BLOCK blocks (row major) in CSR order of the blocks.
+/// The number of rows and columns must be a multiple of BLOCK.
+template <typename T, size_t BLOCK>
+class BsrMatrix
+{
+private:
+
+    // number of block rows
+    std::size_t m_blockRows = 0;
+    // number of block columns
+    std::size_t m_blockCols = 0;
+    // index of the first block of each block row, plus one past the end
+    std::vector<std::size_t> m_blockStart;
+    // block column of each block
+    std::vector<std::size_t> m_blockCol;
+    // BLOCK*BLOCK values per block
+    std::vector<T> m_values;
+
+public:
+
+    // empty 0x0 matrix
+    BsrMatrix() : m_blockStart(1,0) {}
+
+    // builds a matrix from (row,column,value) triplets, duplicates are added together
+    static BsrMatrix fromTriplets(std::size_t _rows, std::size_t _cols, const std::vector< Triplet<T> >& _triplets);
+
+    // read only returns number of rows
+    std::size_t getRows() const { return m_blockRows*BLOCK; }
+    // read only returns number of cols
+    std::size_t getCols() const { return m_blockCols*BLOCK; }
+    // number of blocks stored
+    std::size_t nonZeroBlocks() const { return m_blockCol.size(); }
+
+    // value at (_rowID,_colID) starting at 1, 0 if it isn't stored
+    T operator()(std::size_t _rowID, std::size_t _colID) const;
+
+    // y = A*x on raw contiguous arrays, split across threads when large
+    void multiply(const T* _x, T* _y) const;
+
+    // Y = A*X for a dense column vector X, the result is written into _out
+    template <size_t ROWS, size_t COLS>
+    void multiply(const Matrix<T,COLS,1>& _rhs, Matrix<T,ROWS,1>& _out) const;
+};
+
+//----------------------------------------------------------------------------------------------
+/// @brief Builds a CSR matrix from triplets with a counting sort on the rows, then sorts and merges each row
+/// param[in] _rows, number of rows
+/// param[in] _cols, number of columns
+/// param[in] _triplets, the (row,column,value) entries, row and column start at 1
+template <typename T>
+CsrMatrix<T> CsrMatrix<T>::fromTriplets(std::size_t _rows, std::size_t _cols, const std::vector< Triplet<T> >& _triplets)
+{
+  CsrMatrix<T> mat(_rows,_cols);
+
+  // count entries per row
+  for(const Triplet<T>& t : _triplets)
+  {
+    if(t.row < 1 || t.row > _rows || t.col < 1 || t.col > _cols)
+    {
+      throw std::out_of_range("triplet out of range");
+    }
+    ++mat.m_rowStart[t.row];
+  }
+  for(std::size_t i = 0; i < _rows; ++i)
+  {
+    mat.m_rowStart[i+1] += mat.m_rowStart[i];
+  }
+
+  // scatter into rows
+  std::vector<std::size_t> next(mat.m_rowStart.begin(),mat.m_rowStart.end()-1);
+  std::vector< std::pair<std::size_t,T> > entries(_triplets.size());
+  for(const Triplet<T>& t : _triplets)
+  {
+    entries[next[t.row-1]++] = std::make_pair(t.col-1,t.value);
+  }
+
+  // sort each row by column and add duplicates together
+  mat.m_colIndex.reserve(entries.size());
+  mat.m_values.reserve(entries.size());
+  std::size_t start = 0;
+  for(std::size_t i = 0; i < _rows; ++i)
+  {
+    std::size_t end = mat.m_rowStart[i+1];
+    std::sort(entries.begin()+start,entries.begin()+end,
+              [](const std::pair<std::size_t,T>& _a, const std::pair<std::size_t,T>& _b) { return _a.first < _b.first; });
+
+    mat.m_rowStart[i] = mat.m_values.size();
+    for(std::size_t k = start; k < end; ++k)
+    {
+      if(k > start && entries[k].first == entries[k-1].first)
+      {
+        mat.m_values.back() += entries[k].second;
+      }
+      else
+      {
+        mat.m_colIndex.push_back(entries[k].first);
+        mat.m_values.push_back(entries[k].second);
+      }
+    }
+    start = end;
+  }
+  mat.m_rowStart[_rows] = mat.m_values.size();
+
+  return mat;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Builds a CSR matrix from the non zero values of a dense matrix
+/// param[in] _dense, the dense matrix
+template <typename T>
+template <size_t ROWS, size_t COLS>
+CsrMatrix<T> CsrMatrix<T>::fromDense(const Matrix<T,ROWS,COLS>& _dense)
+{
+  CsrMatrix<T> mat(ROWS,COLS);
+  const T* data = _dense.data();
+
+  for(std::size_t i = 0; i < ROWS; ++i)
+  {
+    for(std::size_t j = 0; j < COLS; ++j)
+    {
+      if(data[i*COLS+j] != T(0))
+      {
+        mat.m_colIndex.push_back(j);
+        mat.m_values.push_back(data[i*COLS+j]);
+      }
+    }
+    mat.m_rowStart[i+1] = mat.m_values.size();
+  }
+
+  return mat;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the value at (_rowID,_colID), starting at 1, using a binary search of the row
+template <typename T>
+T CsrMatrix<T>::operator()(std::size_t _rowID, std::size_t _colID) const
+{
+  if(_rowID < 1 || _rowID > m_rows)
+    throw std::out_of_range("row out of range");
+  if(_colID < 1 || _colID > m_cols)
+    throw std::out_of_range("column out of range");
+
+  std::vector<std::size_t>::const_iterator first = m_colIndex.begin() + m_rowStart[_rowID-1];
+  std::vector<std::size_t>::const_iterator last = m_colIndex.begin() + m_rowStart[_rowID];
+  std::vector<std::size_t>::const_iterator it = std::lower_bound(first,last,_colID-1);
+
+  if(it != last && *it == _colID-1)
+  {
+    return m_values[it - m_colIndex.begin()];
+  }
+
+  return T(0);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Sparse matrix-vector product y = A*x, each row is an independent dot product so rows are split across threads
+/// param[in] _x, getCols() values
+/// param[in] _y, getRows() values, overwritten
+template <typename T>
+void CsrMatrix<T>::multiply(const T* _x, T* _y) const
+{
+  // give each thread enough rows to cover MYLIB_PARALLEL_MIN_ELEMENTS values on average
+  std::size_t minRows = m_rows;
+  if(!m_values.empty())
+  {
+    minRows = std::max<std::size_t>(1,(std::size_t)((double)MYLIB_PARALLEL_MIN_ELEMENTS * m_rows / m_values.size()));
+  }
+
+  parallelFor(0,m_rows,minRows,[&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      T sum = 0;
+      for(std::size_t k = m_rowStart[i]; k < m_rowStart[i+1]; ++k)
+      {
+        sum += m_values[k] * _x[m_colIndex[k]];
+      }
+      _y[i] = sum;
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Throws if the dense matrices passed to multiply don't match the size of the sparse matrix
+template <typename T>
+void CsrMatrix<T>::sizeCheck(std::size_t _rhsRows, std::size_t _outRows, std::size_t _rhsCols, std::size_t _outCols) const
+{
+  if(_rhsRows != m_cols || _outRows != m_rows || _rhsCols != _outCols)
+  {
+    throw std::out_of_range("number of columns of matrix 1 must be equil to number of rows of matrix 2");
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Sparse times dense product Y = A*X, for a column vector this is the sparse matrix-vector product
+/// Each value of the sparse row scales a whole contiguous row of X, so the inner loop vectorises.
+/// param[in] _rhs, dense matrix with getCols() rows
+/// param[in] _out, dense matrix with getRows() rows, overwritten
+template <typename T>
+template <size_t ROWS, size_t COLS, size_t N>
+void CsrMatrix<T>::multiply(const Matrix<T,COLS,N>& _rhs, Matrix<T,ROWS,N>& _out) const
+{
+  sizeCheck(COLS,ROWS,N,N);
+
+  if(N == 1)
+  {
+    multiply(_rhs.data(),_out.data());
+    return;
+  }
+
+  const T* x = _rhs.data();
+  T* y = _out.data();
+
+  parallelFor(0,m_rows,std::max<std::size_t>(1,MYLIB_PARALLEL_MIN_ELEMENTS/(N*(nonZeros()/std::max<std::size_t>(1,m_rows)+1))),
+              [&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t i = _first; i < _last; ++i)
+    {
+      T* yRow = y + i*N;
+      std::fill(yRow,yRow+N,T(0));
+      for(std::size_t k = m_rowStart[i]; k < m_rowStart[i+1]; ++k)
+      {
+        const T a = m_values[k];
+        const T* xRow = x + m_colIndex[k]*N;
+        for(std::size_t j = 0; j < N; ++j)
+        {
+          yRow[j] += a * xRow[j];
+        }
+      }
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the transpose, found with a counting sort on the columns so it is O(non zeros + columns)
+template <typename T>
+CsrMatrix<T> CsrMatrix<T>::transpose() const
+{
+  CsrMatrix<T> result(m_cols,m_rows);
+  result.m_colIndex.resize(m_values.size());
+  result.m_values.resize(m_values.size());
+
+  for(std::size_t k = 0; k < m_colIndex.size(); ++k)
+  {
+    ++result.m_rowStart[m_colIndex[k]+1];
+  }
+  for(std::size_t j = 0; j < m_cols; ++j)
+  {
+    result.m_rowStart[j+1] += result.m_rowStart[j];
+  }
+
+  // walking rows in order keeps each transposed row sorted by column
+  std::vector<std::size_t> next(result.m_rowStart.begin(),result.m_rowStart.end()-1);
+  for(std::size_t i = 0; i < m_rows; ++i)
+  {
+    for(std::size_t k = m_rowStart[i]; k < m_rowStart[i+1]; ++k)
+    {
+      std::size_t dest = next[m_colIndex[k]]++;
+      result.m_colIndex[dest] = i;
+      result.m_values[dest] = m_values[k];
+    }
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the same matrix in compressed sparse column format
+template <typename T>
+CscMatrix<T> CsrMatrix<T>::toCsc() const
+{
+  return CscMatrix<T>(transpose());
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Copies the values into a dense matrix, which must be the same size
+template <typename T>
+template <size_t ROWS, size_t COLS>
+void CsrMatrix<T>::toDense(Matrix<T,ROWS,COLS>& _dense) const
+{
+  sizeCheck(COLS,ROWS,1,1);
+
+  T* data = _dense.data();
+  std::fill(data,data+ROWS*COLS,T(0));
+
+  for(std::size_t i = 0; i < m_rows; ++i)
+  {
+    for(std::size_t k = m_rowStart[i]; k < m_rowStart[i+1]; ++k)
+    {
+      data[i*COLS+m_colIndex[k]] = m_values[k];
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Builds a CSC matrix from triplets, duplicates are added together
+template <typename T>
+CscMatrix<T> CscMatrix<T>::fromTriplets(std::size_t _rows, std::size_t _cols, const std::vector< Triplet<T> >& _triplets)
+{
+  std::vector< Triplet<T> > swapped(_triplets);
+  for(Triplet<T>& t : swapped)
+  {
+    std::swap(t.row,t.col);
+  }
+
+  return CscMatrix<T>(CsrMatrix<T>::fromTriplets(_cols,_rows,swapped));
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Sparse matrix-vector product y = A*x, each column j adds x[j] times the column into y
+/// param[in] _x, getCols() values
+/// param[in] _y, getRows() values, overwritten
+template <typename T>
+void CscMatrix<T>::multiply(const T* _x, T* _y) const
+{
+  std::fill(_y,_y+getRows(),T(0));
+
+  const std::vector<std::size_t>& start = colStart();
+  const std::vector<std::size_t>& rows = rowIndex();
+  const std::vector<T>& vals = values();
+
+  for(std::size_t j = 0; j < getCols(); ++j)
+  {
+    const T xj = _x[j];
+    for(std::size_t k = start[j]; k < start[j+1]; ++k)
+    {
+      _y[rows[k]] += vals[k] * xj;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Builds a BSR matrix from triplets, every block with at least one triplet is stored in full
+/// param[in] _rows, number of rows, a multiple of BLOCK
+/// param[in] _cols, number of columns, a multiple of BLOCK
+/// param[in] _triplets, the (row,column,value) entries, row and column start at 1
+template <typename T, size_t BLOCK>
+BsrMatrix<T,BLOCK> BsrMatrix<T,BLOCK>::fromTriplets(std::size_t _rows, std::size_t _cols, const std::vector< Triplet<T> >& _triplets)
+{
+  if(_rows % BLOCK || _cols % BLOCK)
+  {
+    throw std::out_of_range("number of rows and columns must be a multiple of the block size");
+  }
+
+  // the block pattern is found by building a CSR matrix of blocks, each entry just counts as 1
+  std::vector< Triplet<char> > blocks;
+  blocks.reserve(_triplets.size());
+  for(const Triplet<T>& t : _triplets)
+  {
+    if(t.row < 1 || t.row > _rows || t.col < 1 || t.col > _cols)
+    {
+      throw std::out_of_range("triplet out of range");
+    }
+    Triplet<char> b = {(t.row-1)/BLOCK + 1, (t.col-1)/BLOCK + 1, 1};
+    blocks.push_back(b);
+  }
+  CsrMatrix<char> pattern = CsrMatrix<char>::fromTriplets(_rows/BLOCK,_cols/BLOCK,blocks);
+
+  BsrMatrix<T,BLOCK> mat;
+  mat.m_blockRows = _rows/BLOCK;
+  mat.m_blockCols = _cols/BLOCK;
+  mat.m_blockStart = pattern.rowStart();
+  mat.m_blockCol = pattern.colIndex();
+  mat.m_values.assign(mat.m_blockCol.size()*BLOCK*BLOCK,T(0));
+
+  for(const Triplet<T>& t : _triplets)
+  {
+    std::size_t blockRow = (t.row-1)/BLOCK;
+    std::size_t blockCol = (t.col-1)/BLOCK;
+    std::vector<std::size_t>::const_iterator first = mat.m_blockCol.begin() + mat.m_blockStart[blockRow];
+    std::vector<std::size_t>::const_iterator last = mat.m_blockCol.begin() + mat.m_blockStart[blockRow+1];
+    std::size_t block = std::lower_bound(first,last,blockCol) - mat.m_blockCol.begin();
+
+    mat.m_values[block*BLOCK*BLOCK + ((t.row-1)%BLOCK)*BLOCK + (t.col-1)%BLOCK] += t.value;
+  }
+
+  return mat;
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Returns the value at (_rowID,_colID), starting at 1
+template <typename T, size_t BLOCK>
+T BsrMatrix<T,BLOCK>::operator()(std::size_t _rowID, std::size_t _colID) const
+{
+  if(_rowID < 1 || _rowID > getRows())
+    throw std::out_of_range("row out of range");
+  if(_colID < 1 || _colID > getCols())
+    throw std::out_of_range("column out of range");
+
+  std::size_t blockRow = (_rowID-1)/BLOCK;
+  std::size_t blockCol = (_colID-1)/BLOCK;
+  std::vector<std::size_t>::const_iterator first = m_blockCol.begin() + m_blockStart[blockRow];
+  std::vector<std::size_t>::const_iterator last = m_blockCol.begin() + m_blockStart[blockRow+1];
+  std::vector<std::size_t>::const_iterator it = std::lower_bound(first,last,blockCol);
+
+  if(it != last && *it == blockCol)
+  {
+    return m_values[(it - m_blockCol.begin())*BLOCK*BLOCK + ((_rowID-1)%BLOCK)*BLOCK + (_colID-1)%BLOCK];
+  }
+
+  return T(0);
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Block sparse matrix-vector product y = A*x, each block is a small dense BLOCK x BLOCK product
+/// with a compile time size so it is fully unrolled. Block rows are split across threads.
+template <typename T, size_t BLOCK>
+void BsrMatrix<T,BLOCK>::multiply(const T* _x, T* _y) const
+{
+  std::size_t minRows = m_blockRows;
+  if(!m_blockCol.empty())
+  {
+    minRows = std::max<std::size_t>(1,(std::size_t)((double)MYLIB_PARALLEL_MIN_ELEMENTS * m_blockRows /
+                                                    (m_blockCol.size()*BLOCK*BLOCK)));
+  }
+
+  parallelFor(0,m_blockRows,minRows,[&](std::size_t _first, std::size_t _last)
+  {
+    for(std::size_t bi = _first; bi < _last; ++bi)
+    {
+      T sum[BLOCK] = {};
+      for(std::size_t k = m_blockStart[bi]; k < m_blockStart[bi+1]; ++k)
+      {
+        const T* block = &m_values[k*BLOCK*BLOCK];
+        const T* x = _x + m_blockCol[k]*BLOCK;
+        for(std::size_t r = 0; r < BLOCK; ++r)
+        {
+          for(std::size_t c = 0; c < BLOCK; ++c)
+          {
+            sum[r] += block[r*BLOCK+c] * x[c];
+          }
+        }
+      }
+      std::copy(sum,sum+BLOCK,_y + bi*BLOCK);
+    }
+  });
+}
+
+//----------------------------------------------------------------------------------------------
+/// @brief Block sparse matrix-vector product with dense column vectors
+template <typename T, size_t BLOCK>
+template <size_t ROWS, size_t COLS>
+void BsrMatrix<T,BLOCK>::multiply(const Matrix<T,COLS,1>& _rhs, Matrix<T,ROWS,1>& _out) const
+{
+  if(COLS != getCols() || ROWS != getRows())
+  {
+    throw std::out_of_range("number of columns of matrix 1 must be equil to number of rows of matrix 2");
+  }
+
+  multiply(_rhs.data(),_out.data());
+}
+
+//----------------------------------------------------------------------------------------------
+#endif // SPARSEMATRIX_H
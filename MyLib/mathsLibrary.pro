@@ -1,5 +1,5 @@
 TEMPLATE = lib
-CONFIG += console c++11
+CONFIG += console c++14
 CONFIG -= app_bundle
 CONFIG -= qt
 
@@ -8,8 +8,30 @@ CONFIG -= qt
 OBJECTS_DIR = $$PWD/obj
 
 HEADERS += \
+    $$PWD/include/arena.h \
+    $$PWD/include/complexMatrix.h \
+    $$PWD/include/distributedMatrix.h \
+    $$PWD/include/dualQuaternion.h \
+    $$PWD/include/iterativeSolvers.h \
+    $$PWD/include/largeAllocation.h \
+    $$PWD/include/mappedMatrix.h \
     $$PWD/include/matrix.h \
-    $$PWD/include/quaternion.h
+    $$PWD/include/matrixBlas.h \
+    $$PWD/include/matrixChain.h \
+    $$PWD/include/matrixFunctions.h \
+    $$PWD/include/matrixMap.h \
+    $$PWD/include/matrixReductions.h \
+    $$PWD/include/matrixTranspose.h \
+    $$PWD/include/parallel.h \
+    $$PWD/include/quaternion.h \
+    $$PWD/include/quaternionArray.h \
+    $$PWD/include/quaternionBatch.h \
+    $$PWD/include/quaternionCompression.h \
+    $$PWD/include/quaternionSpline.h \
+    $$PWD/include/reducedPrecision.h \
+    $$PWD/include/sharedMatrix.h \
+    $$PWD/include/simdFloat.h \
+    $$PWD/include/sparseMatrix.h
 
 TARGET=$$PWD/lib/myLib
 